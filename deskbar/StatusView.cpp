@@ -46,6 +46,7 @@ All rights reserved.
 
 #include <Debug.h>
 #include <Application.h>
+#include <Autolock.h>
 #include <Beep.h>
 #include <Directory.h>
 #include <FindDirectory.h>
@@ -109,6 +110,355 @@ DumpList(BList *itemlist)
 		DumpItem(item);
 	}
 }
+
+
+//	loads the add-on image and archives the view it hands out;
+//	safe to call from any thread, the result gets added to the
+//	shelf by the tray itself
+
+static status_t
+InstantiateAddOn(BEntry *entry, uint64 securityCode, bool force,
+	BMessage *archive, BString *name, image_id *_image)
+{
+	if (!force) {
+		BNode node(entry);
+		status_t error = node.InitCheck();
+		if (error != B_OK)
+			return error;
+
+		uint64 deskbarID;
+		ssize_t size = node.ReadAttr(kDeskbarSecurityCodeAttr, B_UINT64_TYPE, 0,
+			&deskbarID, sizeof(securityCode));
+		if (size != sizeof(securityCode) || deskbarID != securityCode) {
+			// no code or code doesn't match
+			return B_ERROR;
+		}
+	}
+
+	BPath path;
+	entry->GetPath(&path);
+
+	//	load the add-on
+	image_id image = load_add_on(path.Path());
+	if (image < 0)
+		return (status_t)image;
+
+	// 	get the view loading function symbol		
+	//    we first look for a symbol that takes an image_id
+	//    and entry_ref pointer, if not found, go with normal
+	//    instantiate function
+	BView *(*entryFunction)(image_id, const entry_ref *);
+	BView *(*itemFunction)(void);
+	BView *view = NULL;
+
+	entry_ref ref;
+	entry->GetRef(&ref);
+
+	if (get_image_symbol(image, kInstantiateEntryCFunctionName,
+		B_SYMBOL_TYPE_TEXT, (void **)&entryFunction) >= 0) {
+
+		view = (*entryFunction)(image, &ref);
+	} else if (get_image_symbol(image, kInstantiateItemCFunctionName,
+		B_SYMBOL_TYPE_TEXT, (void **)&itemFunction) >= 0) {
+
+		view = (*itemFunction)();
+	} else {
+		unload_add_on(image);
+		return B_ERROR;
+	}
+
+	if (!view) {
+		unload_add_on(image);
+		return B_ERROR;
+	}
+
+	view->Archive(archive);
+	*name = view->Name();
+	delete view;
+
+	*_image = image;
+	return B_OK;
+}
+
+
+const uint32 kMsgAddOnFound = 'AOfd';
+const uint32 kMsgAddOnLoaded = 'AOld';
+const uint32 kMsgAddOnLoaderDone = 'AOdn';
+
+const int32 kMaxAddOnLoadThreads = 4;
+const bigtime_t kAddOnPostTimeout = 100000;
+
+
+//	Runs the add-on queries for a set of volumes and loads the add-ons
+//	it finds on a few threads in parallel, so that neither a slow query
+//	nor a slow add-on holds up the Deskbar window.
+//	Every add-on found is announced to the tray first (kMsgAddOnFound),
+//	so that it can keep its place in line, then its image is loaded and
+//	the archived view is posted back (kMsgAddOnLoaded).
+
+struct AddOnJob {
+	entry_ref ref;
+	int32 sequence;
+};
+
+class TAddOnLoader {
+public:
+	TAddOnLoader(BHandler *target, uint64 securityCode);
+	~TAddOnLoader();
+
+	void AddVolume(dev_t device, bool createIndex);
+	void Start();
+
+private:
+	static int32 ScanEntry(void *);
+	static int32 LoadEntry(void *);
+	void Scan();
+	void Load();
+
+	status_t Post(BMessage *);
+
+	BMessenger fTarget;
+	uint64 fSecurityCode;
+	BList fDevices;
+	bool fCreateIndex;
+
+	BLocker fLock;
+	BList fJobs;
+	sem_id fJobSem;
+	bool fScanDone;
+	volatile bool fQuitting;
+
+	thread_id fScanThread;
+	thread_id fLoadThreads[kMaxAddOnLoadThreads];
+	int32 fLoadThreadCount;
+	int32 fRunningLoadThreads;
+};
+
+
+TAddOnLoader::TAddOnLoader(BHandler *target, uint64 securityCode)
+	:	fTarget(target),
+		fSecurityCode(securityCode),
+		fCreateIndex(false),
+		fLock("add-on loader"),
+		fJobSem(create_sem(0, "add-on jobs")),
+		fScanDone(false),
+		fQuitting(false),
+		fScanThread(-1),
+		fLoadThreadCount(0),
+		fRunningLoadThreads(0)
+{
+}
+
+
+TAddOnLoader::~TAddOnLoader()
+{
+	fQuitting = true;
+
+	// wakes up the load threads waiting for jobs
+	delete_sem(fJobSem);
+
+	status_t result;
+	if (fScanThread >= 0)
+		wait_for_thread(fScanThread, &result);
+
+	for (int32 i = 0; i < fLoadThreadCount; i++)
+		wait_for_thread(fLoadThreads[i], &result);
+
+	for (int32 i = fJobs.CountItems(); i-- > 0;)
+		delete (AddOnJob *)fJobs.ItemAt(i);
+}
+
+
+void
+TAddOnLoader::AddVolume(dev_t device, bool createIndex)
+{
+	fDevices.AddItem((void *)device);
+	if (createIndex)
+		fCreateIndex = true;
+}
+
+
+void
+TAddOnLoader::Start()
+{
+	system_info info;
+	get_system_info(&info);
+
+	int32 count = info.cpu_count + 1;
+	if (count > kMaxAddOnLoadThreads)
+		count = kMaxAddOnLoadThreads;
+
+	for (int32 i = 0; i < count; i++) {
+		fLoadThreads[i] = spawn_thread(&TAddOnLoader::LoadEntry,
+			"add-on loader", B_NORMAL_PRIORITY, this);
+		if (fLoadThreads[i] < B_OK)
+			break;
+
+		fLoadThreadCount++;
+		atomic_add(&fRunningLoadThreads, 1);
+		resume_thread(fLoadThreads[i]);
+	}
+
+	if (fLoadThreadCount == 0)
+		return;
+
+	fScanThread = spawn_thread(&TAddOnLoader::ScanEntry, "add-on scanner",
+		B_NORMAL_PRIORITY, this);
+	if (fScanThread >= B_OK)
+		resume_thread(fScanThread);
+	else {
+		// nothing to load, just let the load threads go
+		fLock.Lock();
+		fScanDone = true;
+		fLock.Unlock();
+		release_sem_etc(fJobSem, fLoadThreadCount, 0);
+	}
+}
+
+
+int32
+TAddOnLoader::ScanEntry(void *castToLoader)
+{
+	TAddOnLoader *self = (TAddOnLoader *)castToLoader;
+	self->Scan();
+	return 0;
+}
+
+
+int32
+TAddOnLoader::LoadEntry(void *castToLoader)
+{
+	TAddOnLoader *self = (TAddOnLoader *)castToLoader;
+	self->Load();
+	return 0;
+}
+
+
+status_t
+TAddOnLoader::Post(BMessage *message)
+{
+	// don't block forever on a full window port, the window may be
+	// waiting for us to quit
+	for (;;) {
+		status_t result = fTarget.SendMessage(message, (BHandler *)NULL,
+			kAddOnPostTimeout);
+		if (result != B_TIMED_OUT || fQuitting)
+			return result;
+	}
+}
+
+
+void
+TAddOnLoader::Scan()
+{
+	int32 sequence = 0;
+
+	for (int32 index = 0; !fQuitting && index < fDevices.CountItems(); index++) {
+		dev_t device = (dev_t)fDevices.ItemAt(index);
+		if (fCreateIndex)
+			fs_create_index(device, kStatusPredicate, B_STRING_TYPE, 0);
+
+		// Since the new BFS supports querying for attributes without
+		// an index, we only run the query if the index exists (for
+		// newly mounted devices only - the Deskbar will automatically
+		// create an index for every device mounted at startup).
+		BVolume volume(device);
+		index_info info;
+		if (!volume.KnowsQuery()
+			|| fs_stat_index(device, kStatusPredicate, &info) != 0)
+			continue;
+
+		BQuery query;
+		query.SetVolume(&volume);
+		query.SetPredicate(kEnabledPredicate);
+		query.Fetch();
+
+		entry_ref ref;
+		while (!fQuitting && query.GetNextRef(&ref) == B_OK) {
+			// reserve the add-on's place in the tray before anybody
+			// gets to load it
+			BMessage message(kMsgAddOnFound);
+			message.AddPointer("loader", this);
+			message.AddInt32("sequence", sequence);
+			message.AddRef("ref", &ref);
+			if (Post(&message) != B_OK)
+				break;
+
+			AddOnJob *job = new AddOnJob;
+			job->ref = ref;
+			job->sequence = sequence++;
+
+			fLock.Lock();
+			fJobs.AddItem(job);
+			fLock.Unlock();
+			release_sem(fJobSem);
+		}
+	}
+
+	fLock.Lock();
+	fScanDone = true;
+	fLock.Unlock();
+
+	// wake up all the load threads so that they notice we are done
+	release_sem_etc(fJobSem, fLoadThreadCount, 0);
+}
+
+
+void
+TAddOnLoader::Load()
+{
+	while (!fQuitting) {
+		if (acquire_sem(fJobSem) != B_OK)
+			break;
+
+		fLock.Lock();
+		AddOnJob *job = (AddOnJob *)fJobs.RemoveItem(0L);
+		bool done = job == NULL && fScanDone;
+		fLock.Unlock();
+
+		if (done)
+			break;
+		if (job == NULL)
+			continue;
+
+		BMessage message(kMsgAddOnLoaded);
+		message.AddPointer("loader", this);
+		message.AddInt32("sequence", job->sequence);
+
+		BEntry entry(&job->ref);
+		BMessage archive;
+		BString name;
+		image_id image = -1;
+		if (!fQuitting && InstantiateAddOn(&entry, fSecurityCode, false,
+				&archive, &name, &image) == B_OK) {
+			message.AddMessage("archive", &archive);
+			message.AddString("name", name.String());
+			message.AddInt32("image", image);
+		}
+		delete job;
+
+		if (Post(&message) != B_OK && image >= 0)
+			unload_add_on(image);
+	}
+
+	// the last one out tells the tray that it can get rid of us
+	if (atomic_add(&fRunningLoadThreads, -1) == 1 && !fQuitting) {
+		BMessage message(kMsgAddOnLoaderDone);
+		message.AddPointer("loader", this);
+		Post(&message);
+	}
+}
+
+
+struct PendingAddOn {
+	TAddOnLoader *loader;
+	int32 sequence;
+	entry_ref ref;
+	BMessage *archive;
+	BString name;
+	image_id image;
+	bool loaded;
+};
 #endif	/* DB_ADDONS */
 
 
@@ -372,6 +722,18 @@ TReplicantTray::MessageReceived(BMessage *message)
 		case B_QUERY_UPDATE:
 			HandleEntryUpdate(message);
 			break;
+
+		case kMsgAddOnFound:
+			AddOnFound(message);
+			break;
+
+		case kMsgAddOnLoaded:
+			AddOnLoaded(message);
+			break;
+
+		case kMsgAddOnLoaderDone:
+			AddOnLoaderDone(message);
+			break;
 #endif
 
 		default:
@@ -479,12 +841,16 @@ TReplicantTray::InitAddOnSupport()
 	
 	//	for each volume currently mounted
 	//		index the volume with our indices
+	//	the queries and the add-on loading are done in the background,
+	//	the add-ons show up in the tray as they get loaded
+	TAddOnLoader *loader = new TAddOnLoader(this, fDeskbarSecurityCode);
 	BVolumeRoster roster;
 	BVolume volume;
-	while (roster.GetNextVolume(&volume) == B_OK) {
-		fs_create_index(volume.Device(), kStatusPredicate, B_STRING_TYPE, 0);
-		RunAddOnQuery(&volume, kEnabledPredicate);
-	}
+	while (roster.GetNextVolume(&volume) == B_OK)
+		loader->AddVolume(volume.Device(), true);
+
+	fAddOnLoaders.AddItem(loader);
+	loader->Start();
 
 	//	we also watch for volumes mounted and unmounted
 	watch_node(NULL, B_WATCH_MOUNT | B_WATCH_ATTR, this, Window());
@@ -494,6 +860,20 @@ TReplicantTray::InitAddOnSupport()
 void
 TReplicantTray::DeleteAddOnSupport()
 {
+	//	stop the loaders first, they may still be posting add-ons to us
+	for (int32 i = fAddOnLoaders.CountItems(); i-- > 0 ;)
+		delete (TAddOnLoader *)fAddOnLoaders.ItemAt(i);
+	fAddOnLoaders.MakeEmpty();
+
+	for (int32 i = fPendingAddOns.CountItems(); i-- > 0 ;) {
+		PendingAddOn *pending = (PendingAddOn *)fPendingAddOns.ItemAt(i);
+		if (pending->image >= 0)
+			unload_add_on(pending->image);
+		delete pending->archive;
+		delete pending;
+	}
+	fPendingAddOns.MakeEmpty();
+
 	for (int32 i = fItemList->CountItems(); i-- > 0 ;) {
 		DeskbarItemInfo *item = (DeskbarItemInfo *)fItemList->RemoveItem(i);
 		if (item) {
@@ -504,6 +884,8 @@ TReplicantTray::DeleteAddOnSupport()
 		}
 	}
 	delete fItemList;
+	fItemsByID.clear();
+	fItemsByNode.clear();
 
 	//	stop the volume mount/unmount watch
 	stop_watching(this, Window());
@@ -511,30 +893,120 @@ TReplicantTray::DeleteAddOnSupport()
 
 
 void
-TReplicantTray::RunAddOnQuery(BVolume *volume, const char *predicate)
-{
-	// Since the new BFS supports querying for attributes without
-	// an index, we only run the query if the index exists (for
-	// newly mounted devices only - the Deskbar will automatically
-	// create an index for every device mounted at startup).
-	index_info info;
-	if (!volume->KnowsQuery() || fs_stat_index(volume->Device(),kStatusPredicate,&info) != 0)
+TReplicantTray::RunAddOnQuery(dev_t device, bool createIndex)
+{
+	// run a new query on a specific volume, in the background
+	TAddOnLoader *loader = new TAddOnLoader(this, fDeskbarSecurityCode);
+	loader->AddVolume(device, createIndex);
+
+	fAddOnLoaders.AddItem(loader);
+	loader->Start();
+}
+
+
+void
+TReplicantTray::AddOnFound(BMessage *message)
+{
+	//	reserve a place for the add-on, it will be added once it and
+	//	all the ones found before it are loaded
+	PendingAddOn *pending = new PendingAddOn;
+	if (message->FindPointer("loader", (void **)&pending->loader) != B_OK
+		|| message->FindInt32("sequence", &pending->sequence) != B_OK
+		|| message->FindRef("ref", &pending->ref) != B_OK) {
+		delete pending;
+		return;
+	}
+
+	pending->archive = NULL;
+	pending->image = -1;
+	pending->loaded = false;
+
+	fPendingAddOns.AddItem(pending);
+}
+
+
+void
+TReplicantTray::AddOnLoaded(BMessage *message)
+{
+	TAddOnLoader *loader;
+	int32 sequence;
+	if (message->FindPointer("loader", (void **)&loader) != B_OK
+		|| message->FindInt32("sequence", &sequence) != B_OK)
+		return;
+
+	PendingAddOn *pending = NULL;
+	for (int32 i = 0; i < fPendingAddOns.CountItems(); i++) {
+		PendingAddOn *item = (PendingAddOn *)fPendingAddOns.ItemAt(i);
+		if (item->loader == loader && item->sequence == sequence) {
+			pending = item;
+			break;
+		}
+	}
+
+	image_id image;
+	if (message->FindInt32("image", &image) != B_OK)
+		image = -1;
+
+	if (pending == NULL) {
+		if (image >= 0)
+			unload_add_on(image);
+		return;
+	}
+
+	BMessage archive;
+	const char *name;
+	if (image >= 0 && message->FindMessage("archive", &archive) == B_OK
+		&& message->FindString("name", &name) == B_OK) {
+		pending->archive = new BMessage(archive);
+		pending->name = name;
+		pending->image = image;
+	} else if (image >= 0)
+		unload_add_on(image);
+
+	pending->loaded = true;
+	AddPendingAddOns();
+}
+
+
+void
+TReplicantTray::AddOnLoaderDone(BMessage *message)
+{
+	TAddOnLoader *loader;
+	if (message->FindPointer("loader", (void **)&loader) != B_OK
+		|| !fAddOnLoaders.RemoveItem(loader))
 		return;
 
-	// run a new query on a specific volume
-	// make it live
-	BQuery query;
-	query.SetVolume(volume);
-	query.SetPredicate(predicate);
-	query.Fetch();
+	//	anything from this loader still waiting will never show up
+	for (int32 i = 0; i < fPendingAddOns.CountItems(); i++) {
+		PendingAddOn *pending = (PendingAddOn *)fPendingAddOns.ItemAt(i);
+		if (pending->loader == loader)
+			pending->loaded = true;
+	}
 
-	int32 id;
-	BEntry entry;
-	while (query.GetNextEntry(&entry) == B_OK) 
-		//	scan any entries returned
-		//	attempt to load them as add-ons
-		//	collisions are handled in LoadAddOn
-		LoadAddOn(&entry, &id);
+	delete loader;
+	AddPendingAddOns();
+}
+
+
+void
+TReplicantTray::AddPendingAddOns()
+{
+	for (;;) {
+		PendingAddOn *pending = (PendingAddOn *)fPendingAddOns.FirstItem();
+		if (pending == NULL || !pending->loaded)
+			break;
+
+		fPendingAddOns.RemoveItem(0L);
+
+		if (pending->archive != NULL) {
+			int32 id;
+			AddLoadedAddOn(pending->archive, pending->name.String(),
+				pending->image, &pending->ref, &id);
+		}
+
+		delete pending->archive;
+		delete pending;
+	}
 }
 
 
@@ -552,32 +1024,22 @@ TReplicantTray::IsAddOn(entry_ref &ref)
 DeskbarItemInfo *
 TReplicantTray::DeskbarItemFor(node_ref &nodeRef)
 {
-	for (int32 i = fItemList->CountItems(); i-- > 0 ;) {
-		DeskbarItemInfo *item = static_cast<DeskbarItemInfo *>(fItemList->ItemAt(i));
-		if (item == NULL)
-			continue;
+	ItemNodeMap::iterator found = fItemsByNode.find(nodeRef);
+	if (found == fItemsByNode.end())
+		return NULL;
 
-		if (item->nodeRef == nodeRef)
-			return item;
-	}
-
-	return NULL;
+	return found->second;
 }
 
 
 DeskbarItemInfo *
 TReplicantTray::DeskbarItemFor(int32 id)
 {
-	for (int32 i = fItemList->CountItems(); i-- > 0 ;) {
-		DeskbarItemInfo *item = static_cast<DeskbarItemInfo *>(fItemList->ItemAt(i));
-		if (item == NULL)
-			continue;
+	ItemIDMap::iterator found = fItemsByID.find(id);
+	if (found == fItemsByID.end())
+		return NULL;
 
-		if (item->id == id)
-			return item;
-	}
-
-	return NULL;
+	return found->second;
 }
 
 
@@ -706,7 +1168,7 @@ TReplicantTray::HandleEntryUpdate(BMessage *message)
 				if (message->FindInt32("new device", &device) != B_OK)
 					break;
 
-				RunAddOnQuery(new BVolume(device), kEnabledPredicate);
+				RunAddOnQuery(device, false);
 			}
 			break;
 		case B_DEVICE_UNMOUNTED:
@@ -742,64 +1204,41 @@ TReplicantTray::LoadAddOn(BEntry *entry, int32 *id, bool force)
 	if (NodeExists(nodeRef))
 		return B_ERROR;
 
-	BNode node(entry);
-	if (!force) {
-		status_t error = node.InitCheck();
-		if (error != B_OK)
-			return error;
-
-		uint64 deskbarID;
-		ssize_t size = node.ReadAttr(kDeskbarSecurityCodeAttr, B_UINT64_TYPE, 0,
-			&deskbarID, sizeof(fDeskbarSecurityCode));
-		if (size != sizeof(fDeskbarSecurityCode) || deskbarID != fDeskbarSecurityCode) {
-			// no code or code doesn't match
-			return B_ERROR;
-		}
-	}
-
-	BPath path;
-	entry->GetPath(&path);
-
-	//	load the add-on
-	image_id image = load_add_on(path.Path());
-	if (image < 0)
-		return (status_t)image;
-
-	// 	get the view loading function symbol		
-	//    we first look for a symbol that takes an image_id
-	//    and entry_ref pointer, if not found, go with normal
-	//    instantiate function
-	BView *(*entryFunction)(image_id, const entry_ref *);
-	BView *(*itemFunction)(void);
-	BView *view = NULL;
+	BMessage archive;
+	BString name;
+	image_id image;
+	status_t result = InstantiateAddOn(entry, fDeskbarSecurityCode, force,
+		&archive, &name, &image);
+	if (result != B_OK)
+		return result;
 
 	entry_ref ref;
 	entry->GetRef(&ref);
 
-	if (get_image_symbol(image, kInstantiateEntryCFunctionName,
-		B_SYMBOL_TYPE_TEXT, (void **)&entryFunction) >= 0) {
+	return AddLoadedAddOn(&archive, name.String(), image, &ref, id);
+}
 
-		view = (*entryFunction)(image, &ref);
-	} else if (get_image_symbol(image, kInstantiateItemCFunctionName,
-		B_SYMBOL_TYPE_TEXT, (void **)&itemFunction) >= 0) {
 
-		view = (*itemFunction)();
-	} else {
-		unload_add_on(image);
-		return B_ERROR;
-	}
+//	adds the archived view of an add-on loaded by InstantiateAddOn
+//	to the shelf, takes care of unloading the image if that fails
 
-	if (!view || IconExists(view->Name())) {
-		delete view;
+status_t
+TReplicantTray::AddLoadedAddOn(BMessage *archive, const char *name,
+	image_id image, const entry_ref *ref, int32 *id)
+{
+	BNode node(ref);
+	node_ref nodeRef;
+	node.GetNodeRef(&nodeRef);
+
+	//	no duplicates; the add-on may have been added while it was
+	//	being loaded
+	if (NodeExists(nodeRef) || IconExists(name)) {
 		unload_add_on(image);
 		return B_ERROR;
 	}
 
-	BMessage *data = new BMessage;
-	view->Archive(data);
-	delete view;
-
-	AddIcon(data, id, &ref);
+	BMessage *data = new BMessage(*archive);
+	AddIcon(data, id, ref);
 		// add the rep; adds info to list
 
 	node.WriteAttr(kDeskbarSecurityCodeAttr, B_UINT64_TYPE, 0,
@@ -827,6 +1266,8 @@ TReplicantTray::AddItem(int32 id, node_ref nodeRef, BEntry &entry, bool isAddOn)
 	item->nodeRef = nodeRef;
 
 	fItemList->AddItem(item);
+	fItemsByID[id] = item;
+	fItemsByNode[nodeRef] = item;
 
 	if (isAddOn)
 		watch_node(&nodeRef, B_WATCH_NAME | B_WATCH_ATTR, this, Window());
@@ -878,6 +1319,23 @@ TReplicantTray::RemoveItem(int32 id)
 	}
 
 	fItemList->RemoveItem(item);
+	fItemsByID.erase(item->id);
+
+	ItemNodeMap::iterator found = fItemsByNode.find(item->nodeRef);
+	if (found != fItemsByNode.end() && found->second == item) {
+		fItemsByNode.erase(found);
+
+		//	the same node may have been added more than once, fall back
+		//	to the most recent of the others
+		for (int32 i = fItemList->CountItems(); i-- > 0 ;) {
+			DeskbarItemInfo *other = (DeskbarItemInfo *)fItemList->ItemAt(i);
+			if (other->nodeRef == item->nodeRef) {
+				fItemsByNode[other->nodeRef] = other;
+				break;
+			}
+		}
+	}
+
 	delete item;			
 }
 
@@ -1038,6 +1496,8 @@ TReplicantTray::AddIcon(BMessage *icon, int32 *id, const entry_ref *addOn)
 	int32 count = fShelf->CountReplicants();
 	BView *view;
 	fShelf->ReplicantAt(count-1, &view, (uint32 *)id, NULL);
+	if (view)
+		IndexIcon(view, *id);
 	
 	//	add the item to the add-on list
 	entry_ref ref;
@@ -1137,16 +1597,33 @@ TReplicantTray::ViewAt(int32 *index, int32 *id, int32 target, bool byIndex)
 				return view;
 			}
 		}
-	} else {
-		int32 count = fShelf->CountReplicants()-1;
-		int32 localid;
-		for (int32 repIndex = count ; repIndex >= 0 ; repIndex--) {
-			fShelf->ReplicantAt(repIndex, &view, (uint32 *)&localid);
-			if (localid == target && view) {
-				*index = repIndex;
-				*id = localid;
-				return view;
-			}
+		return NULL;
+	}
+
+	IconIDMap::iterator found = fIconsByID.find(target);
+	if (found != fIconsByID.end()) {
+		//	make sure the replicant is still around
+		int32 repIndex = fShelf->IndexOf(found->second);
+		uint32 localid;
+		if (repIndex >= 0 && fShelf->ReplicantAt(repIndex, &view, &localid)
+			&& view == found->second && (int32)localid == target) {
+			*index = repIndex;
+			*id = target;
+			return view;
+		}
+		fIconsByID.erase(found);
+	}
+
+	//	not indexed yet (added to the shelf directly), go look for it
+	int32 count = fShelf->CountReplicants()-1;
+	int32 localid;
+	for (int32 repIndex = count ; repIndex >= 0 ; repIndex--) {
+		fShelf->ReplicantAt(repIndex, &view, (uint32 *)&localid);
+		if (localid == target && view) {
+			*index = repIndex;
+			*id = localid;
+			IndexIcon(view, localid);
+			return view;
 		}
 	}
 	
@@ -1163,19 +1640,68 @@ TReplicantTray::ViewAt(int32 *index, int32 *id, const char *name)
 	*id = -1;
 	
 	BView *view;
+	IconNameMap::iterator found = fIconsByName.find(name);
+	if (found != fIconsByName.end()) {
+		view = ViewAt(index, id, found->second, false);
+		if (view && view->Name() && strcmp(name, view->Name()) == 0)
+			return view;
+
+		//	renamed or gone
+		*index = -1;
+		*id = -1;
+		fIconsByName.erase(name);
+	}
+
 	int32 count = fShelf->CountReplicants()-1;
 	for (int32 repIndex = count ; repIndex >= 0 ; repIndex--) {
 		fShelf->ReplicantAt(repIndex, &view, (uint32 *)id);
 		if (view && view->Name() && strcmp(name, view->Name()) == 0) {
 			*index = repIndex;
+			IndexIcon(view, *id);
 			return view;
 		}
 	}
 	
+	*id = -1;
 	return NULL;
 }
 
 
+void
+TReplicantTray::IndexIcon(BView *view, int32 id)
+{
+	fIconsByID[id] = view;
+	if (view->Name())
+		fIconsByName[view->Name()] = id;
+}
+
+
+//	called by the shelf for every replicant going away, no matter
+//	who removed it
+
+void
+TReplicantTray::UnindexIcon(const BView *view)
+{
+	for (IconIDMap::iterator iterator = fIconsByID.begin();
+			iterator != fIconsByID.end(); iterator++) {
+		if (iterator->second != view)
+			continue;
+
+		int32 id = iterator->first;
+		fIconsByID.erase(iterator);
+
+		for (IconNameMap::iterator name = fIconsByName.begin();
+				name != fIconsByName.end(); name++) {
+			if (name->second == id) {
+				fIconsByName.erase(name);
+				break;
+			}
+		}
+		break;
+	}
+}
+
+
 // 	Shelf will call to determine where and if
 //	the replicant is to be added
 bool
@@ -39,8 +39,11 @@ All rights reserved.
 #include <Node.h>
 #include <Query.h>
 #include <Shelf.h>
+#include <String.h>
 #include <View.h>
 
+#include <map>
+
 #include "BarView.h"
 #include "TimeView.h"
 
@@ -68,6 +71,8 @@ struct DeskbarItemInfo {
 	entry_ref entryRef;	// entry_ref to item tagged
 	node_ref nodeRef;	// node_ref to boot vol item
 };
+
+class TAddOnLoader;
 #endif
 
 class TReplicantTray : public BView {
@@ -126,12 +131,22 @@ private:
 	BView *ViewAt(int32 *index, int32 *id, int32 target, bool byIndex = false);
 	BView *ViewAt(int32 *index, int32 *id, const char *name);
 
+	void IndexIcon(BView *view, int32 id);
+	void UnindexIcon(const BView *view);
+
 	void RealReplicantAdjustment(int32 startindex);
 
 #ifdef DB_ADDONS
 	void InitAddOnSupport();
 	void DeleteAddOnSupport();
-	void RunAddOnQuery(BVolume *volume, const char *predicated);
+	void RunAddOnQuery(dev_t device, bool createIndex);
+
+	void AddOnFound(BMessage *);
+	void AddOnLoaded(BMessage *);
+	void AddOnLoaderDone(BMessage *);
+	void AddPendingAddOns();
+	status_t AddLoadedAddOn(BMessage *archive, const char *name,
+		image_id image, const entry_ref *ref, int32 *id);
 
 	bool IsAddOn(entry_ref &ref);
 	DeskbarItemInfo *DeskbarItemFor(node_ref &nodeRef);
@@ -152,6 +167,9 @@ private:
 	
 	friend class TReplicantShelf;
 
+	typedef std::map<int32, BView *> IconIDMap;
+	typedef std::map<BString, int32> IconNameMap;
+
 	TTimeView *fClock;
 	TBarView *fBarView;
 	TReplicantShelf *fShelf;
@@ -159,9 +177,31 @@ private:
 	bool fMultiRowMode;
 	
 	bool fAlignmentSupport;		
+
+	IconIDMap fIconsByID;
+	IconNameMap fIconsByName;
+		// lookup caches for ViewAt, checked against the shelf on every
+		// hit since the shelf can lose replicants behind our back
+
 #ifdef DB_ADDONS
+	struct NodeRefLess {
+		bool operator()(const node_ref &a, const node_ref &b) const
+			{ return a.device < b.device
+				|| (a.device == b.device && a.node < b.node); }
+	};
+
+	typedef std::map<int32, DeskbarItemInfo *> ItemIDMap;
+	typedef std::map<node_ref, DeskbarItemInfo *, NodeRefLess> ItemNodeMap;
+
 	BList *fItemList;
+	ItemIDMap fItemsByID;
+	ItemNodeMap fItemsByNode;
 	uint64 fDeskbarSecurityCode;
+
+	BList fAddOnLoaders;
+	BList fPendingAddOns;
+		// add-ons found by the loaders, in the order they were found; they
+		// get added to the shelf in that order as soon as they are loaded
 #endif
 
 };
@@ -127,6 +127,7 @@ TReplicantShelf::AdjustReplicantBy(BRect frame, BMessage *message) const
 //	thus, this returns the wrong number of replicants.
 //
 void
-TReplicantShelf::ReplicantDeleted(int32, const BMessage*, const BView*)
+TReplicantShelf::ReplicantDeleted(int32, const BMessage*, const BView* view)
 {
+	fParent->UnindexIcon(view);
 }
@@ -144,6 +144,133 @@ TTeamGroup::Draw(BView *view, BRect bounds, bool main)
 }
 
 
+//	#pragma mark -
+
+
+TWindowListProvider::~TWindowListProvider()
+{
+}
+
+
+int32 *
+TServerWindowListProvider::GetTokenList(int32 *count)
+{
+	return get_token_list(-1, count);
+}
+
+
+window_info *
+TServerWindowListProvider::GetWindowInfo(int32 token)
+{
+	return get_window_info(token);
+}
+
+
+//	#pragma mark -
+
+
+TWindowList::TWindowList(TWindowListProvider *provider)
+	:	fProvider(provider),
+		fWindows(20),
+		fGroupWindows(10),
+		fValid(false)
+{
+}
+
+
+TWindowList::~TWindowList()
+{
+	MakeEmpty();
+}
+
+
+void
+TWindowList::MakeEmpty()
+{
+	for (int32 i = fGroupWindows.CountItems(); i-- > 0;)
+		delete (BList *)fGroupWindows.ItemAt(i);
+	fGroupWindows.MakeEmpty();
+
+	for (int32 i = fWindows.CountItems(); i-- > 0;)
+		free(fWindows.ItemAt(i));
+	fWindows.MakeEmpty();
+
+	fValid = false;
+}
+
+
+bool
+TWindowList::Update(const BList *groupList)
+{
+	MakeEmpty();
+
+	int32 tokenCount;
+	int32 *tokens = fProvider->GetTokenList(&tokenCount);
+	if (!tokens)
+		return false;
+
+	int32 groupCount = groupList->CountItems();
+	for (int32 index = 0; index < groupCount; index++)
+		fGroupWindows.AddItem(new BList(4));
+
+	for (int32 i = 0; i < tokenCount; i++) {
+		window_info	*windowInfo = fProvider->GetWindowInfo(tokens[i]);
+		if (!windowInfo)
+			// that window probably closed, just go to the next one
+			continue;
+
+		fWindows.AddItem(windowInfo);
+
+		// skip hidden/special windows
+		if (!IsWindowOK(windowInfo))
+			continue;
+
+		// a team belongs to at most one group (multiple-launch apps
+		// put several teams into the same one)
+		for (int32 index = 0; index < groupCount; index++) {
+			TTeamGroup *teamGroup = (TTeamGroup *)groupList->ItemAt(index);
+			if (teamGroup->TeamList()->HasItem((void *)windowInfo->team)) {
+				((BList *)fGroupWindows.ItemAt(index))->AddItem(windowInfo);
+				break;
+			}
+		}
+	}
+
+	free(tokens);
+	fValid = true;
+	return true;
+}
+
+
+int32
+TWindowList::CountGroupWindows(int32 groupIndex) const
+{
+	BList *windows = (BList *)fGroupWindows.ItemAt(groupIndex);
+	return windows ? windows->CountItems() : 0;
+}
+
+
+const window_info *
+TWindowList::GroupWindowAt(int32 groupIndex, int32 windowIndex) const
+{
+	BList *windows = (BList *)fGroupWindows.ItemAt(groupIndex);
+	return windows ? (const window_info *)windows->ItemAt(windowIndex) : NULL;
+}
+
+
+bool
+TWindowList::WindowExists(int32 token)
+{
+	// asks the provider directly, the snapshot may be stale
+	window_info	*windowInfo = fProvider->GetWindowInfo(token);
+	if (!windowInfo)
+		return false;
+
+	free(windowInfo);
+	return true;
+}
+
+
 //	#pragma mark -
 
 const int32 kHorizontalMargin = 11;
@@ -157,7 +284,7 @@ const int32 kScrollStep = kSlotSize / 2;
 const int32 kNumSlots = 7;
 const int32 kCenterSlot = 3;
 
-TSwitchMgr::TSwitchMgr(BPoint point)
+TSwitchMgr::TSwitchMgr(BPoint point, TWindowListProvider *provider)
 	:	BHandler("SwitchMgr"),
 		fMainMonitor(create_sem(1, "main_monitor")),
 		fBlock(false),
@@ -166,7 +293,10 @@ TSwitchMgr::TSwitchMgr(BPoint point)
 		fCurIndex(0),
 		fCurSlot(0),
 		fWindowID(-1),
-		fLastActivity(0)
+		fLastActivity(0),
+		fWindowListProvider(provider ? provider
+			: new TServerWindowListProvider()),
+		fWindowList(fWindowListProvider)
 {
 	BRect rect(point.x, point.y,
 		point.x + (kSlotSize * kNumSlots) - 1 + (2 * kHorizontalMargin),
@@ -204,6 +334,9 @@ TSwitchMgr::~TSwitchMgr()
 		TTeamGroup *teamInfo = static_cast<TTeamGroup *>(fGroupList.ItemAt(i));
 		delete teamInfo;
 	}
+
+	fWindowList.MakeEmpty();
+	delete fWindowListProvider;
 }
 
 
@@ -223,6 +356,7 @@ TSwitchMgr::MessageReceived(BMessage *message)
 				while ((tinfo = (TTeamGroup *) fGroupList.ItemAt(i)) != NULL) {
 					if (tinfo->TeamList()->HasItem((void *)teamID)) {
 						fGroupList.RemoveItem(i);
+						InvalidateWindowList();
 	
 						if (OKToUse(tinfo)) {
 							fWindow->Redraw(i);
@@ -271,6 +405,7 @@ TSwitchMgr::MessageReceived(BMessage *message)
 				TTeamGroup *tinfo = new TTeamGroup(teams, flags, strdup(name), sig);
 				
 				fGroupList.AddItem(tinfo);
+				InvalidateWindowList();
 				if (OKToUse(tinfo)) 
 					fWindow->Redraw(fGroupList.CountItems() - 1);
 
@@ -285,8 +420,10 @@ TSwitchMgr::MessageReceived(BMessage *message)
 				for (int32 i = 0; i < numItems; i++) {
 					TTeamGroup *tinfo = (TTeamGroup *)fGroupList.ItemAt(i);
 					if (strcasecmp(tinfo->Sig(), sig) == 0) {
-						if (!(tinfo->TeamList()->HasItem((void *)team)))
+						if (!(tinfo->TeamList()->HasItem((void *)team))) {
 							tinfo->TeamList()->AddItem((void *)team);
+							InvalidateWindowList();
+						}
 						break;
 					}
 				}		
@@ -301,6 +438,7 @@ TSwitchMgr::MessageReceived(BMessage *message)
 					TTeamGroup *tinfo = (TTeamGroup *)fGroupList.ItemAt(i);
 					if (tinfo->TeamList()->HasItem((void *)team)) {
 						tinfo->TeamList()->RemoveItem((void *)team);
+						InvalidateWindowList();
 						break;
 					}
 				}		
@@ -357,6 +495,9 @@ TSwitchMgr::MainEntry(BMessage *message)
 
 	bigtime_t timeout = system_time() + keyRepeatRate;
 
+	// a new switcher session, take a fresh window list snapshot
+	InvalidateWindowList();
+
 	app_info appInfo;
 	be_roster->GetActiveAppInfo(&appInfo);
 
@@ -388,9 +529,14 @@ void
 TSwitchMgr::Stop(bool do_action, uint32 )
 {
 	fWindow->Hide();
+
+	// activate based on the current window order, not the one from when
+	// the session started
+	InvalidateWindowList();
 	if (do_action)
 		ActivateApp(true, true);
 	
+	InvalidateWindowList();
 	release_sem(fMainMonitor);
 }
 
@@ -474,6 +620,7 @@ TSwitchMgr::QuickSwitch(BMessage *message)
 			CycleApp(forward, true);
 	}
 
+	InvalidateWindowList();
 	release_sem(fMainMonitor);
 }
 
@@ -597,7 +744,7 @@ TSwitchMgr::ActivateApp(bool forceShow, bool allowWorkspaceSwitch)
 	// Let's get the info about the selected window. If it doesn't exist
 	// anymore then get info about first window. If that doesn't exist then
 	// do nothing.
-	window_info	*windowInfo = WindowInfo(fCurIndex, fCurWindow);
+	const window_info *windowInfo = WindowInfo(fCurIndex, fCurWindow);
 	if (!windowInfo) {
 		windowInfo = WindowInfo(fCurIndex, 0);
 		if (!windowInfo)
@@ -626,8 +773,6 @@ TSwitchMgr::ActivateApp(bool forceShow, bool allowWorkspaceSwitch)
 			be_roster->ActivateApp((team_id) teamGroup->TeamList()->ItemAt(0));
 		}
 		
-		ASSERT(windowInfo);
-		free(windowInfo);
 		return result;
 	}
 
@@ -637,58 +782,48 @@ TSwitchMgr::ActivateApp(bool forceShow, bool allowWorkspaceSwitch)
 	// want to bring to the front every window of the group of teams that
 	// lives in that workspace.
 	
+	int32 windowID = windowInfo->id;
+	bool isMini = windowInfo->is_mini;
+
 	if ((windowInfo->workspaces & (1 << currentWorkspace)) == 0) {
 		if (!allowWorkspaceSwitch) {
 			// If the first window in the list isn't in current workspace,
 			// then none are. So we can't switch to this app.
-			ASSERT(windowInfo);
-			free(windowInfo);
 			return false;
 		}
 		int32 dest_ws = LowBitIndex(windowInfo->workspaces);
 		// now switch to that workspace
 		activate_workspace(dest_ws);
+
+		// the window layers changed with the workspace, so the snapshot
+		// (and windowInfo with it) is stale
+		InvalidateWindowList();
+		windowInfo = NULL;
 	}
 
-	if (!forceShow && windowInfo->is_mini) {
+	if (!forceShow && isMini) {
 		// If the first window in the list is hiddenm then no windows in
 		// this group are visible. So we can't switch to this app.
-		ASSERT(windowInfo);
-		free(windowInfo);
 		return false;
 	}
 
-	int32 tokenCount;
-	int32 *tokens = get_token_list(-1, &tokenCount);
-	if (!tokens) {
-		ASSERT(windowInfo);
-		free(windowInfo);
-		return true;	// weird error, so don't try to recover
-	}
-
+	TWindowList *windowList = WindowList();
 	BList windowsToActivate;
 
 	// Now we go through all the windows in the current workspace list in order.
 	// As we hit member teams we build the "activate" list.
-	for (int32 i = 0; i < tokenCount; i++) {
-		window_info	*matchWindowInfo = get_window_info(tokens[i]);
-		if (!matchWindowInfo) 
-			// That window probably closed. Just go to the next one.
-			continue;
-		if (!IsVisibleInCurrentWorkspace(matchWindowInfo)) {
+	int32 windowCount = windowList->CountItems();
+	for (int32 i = 0; i < windowCount; i++) {
+		const window_info *matchWindowInfo = windowList->ItemAt(i);
+		if (!IsVisibleInCurrentWorkspace(matchWindowInfo))
 			// first non-visible in workspace window means we're done.
-			free(matchWindowInfo);
 			break;
-		}
-		if ((matchWindowInfo->id != windowInfo->id)
+
+		if ((matchWindowInfo->id != windowID)
 			&& teamGroup->TeamList()->HasItem((void *)matchWindowInfo->team))
 				windowsToActivate.AddItem((void *)matchWindowInfo->id);
-
-		free(matchWindowInfo);
 	}
 
-	free(tokens);
-
 	// Want to go through the list backwards to keep windows in same relative
 	// order.
 	int32 i = windowsToActivate.CountItems() - 1;
@@ -699,89 +834,51 @@ TSwitchMgr::ActivateApp(bool forceShow, bool allowWorkspaceSwitch)
 
 	// now bring the select window on top of everything.
 
-	do_window_action(windowInfo->id, B_BRING_TO_FRONT, BRect(0, 0, 0, 0), false);
-	free(windowInfo);
+	do_window_action(windowID, B_BRING_TO_FRONT, BRect(0, 0, 0, 0), false);
 	return true;
 }
 
 
-window_info *
-TSwitchMgr::WindowInfo(int32 groupIndex, int32 windowIndex)
+TWindowList *
+TSwitchMgr::WindowList()
 {
+	if (!fWindowList.IsValid())
+		fWindowList.Update(&fGroupList);
 
-	TTeamGroup *teamGroup = (TTeamGroup *) fGroupList.ItemAt(groupIndex);
-	if (!teamGroup)
-		return NULL;
-	
-	int32 tokenCount;
-	int32 *tokens = get_token_list(-1, &tokenCount);
-	if (!tokens)
-		return NULL;
-	
-	int32 matches = 0;
+	return &fWindowList;
+}
 
-	// Want to find the "windowIndex'th" window in window order that belongs
-	// the the specified group (groupIndex). Since multiple teams can belong to
-	// the same group (multiple-launch apps) we get the list of _every_
-	// window and go from there.
 
-	window_info	*result = NULL;
-	for (int32 i = 0; i < tokenCount; i++) {
-		window_info	*windowInfo = get_window_info(tokens[i]);
-		if (windowInfo) {
-			// skip hidden/special windows
-			if (IsWindowOK(windowInfo)
-				&& (teamGroup->TeamList()->HasItem((void *)windowInfo->team))) {
-				// this window belongs to the team!
-				if (matches == windowIndex) {
-					// we found it!
-					result = windowInfo;
-					break;
-				}
-				matches++;
-			}
-			free(windowInfo);
-		}
-		// else - that window probably closed. Just go to the next one.
-	}
+void
+TSwitchMgr::InvalidateWindowList()
+{
+	fWindowList.MakeEmpty();
+}
 
-	free(tokens);
 
-	return result;
+bool
+TSwitchMgr::WindowExists(int32 token)
+{
+	return fWindowList.WindowExists(token);
 }
 
 
-int32
-TSwitchMgr::CountWindows(int32 groupIndex, bool )
+const window_info *
+TSwitchMgr::WindowInfo(int32 groupIndex, int32 windowIndex)
 {
-	TTeamGroup *teamGroup = (TTeamGroup *)fGroupList.ItemAt(groupIndex);
-	if (!teamGroup)
-		return 0;
-	
-	int32 result = 0;
+	// Want to find the "windowIndex'th" window in window order that belongs
+	// the the specified group (groupIndex). The window list snapshot keeps
+	// these in order for every group, so we don't have to go through the
+	// list of _every_ window each time.
 
-	for (int32 i = 0; ; i++) {
-		team_id	teamID = (team_id)teamGroup->TeamList()->ItemAt(i);
-		if (teamID == 0)
-			break;
-	
-		int32 count;
-		int32 *tokens = get_token_list(teamID, &count);
-		if (!tokens)
-			continue;
+	return WindowList()->GroupWindowAt(groupIndex, windowIndex);
+}
 
-		for (int32 i = 0; i < count; i++) {
-			window_info	*windowInfo = get_window_info(tokens[i]);
-			if (windowInfo) {
-				if (IsWindowOK(windowInfo))
-					result++;
-				free(windowInfo);
-			}
-		}
-		free(tokens);
-	}
 
-	return result;
+int32
+TSwitchMgr::CountWindows(int32 groupIndex, bool )
+{
+	return WindowList()->CountGroupWindows(groupIndex);
 }
 
 
@@ -803,25 +900,22 @@ TSwitchMgr::SwitchWindow(team_id team, bool, bool activate)
 
 	int32 index;
 	TTeamGroup*teamGroup = FindTeam(team, &index);
+	if (!teamGroup)
+		return;
 
 	// cycle through the window in the active application
-	int32 count;
-	int32 *tokens = get_token_list(-1, &count);
-	for (int32 i = count-1; i>=0; i--) {
-		window_info	*windowInfo;
-		windowInfo = get_window_info(tokens[i]);
-		if (windowInfo && IsVisibleInCurrentWorkspace(windowInfo)
+	TWindowList *windowList = WindowList();
+	for (int32 i = windowList->CountItems() - 1; i >= 0; i--) {
+		const window_info *windowInfo = windowList->ItemAt(i);
+		if (IsVisibleInCurrentWorkspace(windowInfo)
 			&& teamGroup->TeamList()->HasItem((void *)windowInfo->team)) {
 				fWindowID = windowInfo->id;
 				if (activate) 
 					ActivateWindow(windowInfo->id);
 
-				free(windowInfo);
 				break;
 		}
-		free(windowInfo);
 	}
-	free(tokens);
 }
 
 
@@ -1797,12 +1891,11 @@ TWindowView::ShowIndex(int32 newIndex)
 	if (!teamGroup)
 		return;
 
-	window_info	*windowInfo = fMgr->WindowInfo(groupIndex, newIndex);
+	const window_info *windowInfo = fMgr->WindowInfo(groupIndex, newIndex);
 	if (windowInfo == NULL)
 		return;
 
 	fCurToken = windowInfo->id;
-	free(windowInfo);
 
 	if (bounds.top == point.y)
 		return;
@@ -1850,7 +1943,7 @@ TWindowView::Draw(BRect update)
 		bool minimized = false;
 		BString title;
 
-		window_info	*windowInfo = fMgr->WindowInfo(groupIndex, windowIndex);
+		const window_info *windowInfo = fMgr->WindowInfo(groupIndex, windowIndex);
 		if (windowInfo != NULL) {
 			
 			if (SmartStrcmp(windowInfo->name, teamGroup->Name()) != 0)
@@ -1863,7 +1956,6 @@ TWindowView::Draw(BRect update)
 				local = false;
 
 			minimized = windowInfo->is_mini;
-			free(windowInfo);
 		} else 
 			title = teamGroup->Name();
 
@@ -1926,13 +2018,13 @@ TWindowView::UpdateGroup(int32 , int32 windowIndex)
 void
 TWindowView::Pulse()
 {
-	// If selected window went away then reset to first window
-	window_info	*windowInfo = get_window_info(fCurToken);
-	if (windowInfo == NULL) {
+	// If selected window went away then reset to first window; the window
+	// list snapshot is stale at this point, so have it rebuilt
+	if (!fMgr->WindowExists(fCurToken)) {
+		fMgr->InvalidateWindowList();
 		Invalidate();
 		ShowIndex(0);
-	} else
-		free(windowInfo);
+	}
 }
 
 
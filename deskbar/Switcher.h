@@ -79,9 +79,56 @@ class TWindowView;
 class TSwitcherWindow;
 struct window_info;
 
+class TWindowListProvider {
+	// wraps the app_server window list calls used by the switcher, so
+	// that a canned window list can be substituted for testing
+public:
+	virtual ~TWindowListProvider();
+
+	virtual int32 *GetTokenList(int32 *count) = 0;
+	virtual window_info *GetWindowInfo(int32 token) = 0;
+		// both return malloc-ed data the caller has to free
+};
+
+class TServerWindowListProvider : public TWindowListProvider {
+public:
+	virtual int32 *GetTokenList(int32 *count);
+	virtual window_info *GetWindowInfo(int32 token);
+};
+
+class TWindowList {
+	// snapshot of the window list, in front to back order, with the
+	// switchable windows of every team group indexed by group
+public:
+	TWindowList(TWindowListProvider *);
+	~TWindowList();
+
+	bool Update(const BList *groupList);
+	void MakeEmpty();
+	bool IsValid() const
+		{ return fValid; }
+
+	int32 CountItems() const
+		{ return fWindows.CountItems(); }
+	const window_info *ItemAt(int32 index) const
+		{ return (const window_info *)fWindows.ItemAt(index); }
+
+	int32 CountGroupWindows(int32 groupIndex) const;
+	const window_info *GroupWindowAt(int32 groupIndex, int32 windowIndex) const;
+
+	bool WindowExists(int32 token);
+
+private:
+	TWindowListProvider *fProvider;
+	BList fWindows;
+	BList fGroupWindows;
+	bool fValid;
+};
+
 class TSwitchMgr : public BHandler {
 public:
-	TSwitchMgr(BPoint where);
+	TSwitchMgr(BPoint where, TWindowListProvider *provider = NULL);
+		// takes ownership of <provider>, uses the app_server if NULL
 	virtual ~TSwitchMgr();
 
 	virtual void MessageReceived(BMessage *);
@@ -99,9 +146,15 @@ public:
 	void Touch(bool zero = false);
 	bigtime_t IdleTime();
 
-	window_info *WindowInfo(int32 groupIndex, int32 wdIndex);
+	const window_info *WindowInfo(int32 groupIndex, int32 wdIndex);
+		// returned window_info is owned by the window list snapshot and
+		// is only valid until the next InvalidateWindowList()
 	int32 CountWindows(int32 groupIndex, bool inCurrentWorkspace = false);
 	TTeamGroup *FindTeam(team_id, int32 *index);
+
+	TWindowList *WindowList();
+	void InvalidateWindowList();
+	bool WindowExists(int32 token);
 		
 private:
 	void MainEntry(BMessage *);	
@@ -121,6 +174,8 @@ private:
 	int32 fCurSlot;
 	int32 fWindowID;
 	bigtime_t fLastActivity;
+	TWindowListProvider *fWindowListProvider;
+	TWindowList fWindowList;
 };
 
 class TSwitcherWindow : public BWindow {
@@ -0,0 +1,631 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+#include <AppFileInfo.h>
+#include <Debug.h>
+#include <File.h>
+#include <Mime.h>
+#include <NodeMonitor.h>
+#include <Query.h>
+#include <Volume.h>
+#include <VolumeRoster.h>
+
+#include <stddef.h>
+#include <string.h>
+
+#include "AppCapabilityIndex.h"
+#include "Attributes.h"
+#include "AutoLock.h"
+#include "Model.h"
+#include "Tracker.h"
+
+
+static int
+CompareNodeRef(const node_ref *a, const node_ref *b)
+{
+	if (a->device != b->device)
+		return a->device < b->device ? -1 : 1;
+	if (a->node != b->node)
+		return a->node < b->node ? -1 : 1;
+	return 0;
+}
+
+static int
+CompareAppNode(const IndexedApp *a, const IndexedApp *b)
+{
+	return CompareNodeRef(&a->fNode, &b->fNode);
+}
+
+static int32
+MatchTypeString(const char *documentType, const char *handlerType)
+{
+	// same wildcard rules as MatchMimeTypeString in Model.cpp:
+	// handler types without a subtype handle the whole supertype
+	if (handlerType[0] && !strchr(handlerType, '/')) {
+		int32 supertypeLength = (int32)strlen(handlerType);
+		const char *slash = strchr(documentType, '/');
+		if (slash && slash - documentType == supertypeLength) {
+			if (strncasecmp(documentType, handlerType, supertypeLength) == 0)
+				return kModelSupportsSupertype;
+
+			return kDoesNotSupportType;
+		}
+		// anything else still gets the full string match below
+	}
+
+	if (strcasecmp(documentType, handlerType) == 0)
+		return kModelSupportsType;
+
+	return kDoesNotSupportType;
+}
+
+
+IndexedApp::IndexedApp(const entry_ref *ref, const node_ref *node)
+	:	fRef(*ref),
+		fNode(*node),
+		fSupportedTypes(10, true),
+		fSuperHandler(false)
+{
+}
+
+status_t
+IndexedApp::ReadFromNode()
+{
+	fSignature = "";
+	fSupportedTypes.MakeEmpty();
+	fSuperHandler = false;
+
+	BFile file(&fRef, O_RDONLY);
+	status_t result = file.InitCheck();
+	if (result != B_OK)
+		return result;
+
+	BAppFileInfo appFileInfo(&file);
+	char signature[B_MIME_TYPE_LENGTH];
+	if (appFileInfo.GetSignature(signature) == B_OK)
+		fSignature = signature;
+
+	BMessage message;
+	if (appFileInfo.GetSupportedTypes(&message) != B_OK)
+		return B_OK;
+
+	for (int32 index = 0; ; index++) {
+		const char *type;
+		int32 length;
+		if (message.FindData("types", 'CSTR', index, (const void **)&type,
+			&length) != B_OK)
+			break;
+
+		if (strcasecmp(type, B_FILE_MIMETYPE) == 0)
+			fSuperHandler = true;
+
+		fSupportedTypes.AddItem(new BString(type));
+	}
+
+	return B_OK;
+}
+
+int32
+IndexedApp::SupportsMimeType(const char *type) const
+{
+	int32 result = fSuperHandler ? kSuperhandlerModel : kDoesNotSupportType;
+
+	int32 count = fSupportedTypes.CountItems();
+	for (int32 index = 0; index < count; index++) {
+		int32 match = MatchTypeString(type, fSupportedTypes.ItemAt(index)->String());
+		if (match == kModelSupportsType)
+			// supports the actual type, it can't get any better
+			return kModelSupportsType;
+
+		if (match == kModelSupportsSupertype)
+			result = kModelSupportsSupertype;
+	}
+
+	return result;
+}
+
+
+IndexedAppEntryList::IndexedAppEntryList()
+	:	fList(20, true),
+		fIndex(0)
+{
+}
+
+
+IndexedAppEntryList::~IndexedAppEntryList()
+{
+}
+
+void
+IndexedAppEntryList::AddItem(const entry_ref *ref, const node_ref *node)
+{
+	int32 count = fList.CountItems();
+	for (int32 index = 0; index < count; index++) {
+		if (fList.ItemAt(index)->fNode == *node)
+			return;
+	}
+
+	fList.AddItem(new IndexedApp(ref, node));
+}
+
+status_t
+IndexedAppEntryList::GetNextEntry(BEntry *entry, bool traverse)
+{
+	entry_ref ref;
+	status_t result = GetNextRef(&ref);
+	if (result != B_OK)
+		return result;
+
+	return entry->SetTo(&ref, traverse);
+}
+
+status_t
+IndexedAppEntryList::GetNextRef(entry_ref *ref)
+{
+	if (fIndex >= fList.CountItems())
+		return B_ENTRY_NOT_FOUND;
+
+	*ref = fList.ItemAt(fIndex++)->fRef;
+	return B_OK;
+}
+
+int32
+IndexedAppEntryList::GetNextDirents(struct dirent *buffer, size_t length,
+	int32 count)
+{
+	if (!count || fIndex >= fList.CountItems())
+		return 0;
+
+	const IndexedApp *app = fList.ItemAt(fIndex);
+	size_t nameLength = strlen(app->fRef.name);
+	if (sizeof(dirent) + nameLength > length)
+		return 0;
+
+	// record length follows the EntryListBase::Next convention
+	buffer->d_pdev = app->fRef.device;
+	buffer->d_pino = app->fRef.directory;
+	buffer->d_dev = app->fNode.device;
+	buffer->d_ino = app->fNode.node;
+	buffer->d_reclen = (unsigned short)nameLength;
+	strcpy(buffer->d_name, app->fRef.name);
+
+	fIndex++;
+	return 1;
+}
+
+status_t
+IndexedAppEntryList::Rewind()
+{
+	fIndex = 0;
+	return B_OK;
+}
+
+int32
+IndexedAppEntryList::CountEntries()
+{
+	return fList.CountItems();
+}
+
+
+AppCapabilityIndex::AppCapabilityIndex()
+	:	BLooper("AppCapabilityIndex", B_LOW_PRIORITY),
+		fApps(100, true),
+		fQueryList(5, true),
+		fLock("appCapabilityIndex"),
+		fBuildThread(-1),
+		fQuitting(false),
+		fReady(false)
+{
+	BMimeType::StartWatching(BMessenger(this));
+	TTracker::WatchNode(0, B_WATCH_MOUNT, this);
+
+	fBuildThread = spawn_thread(&AppCapabilityIndex::BuildEntry,
+		"AppCapabilityIndex::Build()", B_LOW_PRIORITY, this);
+	if (fBuildThread >= B_OK)
+		resume_thread(fBuildThread);
+}
+
+
+AppCapabilityIndex::~AppCapabilityIndex()
+{
+	BMimeType::StopWatching(BMessenger(this));
+	stop_watching(this);
+
+	// the build thread works on this object, let it bail out before
+	// tearing it down
+	fQuitting = true;
+	if (fBuildThread >= B_OK) {
+		status_t result;
+		wait_for_thread(fBuildThread, &result);
+	}
+
+	AutoLock<BLocker> lock(fLock);
+	fReady = false;
+	fTypeMap.clear();
+	fSignatureMap.clear();
+}
+
+AppCapabilityIndex *
+AppCapabilityIndex::Get()
+{
+	TTracker *tracker = dynamic_cast<TTracker *>(be_app);
+	if (!tracker)
+		return NULL;
+
+	AppCapabilityIndex *index = tracker->AppCapabilities();
+	if (!index || !index->IsReady())
+		return NULL;
+
+	return index;
+}
+
+bool
+AppCapabilityIndex::IsReady() const
+{
+	return fReady;
+}
+
+int32
+AppCapabilityIndex::BuildEntry(void *castToThis)
+{
+	((AppCapabilityIndex *)castToThis)->Build();
+	return 0;
+}
+
+void
+AppCapabilityIndex::Build()
+{
+	BVolumeRoster roster;
+	BVolume volume;
+	while (!fQuitting && roster.GetNextVolume(&volume) == B_OK)
+		StartLiveQuery(&volume);
+
+	if (fQuitting)
+		return;
+
+	fReady = true;
+	PRINT(("app capability index built, %ld apps\n", fApps.CountItems()));
+}
+
+void
+AppCapabilityIndex::StartLiveQuery(BVolume *volume)
+{
+	if (!volume->KnowsQuery() || !volume->KnowsAttr())
+		return;
+
+	BQuery *query = new BQuery;
+	BString predicate;
+	predicate << kAttrMIMEType << " == " << B_APP_MIME_TYPE;
+	query->SetPredicate(predicate.String());
+	query->SetVolume(volume);
+	query->SetTarget(BMessenger(this));
+		// live query, keeps us posted about installs and removals
+
+	if (query->Fetch() != B_OK) {
+		delete query;
+		return;
+	}
+
+	char buffer[sizeof(dirent) + B_FILE_NAME_LENGTH];
+	dirent *ent = (dirent *)buffer;
+	while (!fQuitting && query->GetNextDirents(ent, sizeof(buffer), 1) > 0) {
+		entry_ref ref(ent->d_pdev, ent->d_pino, ent->d_name);
+		node_ref node;
+		node.device = ent->d_dev;
+		node.node = ent->d_ino;
+		AddApp(&ref, &node);
+	}
+
+	AutoLock<BLocker> lock(fLock);
+	fQueryList.AddItem(query);
+}
+
+IndexedApp *
+AppCapabilityIndex::FindApp(const node_ref *node) const
+{
+	entry_ref ref;
+	IndexedApp tmp(&ref, node);
+	return const_cast<IndexedApp *>(fApps.BinarySearch(tmp, &CompareAppNode));
+}
+
+void
+AppCapabilityIndex::MapApp(IndexedApp *app)
+{
+	if (!app->fSignature.Length())
+		// same as the signature query, apps without one are never offered
+		return;
+
+	BString key(app->fSignature);
+	key.ToLower();
+	fSignatureMap.insert(AppMap::value_type(key, app));
+
+	int32 count = app->fSupportedTypes.CountItems();
+	for (int32 index = 0; index < count; index++) {
+		key = *app->fSupportedTypes.ItemAt(index);
+		key.ToLower();
+		fTypeMap.insert(AppMap::value_type(key, app));
+	}
+}
+
+static void
+EraseMapped(std::multimap<BString, IndexedApp *> *map, const BString &key,
+	const IndexedApp *app)
+{
+	BString lowerKey(key);
+	lowerKey.ToLower();
+
+	std::multimap<BString, IndexedApp *>::iterator iterator
+		= map->lower_bound(lowerKey);
+	while (iterator != map->end() && iterator->first == lowerKey) {
+		if (iterator->second == app)
+			map->erase(iterator++);
+		else
+			iterator++;
+	}
+}
+
+void
+AppCapabilityIndex::UnmapApp(IndexedApp *app)
+{
+	if (!app->fSignature.Length())
+		return;
+
+	EraseMapped(&fSignatureMap, app->fSignature, app);
+
+	int32 count = app->fSupportedTypes.CountItems();
+	for (int32 index = 0; index < count; index++)
+		EraseMapped(&fTypeMap, *app->fSupportedTypes.ItemAt(index), app);
+}
+
+void
+AppCapabilityIndex::AddMappedApps(const AppMap &map, const char *key,
+	IndexedAppEntryList *result)
+{
+	BString lowerKey(key);
+	lowerKey.ToLower();
+
+	std::pair<AppMap::const_iterator, AppMap::const_iterator> range
+		= map.equal_range(lowerKey);
+	for (AppMap::const_iterator iterator = range.first;
+		iterator != range.second; iterator++)
+		result->AddItem(&iterator->second->fRef, &iterator->second->fNode);
+}
+
+void
+AppCapabilityIndex::AddApp(const entry_ref *ref, const node_ref *node)
+{
+	// read the app outside of the lock, readers should not wait on disk
+	IndexedApp *app = new IndexedApp(ref, node);
+	if (app->ReadFromNode() != B_OK) {
+		delete app;
+		return;
+	}
+
+	AutoLock<BLocker> lock(fLock);
+	IndexedApp *existing = FindApp(node);
+	if (existing) {
+		UnmapApp(existing);
+		fApps.RemoveItem(existing);
+	}
+
+	fApps.BinaryInsert(app, &CompareAppNode);
+	MapApp(app);
+}
+
+void
+AppCapabilityIndex::RemoveApp(const node_ref *node)
+{
+	AutoLock<BLocker> lock(fLock);
+	IndexedApp *app = FindApp(node);
+	if (app) {
+		UnmapApp(app);
+		fApps.RemoveItem(app);
+	}
+}
+
+void
+AppCapabilityIndex::SignatureChanged(const char *signature)
+{
+	// collect copies, AddApp replaces the indexed entries
+	BObjectList<IndexedApp> changed(5, true);
+	{
+		AutoLock<BLocker> lock(fLock);
+		int32 count = fApps.CountItems();
+		for (int32 index = 0; index < count; index++) {
+			IndexedApp *app = fApps.ItemAt(index);
+			if (app->fSignature.ICompare(signature) == 0)
+				changed.AddItem(new IndexedApp(&app->fRef, &app->fNode));
+		}
+	}
+
+	int32 count = changed.CountItems();
+	for (int32 index = 0; index < count; index++) {
+		IndexedApp *app = changed.ItemAt(index);
+		AddApp(&app->fRef, &app->fNode);
+	}
+}
+
+void
+AppCapabilityIndex::VolumeUnmounted(dev_t device)
+{
+	AutoLock<BLocker> lock(fLock);
+	for (int32 index = fApps.CountItems() - 1; index >= 0; index--) {
+		IndexedApp *app = fApps.ItemAt(index);
+		if (app->fNode.device == device) {
+			UnmapApp(app);
+			delete fApps.RemoveItemAt(index);
+		}
+	}
+
+	for (int32 index = fQueryList.CountItems() - 1; index >= 0; index--) {
+		BQuery *query = fQueryList.ItemAt(index);
+		if (query->TargetDevice() == device)
+			delete fQueryList.RemoveItemAt(index);
+	}
+}
+
+int32
+AppCapabilityIndex::SupportsMimeType(const node_ref *node,
+	const char *type) const
+{
+	AutoLock<BLocker> lock(fLock);
+	IndexedApp *app = FindApp(node);
+	if (!app)
+		return -1;
+
+	return app->SupportsMimeType(type);
+}
+
+bool
+AppCapabilityIndex::AddAppsWithSignatures(const BObjectList<BString> *signatures,
+	IndexedAppEntryList *result) const
+{
+	AutoLock<BLocker> lock(fLock);
+	if (!fReady)
+		return false;
+
+	int32 count = signatures->CountItems();
+	for (int32 index = 0; index < count; index++)
+		AddMappedApps(fSignatureMap, signatures->ItemAt(index)->String(), result);
+
+	return true;
+}
+
+bool
+AppCapabilityIndex::AddAppsSupportingTypes(const BObjectList<BString> *types,
+	IndexedAppEntryList *result) const
+{
+	AutoLock<BLocker> lock(fLock);
+	if (!fReady)
+		return false;
+
+	int32 count = types->CountItems();
+	for (int32 index = 0; index < count; index++) {
+		const BString *type = types->ItemAt(index);
+		AddMappedApps(fTypeMap, type->String(), result);
+
+		// apps listing just the supertype handle the type as well
+		int32 slash = type->FindFirst('/');
+		if (slash > 0) {
+			BString supertype;
+			type->CopyInto(supertype, 0, slash);
+			AddMappedApps(fTypeMap, supertype.String(), result);
+		}
+	}
+
+	return true;
+}
+
+bool
+AppCapabilityIndex::AddAllApps(IndexedAppEntryList *result) const
+{
+	AutoLock<BLocker> lock(fLock);
+	if (!fReady)
+		return false;
+
+	int32 count = fApps.CountItems();
+	for (int32 index = 0; index < count; index++) {
+		IndexedApp *app = fApps.ItemAt(index);
+		if (app->fSignature.Length())
+			result->AddItem(&app->fRef, &app->fNode);
+	}
+	return true;
+}
+
+void
+AppCapabilityIndex::MessageReceived(BMessage *message)
+{
+	switch (message->what) {
+		case B_QUERY_UPDATE:
+			{
+				int32 opcode;
+				node_ref node;
+				if (message->FindInt32("opcode", &opcode) != B_OK
+					|| message->FindInt32("device", &node.device) != B_OK
+					|| message->FindInt64("node", &node.node) != B_OK)
+					break;
+
+				if (opcode == B_ENTRY_CREATED) {
+					entry_ref ref;
+					const char *name;
+					if (message->FindInt64("directory", &ref.directory) != B_OK
+						|| message->FindString("name", &name) != B_OK)
+						break;
+
+					ref.device = node.device;
+					ref.set_name(name);
+					AddApp(&ref, &node);
+				} else if (opcode == B_ENTRY_REMOVED)
+					RemoveApp(&node);
+				break;
+			}
+
+		case B_META_MIME_CHANGED:
+			{
+				const char *type;
+				int32 which;
+				if (message->FindString("be:type", &type) == B_OK
+					&& message->FindInt32("be:which", &which) == B_OK
+					&& (which & B_SUPPORTED_TYPES_CHANGED) != 0)
+					SignatureChanged(type);
+				break;
+			}
+
+		case B_NODE_MONITOR:
+			switch (message->FindInt32("opcode")) {
+				case B_DEVICE_MOUNTED:
+					{
+						dev_t device;
+						if (message->FindInt32("new device", &device) == B_OK) {
+							BVolume volume(device);
+							StartLiveQuery(&volume);
+						}
+						break;
+					}
+
+				case B_DEVICE_UNMOUNTED:
+					{
+						dev_t device;
+						if (message->FindInt32("device", &device) == B_OK)
+							VolumeUnmounted(device);
+						break;
+					}
+			}
+			break;
+
+		default:
+			_inherited::MessageReceived(message);
+			break;
+	}
+}
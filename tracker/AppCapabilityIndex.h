@@ -0,0 +1,167 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+//	AppCapabilityIndex keeps an in-memory map of every installed application,
+//	its signature and the types it lists as supported.
+//
+//	It is built once in the background when Tracker starts and kept current
+//	with a live query on every volume (app installs and removals) and by
+//	watching the MIME database (supported types changes). The Open With menu
+//	and window use it instead of running a query per signature and reading
+//	the supported types of each candidate app for every opened file.
+
+#ifndef __APP_CAPABILITY_INDEX__
+#define __APP_CAPABILITY_INDEX__
+
+#include <Entry.h>
+#include <Locker.h>
+#include <Looper.h>
+#include <Node.h>
+#include <String.h>
+
+#include <map>
+
+#include "EntryIterator.h"
+#include "ObjectList.h"
+
+class BQuery;
+class BVolume;
+
+namespace BPrivate {
+
+class IndexedApp {
+public:
+	IndexedApp(const entry_ref *, const node_ref *);
+
+	status_t ReadFromNode();
+		// reads signature and supported types from the app file
+
+	int32 SupportsMimeType(const char *type) const;
+		// same results as Model::SupportsMimeType(type, 0, true), without
+		// touching the node
+
+	entry_ref fRef;
+	node_ref fNode;
+	BString fSignature;
+	BObjectList<BString> fSupportedTypes;
+	bool fSuperHandler;
+};
+
+class IndexedAppEntryList : public EntryListBase {
+	// iterates a snapshot of application refs picked from the index
+public:
+	IndexedAppEntryList();
+	virtual ~IndexedAppEntryList();
+
+	void AddItem(const entry_ref *, const node_ref *);
+		// ignores apps that were already added
+
+	virtual status_t GetNextEntry(BEntry *entry, bool traverse = false);
+	virtual status_t GetNextRef(entry_ref *ref);
+	virtual int32 GetNextDirents(struct dirent *buffer, size_t length,
+		int32 count = INT_MAX);
+
+	virtual status_t Rewind();
+	virtual int32 CountEntries();
+
+private:
+	BObjectList<IndexedApp> fList;
+	int32 fIndex;
+};
+
+class AppCapabilityIndex : public BLooper {
+public:
+	AppCapabilityIndex();
+	virtual ~AppCapabilityIndex();
+
+	static AppCapabilityIndex *Get();
+		// returns the index of the running Tracker, NULL if we are not
+		// running in the Tracker (file panels in other apps) or if the
+		// index did not finish building yet
+
+	bool IsReady() const;
+
+	int32 SupportsMimeType(const node_ref *app, const char *type) const;
+		// returns one of the kDoesNotSupportType, kSuperhandlerModel, ...
+		// values or -1 if <app> is not in the index
+
+	bool AddAppsWithSignatures(const BObjectList<BString> *signatures,
+		IndexedAppEntryList *result) const;
+	bool AddAppsSupportingTypes(const BObjectList<BString> *types,
+		IndexedAppEntryList *result) const;
+		// adds the apps listing one of <types> or its supertype as
+		// supported, the same apps BMimeType::GetSupportingApps returns
+	bool AddAllApps(IndexedAppEntryList *result) const;
+
+protected:
+	virtual void MessageReceived(BMessage *);
+
+private:
+	typedef std::multimap<BString, IndexedApp *> AppMap;
+		// keyed by lower case type or signature
+
+	static int32 BuildEntry(void *);
+	void Build();
+	void StartLiveQuery(BVolume *);
+	void AddApp(const entry_ref *, const node_ref *);
+	void RemoveApp(const node_ref *);
+	void SignatureChanged(const char *signature);
+	void VolumeUnmounted(dev_t);
+
+	IndexedApp *FindApp(const node_ref *) const;
+	void MapApp(IndexedApp *);
+	void UnmapApp(IndexedApp *);
+		// keep fTypeMap and fSignatureMap in sync with fApps, called
+		// with fLock held
+	static void AddMappedApps(const AppMap &, const char *key,
+		IndexedAppEntryList *result);
+
+	BObjectList<IndexedApp> fApps;
+		// sorted by node_ref
+	AppMap fTypeMap;
+	AppMap fSignatureMap;
+	BObjectList<BQuery> fQueryList;
+	mutable BLocker fLock;
+	thread_id fBuildThread;
+	volatile bool fQuitting;
+	volatile bool fReady;
+
+	typedef BLooper _inherited;
+};
+
+} // namespace BPrivate
+
+using namespace BPrivate;
+
+#endif
@@ -94,6 +94,10 @@ namespace BPrivate {
 #define	kAttrPoseInfo_le				"_trk/pinfo_le"
 #define	kAttrDisksPoseInfo_be			"_trk/d_pinfo"
 #define	kAttrDisksPoseInfo_le			"_trk/d_pinfo_le"
+#define	kAttrPoseLocationIndex_be		"_trk/pinfo_idx"
+#define	kAttrPoseLocationIndex_le		"_trk/pinfo_idx_le"
+#define	kAttrQueryResultSnapshot_be		"_trk/qrslt"
+#define	kAttrQueryResultSnapshot_le		"_trk/qrslt_le"
 #define	kAttrColumns_be					"_trk/columns"
 #define	kAttrColumns_le					"_trk/columns_le"
 #define	kAttrViewState_be				"_trk/viewstate"
@@ -120,6 +124,12 @@ namespace BPrivate {
 #define	kAttrPoseInfo					kAttrPoseInfo_le
 #define	kAttrPoseInfoForeign			kAttrPoseInfo_be
 
+#define	kAttrPoseLocationIndex			kAttrPoseLocationIndex_le
+#define	kAttrPoseLocationIndexForeign	kAttrPoseLocationIndex_be
+
+#define	kAttrQueryResultSnapshot		kAttrQueryResultSnapshot_le
+#define	kAttrQueryResultSnapshotForeign	kAttrQueryResultSnapshot_be
+
 #define	kAttrColumns					kAttrColumns_le
 #define	kAttrColumnsForeign				kAttrColumns_be
 
@@ -152,6 +162,12 @@ namespace BPrivate {
 #define	kAttrPoseInfo					kAttrPoseInfo_be
 #define	kAttrPoseInfoForeign			kAttrPoseInfo_le
 
+#define	kAttrPoseLocationIndex			kAttrPoseLocationIndex_be
+#define	kAttrPoseLocationIndexForeign	kAttrPoseLocationIndex_le
+
+#define	kAttrQueryResultSnapshot		kAttrQueryResultSnapshot_be
+#define	kAttrQueryResultSnapshotForeign	kAttrQueryResultSnapshot_le
+
 #define	kAttrColumns					kAttrColumns_be
 #define	kAttrColumnsForeign				kAttrColumns_le
 
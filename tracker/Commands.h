@@ -108,6 +108,8 @@ const uint32 kContextMenuDragNDrop = '_dnd';
 const uint32 kSwitchToHome = 'Tswh';
 
 const uint32 kTestIconCache = 'TicC';
+const uint32 kRunBenchmarks = 'TrBm';
+const uint32 kRunModelMemoryTests = 'TrMm';
 
 const uint32 kRefresh = 'Resh';
 
@@ -2630,6 +2630,8 @@ BContainerWindow::AddWindowContextMenus(BMenu *menu, bool isInMenuBar)
 	menu->AddSeparatorItem();
 	BMenuItem *testing = new BMenuItem("Test Icon Cache", new BMessage(kTestIconCache));
 	menu->AddItem(testing);
+	menu->AddItem(new BMenuItem("Run Benchmarks", new BMessage(kRunBenchmarks)));
+	menu->AddItem(new BMenuItem("Test Model Memory", new BMessage(kRunModelMemoryTests)));
 #endif
 
 	// target items as needed
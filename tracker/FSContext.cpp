@@ -59,12 +59,18 @@ All rights reserved.
 //#define FS_SAME_DEVICE_OPT		1		// this will call a sync on the target node when a file is copied on the same phisical device (should speed things up)
 //#define FS_USE_SET_FILE_SIZE		1		// will call BFile::SetSize() before copy; prpbably faster, but never checked
 											// but this way in an extreme case you may end up in a properly sized file not properly copied!
+#ifdef __HAIKU__
+  #define FS_STREAM_BIG_ATTRIBUTES	1		// copy attributes bigger than the attribute buffer in offset chunks
+#else
+  #define FS_STREAM_BIG_ATTRIBUTES	0		// R5 ignores the attribute offset, big attributes are read at once
+#endif
 // 	See header file for more config stuff!!!
 
 #include "FSContext.h"
 #include "FSUtils.h"
 #include "LanguageTheme.h"
 #include "Undo.h"
+#include "md4checksum.h"
 
 // from FSUtils.cpp
 enum {
@@ -180,13 +186,20 @@ static const int32		kMaxChunkSizeDivider			= 32;				// max_mem / kMaxChunkSizeDi
 static const bigtime_t	kShrinkBufferAfterThisDelay		= 2000000;			// delay after buffer may shrink
 static const int32		kBuffersInTwoDeviceCopyMode		= 4;				// must be bigger or equal to 2
 static const int32		kReaderSemCount					= kBuffersInTwoDeviceCopyMode - 1;
+static const size_t		kAttributeBufferSize			= 64 * 1024;		// small attributes of a node are batched in a buffer of this size
+static const size_t		kJournalVerifySize				= 64 * 1024;		// this much is compared before a file copy is resumed from the journal
+static const size_t		kVerifyChunkSize				= 256 * 1024;		// the target is read back in chunks of this size with fVerifyData
+static const size_t		kDeltaChunkSize					= 1024 * 1024;		// kUpdateChanged reads this much of both files at once
+static const size_t		kDeltaBlockSize					= 16 * 1024;		// and writes the differing blocks of this size
+static const int32		kProgressReadRetries			= 16;				// progress readers snooze after this many torn reads in a row
+static const bigtime_t	kProgressReadSnooze				= 1000;				// so that an updater that got descheduled can finish
 
 #if FS_SAME_DEVICE_OPT
 static const int32		kSyncLowerLimit					= 128 * 1024;		// files smaller then this won't be flushed when they are written
 #endif
 
 uint64						FSContext::sMaxMemorySize;
-int32						FSContext::sEmptyTrashRunning = 0;
+vector<dev_t>				FSContext::sTrashesBeingEmptied;
 int32						FSContext::sInitialized = 0;
 BLocker						FSContext::sLocker;
 FSContext::node_ref_list_t	FSContext::sTrashDirList;
@@ -286,6 +299,11 @@ const FSContext::InteractionDescription		FSContext::sInteractionsTable[kTotalInt
 				 		{a, b, c, d, e, f, g, h, i, j, k, l, m, kInvalidCommand}, \
 				 		{ax, bx, cx, dx, ex, fx, gx, hx, ix, jx, kx, lx, mx, false} \
 				 	},
+	#define		INT_14(name, string, showfile, a, ax, b, bx, c, cx, d, dx, e, ex, f, fx, g, gx, h, hx, i, ix, j, jx, k, kx, l, lx, m, mx, n, nx) \
+				 	{string, showfile, \
+				 		{a, b, c, d, e, f, g, h, i, j, k, l, m, n, kInvalidCommand}, \
+				 		{ax, bx, cx, dx, ex, fx, gx, hx, ix, jx, kx, lx, mx, nx, false} \
+				 	},
 	#include		"FSInteractions.tbl"
 };
 
@@ -408,6 +426,7 @@ FSContext::PushOperation(operation iop) FS_NOTHROW {
 		mCurrentEntry = 0;			// in case of an early error in some init phase
 		SetCurrentEntryType(0);		// mark that there's no info available yet
 		mOperationStack.Push(iop);
+		mTelemetry.SetOperation(AsString(iop));
 	} else {
 		if (mOperationStack.Current() != iop)
 			mOperationStack.Push(iop);
@@ -449,6 +468,11 @@ FSContext::FSContext() FS_NOTHROW :
 							mShrinkBufferSuggestionTime(0),
 							mBuffer(0),
 							mBufferSize(0),
+							mAttributeBuffer(0),
+							mAttributeBufferSize(0),
+							mJournal(0),
+							mJournaledNode(0),
+							mCopyDigest(0),
 							mCurrentEntry(0),
 							mPossibleAnswers(fDefaultPossibleAnswers),
 							mSkipOperationTargetOperation(kInvalidOperation),
@@ -504,6 +528,8 @@ FSContext::FSContext() FS_NOTHROW :
 	
 	mMaxBufferSize = sMaxMemorySize / kMemsizeDividerForCopyBuffer;
 	
+	gTelemetryLog().Register(&mTelemetry);
+	
 	if (gTrackerSettings.UndoEnabled())
 		gUndoHistory.PrepareUndoContext(this);
 }
@@ -514,8 +540,12 @@ FSContext::~FSContext() FS_NOTHROW
 		gUndoHistory.CommitUndoContext(this);
 	
 	delete [] mBuffer;
+	delete [] mAttributeBuffer;
 	delete mChunkList;
 
+	for (name_index_map_t::iterator i = mNameIndexes.begin();  i != mNameIndexes.end();  ++i)
+		delete i -> second;
+
 	for (int32 i = 0;  mWriterThreadRunning == true;  ++i) {	// wait for the writer thread to realize that we are quitting...
 		snooze(100000);
 		ASSERT(i < 10);
@@ -530,6 +560,9 @@ FSContext::~FSContext() FS_NOTHROW
 		}
 		#endif
 	}
+
+	delete mJournal;		// after the writer thread, it may be checkpointing
+	gTelemetryLog().Unregister(&mTelemetry);
 }
 
 void
@@ -749,9 +782,80 @@ FSContext::ResetProgressIndicator() FS_NOTHROW {
 	mProgressInfo.Clear();
 }
 
+void
+FSContext::ProgressInfo::EndFile(off_t old_current_size) FS_NOTHROW {
+	BeginUpdate();
+	off_t current_size = CurrentSize();
+	if (current_size < old_current_size + mCurrentFileTotalSize)	// if file was not finished
+		mDiscardedSize += current_size - old_current_size;			// restore old total size
+	mCurrentFileTotalSize = 0;	// means that there's no file copy progressbar
+	EndUpdate();
+}
+
+off_t
+FSContext::ProgressInfo::WrittenSize(int32 *sequence) const FS_NOTHROW {
+	for (int32 tries = 1;  ;  ++tries) {
+		if (tries % kProgressReadRetries == 0)
+			snooze(kProgressReadSnooze);
+		
+		int32 before = mWriteSequence;
+		if (before & 1)
+			continue;							// the writer is in the middle of an update
+		
+		off_t size = mWrittenSize;
+		
+		if (mWriteSequence == before) {
+			if (sequence)
+				*sequence = before;
+			return size;
+		}
+	}
+}
+
+off_t
+FSContext::ProgressInfo::CurrentFileCurrentSize() const FS_NOTHROW {
+	off_t written = WrittenSize() - mCurrentFileWrittenStart;
+	if (written < 0)							// the writer is still busy with the previous file
+		written = 0;
+	
+	return (mReadSize - mCurrentFileReadStart + written) / 2;
+}
+
+void
+FSContext::ProgressInfo::GetSnapshot(Snapshot &snapshot) const FS_NOTHROW {
+	for (int32 tries = 1;  ;  ++tries) {
+		if (tries % kProgressReadRetries == 0)
+			snooze(kProgressReadSnooze);
+		
+		int32 before = mSequence;
+		if (before & 1)
+			continue;
+		
+		int32 write_sequence;
+		off_t written = WrittenSize(&write_sequence);
+		off_t file_written = written - mCurrentFileWrittenStart;
+		if (file_written < 0)
+			file_written = 0;
+		
+		snapshot.mCurrentFileTotalSize		= mCurrentFileTotalSize;
+		snapshot.mCurrentFileCurrentSize	= (mReadSize - mCurrentFileReadStart + file_written) / 2;
+		snapshot.mTotalSize					= mTotalSize;
+		snapshot.mCurrentSize				= (mReadSize + written) / 2 - mDiscardedSize;
+		snapshot.mTotalEntryCount			= mTotalEntryCount;
+		snapshot.mCurrentEntryCount			= mCurrentEntryCount;
+		snapshot.mTotalDisabled				= mTotalDisabled;
+		snapshot.mTotalSizeProgressEnabled	= mTotalSizeProgressEnabled;
+		
+		if (mSequence == before) {
+			snapshot.mGeneration = before + write_sequence;		// both only grow
+			return;
+		}
+	}
+}
+
 void
 FSContext::ProgressInfo::PrintToStream() {
-	printf("mTotalSize:\t%Ld\nmCurrentSize:\t%Ld\nTotalSizeProgress:\t%.2f\n", mTotalSize, mCurrentSize, TotalSizeProgress());
+	printf("mTotalSize:\t%Ld\nCurrentSize:\t%Ld\nTotalSizeProgress:\t%.2f\n", mTotalSize, CurrentSize(), TotalSizeProgress());
 }
 
 void
@@ -990,10 +1094,7 @@ FSContext::RawCopyLink(const BEntry &source_entry, BDirectory &target_dir, char
 			entry_ref orig_ref;
 			source_entry.GetRef(&orig_ref);
 			
-			BMessage *undo = new BMessage(kCopySelectionTo);
-			undo->AddRef("new_ref", &new_ref);
-			undo->AddRef("orig_ref", &orig_ref);
-			gUndoHistory.AddItemToContext(undo, this);
+			gUndoHistory.AddEntryToContext(kCopySelectionTo, orig_ref, new_ref, this);
 		}
 	}
 
@@ -1012,7 +1113,7 @@ FSContext::CopyLink(EntryIterator &i, BEntry &source_entry, BDirectory &target_d
 		BEntry entry;
 		
 		FS_OPERATION(entry.SetTo(&target_dir, target_name));
-		if (entry.Exists() == false)
+		if (TargetExists(target_dir, target_name, &entry) == false)
 			break;
 
 		char name_buf[B_FILE_NAME_LENGTH];
@@ -1046,14 +1147,16 @@ FSContext::CopyLink(EntryIterator &i, BEntry &source_entry, BDirectory &target_d
 				FS_SET_OPERATION(kRenaming);
 				FS_ADD_POSSIBLE_ANSWER(fIgnore);
 				FS_OPERATION(entry.Rename(name_buf));
+				TargetNameChanged(target_dir, name_buf, true);
 				break;
 			}
 			case kMakeUniqueName:
-				MakeUniqueName(target_dir, target_name);
+				MakeUniqueTargetName(target_dir, target_name);
 				break;
 				
 			case kMoveTargetToTrash:
 				MoveToTrash(TargetDevice(), entry);
+				TargetNameChanged(target_dir, target_name, false);
 				break;
 			
 			case kRetryOperation:
@@ -1209,6 +1312,11 @@ FSContext::CopyDirectory(EntryIterator &i, BEntry &source_entry, BDirectory &tar
 				FS_BACKUP_VARIABLE_AND_SET(mSourceNewName, target_name);
 				FS_BACKUP_VARIABLE_AND_SET(mTargetNewName, name_buf);
 				FS_BACKUP_VARIABLE_AND_SET(mTargetEntry, &target_entry);
+				
+				if (icode == kDirectoryAlreadyExists  &&  ResumableDirectory(source_entry)) {
+					target_dir_ok = true;
+					continue;
+				}
 		
 				switch ((int32)Interaction(icode)) {
 					case kEnterBoth:
@@ -1232,6 +1340,7 @@ FSContext::CopyDirectory(EntryIterator &i, BEntry &source_entry, BDirectory &tar
 						FS_ADD_POSSIBLE_ANSWER(fIgnore);
 						FS_OPERATION(new_dir.GetEntry(&e));
 						FS_OPERATION(e.Rename(name_buf));
+						TargetNameChanged(target_dir, name_buf, true);
 						continue;
 					}
 					
@@ -1250,7 +1359,7 @@ FSContext::CopyDirectory(EntryIterator &i, BEntry &source_entry, BDirectory &tar
 					}
 					case kMakeUniqueName:
 	
-						MakeUniqueName(target_dir, target_name);	// substitute target with the new unique name
+						MakeUniqueTargetName(target_dir, target_name);	// substitute target with the new unique name
 						break;
 						
 					case kRetryOperation:
@@ -1270,6 +1379,8 @@ FSContext::CopyDirectory(EntryIterator &i, BEntry &source_entry, BDirectory &tar
 		}
 
 		NextEntryCreated(target_dir, target_name);
+		
+		JournalDirectoryEntered(source_entry);
 
 		DirEntryIterator dei;
 		i.RegisterNested(dei);
@@ -1354,12 +1465,19 @@ FSContext::CopyFile(BEntry &source_entry, BDirectory &target_dir, char *target_n
 	BFile source_file, target_file;
 	BEntry target_entry;
 	
+	bigtime_t start_time = system_time();
+	off_t read_before = mTelemetry.BytesRead(), written_before = mTelemetry.BytesWritten();
+	
 	FS_OPERATION(source_file.SetTo(&source_entry, B_READ_ONLY));
+	mTelemetry.Syscall(Telemetry::kOpen);
 	
 	FS_BACKUP_VARIABLE_AND_SET(mFileCreatedByUs, false);
-	bool appending = false, touched = false;
+	bool appending = false, updating = false, touched = false;
 	off_t target_size_before_append;
 	
+	node_ref source_node;
+	FS_BACKUP_VARIABLE_AND_SET(mJournaledNode, 0);
+	
 	try {
 
 		off_t file_size;
@@ -1371,8 +1489,29 @@ FSContext::CopyFile(BEntry &source_entry, BDirectory &target_dir, char *target_n
 			char name_buf[B_FILE_NAME_LENGTH];
 			
 			FS_OPERATION(target_entry.SetTo(&target_dir, target_name));
-			if (target_entry.Exists() == false) {
+			if (TargetExists(target_dir, target_name, &target_entry) == false) {
+				CheckCancelInCopyFile();
+				
+				touched = true;
+				FS_OPERATION_ETC(target_file.SetTo(&target_dir, target_name, B_WRITE_ONLY | B_CREATE_FILE | B_FAIL_IF_EXISTS),
+								rc != B_FILE_EXISTS, NOP);
+				if (rc == B_FILE_EXISTS) {		// created by someone else since the check, ask what to do with it
+					touched = false;
+					TargetNameChanged(target_dir, target_name, true);
+					continue;
+				}
+				mTelemetry.Syscall(Telemetry::kCreate);
 				mFileCreatedByUs = true;
+				
+				if (gTrackerSettings.UndoEnabled()) {
+					BEntry entry(&target_dir, target_name);
+					entry_ref new_ref;
+					entry.GetRef(&new_ref);
+					entry_ref orig_ref;
+					source_entry.GetRef(&orig_ref);
+									
+					gUndoHistory.AddEntryToContext(kCopySelectionTo, orig_ref, new_ref, this);
+				}
 				break;
 			}
 			
@@ -1380,6 +1519,23 @@ FSContext::CopyFile(BEntry &source_entry, BDirectory &target_dir, char *target_n
 			FS_BACKUP_VARIABLE_AND_SET(mTargetNewName, name_buf);
 			FS_BACKUP_VARIABLE_AND_SET(mTargetEntry, &target_entry);
 			
+			off_t resume_offset;
+			if (target_entry.IsFile()  &&  ResumableFile(source_file, target_entry, file_size, &resume_offset)) {
+			
+				if (resume_offset == file_size) {		// an earlier run of this operation has finished it
+					mProgressInfo.DecreaseTotalSize(file_size);
+					return;
+				}
+				
+				FS_OPERATION(target_file.SetTo(&target_entry, B_WRITE_ONLY));
+				FS_OPERATION(target_file.SetSize(resume_offset));		// drop what could not be verified
+				mTelemetry.Syscall(Telemetry::kSetSize);
+				FS_OPERATION(target_file.Seek(resume_offset, SEEK_SET));
+				FS_OPERATION(source_file.Seek(resume_offset, SEEK_SET));
+				mProgressInfo.DecreaseTotalSize(resume_offset);
+				break;
+			}
+			
 			if (target_entry.IsFile())
 				cmd = Interaction(kFileAlreadyExists);
 			else
@@ -1404,12 +1560,13 @@ FSContext::CopyFile(BEntry &source_entry, BDirectory &target_dir, char *target_n
 				FS_SET_OPERATION(kRenaming);
 				FS_ADD_POSSIBLE_ANSWER(fIgnore);
 				FS_OPERATION(target_entry.Rename(name_buf));
+				TargetNameChanged(target_dir, name_buf, true);
 				continue;
 
 			} else if (cmd == kMoveTargetToTrash) {
 			
 				MoveToTrash(TargetDevice(), target_entry);
-				FS_OPERATION(target_entry.SetTo(&target_dir, target_name));
+				TargetNameChanged(target_dir, target_name, false);
 				continue;
 				
 			} else if (cmd == kAppend) {
@@ -1420,6 +1577,13 @@ FSContext::CopyFile(BEntry &source_entry, BDirectory &target_dir, char *target_n
 				appending = true;
 				break;
 				
+			} else if (cmd == kUpdateChanged) {
+			
+				ASSERT(target_entry.IsFile());
+				FS_OPERATION(target_file.SetTo(&target_entry, B_READ_WRITE));
+				updating = true;
+				break;
+				
 			} else if (cmd == kContinueFile) {
 			
 				ASSERT(target_entry.IsFile());
@@ -1428,12 +1592,12 @@ FSContext::CopyFile(BEntry &source_entry, BDirectory &target_dir, char *target_n
 				FS_OPERATION(target_file.GetSize(&stmp));
 				ASSERT(stmp < file_size);
 				FS_OPERATION(source_file.Seek(stmp, SEEK_SET));
-				mProgressInfo.mTotalSize -= stmp;
+				mProgressInfo.DecreaseTotalSize(stmp);
 				break;
 				
 			} else if (cmd == kMakeUniqueName) {
 			
-				MakeUniqueName(target_dir, target_name);	// substitute target with the new unique name
+				MakeUniqueTargetName(target_dir, target_name);	// substitute target with the new unique name
 			} else if (cmd == kRetryOperation) {
 				
 				continue;
@@ -1445,24 +1609,6 @@ FSContext::CopyFile(BEntry &source_entry, BDirectory &target_dir, char *target_n
 		
 		CheckCancelInCopyFile();
 		
-		if (target_file.InitCheck() != B_OK) {
-			touched = true;
-			FS_OPERATION(target_file.SetTo(&target_dir, target_name, B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE));
-			
-			if (gTrackerSettings.UndoEnabled()) {
-				BEntry entry(&target_dir, target_name);
-				entry_ref new_ref;
-				entry.GetRef(&new_ref);
-				entry_ref orig_ref;
-				source_entry.GetRef(&orig_ref);
-								
-				BMessage *undo = new BMessage(kCopySelectionTo);
-				undo->AddRef("new_ref", &new_ref);
-				undo->AddRef("orig_ref", &orig_ref);
-				gUndoHistory.AddItemToContext(undo, this);
-			}
-		}
-		
 		source_entry.Unset();		// spare some fd's
 		
 		NextEntryCreated(target_dir, target_name);
@@ -1493,7 +1639,20 @@ FSContext::CopyFile(BEntry &source_entry, BDirectory &target_dir, char *target_n
 											// it's destructed before the end of the file. required
 											// partly to keep the progress info in sync
 		
-		if (mSameDevice) {
+		if (appending == false  &&  source_file.GetNodeRef(&source_node) == B_OK) {
+			mJournaledNode = &source_node;		// offsets in an appended file would mean nothing to a resume
+			CheckpointJournal(target_file);
+		}
+		
+		MD4Checksum digest;
+		off_t verify_from = (appending) ? target_size_before_append : source_file.Position();	// only what is written now goes through the digest
+		FS_BACKUP_VARIABLE_AND_SET(mCopyDigest, (ShouldCopy(fVerifyData)) ? &digest : 0);
+		
+		if (updating) {
+		
+			CopyChangedBlocks(source_file, target_file);
+			
+		} else if (mSameDevice) {
 		
 			SuggestBufferSize(file_size);
 			CopyFileInnerLoop(source_file, target_file, file_size);
@@ -1516,14 +1675,22 @@ FSContext::CopyFile(BEntry &source_entry, BDirectory &target_dir, char *target_n
 		}
 		#endif
 
+		if (mCopyDigest != 0) {
+			FS_SET_OPERATION(kVerifyingFile);
+			FS_REMOVE_POSSIBLE_ANSWER(fRetryOperation);		// reading the same data back again wouldn't change the outcome
+			FS_OPERATION(VerifyCopy(target_entry, verify_from, digest));
+		}
+
 	} catch (FSException e) {
 	
 		if (touched) {
 			
+			CheckpointJournal(target_file, true);		// if the file is kept, the next run may continue it
+			
 			FS_SET_OPERATION(kCleaningUp);
 			FS_REMOVE_POSSIBLE_ANSWER(fRetryEntry | fSkipEntry | fSkipDirectory | fRetryOperation);
 			
-			if ((mFileCreatedByUs  ||  ! IsThrowableCommand(static_cast<command>(e)))  &&   // or some unknown exception
+			if ((mFileCreatedByUs  ||  updating  ||  ! IsThrowableCommand(static_cast<command>(e)))  &&   // or some unknown exception
 					target_entry.Exists()) {
 						
 				switch (Interaction(kAboutToCleanupFile)) {
@@ -1558,6 +1725,103 @@ FSContext::CopyFile(BEntry &source_entry, BDirectory &target_dir, char *target_n
 	CopyAdditionals(source_file, target_file);
 
 	ThrowIfNecessary(mThrowThisAfterFileCopyFinished);
+	
+	mTelemetry.FileDone(system_time() - start_time, mSourceDevice, mTelemetry.BytesRead() - read_before,
+						TargetDevice(), mTelemetry.BytesWritten() - written_before);
+}
+
+void	// Precond: target is opened for reading and writing. compares the files block by block and writes only the blocks that differ
+FSContext::CopyChangedBlocks(BFile &source_file, BFile &target_file) FS_THROW_FSEXCEPTION {
+
+	status_t rc;
+
+	SuggestBufferSize(2 * kDeltaChunkSize);
+	FS_BACKUP_VARIABLE_AND_SET(mBufferReleasable, false);
+
+	size_t chunk_size = BufferSize() / 2;
+	if (chunk_size > kDeltaChunkSize)
+		chunk_size = kDeltaChunkSize;
+	chunk_size -= chunk_size % kDeltaBlockSize;
+	
+	uint8 *source_buffer = Buffer();
+	uint8 *target_buffer = Buffer() + chunk_size;
+	off_t pos = source_file.Position();
+	
+	for (;;) {
+	
+		CheckCancelInCopyFile();
+		CheckpointJournal(target_file);
+		
+		ssize_t source_read, target_read;
+		{
+			FS_SET_OPERATION(kReadingFile);
+			
+			while ((source_read = source_file.ReadAt(pos, source_buffer, chunk_size)) < 0) {
+				if (ErrorHandler(source_read) == false)
+					TRESPASS();							// this is an illegal false return from ErrorHandler
+			}
+			
+			if (source_read == 0)
+				break;
+			
+			mTelemetry.Read(source_read);
+			if (mCopyDigest != 0)
+				mCopyDigest -> Process((char *)source_buffer, source_read);
+			
+			while ((target_read = target_file.ReadAt(pos, target_buffer, source_read)) < 0) {
+				if (ErrorHandler(target_read) == false)
+					TRESPASS();
+			}
+			mTelemetry.Read(target_read);
+			
+			mProgressInfo.ReadProgress(source_read);
+		}
+		
+		{
+			FS_SET_OPERATION(kWritingFile);
+		
+			ssize_t block = 0;
+			while (block < source_read) {
+			
+				// find the next run of differing blocks, the tail beyond the old target size always differs
+				ssize_t end = block;
+				while (end < source_read) {
+					ssize_t size = (source_read - end > (ssize_t)kDeltaBlockSize) ? (ssize_t)kDeltaBlockSize : source_read - end;
+					if (end + size <= target_read  &&  memcmp(source_buffer + end, target_buffer + end, size) == 0) {
+						if (end > block)
+							break;
+						block = end += size;		// same, skip it
+						continue;
+					}
+					end += size;
+				}
+				
+				while (block < end) {
+					ssize_t written;
+					while ((written = target_file.WriteAt(pos + block, source_buffer + block, end - block)) < 0) {
+						if (ErrorHandler(written) == false)
+							TRESPASS();
+					}
+					mTelemetry.Written(written);
+					block += written;
+				}
+			}
+			
+			mProgressInfo.WriteProgress(source_read);
+		}
+		
+		pos += source_read;
+		target_file.Seek(pos, SEEK_SET);		// for the journal
+	}
+	
+	FS_SET_OPERATION(kSettingFileSize);
+	
+	off_t target_size;
+	FS_OPERATION(target_file.GetSize(&target_size));
+	if (target_size != pos) {
+		FS_OPERATION(target_file.SetSize(pos));		// truncate, the source got shorter
+		mTelemetry.Syscall(Telemetry::kSetSize);
+	}
 }
 
 void
@@ -1656,11 +1920,13 @@ FSContext::CopyFileReaderThread(BFile *file, ChunkList *chunks, sem_id chunk_sem
 			}
 			
 			mProgressInfo.ReadProgress(this_chunk);
+			mTelemetry.Read(this_chunk);
 			
 			if (skip_recalc == false  &&  this_chunk != 0)
 				CalculateNewChunkSize(chunk_size, max_chunk_size, start_time);
 	
 			{
+				Telemetry::BlockedTimer bt(mTelemetry.mReaderBlocked);
 				#if FS_MONITOR_THREAD_WAITINGS
 					RunStopWatch rsw(mReaderThreadWaiting);
 				#endif
@@ -1736,6 +2002,7 @@ FSContext::CopyFileWriterThread(BFile *file, ChunkList *chunks, sem_id chunk_sem
 		for (;;) {
 			
 			{
+				Telemetry::BlockedTimer bt(mTelemetry.mWriterBlocked);
 				#if FS_MONITOR_THREAD_WAITINGS
 					RunStopWatch rsw(mWriterThreadWaiting);
 				#endif
@@ -1775,14 +2042,20 @@ FSContext::CopyFileWriterThread(BFile *file, ChunkList *chunks, sem_id chunk_sem
 				}
 				
 				mProgressInfo.WriteProgress(this_chunk);
+				mTelemetry.Written(this_chunk);
 				buffer_pos += this_chunk;
 				write_pos += this_chunk;
 			}
 			
+			if (mCopyDigest != 0)		// here, so that the digest is calculated parallel with reading the next chunks
+				mCopyDigest -> Process((char *)chunk_struct -> first, chunk_struct -> second);
+			
 			delete [] chunk_struct -> first;
 			delete chunk_struct;
 			chunk_struct = 0;
 			
+			CheckpointJournal(*file);
+			
 			release_sem_etc(reader_sem, 1, B_DO_NOT_RESCHEDULE);
 		}
 		
@@ -1820,6 +2093,7 @@ FSContext::CopyFileInnerLoop(BFile &source_file, BFile &target_file, off_t file_
 	while (keep_on) {
 	
 		CheckCancelInCopyFile();
+		CheckpointJournal(target_file);
 		
 		write_pos = read_pos;								// store current position
 		
@@ -1865,6 +2139,9 @@ FSContext::CopyFileInnerLoop(BFile &source_file, BFile &target_file, off_t file_
 						}
 						
 						mProgressInfo.ReadProgress(this_chunk);
+						mTelemetry.Read(this_chunk);
+						if (mCopyDigest != 0)
+							mCopyDigest -> Process((char *)buffer_pos, this_chunk);
 						read_pos += this_chunk;
 						buffer_pos += this_chunk;
 					}				
@@ -1887,6 +2164,7 @@ FSContext::CopyFileInnerLoop(BFile &source_file, BFile &target_file, off_t file_
 							}
 							
 							mProgressInfo.WriteProgress(this_chunk);
+							mTelemetry.Written(this_chunk);
 							buffer_pos += this_chunk;
 							write_pos += this_chunk;
 						}
@@ -1928,6 +2206,7 @@ FSContext::CopyFileInnerLoop(BFile &source_file, BFile &target_file, off_t file_
 					}
 					
 					mProgressInfo.WriteProgress(this_chunk);
+					mTelemetry.Written(this_chunk);
 					buffer_pos += this_chunk;
 					write_pos += this_chunk;
 					
@@ -1997,6 +2276,7 @@ FSContext::CopyEntry(EntryIterator &i, EntryRef &ref, BDirectory &target_dir, co
 		FS_OPERATION(entry.SetTo(&mSourceDir, ref.Name()));
 		
 		FS_OPERATION(entry.GetStat(&statbuf));
+		mTelemetry.Syscall(Telemetry::kStat);
 		SetCurrentEntryType(statbuf.st_mode);
 	}
 
@@ -2027,6 +2307,8 @@ FSContext::CopyEntry(EntryIterator &i, EntryRef &ref, BDirectory &target_dir, co
 	
 			Interaction(kIrregularFile);
 		}
+		
+		JournalEntryDone(statbuf);
 	} catch (FSException e) {
 	
 		if (e == kSkipEntry) {			// if we skip the entry then alter the progress indicator
@@ -2179,14 +2461,19 @@ FSContext::CopyTo(EntryIterator &i, BDirectory &target_dir) FS_NOTHROW {
 		
 		CheckFreeSpaceOnTarget(mProgressInfo.mTotalSize, kNotEnoughFreeSpace);
 
+		BeginJournal(i, target_dir, kCopying);
+
 		OperationBegins();
 
 		CopyRecursive(i, target_dir, true);
 		
 	} catch (FSException e) {
+		EndJournal(false);
 		return e;
 	}
 	
+	EndJournal(true);
+	
 	return B_OK;
 }
 
@@ -2362,6 +2649,7 @@ FSContext::MoveToRecursive(EntryIterator &i, BDirectory &target_dir, bool first_
 						break;
 					}
 					
+					mTelemetry.Syscall(Telemetry::kRename);
 					switch ((rc = entry.MoveTo(&target_dir, name, clobber))) {
 						default:
 							if (ErrorHandler(rc) == false)
@@ -2382,10 +2670,7 @@ FSContext::MoveToRecursive(EntryIterator &i, BDirectory &target_dir, bool first_
 								entry_ref new_ref;
 								entry.GetRef(&new_ref);
 								
-								BMessage *undo = new BMessage(kMoveSelectionTo);
-								undo->AddRef("new_ref", &new_ref);
-								undo->AddRef("orig_ref", &orig_ref);
-								gUndoHistory.AddItemToContext(undo, this);
+								gUndoHistory.AddEntryToContext(kMoveSelectionTo, orig_ref, new_ref, this);
 							}
 							continue;
 						
@@ -2446,7 +2731,7 @@ FSContext::MoveToRecursive(EntryIterator &i, BDirectory &target_dir, bool first_
 									continue;
 									
 								case kMakeUniqueName:
-									MakeUniqueName(target_dir, name_buf);
+									MakeUniqueTargetName(target_dir, name_buf);
 									name = name_buf;
 									continue;
 	
@@ -2563,19 +2848,23 @@ FSContext::MoveTo(EntryIterator &i, BDirectory &target_dir) FS_NOTHROW {
 		}
 				
 		ResetProgressIndicator();
-		mProgressInfo.mTotalEntryCount = i.CountEntries();
-		mProgressInfo.SetDirty();
+		mProgressInfo.SetTotalEntryCount(i.CountEntries());
 		InitProgressIndicator();
 		
 		FS_ADD_POSSIBLE_ANSWER(fRetryEntry + fSkipEntry);
 		
+		BeginJournal(i, target_dir, kMoving);	// only written if some entry has to be copied to an other volume
+
 		OperationBegins();
 		MoveToRecursive(i, target_dir, true);	// first run
 		
 	} catch (FSException e) {
+		EndJournal(false);
 		return e;
 	}
 	
+	EndJournal(true);
+	
 	return B_OK;
 }
 
@@ -2703,10 +2992,7 @@ FSContext::RestoreFromTrash(BEntry &entry) FS_THROW_FSEXCEPTION {
 					entry_ref new_ref;
 					entry.GetRef(&new_ref);
 								
-					BMessage *undo = new BMessage(kRestoreFromTrash);
-					undo->AddRef("new_ref", &new_ref);
-					undo->AddRef("orig_ref", &orig_ref);
-					gUndoHistory.AddItemToContext(undo, this);
+					gUndoHistory.AddEntryToContext(kRestoreFromTrash, orig_ref, new_ref, this);
 				}	
 				break;
 
@@ -2750,8 +3036,7 @@ FSContext::RestoreFromTrash(EntryIterator &i) FS_NOTHROW {
 	FS_SET_OPERATION(kRestoringFromTrash);
 	
 	ResetProgressIndicator();
-	mProgressInfo.mTotalEntryCount = i.CountEntries();
-	mProgressInfo.SetDirty();
+	mProgressInfo.SetTotalEntryCount(i.CountEntries());
 	InitProgressIndicator();
 	
 	FS_ADD_POSSIBLE_ANSWER(fRetryEntry + fSkipEntry);
@@ -2848,7 +3133,8 @@ FSContext::MoveToTrash(dev_t device, BEntry &entry, BDirectory &trash_dir) FS_TH
 	FS_OPERATION(entry.GetPath(&old_path));
 	
 	do {
-		MakeUniqueName(trash_dir, name);
+		MakeUniqueTargetName(trash_dir, name);
+		mTelemetry.Syscall(Telemetry::kRename);
 		FS_OPERATION_ETC(entry.MoveTo(&trash_dir, name), rc != B_ENTRY_NOT_FOUND  &&  rc != B_FILE_EXISTS, NOP);
 	} while (rc == B_FILE_EXISTS);
 	
@@ -2864,10 +3150,7 @@ FSContext::MoveToTrash(dev_t device, BEntry &entry, BDirectory &trash_dir) FS_TH
 		entry_ref new_ref;
 		entry.GetRef(&new_ref);
 		
-		BMessage *undo = new BMessage(kDelete); // kMoveToTrash gives 22 here?!
-		undo->AddRef("new_ref", &new_ref);
-		undo->AddRef("orig_ref", &orig_ref);
-		gUndoHistory.AddItemToContext(undo, this);
+		gUndoHistory.AddEntryToContext(kDelete, orig_ref, new_ref, this); // kMoveToTrash gives 22 here?!
 	}	
 
 	if (is_dir)
@@ -2903,8 +3186,7 @@ FSContext::MoveToTrash(EntryIterator &i) FS_NOTHROW {
 	FS_SET_OPERATION(kMovingToTrash);
 	
 	ResetProgressIndicator();
-	mProgressInfo.mTotalEntryCount = i.CountEntries();
-	mProgressInfo.SetDirty();
+	mProgressInfo.SetTotalEntryCount(i.CountEntries());
 	InitProgressIndicator();
 	
 	FS_ADD_POSSIBLE_ANSWER(fRetryEntry + fSkipEntry);
@@ -3108,7 +3390,8 @@ FSContext::CopyAdditionals(BNode &source, BNode &target) FS_THROW_FSEXCEPTION {
 
 
 
-void
+void		// small attributes are read into the attribute buffer one after the other and written out in one go,
+		// bigger ones are streamed through the same buffer
 FSContext::CopyAttributes(BNode &source, BNode &target) FS_THROW_FSEXCEPTION {
 
 	if (mTargetVolume.KnowsAttr() == false)
@@ -3117,54 +3400,139 @@ FSContext::CopyAttributes(BNode &source, BNode &target) FS_THROW_FSEXCEPTION {
 	status_t rc;
 
 	source.RewindAttrs();
-	char name[B_ATTR_NAME_LENGTH];
+	mPendingAttributes.clear();
+
+	PendingAttribute attr;
+	size_t used = 0;
 	
 	{
 		FS_SET_OPERATION(kCopyingAttributes);
 		
 		FS_ADD_POSSIBLE_ANSWER(fSkipOperation);
 		
-		while (source.GetNextAttrName(name) == B_OK) {
-			if (mSkipTrackerPoseInfoAttibute  &&  strcmp(name, kAttrPoseInfo) == 0)
-				continue;	// force auto placement when duplicating
+		try  {
+
+			while (source.GetNextAttrName(attr.mName) == B_OK) {
+				if (mSkipTrackerPoseInfoAttibute  &&  strcmp(attr.mName, kAttrPoseInfo) == 0)
+					continue;	// force auto placement when duplicating
 
-			try  {
-			
 				attr_info info;
-				FS_OPERATION(source.GetAttrInfo(name, &info));
-				
-				SuggestBufferSize(info.size);
-				
-				// XXX beos does not yet honor the offset parameter for attr read/write, so the loop below
-				// is good only if the buffer is big enough to copy attributes in one chunk. remove below lines when ok.
-				if (BufferSize() < info.size) {
-					TRESPASS();
-					FS_ERROR_THROW(	"Attribute is too big to fit in buffer! And R5 BeOS does not honor the offset parameter"
-										"for attribute read/writes.", B_NO_MEMORY);
+				FS_OPERATION(source.GetAttrInfo(attr.mName, &info));
+
+				attr.mType = info.type;
+				attr.mSize = (size_t)info.size;
+
+				if (used + attr.mSize > AttributeBufferSize()) {
+					WritePendingAttributes(target);				// make room
+					used = 0;
 				}
 				
-				size_t size, written = 0;
-				while (written < info.size) {
-				
-					{
-						FS_SET_OPERATION(kReadingAttribute);
-						FS_OPERATION(size = source.ReadAttr(name, B_ANY_TYPE, written, Buffer(), BufferSize()));
-					}
+				ReserveAttributeBuffer(attr.mSize);
 
-					{
-						FS_SET_OPERATION(kWritingAttribute);
-						FS_OPERATION(target.WriteAttr(name, info.type, written, Buffer(), size));
-					}
+				if (attr.mSize > AttributeBufferSize()) {
+					StreamAttribute(source, target, attr);
+					continue;
+				}
 
-					written += size;
+				{
+					FS_SET_OPERATION(kReadingAttribute);
+					FS_OPERATION(rc = source.ReadAttr(attr.mName, B_ANY_TYPE, 0, mAttributeBuffer + used, attr.mSize));
+					mTelemetry.AttributeRead(rc);
 				}
-							
+
+				attr.mSize = rc;							// it may have shrunk since GetAttrInfo()
+				attr.mOffset = used;
+				used += attr.mSize;
+				mPendingAttributes.push_back(attr);
+			}
+
+			WritePendingAttributes(target);
+						
+		} catch (FSException e) {
+
+			FS_FILTER_EXCEPTION(kSkipOperation, NOP);
+
+			try {
+				WritePendingAttributes(target);				// the ones read before the skipped one are still copied
 			} catch (FSException e) {
-	
-				FS_FILTER_EXCEPTION(kSkipOperation, return);
+				FS_FILTER_EXCEPTION(kSkipOperation, NOP);
 			}
 		}
 	}
+
+	mPendingAttributes.clear();
+}
+
+void		// grows the attribute buffer if it is not allocated yet or in_size must fit in it; precond: nothing is pending
+FSContext::ReserveAttributeBuffer(size_t in_size) FS_NOTHROW {
+
+	size_t size = kAttributeBufferSize;
+
+#if !FS_STREAM_BIG_ATTRIBUTES
+	if (in_size > size)
+		size = in_size;					// the whole attribute must be read at once
+#else
+	(void)in_size;
+#endif
+
+	if (mAttributeBufferSize < size) {
+		ASSERT(mPendingAttributes.empty());
+		
+		delete [] mAttributeBuffer;
+		mAttributeBuffer = new uint8[size];
+		mAttributeBufferSize = size;
+	}
+}
+
+void
+FSContext::WritePendingAttributes(BNode &target) FS_THROW_FSEXCEPTION {
+
+	status_t rc;
+	FS_SET_OPERATION(kWritingAttribute);
+
+	attribute_list_t::iterator pos = mPendingAttributes.begin(), end = mPendingAttributes.end();
+	
+	try {
+
+		for (;  pos != end;  ++pos) {
+			FS_OPERATION(target.WriteAttr(pos -> mName, pos -> mType, 0, mAttributeBuffer + pos -> mOffset, pos -> mSize));
+			mTelemetry.AttributeWritten(pos -> mSize);
+		}
+
+	} catch (FSException e) {
+
+		mPendingAttributes.erase(mPendingAttributes.begin(), pos + 1);		// the failed one is skipped as well
+		throw;
+	}
+	
+	mPendingAttributes.clear();
+}
+
+void		// precond: the attribute buffer is empty
+FSContext::StreamAttribute(BNode &source, BNode &target, const PendingAttribute &in_attr) FS_THROW_FSEXCEPTION {
+
+	status_t rc;
+	size_t size, written = 0;
+	
+	while (written < in_attr.mSize) {
+	
+		{
+			FS_SET_OPERATION(kReadingAttribute);
+			FS_OPERATION(rc = source.ReadAttr(in_attr.mName, B_ANY_TYPE, written, mAttributeBuffer, AttributeBufferSize()));
+			mTelemetry.AttributeRead(rc);
+		}
+
+		if ((size = rc) == 0)
+			break;									// it was truncated meanwhile
+
+		{
+			FS_SET_OPERATION(kWritingAttribute);
+			FS_OPERATION(target.WriteAttr(in_attr.mName, in_attr.mType, written, mAttributeBuffer, size));
+			mTelemetry.AttributeWritten(size);
+		}
+
+		written += size;
+	}
 }
 
 status_t
@@ -3237,15 +3605,32 @@ FSContext::MakeUniqueName(BPath &path, const char *suffix) FS_THROW_FSEXCEPTION
 	char name_buf[B_FILE_NAME_LENGTH];
 	strcpy(name_buf, path.Leaf());
 	
-	MakeUniqueName(dir, name_buf, suffix);
+	MakeUniqueTargetName(dir, name_buf, suffix);
 	
 	FS_OPERATION(path.SetTo(str.String(), name_buf));
 }
 
+bool	// names found in the index are taken as occupied (at worst a free name is passed over), the others are checked
+FSContext::IsNameTaken(BDirectory &dir, const char *name, NameIndex *index) FS_NOTHROW {
+
+	if (index == 0)
+		return dir.Contains(name);
+		
+	if (index -> Contains(name))
+		return true;
+		
+	if (dir.Contains(name)) {
+		index -> Add(name);		// created by someone else meanwhile
+		return true;
+	}
+	
+	return false;
+}
+
 void
-FSContext::MakeUniqueName(BDirectory &dir, char *name, const char *suffix) FS_NOTHROW {
+FSContext::MakeUniqueName(BDirectory &dir, char *name, const char *suffix, NameIndex *index) FS_NOTHROW {
 
-	if ( ! dir.Contains(name))
+	if ( ! IsNameTaken(dir, name, index))
 		return;
 
 	char	root[B_FILE_NAME_LENGTH];
@@ -3321,7 +3706,7 @@ FSContext::MakeUniqueName(BDirectory &dir, char *name, const char *suffix) FS_NO
 	// if name already exists then add a number
 	fnum = 1;
 	strcpy(tmp, base);
-	while (dir.Contains(tmp)) {
+	while (IsNameTaken(dir, tmp, index)) {
 		sprintf(tmp, "%s %ld", base, ++fnum);
 
 		if (strlen(tmp) > (B_FILE_NAME_LENGTH - 1)) {
@@ -3342,6 +3727,240 @@ FSContext::MakeUniqueName(BDirectory &dir, char *name, const char *suffix) FS_NO
 	strcpy(name, tmp);
 }
 
+void
+FSContext::MakeUniqueTargetName(BDirectory &dir, char *name, const char *suffix) FS_NOTHROW {
+	MakeUniqueName(dir, name, suffix, TargetNameIndex(dir));
+}
+
+FSContext::NameIndex *	// returns zero when the directory is used for the first time, the index is only worth it from the second
+FSContext::TargetNameIndex(BDirectory &dir) FS_NOTHROW {
+
+	node_ref ref;
+	if (dir.GetNodeRef(&ref) != B_OK)
+		return 0;
+
+	NameIndex *&index = mNameIndexes[ref];
+	if (index == 0)
+		index = new NameIndex();
+
+	index -> Used();
+	if (index -> IsBuilt() == false  &&  index -> Uses() >= 2)
+		index -> Build(dir);
+
+	return index -> IsBuilt() ? index : 0;
+}
+
+FSContext::NameIndex *
+FSContext::BuiltTargetNameIndex(BDirectory &dir) FS_NOTHROW {
+
+	if (mNameIndexes.empty())
+		return 0;
+
+	node_ref ref;
+	if (dir.GetNodeRef(&ref) != B_OK)
+		return 0;
+
+	name_index_map_t::iterator i = mNameIndexes.find(ref);
+	if (i == mNameIndexes.end()  ||  i -> second -> IsBuilt() == false)
+		return 0;
+
+	return i -> second;
+}
+
+bool	// collision check; others may change the directory, so it is always asked (through entry if it is set to the name
+		// already) and the index is brought up to date with the answer
+FSContext::TargetExists(BDirectory &dir, const char *name, BEntry *entry) FS_NOTHROW {
+
+	bool exists = (entry) ? entry -> Exists() : BEntry(&dir, name).Exists();
+	TargetNameChanged(dir, name, exists);
+
+	return exists;
+}
+
+void
+FSContext::TargetNameChanged(BDirectory &dir, const char *name, bool exists) FS_NOTHROW {
+
+	NameIndex *index = BuiltTargetNameIndex(dir);
+	if (index == 0)
+		return;
+
+	if (exists)
+		index -> Add(name);
+	else
+		index -> Remove(name);
+}
+
+void	// the id tells apart operations with different sources or targets, the journal of the same operation is read back
+FSContext::BeginJournal(EntryIterator &i, BDirectory &target_dir, operation op) FS_NOTHROW {
+
+	delete mJournal;
+	mJournal = 0;
+	
+	uint32 id = Journal::Checksum(&op, sizeof(op));
+	id = Journal::Checksum(&mRootTargetDirNodeRef.device, sizeof(mRootTargetDirNodeRef.device), id);
+	id = Journal::Checksum(&mRootTargetDirNodeRef.node, sizeof(mRootTargetDirNodeRef.node), id);
+	
+	EntryRef ref;
+	while (i.GetNext(ref)) {
+		dev_t device = ref.Device();
+		ino_t dir = ref.Directory();
+		id = Journal::Checksum(&device, sizeof(device), id);
+		id = Journal::Checksum(&dir, sizeof(dir), id);
+		id = Journal::Checksum(ref.Name(), strlen(ref.Name()), id);
+	}
+	i.Rewind();
+	
+	if (id == 0)
+		id = 1;
+	
+	mJournal = new Journal();
+	mJournal -> SetTo(target_dir, id);
+}
+
+void
+FSContext::EndJournal(bool succeeded) FS_NOTHROW {
+
+	if (mJournal == 0)
+		return;
+	
+	if (succeeded)
+		mJournal -> Remove();
+	else
+		mJournal -> Flush();
+}
+
+void	// may be called from the writer thread
+FSContext::CheckpointJournal(BFile &target_file, bool flush) FS_NOTHROW {
+
+	if (mJournal == 0  ||  mJournaledNode == 0  ||  target_file.InitCheck() != B_OK)
+		return;
+	
+	mJournal -> Partial(*mJournaledNode, target_file.Position(), flush);
+}
+
+void
+FSContext::JournalEntryDone(const struct stat &statbuf) FS_NOTHROW {
+
+	if (mJournal == 0)
+		return;
+
+	node_ref node;
+	node.device = statbuf.st_dev;
+	node.node = statbuf.st_ino;
+	mJournal -> Done(node);
+}
+
+void
+FSContext::JournalDirectoryEntered(BEntry &source_entry) FS_NOTHROW {
+
+	struct stat statbuf;
+	if (mJournal == 0  ||  source_entry.GetStat(&statbuf) != B_OK)
+		return;
+
+	node_ref node;
+	node.device = statbuf.st_dev;
+	node.node = statbuf.st_ino;
+	mJournal -> Started(node);
+}
+
+bool	// Postcond: *offset is where the copy can go on, file_size if there's nothing left to do
+FSContext::ResumableFile(BFile &source_file, BEntry &target_entry, off_t file_size, off_t *out_offset) FS_NOTHROW {
+
+	node_ref node;
+	off_t offset;
+	if (mJournal == 0  ||  source_file.GetNodeRef(&node) != B_OK  ||  mJournal -> Lookup(node, &offset) == false)
+		return false;
+	
+	BFile target(&target_entry, B_READ_ONLY);
+	off_t target_size;
+	if (target.GetSize(&target_size) != B_OK)
+		return false;
+	
+	if (offset == Journal::kDone) {
+		// unless it was changed since, or its data didn't make it to the disk before a crash
+		if (target_size != file_size  ||  SameDataBefore(source_file, target, file_size) == false)
+			return false;
+		
+		*out_offset = file_size;
+		return true;
+	}
+	
+	if (offset > target_size)			// the journal may be ahead of the data after a crash
+		offset = target_size;
+	
+	if (offset > file_size)
+		return false;
+	
+	if (SameDataBefore(source_file, target, offset) == false)
+		offset = 0;
+	
+	*out_offset = offset;
+	return true;
+}
+
+bool
+FSContext::ResumableDirectory(BEntry &source_entry) FS_NOTHROW {
+
+	struct stat statbuf;
+	if (mJournal == 0  ||  source_entry.GetStat(&statbuf) != B_OK)
+		return false;
+
+	node_ref node;
+	node.device = statbuf.st_dev;
+	node.node = statbuf.st_ino;
+	
+	off_t offset;
+	return mJournal -> Lookup(node, &offset);
+}
+
+status_t	// reads the target back from offset and compares it with the digest of what was written there
+FSContext::VerifyCopy(BEntry &target_entry, off_t from, MD4Checksum &source_digest) FS_THROW_FSEXCEPTION {
+
+	status_t rc;
+	BFile target;
+	if ((rc = target.SetTo(&target_entry, B_READ_ONLY)) != B_OK)
+		return rc;
+	
+	SuggestBufferSize(kVerifyChunkSize);
+	FS_BACKUP_VARIABLE_AND_SET(mBufferReleasable, false);
+	
+	size_t chunk_size = (BufferSize() < kVerifyChunkSize) ? BufferSize() : kVerifyChunkSize;
+	MD4Checksum target_digest;
+	ssize_t this_chunk;
+	
+	while ((this_chunk = target.ReadAt(from, Buffer(), chunk_size)) > 0) {
+		CheckCancelInCopyFile();
+		mTelemetry.Read(this_chunk);
+		target_digest.Process((char *)Buffer(), this_chunk);
+		from += this_chunk;
+	}
+	
+	if (this_chunk < 0)
+		return this_chunk;
+	
+	char result[16];
+	source_digest.GetResult(result);
+	
+	return (target_digest.Equals(result)) ? B_OK : B_IO_ERROR;
+}
+
+bool	// compares the last block before offset, without moving the file positions
+FSContext::SameDataBefore(BFile &file1, BFile &file2, off_t offset) FS_NOTHROW {
+
+	size_t size = (offset < kJournalVerifySize) ? (size_t)offset : kJournalVerifySize;
+	if (size == 0)
+		return true;
+	
+	uint8 *buffer = new uint8[size * 2];
+	
+	bool same = file1.ReadAt(offset - size, buffer, size) == (ssize_t)size
+				&&  file2.ReadAt(offset - size, buffer + size, size) == (ssize_t)size
+				&&  memcmp(buffer, buffer + size, size) == 0;
+	
+	delete [] buffer;
+	return same;
+}
+
 // private recursive delete
 void
 FSContext::RemoveRecursive(EntryIterator &i, bool progress_enabled, bool first_run) FS_THROW_FSEXCEPTION {
@@ -3399,6 +4018,83 @@ FSContext::RemoveRecursive(EntryIterator &i, bool progress_enabled, bool first_r
 	}
 }
 
+bool	// private depth first delete (used for emptying the trash): entries are stat-ed before they are removed,
+		// so directories are emptied first instead of failing to remove them; the totals grow as the directories
+		// are opened, there is no pre-walk
+FSContext::RemoveDepthFirst(BDirectory &dir, bool first_run) FS_THROW_FSEXCEPTION {
+
+	status_t rc;
+
+	entry_ref ref;
+	bool retry_entry = false;
+	bool emptied = true;
+
+	while (retry_entry  ||  dir.GetNextRef(&ref) == B_OK) {
+		retry_entry = false;
+		mProgressInfo.NewEntry();		// counted as it is found, a retry was un-counted by SkipEntry()
+
+		EntryRef eref(ref);
+		BEntry entry;
+		
+		try {
+			FS_SET_CURRENT_ENTRY(eref);
+			CheckCancel();
+
+			struct stat st;
+			{
+				FS_SET_OPERATION(kInspecting);
+				FS_OPERATION(entry.SetTo(&ref));
+				FS_OPERATION(entry.GetStat(&st));
+				mTelemetry.Syscall(Telemetry::kStat);
+			}
+			SetCurrentEntryType(st.st_mode);
+			
+			if (first_run) {
+				AboutToDeleteOrTrash(entry);
+			
+				if (!ConfirmChangeIfWellKnownDirectory(&entry, "delete", false)) {
+					FS_CONTROL_THROW(kSkipEntry);
+				}
+			}
+			
+			if (S_ISDIR(st.st_mode)) {
+				BDirectory subdir;
+				FS_OPERATION(subdir.SetTo(&entry));
+
+				if (RemoveDepthFirst(subdir, false) == false) {	// something was skipped in there, keep the directory
+					emptied = false;
+					mProgressInfo.SkipEntry();
+					continue;
+				}
+			}
+			
+			while ((rc = entry.Remove()) < 0) {
+				if (rc == B_ENTRY_NOT_FOUND  ||  ErrorHandler(rc) == false)
+					break;
+			}
+			mTelemetry.Syscall(Telemetry::kRemove);
+			
+			if (rc < 0  &&  rc != B_ENTRY_NOT_FOUND) {	// ignored, it is still there
+				emptied = false;
+				mProgressInfo.SkipEntry();
+				continue;
+			}
+
+			mProgressInfo.EntryDone();
+			
+		} catch (FSException e) {
+		
+			FS_FILTER_EXCEPTION_2(	kSkipEntry,		emptied = false;
+													mProgressInfo.SkipEntry(),
+									kRetryEntry,	retry_entry = true;
+													mProgressInfo.SkipEntry();
+								);
+		}
+	}
+	
+	return emptied;
+}
+
 status_t
 FSContext::Remove(EntryIterator *i, bool askbefore, bool async) FS_NOTHROW {
 
@@ -3484,6 +4180,7 @@ FSContext::Remove(BDirectory &dir, const char *file) FS_THROW_FSEXCEPTION {
 		return;
 	
 	Remove(entry);
+	TargetNameChanged(dir, file, false);
 }
 
 
@@ -3541,8 +4238,7 @@ FSContext::CreateLinkTo(EntryIterator &i, BDirectory &target_dir, bool relative)
 		}
 		
 		ResetProgressIndicator();
-		mProgressInfo.mTotalEntryCount = i.CountEntries();
-		mProgressInfo.SetDirty();
+		mProgressInfo.SetTotalEntryCount(i.CountEntries());
 		InitProgressIndicator();
 
 		char target_name[B_FILE_NAME_LENGTH];
@@ -3583,7 +4279,7 @@ FSContext::CreateLinkTo(EntryIterator &i, BDirectory &target_dir, bool relative)
 				node_ref target_nref;
 				FS_OPERATION(target_dir.GetNodeRef(&target_nref));
 				if (target_nref == mSourceDirNodeRef)
-					MakeUniqueName(target_dir, target_name, LOCALE(" link"));	// make a unique name if link to the same dir
+					MakeUniqueTargetName(target_dir, target_name, LOCALE(" link"));	// make a unique name if link to the same dir
 				
 				if (CreateLink(entry, target_dir, target_name, relative) == true) {
 	
@@ -3757,10 +4453,7 @@ FSContext::CreateLink(BEntry &source_entry, BDirectory &target_dir, char *target
 					entry_ref new_ref;
 					entry.GetRef(&new_ref);
 					
-					BMessage *undo = new BMessage((relative ? kCreateRelativeLink : kCreateLink));
-					undo->AddRef("new_ref", &new_ref);
-					undo->AddRef("orig_ref", &orig_ref);
-					gUndoHistory.AddItemToContext(undo, this);
+					gUndoHistory.AddEntryToContext(relative ? kCreateRelativeLink : kCreateLink, orig_ref, new_ref, this);
 				}
 				break;
 			}
@@ -3800,7 +4493,7 @@ FSContext::CreateLink(BEntry &source_entry, BDirectory &target_dir, char *target
 						break;
 
 					case kMakeUniqueName:
-						MakeUniqueName(target_dir, target_name);	// substitute target with the new unique name
+						MakeUniqueTargetName(target_dir, target_name);	// substitute target with the new unique name
 						continue;
 						
 					case kRetryOperation:
@@ -3914,7 +4607,7 @@ FSContext::Duplicate(EntryIterator &i) FS_NOTHROW {
 					CheckTargetDirectory(entry, target_dir);	// may not duplicate in the trash...
 				}
 				
-				MakeUniqueName(target_dir, target_name, LOCALE(" copy"));
+				MakeUniqueTargetName(target_dir, target_name, LOCALE(" copy"));
 				CopyEntry(i, ref, target_dir, target_name);
 
 			} catch (FSException e) {
@@ -4026,6 +4719,7 @@ FSContext::CreateDirectory(BDirectory *target_dir, char *target_name, BDirectory
 	status_t rc;
 	FS_SET_OPERATION(kCreatingDirectory);
 	FS_OPERATION(target_dir->CreateDirectory(target_name, new_dir));
+	mTelemetry.Syscall(Telemetry::kCreate);
 
 	if (gTrackerSettings.UndoEnabled()) {
 		BEntry entry(target_dir, target_name);
@@ -4182,7 +4876,7 @@ FSContext::IsSpecialDir(const node_ref &in_ref, directory_which in_which, node_r
 
 
 
-status_t
+status_t	// every volume's trash is emptied in a separate job, in parallel if the derived class supports NewContext()
 FSContext::EmptyTrash(bool async) FS_NOTHROW {
 
 	if (async) {
@@ -4197,77 +4891,136 @@ FSContext::EmptyTrash(bool async) FS_NOTHROW {
 
 		FS_SET_OPERATION(kEmptyingTrash);
 
-		if (atomic_or(&sEmptyTrashRunning, 1) != 0)			// only one at a time
+		vector<dev_t> devices;
+		
+		BVolumeRoster roster;
+		BVolume vol;
+		while (roster.GetNextVolume(&vol) == B_OK) {
+			if (vol.IsReadOnly()  ||  vol.IsPersistent() == false)
+				continue;
+
+			devices.push_back(vol.Device());
+		}
+
+		if (devices.empty())
 			return B_OK;
+
+		vector<dev_t>::iterator pos = devices.begin() + 1, end = devices.end();
+		for (;  pos < end;  ++pos) {
+			FSContext *context = NewContext();
+			if (context == 0)
+				break;
+			
+			context -> EmptyTrashOnVolume(*pos, true);
+		}
 		
-		vector<EntryIterator *>	trash_iterators;
-	
+		devices.erase(devices.begin() + 1, pos);	// drop the ones handed out, what's left is done in this thread, one after the other
+
 		try {
-		
-			status_t rc;
-			
+
 			ResetProgressIndicator();
 			InitProgressIndicator();
+			
+			FS_SET_OPERATION(kRemoving);
+			FS_ADD_POSSIBLE_ANSWER(fSkipEntry + fRetryEntry);
+			
+			OperationBegins();
+
+			for (pos = devices.begin(), end = devices.end();  pos < end;  ++pos)
+				DrainTrash(*pos);
+			
+		} catch (FSException e) {
+			return e;
+		}
+	}
+
+	return B_OK;
+}
+
+status_t
+FSContext::EmptyTrashOnVolume(dev_t in_device, bool async) FS_NOTHROW {
+
+	if (async) {
+		#if FS_CONFIG_MULTITHREADED
+			LaunchInNewThread("FS empty trash thread", B_NORMAL_PRIORITY, this, &FSContext::EmptyTrashOnVolume, in_device, false);
+		#else
+			return EmptyTrashOnVolume(in_device, false);
+		#endif	
+	} else {
+
+		PreparingOperation();
+
+		FS_SET_OPERATION(kEmptyingTrash);
+
+		try {
 		
-			BVolumeRoster roster;
-			BVolume vol;
-			BPath path;
-			while (roster.GetNextVolume(&vol) == B_OK) {
-				
-				if (vol.IsReadOnly()  ||  vol.IsPersistent() == false)
-					continue;
+			ResetProgressIndicator();
+			InitProgressIndicator();
 			
-				if (find_directory(B_TRASH_DIRECTORY, &path, true, &vol) == B_OK) {
-					BDirectory dir(path.Path());
-					if (dir.InitCheck() != B_OK)
-						continue;
-					
-					auto_ptr<DirEntryIterator> dei(new DirEntryIterator());
-					FS_OPERATION(dei -> SetTo(dir));
-					
-					{
-						FS_SET_OPERATION(kInitializing);
-						
-						AccumulateItemsAndSize(*dei);
-					}					
-					
-					trash_iterators.push_back(dei.release());
-				}
-			}
+			FS_SET_OPERATION(kRemoving);
+			FS_ADD_POSSIBLE_ANSWER(fSkipEntry + fRetryEntry);
 			
-			vector<EntryIterator *>::iterator	pos = trash_iterators.begin(),
-												end = trash_iterators.end();
-			{
-				FS_SET_OPERATION(kRemoving);
-				
-				FS_ADD_POSSIBLE_ANSWER(fSkipEntry + fRetryEntry);
-				
-				OperationBegins();
-				
-				while (pos < end) {
-				
-					RemoveRecursive(**pos, true, true);	// progress indication is on; first run
-					
-					delete *pos;
-					*pos = 0;	// must be cleared because in case of an exception we delete all items. faster then erase().
-					
-					++pos;
-				}
-			}
+			OperationBegins();
+			
+			DrainTrash(in_device);
 						
 		} catch (FSException e) {
-		
-			for_each(trash_iterators.begin(), trash_iterators.end(), deleter<EntryIterator>());
-			sEmptyTrashRunning = 0;
 			return e;
 		}
 	}
 	
-	sEmptyTrashRunning = 0;
-
 	return B_OK;
 }
 
+void	// empties the trash of one volume unless an other job is already at it
+FSContext::DrainTrash(dev_t in_device) FS_THROW_FSEXCEPTION {
+
+	BVolume vol(in_device);
+	BPath path;
+	if (vol.InitCheck() != B_OK  ||  find_directory(B_TRASH_DIRECTORY, &path, false, &vol) != B_OK)
+		return;
+
+	BDirectory dir(path.Path());
+	if (dir.InitCheck() != B_OK)
+		return;
+
+	if (ClaimTrash(in_device) == false)			// somebody is already emptying it
+		return;
+
+	try {
+
+		RemoveDepthFirst(dir, true);			// first run
+					
+	} catch (FSException e) {
+	
+		UnclaimTrash(in_device);
+		throw;
+	}
+	
+	UnclaimTrash(in_device);
+}
+
+bool
+FSContext::ClaimTrash(dev_t in_device) FS_NOTHROW {
+
+	BAutolock l(sLocker);
+	
+	if (find(sTrashesBeingEmptied.begin(), sTrashesBeingEmptied.end(), in_device) != sTrashesBeingEmptied.end())
+		return false;
+	
+	sTrashesBeingEmptied.push_back(in_device);
+	return true;
+}
+
+void
+FSContext::UnclaimTrash(dev_t in_device) FS_NOTHROW {
+
+	BAutolock l(sLocker);
+	
+	sTrashesBeingEmptied.erase(remove(sTrashesBeingEmptied.begin(), sTrashesBeingEmptied.end(), in_device),
+								sTrashesBeingEmptied.end());
+}
+
 ONLY_WITH_TRACKER(
 
 	EntryList::EntryList(const PoseList &inlist) FS_NOTHROW {
@@ -4438,6 +5191,8 @@ FSContext::NextEntryCreated(BDirectory &target_dir, const char *target_name, BDi
 	BNode target_node;
 	FS_OPERATION(target_node.SetTo(&target_dir, target_name));
 
+	TargetNameChanged(target_dir, target_name, true);
+
 	node_ref target_dir_ref;	// XXX rework... look at the comment at PoseInfo in Utility.h
 	if (for_pi_noderef) {
 		FS_OPERATION(for_pi_noderef -> GetNodeRef(&target_dir_ref));
@@ -4454,8 +5209,10 @@ FSContext::RemoveIfNewer(BEntry &source_entry, BDirectory &target_dir, const cha
 	BEntry target_entry;
 	
 	FS_OPERATION_ETC(target_entry.SetTo(&target_dir, target_name), rc != B_ENTRY_NOT_FOUND, NOP);
-	if (rc == B_OK)
-		return RemoveIfNewer(source_entry, target_entry);
+	if (rc == B_OK  &&  RemoveIfNewer(source_entry, target_entry)) {
+		TargetNameChanged(target_dir, target_name, false);
+		return true;
+	}
 
 	return false;
 }
@@ -46,11 +46,16 @@
 
 #include <unistd.h>
 
+#include <map>
 #include <vector>
 
 #include <boost/call_traits.hpp>
 #include <boost/utility.hpp>
 
+#include "FSJournal.h"
+#include "FSNameIndex.h"
+#include "FSTelemetry.h"
+
 #define FS_MONITOR_THREAD_WAITINGS	1
 	// print how much time the writer/reader thread was waiting for the next chunk
 
@@ -152,6 +157,8 @@
 	backup_struct<typeof(x)> __backup_of_##x(&(x));						\
 	##x = (value);
 
+class MD4Checksum;
+
 namespace fs {
 
 using namespace boost;
@@ -303,6 +310,21 @@ private:
 class FSContext : noncopyable {
 public:
 	typedef vector<node_ref> node_ref_list_t;
+	typedef fs::NameIndex NameIndex;
+
+	struct NodeRefLess {
+		bool operator()(const node_ref &a, const node_ref &b) const
+			{ return a.device < b.device  ||  (a.device == b.device  &&  a.node < b.node); }
+	};
+	typedef map<node_ref, NameIndex *, NodeRefLess> name_index_map_t;
+
+	struct PendingAttribute {
+		char			mName[B_ATTR_NAME_LENGTH];
+		type_code		mType;
+		size_t			mOffset;						// in the attribute buffer
+		size_t			mSize;
+	};
+	typedef vector<PendingAttribute> attribute_list_t;
 
 	enum answer_flags {
 		fCancel			= 0x0001,
@@ -323,6 +345,7 @@ public:
 		fPermissions		= 0x0008,
 		fAttributes			= 0x0010,
 		fModificationTime	= 0x0020,
+		fVerifyData			= 0x0040,		// compare the digest of the data read back from the target with the source's
 		
 		fDefaultCopyFlags	= fAttributes | fOwner | fGroup | fPermissions | fCreationTime | fModificationTime
 	};
@@ -337,7 +360,8 @@ public:
 		kTotalCommands,
 	};
 
-	static const int32 kMaxAnswersForInteraction = 14;	// max number of possible answers + 1
+	static const int32 kMaxAnswersForInteraction = 15;	// max number of possible answers + 1
+	static const int32 kDeltaCopyMinimalSize = 4 * 1024 * 1024;	// kUpdateChanged is offered for files at least this big
 
 	enum interaction {
 		// Interaction constants for FSContext::Interaction().
@@ -355,6 +379,7 @@ public:
 		#define		INT_11(name, string, showfile,a,ax,b,bx,c,cx,d,dx,e,ex,f,fx,g,gx,h,hx,i,ix,j,jx,k,kx)			name,
 		#define		INT_12(name, string, showfile,a,ax,b,bx,c,cx,d,dx,e,ex,f,fx,g,gx,h,hx,i,ix,j,jx,k,kx,l,lx)		name,
 		#define		INT_13(name, string, showfile,a,ax,b,bx,c,cx,d,dx,e,ex,f,fx,g,gx,h,hx,i,ix,j,jx,k,kx,l,lx,m,mx) name,
+		#define		INT_14(name, string, showfile,a,ax,b,bx,c,cx,d,dx,e,ex,f,fx,g,gx,h,hx,i,ix,j,jx,k,kx,l,lx,m,mx,n,nx) name,
 		#include	"FSInteractions.tbl"
 
 		kTotalInteractions
@@ -383,21 +408,59 @@ public:
 
 	class ProgressInfo : noncopyable {
 	public:
+		// the byte counters are split by the thread that advances them and
+		// each group is published under its own sequence number. the owner
+		// makes it odd while updating, other threads use GetSnapshot(), which
+		// retries until it sees the same even number before and after copying.
+		// this way 64 bit values can't be read half updated on 32 bit cpus,
+		// and no lock is taken in the copy loops.
+		struct Snapshot {
+			off_t			mCurrentFileTotalSize;
+			off_t			mCurrentFileCurrentSize;
+			off_t			mTotalSize;
+			off_t			mCurrentSize;
+			int32			mTotalEntryCount;
+			int32			mCurrentEntryCount;
+			int32			mGeneration;				// changes whenever any of the values do
+			bool			mTotalDisabled;
+			bool			mTotalSizeProgressEnabled;
+
+			float			EntryProgress() const FS_NOTHROW
+								{ return (mTotalEntryCount > 0) ? (float)mCurrentEntryCount / mTotalEntryCount : 0; }
+			float			TotalSizeProgress() const FS_NOTHROW
+								{ return (mTotalSize > 0) ? (float)mCurrentSize / mTotalSize : 0; }
+			bool			HasFileSizeProgress() const FS_NOTHROW
+								{ return mCurrentFileTotalSize != 0; }
+			float			FileSizeProgress() const FS_NOTHROW
+								{ return (mCurrentFileTotalSize > 0) ? (float)mCurrentFileCurrentSize / mCurrentFileTotalSize : 0; }
+			bool			IsTotalEnabled() const FS_NOTHROW
+								{ return ! mTotalDisabled; }
+			bool			IsTotalSizeProgressEnabled() const FS_NOTHROW
+								{ return mTotalSizeProgressEnabled; }
+		};
+
+		// owned by the thread running the operation (the reader thread)
 		off_t				mCurrentFileTotalSize;
 		off_t				mTotalSize;
 		int32				mTotalEntryCount;
 		int32				mTotalFileCount;
 		int32				mTotalDirCount;
 		int32				mTotalLinkCount;
-		volatile off_t		mCurrentFileCurrentSize;
-		volatile off_t		mCurrentSize;
+		volatile off_t		mReadSize;
+		volatile off_t		mDiscardedSize;				// progress of files that were given up halfway
+		volatile off_t		mCurrentFileReadStart;
+		volatile off_t		mCurrentFileWrittenStart;
 		int32				mCurrentEntryCount;
 		int32				mCurrentFileCount;
 		int32				mCurrentDirCount;
 		int32				mCurrentLinkCount;
-		bool				mDirty;
 		bool				mTotalDisabled;				// this is set to true when an entry is skipped in such a way that it's impossible to follow total values right. (skipping a whole dir, no stat info yet available about the entry...)
 		bool				mTotalSizeProgressEnabled;	// set by operations that are related to size, not only count (copy and duplicate)
+		volatile int32		mSequence;
+
+		// owned by the writer thread (or the reader thread when copying single threaded)
+		volatile off_t		mWrittenSize;
+		volatile int32		mWriteSequence;
 
 		// Functions
 							ProgressInfo() FS_NOTHROW
@@ -405,65 +468,80 @@ public:
 
 		void				Clear() FS_NOTHROW
 								{ memset(this, 0, sizeof(*this)); }
+		void				BeginUpdate() FS_NOTHROW
+								{ atomic_add(&mSequence, 1); }
+		void				EndUpdate() FS_NOTHROW
+								{ atomic_add(&mSequence, 1); }
+		void				RestartFileProgress() FS_NOTHROW		// only between BeginUpdate() and EndUpdate()
+								{ mCurrentFileReadStart = mReadSize; mCurrentFileWrittenStart = WrittenSize(); }
+
 		void				EntryDone() FS_NOTHROW
-								{ ++mCurrentEntryCount; SetDirty(); }
+								{ BeginUpdate(); ++mCurrentEntryCount; EndUpdate(); }
 		void				DirectoryDone() FS_NOTHROW
-								{ ++mCurrentDirCount; EntryDone(); }
+								{ BeginUpdate(); ++mCurrentDirCount; ++mCurrentEntryCount; EndUpdate(); }
 		void				FileDone() FS_NOTHROW
-								{ ++mCurrentFileCount; EntryDone(); }
+								{ BeginUpdate(); ++mCurrentFileCount; ++mCurrentEntryCount; EndUpdate(); }
 		void				LinkDone() FS_NOTHROW
-								{ ++mCurrentLinkCount; EntryDone(); }
+								{ BeginUpdate(); ++mCurrentLinkCount; ++mCurrentEntryCount; EndUpdate(); }
 
 		void				NewEntry() FS_NOTHROW
-								{ ++mTotalEntryCount; SetDirty(); }
+								{ BeginUpdate(); ++mTotalEntryCount; EndUpdate(); }
+		void				NewEntries(int32 count) FS_NOTHROW
+								{ BeginUpdate(); mTotalEntryCount += count; EndUpdate(); }
+		void				SetTotalEntryCount(int32 count) FS_NOTHROW
+								{ BeginUpdate(); mTotalEntryCount = count; EndUpdate(); }
 		void				NewDirectory() FS_NOTHROW
-								{ ++mTotalDirCount; NewEntry(); }
+								{ BeginUpdate(); ++mTotalDirCount; ++mTotalEntryCount; EndUpdate(); }
 		void				NewFile(off_t &size) FS_NOTHROW
-								{ ++mTotalFileCount; mTotalSize += size; NewEntry(); }
+								{ BeginUpdate(); ++mTotalFileCount; mTotalSize += size; ++mTotalEntryCount; EndUpdate(); }
 		void				NewLink() FS_NOTHROW
-								{ ++mTotalLinkCount; NewEntry(); }
+								{ BeginUpdate(); ++mTotalLinkCount; ++mTotalEntryCount; EndUpdate(); }
+		void				DecreaseTotalSize(off_t size) FS_NOTHROW
+								{ BeginUpdate(); mTotalSize -= size; EndUpdate(); }
 
 		void				SkipEntry() FS_NOTHROW
-								{ --mTotalEntryCount; mCurrentFileCurrentSize = 0; SetDirty(); }
+								{ BeginUpdate(); --mTotalEntryCount; RestartFileProgress(); EndUpdate(); }
 		void				SkipFile(off_t &size) FS_NOTHROW
-								{ --mTotalFileCount; mTotalSize -= size; SkipEntry(); }
+								{ BeginUpdate(); --mTotalFileCount; mTotalSize -= size; --mTotalEntryCount; RestartFileProgress(); EndUpdate(); }
 		void				SkipLink() FS_NOTHROW
-								{ --mTotalLinkCount; SkipEntry(); }
+								{ BeginUpdate(); --mTotalLinkCount; --mTotalEntryCount; RestartFileProgress(); EndUpdate(); }
 		void				SkipDirectory() FS_NOTHROW
-								{ --mTotalDirCount; SkipEntry(); DisableTotals(); }
+								{ BeginUpdate(); --mTotalDirCount; --mTotalEntryCount; RestartFileProgress(); mTotalDisabled = true; EndUpdate(); }
+
+		void				BeginFile(off_t size) FS_NOTHROW
+								{ BeginUpdate(); mCurrentFileTotalSize = size; RestartFileProgress(); EndUpdate(); }
+		void				EndFile(off_t old_current_size) FS_NOTHROW;
 
-		// XXX replace with atomic_add64 when available
 		void				ReadProgress(size_t size) FS_NOTHROW
-								{ mCurrentSize += size / 2; mCurrentFileCurrentSize += size / 2; SetDirty(); }
+								{ BeginUpdate(); mReadSize += size; EndUpdate(); }
 		void				WriteProgress(size_t size) FS_NOTHROW
-								{ mCurrentSize += size / 2; mCurrentFileCurrentSize += size / 2; SetDirty(); }
+								{ atomic_add(&mWriteSequence, 1); mWrittenSize += size; atomic_add(&mWriteSequence, 1); }
+
+		off_t				WrittenSize(int32 *sequence = 0) const FS_NOTHROW;
+		off_t				CurrentSize() const FS_NOTHROW			// half read, half written, as far as progress is concerned
+								{ return (mReadSize + WrittenSize()) / 2 - mDiscardedSize; }
+		off_t				CurrentFileCurrentSize() const FS_NOTHROW;
+		void				GetSnapshot(Snapshot &snapshot) const FS_NOTHROW;
 
 		float				EntryProgress() const FS_NOTHROW
 								{ return (mTotalEntryCount > 0) ? (float)mCurrentEntryCount / mTotalEntryCount : 0; }
 		void				DisableTotalSizeProgress() FS_NOTHROW
-								{ mTotalSizeProgressEnabled = false; }
+								{ BeginUpdate(); mTotalSizeProgressEnabled = false; EndUpdate(); }
 		void				EnableTotalSizeProgress() FS_NOTHROW
-								{ mTotalSizeProgressEnabled = true; }
+								{ BeginUpdate(); mTotalSizeProgressEnabled = true; EndUpdate(); }
 		bool				IsTotalSizeProgressEnabled() const FS_NOTHROW
 								{ return mTotalSizeProgressEnabled; }
 		float				TotalSizeProgress() const FS_NOTHROW
-								{ return (mTotalSize > 0) ? (float)mCurrentSize / mTotalSize : 0; }
+								{ return (mTotalSize > 0) ? (float)CurrentSize() / mTotalSize : 0; }
 		bool				HasFileSizeProgress() const FS_NOTHROW
 								{ return mCurrentFileTotalSize != 0; }
 		float				FileSizeProgress() const FS_NOTHROW
-								{ return (mCurrentFileTotalSize > 0) ? (float)mCurrentFileCurrentSize / mCurrentFileTotalSize : 0; } 
+								{ return (mCurrentFileTotalSize > 0) ? (float)CurrentFileCurrentSize() / mCurrentFileTotalSize : 0; } 
 
 		bool				IsTotalEnabled() const FS_NOTHROW
 								{ return ! mTotalDisabled; }
 		void				DisableTotals() FS_NOTHROW
-								{ mTotalDisabled = true; }
-
-		bool				IsDirty() const FS_NOTHROW
-								{ return mDirty; }
-		void				ClearDirty() FS_NOTHROW
-								{ mDirty = false; }
-		void				SetDirty() FS_NOTHROW
-								{ mDirty = true; }
+								{ BeginUpdate(); mTotalDisabled = true; EndUpdate(); }
 
 		void				PrintToStream() FS_NOTHROW;
 	};
@@ -474,18 +552,15 @@ private:
 		FSContext		*mContext;
 		
 		FileProgressAdder(off_t &isize, FSContext *icontext) : mContext(icontext) {
-			mOldCurrentSize = Info().mCurrentSize;
+			mOldCurrentSize = Info().CurrentSize();
 
-			Info().mCurrentFileTotalSize = isize;
-			Info().mCurrentFileCurrentSize = 0;
+			Info().BeginFile(isize);
 			
 			mContext -> EffectiveCopyBegins();
 		}
 		~FileProgressAdder() {
 			mContext -> EffectiveCopyEnds();
-			Info().mCurrentFileTotalSize = 0;	// means that there's no file copy progressbar
-			if (Info().mCurrentSize < mOldCurrentSize + Info().mCurrentFileTotalSize)	// if file was not finished
-				Info().mCurrentSize = mOldCurrentSize;			// restore old total size
+			Info().EndFile(mOldCurrentSize);
 		}
 		FSContext::ProgressInfo &Info() {
 			return mContext -> mProgressInfo;
@@ -730,9 +805,10 @@ public:
 			status_t	Remove(EntryIterator &i, bool askbefore)								FS_NOTHROW;
 			status_t	CalculateItemsAndSize(EntryIterator &i, ProgressInfo &)					FS_NOTHROW;
 			status_t	EmptyTrash(bool async = true)											FS_NOTHROW;
+			status_t	EmptyTrashOnVolume(dev_t device, bool async = true)						FS_NOTHROW;
 			
 	static	status_t	CreateNewFolder(const node_ref &in_dir_node, const char *name = 0, entry_ref * = 0, node_ref * = 0) FS_NOTHROW;
-	static	void		MakeUniqueName(BDirectory &, char *name_buf, const char *suffix = 0)	FS_NOTHROW;
+	static	void		MakeUniqueName(BDirectory &, char *name_buf, const char *suffix = 0, NameIndex * = 0)	FS_NOTHROW;
 
 	static	status_t	GetOriginalPath(BEntry &in_entry, BPath &in_path)						FS_NOTHROW;
 	static	status_t	GetOriginalPath(BNode &in_node, BPath &in_path)							FS_NOTHROW;
@@ -777,6 +853,26 @@ protected:
 	static	status_t	GetSpecialDir(node_ref &in_dir_ref, dev_t in_device, directory_which in_which, node_ref_list_t &in_list) FS_NOTHROW;
 	static	status_t	GetSpecialDir(BDirectory &in_dir, dev_t in_device, directory_which in_which, node_ref_list_t &in_list) FS_NOTHROW;
 			void		MakeUniqueName(BPath &, const char * = 0) FS_THROW_FSEXCEPTION;
+			void		MakeUniqueTargetName(BDirectory &, char *name_buf, const char *suffix = 0) FS_NOTHROW;
+
+			// per operation index of the names in the target directories
+			NameIndex *	TargetNameIndex(BDirectory &) FS_NOTHROW;
+			NameIndex *	BuiltTargetNameIndex(BDirectory &) FS_NOTHROW;
+			bool		TargetExists(BDirectory &, const char *name, BEntry *entry = 0) FS_NOTHROW;
+			void		TargetNameChanged(BDirectory &, const char *name, bool exists) FS_NOTHROW;
+	static	bool		IsNameTaken(BDirectory &, const char *name, NameIndex *) FS_NOTHROW;
+
+			// resuming interrupted copies and moves, see FSJournal.h
+			void		BeginJournal(EntryIterator &, BDirectory &target_dir, operation) FS_NOTHROW;
+			void		EndJournal(bool succeeded) FS_NOTHROW;
+			void		CheckpointJournal(BFile &target_file, bool flush = false) FS_NOTHROW;
+			void		JournalEntryDone(const struct stat &) FS_NOTHROW;
+			void		JournalDirectoryEntered(BEntry &source_entry) FS_NOTHROW;
+			bool		ResumableFile(BFile &source_file, BEntry &target_entry, off_t file_size, off_t *offset) FS_NOTHROW;
+			bool		ResumableDirectory(BEntry &source_entry) FS_NOTHROW;
+	static	bool		SameDataBefore(BFile &, BFile &, off_t offset) FS_NOTHROW;
+
+			status_t	VerifyCopy(BEntry &target_entry, off_t from, MD4Checksum &source_digest) FS_THROW_FSEXCEPTION;
 public:
 	static	int32	GetSizeString(char *in_ptr, float in_size1, float in_size2 = 0);
 
@@ -785,6 +881,9 @@ public:
 			void		DontCopy(copy_flags flag) FS_NOTHROW {
 						mCopyFlags = (copy_flags)(mCopyFlags & ~flag);
 					}
+			void		DoCopy(copy_flags flag) FS_NOTHROW {
+						mCopyFlags = (copy_flags)(mCopyFlags | flag);
+					}
 
 // Interaction
 public:
@@ -868,6 +967,7 @@ protected:
 	virtual	void		NextEntryCreated(node_ref &, BNode &) FS_NOTHROW {}	// to save icon positions
 	virtual	void		DirectoryTrashed(node_ref &) FS_NOTHROW {}			// to close open windows
 	virtual	void		AboutToDeleteOrTrash(BEntry &) FS_NOTHROW {}		// to unmount a device (will not be called for every entry!)
+	virtual	FSContext *	NewContext() FS_NOTHROW { return 0; }				// a context for running an other operation in parallel, zero if not supported
 	virtual	void		EffectiveCopyBegins() FS_NOTHROW {}
 	virtual	void		EffectiveCopyEnds() FS_NOTHROW {}
 
@@ -907,6 +1007,7 @@ public:
 		bigtime_t	WriterThreadWaiting()								{ return mWriterThreadWaiting.ElapsedTime(); }
 #endif
 
+		const Telemetry &GetTelemetry() const FS_NOTHROW					{ return mTelemetry; }
 		const EntryRef *CurrentEntry() const FS_NOTHROW						{ return mCurrentEntry; }
 			const char *CurrentEntryName() const FS_NOTHROW					{ return (mCurrentEntry) ? CurrentEntry() -> Name() : ""; }
 			mode_t		CurrentEntryType() const FS_NOTHROW					{ return mCurrentEntryType; }
@@ -941,6 +1042,10 @@ protected:	bool		PushOperation(operation iop) FS_NOTHROW;
 			void		CopyRecursive(EntryIterator &i, BDirectory &target_dir, bool first_run = false) FS_THROW_FSEXCEPTION;
 			void		CopyAdditionals(BNode &source, BNode &target) FS_THROW_FSEXCEPTION;
 			void		CopyAttributes(BNode &source, BNode &target) FS_THROW_FSEXCEPTION;
+			void		WritePendingAttributes(BNode &target) FS_THROW_FSEXCEPTION;
+			void		StreamAttribute(BNode &source, BNode &target, const PendingAttribute &) FS_THROW_FSEXCEPTION;
+			void		ReserveAttributeBuffer(size_t size) FS_NOTHROW;
+			size_t		AttributeBufferSize() FS_NOTHROW const					{ return mAttributeBufferSize; }
 
 			// These assume that mSourceDir is set to the actual source dir; EntryIterators are for inheriting filtering to new DirEntryIterators
 			bool		CopyEntry(EntryIterator &, EntryRef &ref, BDirectory &target_dir, const char *target_name = 0, bool first_run = false) FS_THROW_FSEXCEPTION; // return value means wether the copy actually happened or skip was issued
@@ -950,6 +1055,7 @@ protected:	bool		PushOperation(operation iop) FS_NOTHROW;
 			void		CopyFile(BEntry &, BDirectory &target_dir, char *target_name) FS_THROW_FSEXCEPTION;
 			void		CopyFileInnerLoop(BFile &source, BFile &target, off_t size) FS_THROW_FSEXCEPTION;
 			void		CopyFileInnerLoopTwoDevices(BFile &source, BFile &target) FS_THROW_FSEXCEPTION;
+			void		CopyChangedBlocks(BFile &source, BFile &target) FS_THROW_FSEXCEPTION;
 			void		CopyFileReaderThread(BFile *_file, ChunkList *, sem_id, sem_id, sem_id) FS_THROW_FSEXCEPTION;
 			void		CopyFileWriterThread(BFile *_file, ChunkList *, sem_id, sem_id &reader_sem, sem_id) FS_THROW_FSEXCEPTION;
 			void		CalculateNewChunkSize(size_t &chunk_size, off_t upper_limit, bigtime_t start_time) FS_NOTHROW;
@@ -962,6 +1068,10 @@ protected:	bool		PushOperation(operation iop) FS_NOTHROW;
 						}
 
 			void		RemoveRecursive(EntryIterator &i, bool progress_enabled, bool first_run) FS_THROW_FSEXCEPTION;
+			bool		RemoveDepthFirst(BDirectory &dir, bool first_run) FS_THROW_FSEXCEPTION;	// returns false if something was left in dir
+			void		DrainTrash(dev_t device) FS_THROW_FSEXCEPTION;
+	static	bool		ClaimTrash(dev_t device) FS_NOTHROW;
+	static	void		UnclaimTrash(dev_t device) FS_NOTHROW;
 			void		Remove(BDirectory &dir, const char *file) FS_THROW_FSEXCEPTION;
 			void		Remove(BPath &path) FS_THROW_FSEXCEPTION;
 			void		Remove(BEntry &entry, operation = kRemoving) FS_THROW_FSEXCEPTION;
@@ -1018,13 +1128,21 @@ private:
 	static	node_ref_list_t				sHomeDirList;
 	static	node_ref_list_t				sSystemDirList;
 	static	node_ref_list_t				sBeOSDirList;
-	static	int32						sEmptyTrashRunning;
+	static	vector<dev_t>				sTrashesBeingEmptied;	// one job per volume, guarded by sLocker
 	static	command					sLastSelectedInteractionAnswers[kTotalInteractions]; // initialized to all kInvalidCommand
 
 	bigtime_t			mShrinkBufferSuggestionTime;
 	uint8 *				mBuffer;
 	size_t				mMaxBufferSize;
 	size_t				mBufferSize;
+	uint8 *				mAttributeBuffer;				// separate from the copy buffer, so that attributes don't make it grow and shrink
+	size_t				mAttributeBufferSize;
+	attribute_list_t	mPendingAttributes;				// attributes read into mAttributeBuffer, waiting to be written
+	name_index_map_t	mNameIndexes;					// names in the target directories, see TargetNameIndex()
+	Journal *			mJournal;						// only while a copy or move is running
+	const node_ref *	mJournaledNode;					// the source of the file being copied, if its offset may be journaled
+	MD4Checksum *		mCopyDigest;					// the data of the file being copied goes through it when fVerifyData is set
+	Telemetry			mTelemetry;						// always on counters, registered in gTelemetryLog()
 	thread_id			mMainThreadID;
 
 	const EntryRef *		mCurrentEntry;
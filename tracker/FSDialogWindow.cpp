@@ -802,6 +802,18 @@ FSDialogWindow::TFSContextDialogView::AllAttached() {
 						break;
 					}
 					
+					case TFSContext::kUpdateChanged: {		// only worth it for big files
+							if (mContext.TargetEntry() == 0  ||  mContext.TargetEntry() -> IsFile() == false)
+								continue;
+							
+							BFile source_file(*mContext.CurrentEntry(), B_READ_ONLY);
+							off_t source_size;
+							if (source_file.GetSize(&source_size) != B_OK  ||  source_size < TFSContext::kDeltaCopyMinimalSize)
+								continue;
+								
+						break;
+					}
+					
 					case TFSContext::kSkipEntry:
 							if (mContext.IsAnswerPossible(TFSContext::fSkipEntry) == false)
 								continue;
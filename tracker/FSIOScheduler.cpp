@@ -0,0 +1,366 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+#include "FSIOScheduler.h"
+#include "TFSContext.h"
+
+#include <Autolock.h>
+#include <Debug.h>
+
+#include <algorithm>
+
+namespace BPrivate {
+
+static const bigtime_t	kTimeSlice				= 250000;			// how long an operation may keep its devices if others are waiting
+static const off_t		kSmallOperationSize		= 4 * 1024 * 1024;	// operations with less left than this are served first
+
+FSIOScheduler *	FSIOScheduler	:: sSelf;
+int32			FSIOScheduler	:: sInitialized = 0;
+
+FSIOScheduler::FSIOScheduler() :
+				mLocker("FSIOScheduler"),
+				mSequence(0) {
+}
+
+FSIOScheduler::~FSIOScheduler() {
+	for (client_list_t::iterator i = mClients.begin();  i != mClients.end();  ++i) {
+		delete_sem((*i) -> mWakeSem);
+		delete *i;
+	}
+}
+
+void
+FSIOScheduler::Register(TFSContext &in_context) {
+	BAutolock l(mLocker);
+
+	if (FindClient(in_context) != 0)
+		return;
+
+	Client *client = new Client;
+	client -> mContext = &in_context;
+	client -> mDevices[0] = -1;
+	client -> mDevices[1] = -1;
+	client -> mWakeSem = create_sem(0, "FSIOScheduler wake");
+	client -> mSliceStart = 0;
+	client -> mLastAccounted = 0;
+	client -> mWaitStart = 0;
+	client -> mWaitTime = 0;
+	client -> mLastBytes = 0;
+	client -> mRemaining = -1;
+	client -> mSequence = 0;
+	client -> mWaiting = false;
+	client -> mOwner = false;
+	
+	mClients.push_back(client);
+}
+
+void
+FSIOScheduler::Unregister(const TFSContext &in_context) {
+	BAutolock l(mLocker);
+
+	client_list_t::iterator i;
+	for (i = mClients.begin();  i != mClients.end();  ++i)
+		if ((*i) -> mContext == &in_context)
+			break;
+
+	if (i == mClients.end())
+		return;
+
+	Client *client = *i;
+	mClients.erase(i);
+
+	ReleaseDevices(client);
+	delete_sem(client -> mWakeSem);
+	delete client;
+
+	Grant();
+}
+
+status_t
+FSIOScheduler::Acquire(TFSContext &in_context, off_t in_bytes_done, off_t in_bytes_left, bigtime_t in_timeout) {
+
+	sem_id sem;
+
+	{
+		BAutolock l(mLocker);
+
+		Client *client = FindClient(in_context);
+		if (client == 0)
+			return B_OK;							// not scheduled
+
+		client -> mRemaining = in_bytes_left;
+		SetDevices(client, in_context.SourceDevice(), in_context.TargetDevice());
+
+		if (client -> mOwner) {
+			Account(client, in_bytes_done);
+
+			if (system_time() - client -> mSliceStart < kTimeSlice)
+				return B_OK;
+
+			if (IsSomebodyWaitingFor(client) == false) {
+				client -> mSliceStart = system_time();
+				return B_OK;
+			}
+
+			ReleaseDevices(client);					// slice is over, step back into the queue
+		}
+
+		if (client -> mWaiting == false) {
+			client -> mWaiting = true;
+			client -> mWaitStart = system_time();
+			client -> mSequence = ++mSequence;
+			client -> mLastBytes = in_bytes_done;
+		}
+
+		Grant();
+
+		if (client -> mOwner) {
+			acquire_sem_etc(client -> mWakeSem, 1, B_RELATIVE_TIMEOUT, 0);	// we were granted right away, eat the wakeup
+			return B_OK;
+		}
+
+		sem = client -> mWakeSem;
+	}
+
+	acquire_sem_etc(sem, 1, B_RELATIVE_TIMEOUT, in_timeout);
+
+	BAutolock l(mLocker);
+
+	Client *client = FindClient(in_context);
+	if (client == 0  ||  client -> mOwner)
+		return B_OK;
+
+	return B_TIMED_OUT;
+}
+
+void
+FSIOScheduler::Release(const TFSContext &in_context) {
+	BAutolock l(mLocker);
+
+	Client *client = FindClient(in_context);
+	if (client == 0)
+		return;
+
+	if (client -> mWaiting) {
+		client -> mWaiting = false;
+		client -> mWaitTime += system_time() - client -> mWaitStart;
+	}
+	
+	ReleaseDevices(client);
+	Grant();
+}
+
+bigtime_t
+FSIOScheduler::WaitTime(const TFSContext &in_context) {
+	BAutolock l(mLocker);
+
+	Client *client = FindClient(in_context);
+	if (client == 0)
+		return 0;
+
+	bigtime_t time = client -> mWaitTime;
+	if (client -> mWaiting)
+		time += system_time() - client -> mWaitStart;
+
+	return time;
+}
+
+float
+FSIOScheduler::DeviceThroughput(dev_t in_device) {
+	BAutolock l(mLocker);
+
+	device_map_t::iterator i = mDevices.find(in_device);
+	if (i == mDevices.end()  ||  i -> second.mBusyTime == 0)
+		return 0;
+
+	return (float)i -> second.mBytes / i -> second.mBusyTime;
+}
+
+FSIOScheduler::Client *
+FSIOScheduler::FindClient(const TFSContext &in_context) {
+	ASSERT(mLocker.IsLocked());
+
+	for (client_list_t::iterator i = mClients.begin();  i != mClients.end();  ++i)
+		if ((*i) -> mContext == &in_context)
+			return *i;
+
+	return 0;
+}
+
+void		// the devices change when an operation moves on to an other volume
+FSIOScheduler::SetDevices(Client *in_client, dev_t in_source, dev_t in_target) {
+
+	if (in_target == in_source)
+		in_target = -1;
+
+	if (in_client -> mDevices[0] == in_source  &&  in_client -> mDevices[1] == in_target)
+		return;
+
+	bool owner = in_client -> mOwner;
+	if (owner)
+		ReleaseDevices(in_client);
+
+	in_client -> mDevices[0] = in_source;
+	in_client -> mDevices[1] = in_target;
+
+	if (owner) {
+		in_client -> mWaiting = true;			// reacquire the new set, keeping the place in the queue
+		in_client -> mWaitStart = system_time();
+	}
+}
+
+void
+FSIOScheduler::Account(Client *in_client, off_t in_bytes_done) {
+
+	bigtime_t now = system_time();
+	off_t bytes = in_bytes_done - in_client -> mLastBytes;
+	bigtime_t time = now - in_client -> mLastAccounted;
+
+	if (bytes < 0)
+		bytes = 0;
+
+	for (int32 i = 0;  i < 2;  ++i) {
+		if (in_client -> mDevices[i] < 0)
+			continue;
+
+		Device &device = mDevices[in_client -> mDevices[i]];
+		device.mBytes += bytes;
+		device.mBusyTime += time;
+	}
+
+	in_client -> mLastBytes = in_bytes_done;
+	in_client -> mLastAccounted = now;
+}
+
+bool
+FSIOScheduler::IsSomebodyWaitingFor(const Client *in_client) {
+
+	for (client_list_t::iterator i = mClients.begin();  i != mClients.end();  ++i) {
+		Client *client = *i;
+		if (client == in_client  ||  client -> mWaiting == false)
+			continue;
+
+		for (int32 j = 0;  j < 2;  ++j)
+			for (int32 k = 0;  k < 2;  ++k)
+				if (client -> mDevices[j] >= 0  &&  client -> mDevices[j] == in_client -> mDevices[k])
+					return true;
+	}
+	
+	return false;
+}
+
+void
+FSIOScheduler::ReleaseDevices(Client *in_client) {
+
+	if (in_client -> mOwner == false)
+		return;
+
+	for (int32 i = 0;  i < 2;  ++i) {
+		if (in_client -> mDevices[i] < 0)
+			continue;
+
+		Device &device = mDevices[in_client -> mDevices[i]];
+		if (device.mOwner == in_client)
+			device.mOwner = 0;
+	}
+
+	in_client -> mOwner = false;
+}
+
+bool
+FSIOScheduler::ComesFirst(const Client *a, const Client *b) {
+
+	// an operation that doesn't know its size gets no preference
+
+	bool a_small = a -> mRemaining >= 0  &&  a -> mRemaining < kSmallOperationSize;
+	bool b_small = b -> mRemaining >= 0  &&  b -> mRemaining < kSmallOperationSize;
+
+	if (a_small != b_small)
+		return a_small;
+
+	return a -> mSequence < b -> mSequence;
+}
+
+void		// hands out the free devices to the waiters, a waiter gets all of its devices at once or none of them
+FSIOScheduler::Grant() {
+
+	client_list_t waiting;
+	for (client_list_t::iterator i = mClients.begin();  i != mClients.end();  ++i)
+		if ((*i) -> mWaiting)
+			waiting.push_back(*i);
+
+	if (waiting.empty())
+		return;
+
+	std::sort(waiting.begin(), waiting.end(), ComesFirst);
+
+	std::vector<dev_t> reserved;
+	bigtime_t now = system_time();
+
+	for (client_list_t::iterator i = waiting.begin();  i != waiting.end();  ++i) {
+		Client *client = *i;
+		bool free = true;
+
+		for (int32 j = 0;  j < 2;  ++j) {
+			dev_t dev = client -> mDevices[j];
+			if (dev < 0)
+				continue;
+
+			if (mDevices[dev].mOwner != 0
+				||  std::find(reserved.begin(), reserved.end(), dev) != reserved.end())
+				free = false;
+		}
+
+		if (free == false) {
+			for (int32 j = 0;  j < 2;  ++j)
+				if (client -> mDevices[j] >= 0)
+					reserved.push_back(client -> mDevices[j]);		// keep them for this one
+			continue;
+		}
+
+		for (int32 j = 0;  j < 2;  ++j)
+			if (client -> mDevices[j] >= 0)
+				mDevices[client -> mDevices[j]].mOwner = client;
+
+		client -> mWaiting = false;
+		client -> mOwner = true;
+		client -> mWaitTime += now - client -> mWaitStart;
+		client -> mSliceStart = now;
+		client -> mLastAccounted = now;
+
+		release_sem(client -> mWakeSem);
+	}
+}
+
+}	// namespace BPrivate
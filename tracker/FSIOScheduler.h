@@ -0,0 +1,134 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+//	FSIOScheduler hands out the devices touched by running file operations
+//	in time slices.
+//
+//	Every TFSContext registers when its operation begins and asks for its
+//	source and target devices from CheckCancel(). An operation that owns its
+//	devices keeps running until its slice is used up and somebody else is
+//	waiting for one of them; operations on independent devices never wait
+//	for each other. Waiters are served small (nearly finished) operations
+//	first, then in arrival order, and devices wanted by a blocked waiter are
+//	reserved so that later waiters cannot starve it.
+
+#if !defined(_FSIOSCHEDULER_H)
+#define _FSIOSCHEDULER_H
+
+#include <Locker.h>
+#include <OS.h>
+
+#include <map>
+#include <vector>
+
+namespace BPrivate {
+
+class TFSContext;
+
+class FSIOScheduler {
+	friend FSIOScheduler &gIOScheduler();
+
+	struct Client {
+		TFSContext *	mContext;
+		dev_t			mDevices[2];
+		sem_id			mWakeSem;
+		bigtime_t		mSliceStart;
+		bigtime_t		mLastAccounted;
+		bigtime_t		mWaitStart;
+		bigtime_t		mWaitTime;
+		off_t			mLastBytes;
+		off_t			mRemaining;
+		int32			mSequence;
+		bool			mWaiting;
+		bool			mOwner;
+	};
+
+	struct Device {
+		Client *		mOwner;
+		off_t			mBytes;
+		bigtime_t		mBusyTime;
+
+		Device() : mOwner(0), mBytes(0), mBusyTime(0) {}
+	};
+
+	typedef std::vector<Client *>		client_list_t;
+	typedef std::map<dev_t, Device>		device_map_t;
+
+	FSIOScheduler();
+
+public:
+	~FSIOScheduler();
+
+			void		Register(TFSContext &);
+			void		Unregister(const TFSContext &);
+
+			status_t	Acquire(TFSContext &, off_t in_bytes_done, off_t in_bytes_left, bigtime_t in_timeout);
+						// returns B_OK when the context owns its devices, B_TIMED_OUT if it should check
+						// for cancel/pause and call again; in_bytes_left is negative when it isn't known
+			void		Release(const TFSContext &);
+						// gives up the devices (and the place in the queue) while paused or waiting for the user
+
+			bigtime_t	WaitTime(const TFSContext &);
+			float		DeviceThroughput(dev_t);		// MB/s measured while the device was owned
+
+private:
+			Client *	FindClient(const TFSContext &);
+			void		SetDevices(Client *, dev_t in_source, dev_t in_target);
+			void		Account(Client *, off_t in_bytes_done);
+			bool		IsSomebodyWaitingFor(const Client *);
+			void		ReleaseDevices(Client *);
+			void		Grant();
+
+	static	bool		ComesFirst(const Client *, const Client *);
+
+	static	FSIOScheduler *	sSelf;
+	static	int32			sInitialized;
+
+	BLocker					mLocker;
+	client_list_t			mClients;
+	device_map_t			mDevices;
+	int32					mSequence;
+};
+
+inline FSIOScheduler &
+gIOScheduler() {
+	if (atomic_or(&FSIOScheduler :: sInitialized, 1) == 0) {
+		FSIOScheduler :: sSelf = new FSIOScheduler();
+	}
+	return *FSIOScheduler :: sSelf;
+}
+
+}	// namespace BPrivate
+
+#endif // _FSIOSCHEDULER_H
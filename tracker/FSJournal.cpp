@@ -0,0 +1,300 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+#include "FSJournal.h"
+
+#include <Autolock.h>
+#include <Entry.h>
+#include <OS.h>
+
+#include <stdio.h>
+
+#if _BUILDING_tracker
+  #include "Attributes.h"
+  #include "Utilities.h"
+#endif
+
+namespace fs {
+
+static const uint32		kJournalMagic			= 'FSjr';
+static const uint32		kJournalVersion			= 1;
+static const char		*kJournalName			= "Tracker journal ";
+
+static const int32		kRecordDone				= 1;
+static const int32		kRecordPartial			= 2;
+
+static const bigtime_t	kFlushInterval			= 1000000;
+
+Journal::Journal() :
+				mId(0),
+				mEnd(0),
+				mPartialOffset(0),
+				mPartialDirty(false),
+				mLastFlush(system_time()),
+				mRemoved(false) {
+
+	mName[0] = 0;
+}
+
+Journal::~Journal() {
+
+	Flush();
+}
+
+status_t
+Journal::SetTo(BDirectory &in_dir, uint32 in_id) {
+
+	BAutolock l(mLocker);
+
+	mDir = in_dir;
+	mId = in_id;
+	sprintf(mName, "%s%08lx", kJournalName, in_id);
+	mLastFlush = system_time();
+
+	return Read();
+}
+
+status_t	// loads the records up to the first broken one, and cuts the file there so new records follow the valid ones
+Journal::Read() {
+
+	BFile file(&mDir, mName, B_READ_WRITE);
+	if (file.InitCheck() != B_OK)
+		return file.InitCheck();					// this operation has not been interrupted before
+	
+	Header header;
+	header.mMagic = 0;
+	uint32 sum = 0;
+	if (file.ReadAt(0, &header, sizeof(header)) == sizeof(header)) {
+		sum = header.mChecksum;
+		header.mChecksum = 0;
+	}
+	
+	if (header.mMagic != kJournalMagic  ||  header.mVersion != kJournalVersion  ||  header.mId != mId
+			||  sum != Checksum(&header, sizeof(header))) {
+
+		file.Unset();
+		BEntry(&mDir, mName).Remove();				// unusable, start over
+		return B_BAD_DATA;
+	}
+
+	mEnd = sizeof(header);
+	
+	Record record;
+	while (file.ReadAt(mEnd, &record, sizeof(record)) == sizeof(record)) {
+	
+		sum = record.mChecksum;
+		record.mChecksum = 0;
+		if (sum != Checksum(&record, sizeof(record)))
+			break;
+		
+		node_ref node;
+		node.device = record.mDevice;
+		node.node = record.mNode;
+		
+		if (record.mType == kRecordDone) {
+			mResumeState[node] = kDone;
+		} else if (record.mType == kRecordPartial) {
+			state_map_t::iterator i = mResumeState.find(node);
+			if (i == mResumeState.end()  ||  i -> second != kDone)
+				mResumeState[node] = record.mOffset;
+		} else
+			break;
+
+		mEnd += sizeof(record);
+	}
+	
+	file.SetSize(mEnd);
+	mFile = file;
+	
+	return B_OK;
+}
+
+status_t
+Journal::Create() {
+
+	status_t rc;
+	if ((rc = mFile.SetTo(&mDir, mName, B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE)) != B_OK)
+		return rc;
+	
+	Header header;
+	header.mMagic = kJournalMagic;
+	header.mVersion = kJournalVersion;
+	header.mId = mId;
+	header.mChecksum = 0;
+	header.mChecksum = Checksum(&header, sizeof(header));
+	
+	ssize_t written = mFile.WriteAt(0, &header, sizeof(header));
+	if (written != sizeof(header)) {
+		mFile.Unset();
+		BEntry(&mDir, mName).Remove();
+		return (written < 0) ? written : B_IO_ERROR;
+	}
+
+	#if _BUILDING_tracker
+		PoseInfo info;							// it's none of the user's business
+		info.fInvisible = true;
+		info.fInitedDirectory = -1;
+		mFile.WriteAttr(kAttrPoseInfo, B_RAW_TYPE, 0, &info, sizeof(info));
+	#endif
+
+	mEnd = sizeof(header);
+	return B_OK;
+}
+
+void	// Precond: locked
+Journal::Append(int32 in_type, const node_ref &in_node, off_t in_offset) {
+
+	Record record;
+	record.mType = in_type;
+	record.mChecksum = 0;
+	record.mDevice = in_node.device;
+	record.mReserved = 0;
+	record.mNode = in_node.node;
+	record.mOffset = in_offset;
+	record.mChecksum = Checksum(&record, sizeof(record));
+	
+	mPending.push_back(record);
+}
+
+bool
+Journal::Lookup(const node_ref &in_node, off_t *out_offset) const {
+
+	state_map_t::const_iterator i = mResumeState.find(in_node);
+	if (i == mResumeState.end())
+		return false;
+	
+	*out_offset = i -> second;
+	return true;
+}
+
+void
+Journal::Started(const node_ref &in_node) {
+
+	BAutolock l(mLocker);
+
+	off_t offset;
+	if (Lookup(in_node, &offset) == false)
+		Append(kRecordPartial, in_node, 0);
+}
+
+void
+Journal::Done(const node_ref &in_node) {
+
+	BAutolock l(mLocker);
+
+	if (mPartialDirty  &&  mPartialNode == in_node)
+		mPartialDirty = false;
+
+	off_t offset;
+	if (Lookup(in_node, &offset) == false  ||  offset != kDone)
+		Append(kRecordDone, in_node, kDone);
+
+	if (system_time() - mLastFlush >= kFlushInterval)
+		Flush();
+}
+
+void	// only the last offset is kept until the next flush
+Journal::Partial(const node_ref &in_node, off_t in_offset, bool in_flush) {
+
+	BAutolock l(mLocker);
+
+	mPartialNode = in_node;
+	mPartialOffset = in_offset;
+	mPartialDirty = true;
+	
+	if (in_flush  ||  system_time() - mLastFlush >= kFlushInterval)
+		Flush();
+}
+
+status_t
+Journal::Flush() {
+
+	BAutolock l(mLocker);
+
+	if (mRemoved  ||  mId == 0)
+		return B_OK;
+
+	if (mPartialDirty) {
+		Append(kRecordPartial, mPartialNode, mPartialOffset);
+		mPartialDirty = false;
+	}
+	
+	mLastFlush = system_time();
+
+	if (mPending.empty())
+		return B_OK;
+	
+	status_t rc;
+	if (mFile.InitCheck() != B_OK  &&  (rc = Create()) != B_OK)
+		return rc;
+	
+	size_t size = mPending.size() * sizeof(Record);
+	ssize_t written = mFile.WriteAt(mEnd, &mPending[0], size);
+	if (written < 0)
+		return written;								// keep them, maybe there will be space later
+
+	mEnd += written;
+	mPending.clear();
+	
+	return B_OK;
+}
+
+void
+Journal::Remove() {
+
+	BAutolock l(mLocker);
+
+	mRemoved = true;
+	mPending.clear();
+	mPartialDirty = false;
+	
+	if (mFile.InitCheck() == B_OK) {
+		mFile.Unset();
+		BEntry(&mDir, mName).Remove();
+	}
+}
+
+uint32	// FNV-1a
+Journal::Checksum(const void *in_data, size_t in_size, uint32 in_seed) {
+
+	const uint8 *data = (const uint8 *)in_data;
+	uint32 hash = 2166136261UL ^ in_seed;
+
+	while (in_size-- > 0)
+		hash = (hash ^ *data++) * 16777619UL;
+
+	return hash;
+}
+
+}	// namespace fs
@@ -0,0 +1,128 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+//	Journal records the progress of a copy or move on the target volume, so
+//	that the same operation started again after a cancel, an error or a crash
+//	can skip what is already there and continue a file where it stopped.
+//
+//	It is a file in the root target directory, named after the operation's
+//	id. It holds a header and a list of fixed size records: one for every
+//	finished entry and one for the offset reached in the file being copied.
+//	Every record carries a checksum, and reading stops at the first broken
+//	one, so a journal torn by a crash still gives back everything before the
+//	tear. Records are written at most once a second, and nothing is written
+//	at all for operations that finish within that time.
+
+#if !defined(_FSJOURNAL_H)
+#define _FSJOURNAL_H
+
+#include <Directory.h>
+#include <File.h>
+#include <Locker.h>
+#include <Node.h>
+
+#include <map>
+#include <vector>
+
+namespace fs {
+
+class Journal {
+	struct NodeRefLess {
+		bool operator()(const node_ref &a, const node_ref &b) const
+			{ return a.device < b.device  ||  (a.device == b.device  &&  a.node < b.node); }
+	};
+	typedef std::map<node_ref, off_t, NodeRefLess>	state_map_t;
+
+	struct Header {
+		uint32			mMagic;
+		uint32			mVersion;
+		uint32			mId;
+		uint32			mChecksum;
+	};
+
+	struct Record {
+		int32			mType;
+		uint32			mChecksum;
+		int32			mDevice;
+		int32			mReserved;
+		int64			mNode;
+		int64			mOffset;
+	};
+	typedef std::vector<Record>						record_list_t;
+
+public:
+	static const off_t	kDone = -1;
+
+	Journal();
+	~Journal();
+
+			status_t	SetTo(BDirectory &dir, uint32 id);	// reads back an earlier journal of the operation, if any
+			void		Remove();							// the operation succeeded, forget about it
+
+			bool		Lookup(const node_ref &node, off_t *offset) const;	// kDone or the offset an earlier run reached
+			int32		CountResumable() const						{ return mResumeState.size(); }
+
+			void		Started(const node_ref &node);			// a directory, enter it again on resume
+			void		Done(const node_ref &node);
+			void		Partial(const node_ref &node, off_t offset, bool flush = false);
+			status_t	Flush();
+
+	static	uint32		Checksum(const void *data, size_t size, uint32 seed = 0);
+
+private:
+			status_t	Read();
+			status_t	Create();
+			void		Append(int32 type, const node_ref &node, off_t offset);
+
+	BLocker				mLocker;				// the writer thread of a two device file copy checkpoints, too
+	BDirectory			mDir;
+	BFile				mFile;
+	char				mName[B_FILE_NAME_LENGTH];
+	uint32				mId;
+
+	state_map_t			mResumeState;			// what the earlier runs have recorded
+	record_list_t		mPending;				// not written yet
+	off_t				mEnd;					// the end of the last valid record in the file
+
+	node_ref			mPartialNode;
+	off_t				mPartialOffset;
+	bool				mPartialDirty;
+
+	bigtime_t			mLastFlush;
+	bool				mRemoved;
+};
+
+}	// namespace fs
+
+#endif // _FSJOURNAL_H
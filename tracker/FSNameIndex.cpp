@@ -0,0 +1,143 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+#include "FSNameIndex.h"
+
+#include <dirent.h>
+#include <string.h>
+
+namespace fs {
+
+static const size_t	kInitialBucketCount		= 64;
+static const size_t	kDirentBufferSize		= 4096;
+
+NameIndex::NameIndex() :
+				mBuckets(kInitialBucketCount),
+				mCount(0),
+				mUses(0),
+				mBuilt(false) {
+}
+
+status_t	// reads the names with GetNextDirents(), nothing is stat-ed
+NameIndex::Build(BDirectory &in_dir) {
+
+	status_t rc;
+	if ((rc = in_dir.Rewind()) != B_OK)
+		return rc;
+
+	char buffer[kDirentBufferSize];
+	dirent *ent = (dirent *)buffer;
+
+	int32 count;
+	while ((count = in_dir.GetNextDirents(ent, sizeof(buffer), kDirentBufferSize)) > 0) {
+		dirent *pos = ent;
+		for (int32 i = 0;  i < count;  ++i) {
+			if (strcmp(pos -> d_name, ".") != 0  &&  strcmp(pos -> d_name, "..") != 0)
+				Add(pos -> d_name);
+				
+			pos = (dirent *)((char *)pos + pos -> d_reclen);
+		}
+	}
+
+	in_dir.Rewind();
+	
+	if (count < 0)
+		return count;
+
+	mBuilt = true;
+	return B_OK;
+}
+
+bool
+NameIndex::Contains(const char *in_name) const {
+
+	const bucket_t &bucket = mBuckets[Hash(in_name) % mBuckets.size()];
+	
+	for (bucket_t::const_iterator i = bucket.begin();  i != bucket.end();  ++i)
+		if (*i == in_name)
+			return true;
+
+	return false;
+}
+
+void
+NameIndex::Add(const char *in_name) {
+
+	if (Contains(in_name))
+		return;
+
+	if ((size_t)mCount >= mBuckets.size() * 2)
+		Rehash(mBuckets.size() * 4);
+		
+	mBuckets[Hash(in_name) % mBuckets.size()].push_back(in_name);
+	++mCount;
+}
+
+void
+NameIndex::Remove(const char *in_name) {
+
+	bucket_t &bucket = mBuckets[Hash(in_name) % mBuckets.size()];
+	
+	for (bucket_t::iterator i = bucket.begin();  i != bucket.end();  ++i) {
+		if (*i == in_name) {
+			bucket.erase(i);
+			--mCount;
+			return;
+		}
+	}
+}
+
+uint32
+NameIndex::Hash(const char *in_name) {
+
+	uint32 hash = 0;
+	while (*in_name)
+		hash = (hash << 5) - hash + (uint8)*in_name++;		// hash * 31 + c
+		
+	return hash;
+}
+
+void
+NameIndex::Rehash(size_t in_bucket_count) {
+
+	bucket_list_t buckets(in_bucket_count);
+	
+	for (bucket_list_t::iterator i = mBuckets.begin();  i != mBuckets.end();  ++i)
+		for (bucket_t::iterator j = i -> begin();  j != i -> end();  ++j)
+			buckets[Hash(j -> c_str()) % in_bucket_count].push_back(*j);
+
+	mBuckets.swap(buckets);
+}
+
+}	// namespace fs
@@ -0,0 +1,84 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+//	NameIndex is an in-memory set of the entry names of one directory.
+//
+//	FSContext builds one for a target directory the second time it has to
+//	look for a free name in it, by reading the directory once, and keeps it
+//	up to date with the entries the operation creates and removes. It is
+//	not told about changes made by others, so a name found in the index
+//	may be free already and a name not in it must still be checked before
+//	it is used.
+
+#if !defined(_FSNAMEINDEX_H)
+#define _FSNAMEINDEX_H
+
+#include <Directory.h>
+
+#include <string>
+#include <vector>
+
+namespace fs {
+
+class NameIndex {
+	typedef std::vector<std::string>	bucket_t;
+	typedef std::vector<bucket_t>		bucket_list_t;
+
+public:
+	NameIndex();
+
+			status_t	Build(BDirectory &);
+			bool		IsBuilt() const								{ return mBuilt; }
+
+			bool		Contains(const char *name) const;
+			void		Add(const char *name);
+			void		Remove(const char *name);
+
+			int32		CountNames() const							{ return mCount; }
+			int32		Uses() const								{ return mUses; }
+			void		Used()										{ ++mUses; }
+
+private:
+	static	uint32		Hash(const char *name);
+			void		Rehash(size_t bucket_count);
+
+	bucket_list_t		mBuckets;
+	int32				mCount;
+	int32				mUses;
+	bool				mBuilt;
+};
+
+}	// namespace fs
+
+#endif // _FSNAMEINDEX_H
@@ -36,6 +36,7 @@ All rights reserved.
 #include "Attributes.h"
 #include "Bitmaps.h"
 #include "Commands.h"
+#include "FSIOScheduler.h"
 #include "FSStatusWindow.h"
 #include "LanguageTheme.h"
 #include "Tracker.h"
@@ -164,22 +165,6 @@ FSStatusWindow::Remove(const TFSContext &in_context) {
 	}
 }
 
-bool
-FSStatusWindow::ShouldPause(const TFSContext &in_context) {
-	ContainerView *view = &mContainer;
-	
-	if (ContainerView::HasReplicantInstance())
-		view = &ContainerView::ReplicantInstance();
-
-	bool b = false;
-	
-	if (view -> LockLooper()) {	// make sure the view is still inact
-		b = view -> ShouldPause(in_context);
-		view -> UnlockLooper();
-	}
-	return b;
-}
-
 bool
 FSStatusWindow::QuitRequested() {
 
@@ -455,18 +440,6 @@ FSStatusWindow::ContainerView::Remove(const TFSContext &in_context) {
 		if (*view == in_context) {
 			RemoveChild(view);
 			delete view;
-			
-			// resume next autopaused
-			--count;
-			for (;  i < count;  ++i) {
-			
-				TFSContext &context = assert_cast<StatusView *>(ChildAt(i)) -> FSContext();
-				if (context.IsAutoPaused()) {
-					context.ContinueAutoPaused();
-					i = count;
-					break;
-				}
-			}
 			break;
 		}
 	}
@@ -479,38 +452,6 @@ FSStatusWindow::ContainerView::Remove(const TFSContext &in_context) {
 	}
 }
 
-bool
-FSStatusWindow::ContainerView::ShouldPause(const TFSContext &in_context) {
-	ASSERT(Looper() -> IsLocked());
-	
-	int32 count = CountChildren();
-	if (count <= 1)
-		return false;
-		
-	for (int32 i = 0;  i < count;  ++i) {
-		StatusView *view = dynamic_cast<StatusView *>(ChildAt(i));
-		if (!view)
-			continue;
-		
-		TFSContext &context = view -> FSContext();
-		
-		if (&context == &in_context) {
-			if (i == 0)			// first operation should be running
-				return false;
-		
-			continue;
-		}
-		
-		if (context.IsDeviceInvolved(in_context.SourceDevice())  ||
-			context.IsDeviceInvolved(in_context.TargetDevice())) {
-
-			return true;
-		}
-	}
-	
-	return false;
-}
-
 bool
 FSStatusWindow::ContainerView::AttemptToQuit() {
 	if (LockLooper()) {
@@ -618,6 +559,9 @@ FSStatusWindow::StatusView::StatusView(TFSContext &in_context) :
 								inherited(BRect(0, 0, kStatusViewPreferredWidth, kStatusViewPreferredHeight),
 											"Status View", B_FOLLOW_LEFT_RIGHT, B_WILL_DRAW + B_FRAME_EVENTS),
 								mLastDetailsUpdated(0),
+								mDetailsGeneration(-1),
+								mDetailsTimeLeft(0),
+								mDetailsSeconds(0),
 								mContext(in_context),
 								mProgressView(mContext),
 								mExpandButton(BRect(), LOCALE("Details")),
@@ -702,9 +646,23 @@ FSStatusWindow::StatusView::CustomPulse() {
 		if (system_time() - mLastDetailsUpdated > kDetailsUpdateDelay) {
 			mLastDetailsUpdated = system_time();
 			
-			BRect rect = Bounds();
-			rect.top = mProgressView.Frame().bottom + 1;
-			Invalidate(rect);
+			// a paused or blocked operation would redraw the same numbers
+			TFSContext::ProgressInfo::Snapshot info;
+			mContext.mProgressInfo.GetSnapshot(info);
+			int32 time_left = mContext.EstimatedTimeLeft();
+			int32 seconds = mContext.ElapsedTime() / 1000000;
+			
+			if (info.mGeneration != mDetailsGeneration  ||  time_left != mDetailsTimeLeft  ||
+				seconds != mDetailsSeconds) {
+				
+				mDetailsGeneration = info.mGeneration;
+				mDetailsTimeLeft = time_left;
+				mDetailsSeconds = seconds;
+				
+				BRect rect = Bounds();
+				rect.top = mProgressView.Frame().bottom + 1;
+				Invalidate(rect);
+			}
 		}
 	}
 }
@@ -723,7 +681,7 @@ FSStatusWindow::StatusView::GetPreferredSize(float *in_width, float *in_height)
 	if (mExpanded) {
 		*in_height += sFontHeight + 10;
 		if (mContext.mProgressInfo.IsTotalSizeProgressEnabled()) {
-			*in_height += sFontHeight * 2;
+			*in_height += sFontHeight * 3;
 		}		
 	}
 }
@@ -901,7 +859,7 @@ FSStatusWindow::StatusView::Draw(BRect in_rect) {
 			
 			DrawString(LOCALE("Copy speed:"), BPoint(mDetailsRect.left + 3, y));
 
-			sprintf(buf, "%.2f MB/s", (float)mContext.mProgressInfo.mCurrentSize / (mContext.ElapsedTime()));
+			sprintf(buf, "%.2f MB/s", (float)mContext.mProgressInfo.CurrentSize() / (mContext.ElapsedTime()));
 			DrawString(buf, BPoint(ruler, y));
 			
 			y += sFontHeight;
@@ -915,6 +873,20 @@ FSStatusWindow::StatusView::Draw(BRect in_rect) {
 			DrawString(LOCALE("Queue size:"), BPoint(mDetailsRect.left + 3, y));
 			TFSContext::GetSizeString(buf, mContext.TotalMemoryUsage(), 0);
 			DrawString(buf, BPoint(ruler, y));
+
+			y += sFontHeight;
+
+			DrawString(LOCALE("Disk speed:"), BPoint(mDetailsRect.right - 140, y));
+			dev_t source = mContext.SourceDevice(), target = mContext.TargetDevice();
+			if (source == target  ||  target < 0)
+				sprintf(buf, "%.2f MB/s", gIOScheduler().DeviceThroughput(source));
+			else
+				sprintf(buf, "%.2f / %.2f MB/s", gIOScheduler().DeviceThroughput(source), gIOScheduler().DeviceThroughput(target));
+			DrawString(buf, BPoint(mDetailsRect.right - 3 - StringWidth(buf), y));
+
+			DrawString(LOCALE("Disk wait:"), BPoint(mDetailsRect.left + 3, y));
+			CreateTimeString(buf, mContext.DeviceWaitTime(), true);
+			DrawString(buf, BPoint(ruler, y));
 		}
 	}
 }
@@ -1043,7 +1015,7 @@ FSStatusWindow::StatusView::MessageReceived(BMessage *in_msg) {
 FSStatusWindow::StatusView::ProgressView::ProgressView(TFSContext &in_context) :
 						inherited(BRect(0, 0, 10, 10), "Progress View", B_FOLLOW_LEFT_RIGHT, B_WILL_DRAW + B_FRAME_EVENTS),
 						mContext(in_context), mMode(TFSContext::kInvalidOperation),
-						mStatusBar(BRect(), "StatusBar"), mVerbose(sDefaultVerboseState), mSyncLossDetected(false) {
+						mStatusBar(BRect(), "StatusBar"), mGeneration(-1), mVerbose(sDefaultVerboseState), mSyncLossDetected(false) {
 	
 	SetViewColor(ui_color(B_PANEL_BACKGROUND_COLOR));
 	
@@ -1099,7 +1071,8 @@ FSStatusWindow::StatusView::ProgressView::SetOperationString() {
 			str.Append(LOCALE(" (Paused)"));
 		else
 			str.Append(LOCALE(" (Pausing)"B_UTF8_ELLIPSIS));
-	}
+	} else if (mContext.IsWaitingForDevice())
+		str.Append(LOCALE(" (Waiting for disk)"));
 	
 	mStatusBar.SetText(str.String());
 	
@@ -1128,7 +1101,8 @@ FSStatusWindow::StatusView::ProgressView::SetMode() {
 
 void
 FSStatusWindow::StatusView::ProgressView::CustomPulse() {
-	TFSContext::ProgressInfo &info = mContext.mProgressInfo;
+	TFSContext::ProgressInfo::Snapshot info;
+	mContext.mProgressInfo.GetSnapshot(info);
 
 	// follow operation changes of the context
 	if (mMode != mContext.LastPrimaryOperation())
@@ -1139,8 +1113,13 @@ FSStatusWindow::StatusView::ProgressView::CustomPulse() {
 		SetMode();
 	}
 	
-	if (info.IsDirty() == false)						// no update since last check
+	if (mContext.IsOperationStringDirty())
+		SetOperationString();
+	
+	if (info.mGeneration == mGeneration)				// no update since last check
 		return;
+	
+	mGeneration = info.mGeneration;
 
 	DrawCurrentEntry();									// XXX optimize?
 	
@@ -1203,16 +1182,11 @@ FSStatusWindow::StatusView::ProgressView::CustomPulse() {
 	mStatusBar.SetTrailingText(buf);
 #endif
 	
-	info.ClearDirty();
-	
 	float w, h;
 	GetPreferredSize(&w, &h);
 	
 	BRect bounds = Bounds();
 	
-	if (mContext.IsOperationStringDirty())
-		SetOperationString();
-	
 	if (w > bounds.Width()  ||  h > bounds.Height()) {			// if we need more space call owner window's Pack()
 		FSStatusWindow *win = dynamic_cast<FSStatusWindow *>(Window());
 		if (win) {
@@ -1267,7 +1241,8 @@ FSStatusWindow::StatusView::ProgressView::DrawCurrentEntry() {
 
 	BString str(mContext.CurrentEntryName());
 
-	TFSContext::ProgressInfo &info = mContext.mProgressInfo;
+	TFSContext::ProgressInfo::Snapshot info;
+	mContext.mProgressInfo.GetSnapshot(info);
 	if (info.IsTotalSizeProgressEnabled()) {
 		char buf[64];
 		char *ptr = buf;
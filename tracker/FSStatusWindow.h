@@ -74,7 +74,6 @@ friend FSStatusWindow &gStatusWindow();
 				
 				void		Add(TFSContext &);
 				void		Remove(const TFSContext &);
-				bool		ShouldPause(const TFSContext &);
 				void		Draw(BRect);
 				void		AllAttached();
 				void		MessageReceived(BMessage *);
@@ -167,6 +166,7 @@ friend FSStatusWindow &gStatusWindow();
 //			float								mCountStringPosition,
 //												mTotalSizeStringPosition,
 //												mSizeStringPosition;
+			int32								mGeneration;	// of the progress info last shown
 			bool								mVerbose;
 			bool								mSyncLossDetected;
 		};
@@ -200,6 +200,9 @@ friend FSStatusWindow &gStatusWindow();
 		static font_height		sFontHeightStruct;
 		
 		bigtime_t				mLastDetailsUpdated;
+		int32					mDetailsGeneration;		// what the details were last drawn from
+		int32					mDetailsTimeLeft;
+		int32					mDetailsSeconds;
 		TFSContext &			mContext;
 		ProgressView			mProgressView;
 		PaneSwitch				mExpandButton;
@@ -231,7 +234,6 @@ public:
 
 			void		Add(TFSContext &);
 			void		Remove(const TFSContext &);
-			bool		ShouldPause(const TFSContext &);
 			void		DispatchMessage(BMessage *, BHandler *);
 			void		Pack();
 		ContainerView &	Container()					{ ASSERT(IsLocked()); return mContainer; }
@@ -0,0 +1,297 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+#include "FSTelemetry.h"
+
+#include <Autolock.h>
+
+#include <string.h>
+
+namespace fs {
+
+static const char *kSyscallNames[Telemetry::kTotalSyscalls] = {
+	"read",
+	"write",
+	"read attribute",
+	"write attribute",
+	"stat",
+	"open",
+	"create",
+	"remove",
+	"rename",
+	"set size"
+};
+
+TelemetryLog *	TelemetryLog	:: sSelf;
+int32			TelemetryLog	:: sInitialized = 0;
+
+Telemetry::Telemetry() :
+				mReaderBlocked(0),
+				mWriterBlocked(0),
+				mStartTime(system_time()),
+				mEndTime(0),
+				mBytesRead(0),
+				mBytesWritten(0),
+				mAttributeBytesRead(0),
+				mAttributeBytesWritten(0),
+				mFiles(0),
+				mDeviceCount(0) {
+
+	mOperation[0] = 0;
+	memset(mSyscalls, 0, sizeof(mSyscalls));
+	memset(mChunkSizes, 0, sizeof(mChunkSizes));
+	memset(mLatencies, 0, sizeof(mLatencies));
+	memset(mDevices, 0, sizeof(mDevices));
+	mDevices[kDeviceSlots].mDevice = -1;
+}
+
+void
+Telemetry::SetOperation(const char *in_name) {
+
+	strncpy(mOperation, in_name, sizeof(mOperation) - 1);
+	mOperation[sizeof(mOperation) - 1] = 0;
+	mStartTime = system_time();
+}
+
+int32
+Telemetry::ChunkBucket(size_t in_size) {
+
+	int32 bucket = 0;
+	for (size_t limit = 4096;  in_size > limit  &&  bucket < kChunkBuckets - 1;  limit <<= 1)
+		++bucket;
+
+	return bucket;
+}
+
+Telemetry::DeviceCounters &
+Telemetry::Device(dev_t in_device) {
+
+	for (int32 i = 0;  i < mDeviceCount;  ++i)
+		if (mDevices[i].mDevice == in_device)
+			return mDevices[i];
+
+	if (mDeviceCount == kDeviceSlots)
+		return mDevices[kDeviceSlots];
+
+	DeviceCounters &counters = mDevices[mDeviceCount];
+	counters.mDevice = in_device;
+	counters.mBytesRead = 0;
+	counters.mBytesWritten = 0;
+	atomic_add(&mDeviceCount, 1);
+	
+	return counters;
+}
+
+void	// called from the main thread only, after the file is closed
+Telemetry::FileDone(bigtime_t in_latency, dev_t in_source, off_t in_read, dev_t in_target, off_t in_written) {
+
+	++mFiles;
+
+	int32 bucket = 0;
+	while (in_latency > 1  &&  bucket < kLatencyBuckets - 1) {
+		in_latency >>= 1;
+		++bucket;
+	}
+	++mLatencies[bucket];
+	
+	Device(in_source).mBytesRead += in_read;
+	Device(in_target).mBytesWritten += in_written;
+}
+
+bigtime_t	// the upper limit of the bucket the percentile falls in
+Telemetry::LatencyPercentile(int32 in_percent) const {
+
+	if (mFiles == 0)
+		return 0;
+	
+	int32 wanted = (mFiles * in_percent + 99) / 100, seen = 0;
+	for (int32 i = 0;  i < kLatencyBuckets;  ++i) {
+		seen += mLatencies[i];
+		if (seen >= wanted)
+			return (bigtime_t)2 << i;
+	}
+	
+	return (bigtime_t)2 << (kLatencyBuckets - 1);
+}
+
+status_t
+Telemetry::Archive(BMessage *out_msg) const {
+
+	out_msg -> AddString("operation", mOperation);
+	out_msg -> AddInt64("elapsed", ((mEndTime) ? mEndTime : system_time()) - mStartTime);
+	out_msg -> AddInt64("bytes read", mBytesRead);
+	out_msg -> AddInt64("bytes written", mBytesWritten);
+	out_msg -> AddInt64("attribute bytes read", mAttributeBytesRead);
+	out_msg -> AddInt64("attribute bytes written", mAttributeBytesWritten);
+	out_msg -> AddInt64("reader blocked", mReaderBlocked);
+	out_msg -> AddInt64("writer blocked", mWriterBlocked);
+	out_msg -> AddInt32("files", mFiles);
+	
+	for (int32 i = 0;  i < kTotalSyscalls;  ++i)
+		out_msg -> AddInt32(kSyscallNames[i], mSyscalls[i]);
+
+	for (int32 i = 0;  i < kChunkBuckets;  ++i)
+		out_msg -> AddInt32("chunk sizes", mChunkSizes[i]);
+
+	out_msg -> AddInt64("file latency 50%", LatencyPercentile(50));
+	out_msg -> AddInt64("file latency 90%", LatencyPercentile(90));
+	out_msg -> AddInt64("file latency 99%", LatencyPercentile(99));
+
+	int32 count = mDeviceCount;
+	for (int32 i = 0;  i < count;  ++i)
+		ArchiveDevice(out_msg, mDevices[i]);
+
+	if (mDevices[kDeviceSlots].mBytesRead != 0  ||  mDevices[kDeviceSlots].mBytesWritten != 0)
+		ArchiveDevice(out_msg, mDevices[kDeviceSlots]);		// device -1: all the others
+
+	return B_OK;
+}
+
+void
+Telemetry::ArchiveDevice(BMessage *out_msg, const DeviceCounters &in_counters) const {
+
+	out_msg -> AddInt32("device", in_counters.mDevice);
+	out_msg -> AddInt64("device bytes read", in_counters.mBytesRead);
+	out_msg -> AddInt64("device bytes written", in_counters.mBytesWritten);
+}
+
+void
+Telemetry::Dump(FILE *out_file) const {
+
+	fprintf(out_file, "%s, %.3f s\n", (mOperation[0]) ? mOperation : "(no operation)",
+			(((mEndTime) ? mEndTime : system_time()) - mStartTime) / 1000000.0);
+	fprintf(out_file, "  bytes:      %Ld read, %Ld written\n", mBytesRead, mBytesWritten);
+	fprintf(out_file, "  attributes: %Ld bytes read, %Ld bytes written\n", mAttributeBytesRead, mAttributeBytesWritten);
+	fprintf(out_file, "  blocked:    reader %.3f s, writer %.3f s\n", mReaderBlocked / 1000000.0, mWriterBlocked / 1000000.0);
+	fprintf(out_file, "  files:      %ld, latency 50%% < %Ld us, 90%% < %Ld us, 99%% < %Ld us\n", mFiles,
+			LatencyPercentile(50), LatencyPercentile(90), LatencyPercentile(99));
+
+	fprintf(out_file, "  syscalls:  ");
+	for (int32 i = 0;  i < kTotalSyscalls;  ++i)
+		fprintf(out_file, " %s %ld%s", kSyscallNames[i], mSyscalls[i], (i < kTotalSyscalls - 1) ? "," : "\n");
+
+	fprintf(out_file, "  chunks:    ");
+	for (int32 i = 0;  i < kChunkBuckets;  ++i)
+		if (mChunkSizes[i] != 0)
+			fprintf(out_file, " <=%ldk %ld", 4L << i, mChunkSizes[i]);
+	fprintf(out_file, "\n");
+
+	int32 count = mDeviceCount;
+	for (int32 i = 0;  i < count;  ++i)
+		fprintf(out_file, "  device %ld:  %Ld read, %Ld written\n", mDevices[i].mDevice, mDevices[i].mBytesRead, mDevices[i].mBytesWritten);
+
+	if (mDevices[kDeviceSlots].mBytesRead != 0  ||  mDevices[kDeviceSlots].mBytesWritten != 0)
+		fprintf(out_file, "  other devices:  %Ld read, %Ld written\n", mDevices[kDeviceSlots].mBytesRead, mDevices[kDeviceSlots].mBytesWritten);
+}
+
+TelemetryLog::TelemetryLog() :
+				mLocker("TelemetryLog") {
+}
+
+void
+TelemetryLog::Register(const Telemetry *in_telemetry) {
+
+	BAutolock l(mLocker);
+	mRunning.push_back(in_telemetry);
+}
+
+void
+TelemetryLog::Unregister(const Telemetry *in_telemetry) {
+
+	BAutolock l(mLocker);
+
+	for (std::vector<const Telemetry *>::iterator i = mRunning.begin();  i != mRunning.end();  ++i) {
+		if (*i == in_telemetry) {
+			mRunning.erase(i);
+			break;
+		}
+	}
+	
+	if (in_telemetry -> BytesRead() == 0  &&  in_telemetry -> BytesWritten() == 0)
+		return;									// creating a folder and the like, not interesting
+	
+	mFinished.push_back(*in_telemetry);
+	mFinished.back().Finish();
+	if ((int32)mFinished.size() > kKeptFinished)
+		mFinished.pop_front();
+}
+
+status_t	// one "running" or "finished" message for each operation; the counters of running ones are read on the fly
+TelemetryLog::Archive(BMessage *out_msg) {
+
+	BAutolock l(mLocker);
+
+	for (std::vector<const Telemetry *>::iterator i = mRunning.begin();  i != mRunning.end();  ++i) {
+		BMessage msg;
+		(*i) -> Archive(&msg);
+		out_msg -> AddMessage("running", &msg);
+	}
+
+	for (std::deque<Telemetry>::iterator i = mFinished.begin();  i != mFinished.end();  ++i) {
+		BMessage msg;
+		i -> Archive(&msg);
+		out_msg -> AddMessage("finished", &msg);
+	}
+
+	return B_OK;
+}
+
+status_t
+TelemetryLog::Dump(const char *in_path) {
+
+	FILE *file = fopen(in_path, "a");
+	if (file == 0)
+		return B_ERROR;
+
+	{
+		BAutolock l(mLocker);
+	
+		fprintf(file, "--- Tracker file operations, %ld running, %ld finished\n", mRunning.size(), mFinished.size());
+		
+		for (std::vector<const Telemetry *>::iterator i = mRunning.begin();  i != mRunning.end();  ++i) {
+			fprintf(file, "running: ");
+			(*i) -> Dump(file);
+		}
+	
+		for (std::deque<Telemetry>::iterator i = mFinished.begin();  i != mFinished.end();  ++i) {
+			fprintf(file, "finished: ");
+			i -> Dump(file);
+		}
+	}
+
+	fclose(file);
+	return B_OK;
+}
+
+}	// namespace fs
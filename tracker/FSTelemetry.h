@@ -0,0 +1,171 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+//	Telemetry is a set of counters every FSContext keeps about its operation:
+//	bytes and system calls, time the copy threads spent blocked on each other,
+//	the sizes of the chunks read, attribute traffic and how long the files took.
+//
+//	The counters are plain additions, each of them is only ever updated by the
+//	thread doing that kind of work, so they cost next to nothing and are always
+//	on. TelemetryLog knows about the running operations and keeps the last few
+//	finished ones; it is what the "Telemetry" scripting property of Tracker
+//	reports and dumps.
+
+#if !defined(_FSTELEMETRY_H)
+#define _FSTELEMETRY_H
+
+#include <Locker.h>
+#include <Message.h>
+#include <OS.h>
+
+#include <stdio.h>
+
+#include <deque>
+#include <vector>
+
+namespace fs {
+
+class Telemetry {
+public:
+	enum syscall {
+		kRead,
+		kWrite,
+		kReadAttribute,
+		kWriteAttribute,
+		kStat,
+		kOpen,
+		kCreate,
+		kRemove,
+		kRename,
+		kSetSize,
+		
+		kTotalSyscalls
+	};
+
+	static const int32	kChunkBuckets		= 16;		// bucket i: chunks up to 4k << i bytes
+	static const int32	kLatencyBuckets		= 32;		// bucket i: files done in less than 2^(i+1) usecs
+	static const int32	kDeviceSlots		= 4;		// devices counted separately, the rest are summed up
+
+	struct DeviceCounters {
+		dev_t			mDevice;
+		off_t			mBytesRead;
+		off_t			mBytesWritten;
+	};
+	
+	// measures the time a copy thread spends waiting for the other one
+	struct BlockedTimer {
+		bigtime_t &		mCounter;
+		bigtime_t		mStart;
+		
+		BlockedTimer(bigtime_t &in_counter) : mCounter(in_counter), mStart(system_time())	{}
+		~BlockedTimer()										{ mCounter += system_time() - mStart; }
+	};
+
+	Telemetry();
+
+			void		SetOperation(const char *name);
+			
+			void		Syscall(syscall kind)					{ ++mSyscalls[kind]; }
+			void		Read(size_t size)						{ ++mSyscalls[kRead]; mBytesRead += size; ++mChunkSizes[ChunkBucket(size)]; }
+			void		Written(size_t size)					{ ++mSyscalls[kWrite]; mBytesWritten += size; }
+			void		AttributeRead(size_t size)				{ ++mSyscalls[kReadAttribute]; mAttributeBytesRead += size; }
+			void		AttributeWritten(size_t size)			{ ++mSyscalls[kWriteAttribute]; mAttributeBytesWritten += size; }
+			void		FileDone(bigtime_t latency, dev_t source, off_t read, dev_t target, off_t written);
+			void		Finish()								{ mEndTime = system_time(); }
+
+			bigtime_t	LatencyPercentile(int32 percent) const;
+			off_t		BytesRead() const						{ return mBytesRead; }
+			off_t		BytesWritten() const					{ return mBytesWritten; }
+			
+			status_t	Archive(BMessage *) const;
+			void		Dump(FILE *) const;
+
+	bigtime_t			mReaderBlocked;
+	bigtime_t			mWriterBlocked;
+
+private:
+	static	int32		ChunkBucket(size_t size);
+			DeviceCounters &Device(dev_t);
+			void		ArchiveDevice(BMessage *, const DeviceCounters &) const;
+
+	char				mOperation[64];
+	bigtime_t			mStartTime;
+	bigtime_t			mEndTime;
+	off_t				mBytesRead;
+	off_t				mBytesWritten;
+	off_t				mAttributeBytesRead;
+	off_t				mAttributeBytesWritten;
+	int32				mFiles;
+	int32				mSyscalls[kTotalSyscalls];
+	int32				mChunkSizes[kChunkBuckets];
+	int32				mLatencies[kLatencyBuckets];
+	DeviceCounters		mDevices[kDeviceSlots + 1];		// the last one is for the devices that didn't get a slot
+	int32				mDeviceCount;					// slots in use; a slot is filled in before it is counted, so
+														// the scripting thread can read them while the copy goes on
+};
+
+class TelemetryLog {
+	friend TelemetryLog &gTelemetryLog();
+
+public:
+	TelemetryLog();
+
+			void		Register(const Telemetry *);
+			void		Unregister(const Telemetry *);		// keeps a copy if the operation did something
+
+			status_t	Archive(BMessage *);
+			status_t	Dump(const char *path);
+
+private:
+	static const int32	kKeptFinished		= 16;
+
+	static	TelemetryLog *	sSelf;
+	static	int32			sInitialized;
+
+	BLocker						mLocker;
+	std::vector<const Telemetry *>	mRunning;
+	std::deque<Telemetry>		mFinished;
+};
+
+inline TelemetryLog &
+gTelemetryLog() {
+	if (atomic_or(&TelemetryLog :: sInitialized, 1) == 0) {
+		TelemetryLog :: sSelf = new TelemetryLog();
+	}
+	return *TelemetryLog :: sSelf;
+}
+
+}	// namespace fs
+
+#endif // _FSTELEMETRY_H
@@ -0,0 +1,313 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+#include <Debug.h>
+#include <Directory.h>
+#include <Message.h>
+
+#include "AutoLock.h"
+#include "FolderSizeCalculator.h"
+
+const int32 kMaxWalkerThreads = 6;
+const int32 kFlushBatch = 256;
+	// entries a walker counts locally before adding them to the totals
+const bigtime_t kReportInterval = 200000;
+
+
+FolderSizeCalculator::FolderSizeCalculator(BMessenger target, int32 generation)
+	:	fTarget(target),
+		fGeneration(generation),
+		fWorkSem(create_sem(0, "FolderSizeCalculator")),
+		fPending(20, true),
+		fBusy(0),
+		fSize(0),
+		fFileCount(0),
+		fLinkCount(0),
+		fDirCount(0),
+		fLastReport(0),
+		fWalkerCount(0),
+		fCanceled(false),
+		fDone(false),
+		fReferences(1)
+{
+}
+
+FolderSizeCalculator::~FolderSizeCalculator()
+{
+	delete_sem(fWorkSem);
+}
+
+status_t
+FolderSizeCalculator::AddRoot(const entry_ref *ref)
+{
+	BEntry entry(ref);
+	struct stat st;
+	status_t result = entry.GetStat(&st);
+	if (result != B_OK)
+		return result;
+
+	if (!S_ISDIR(st.st_mode) && !FirstLink(&st))
+		return B_OK;
+
+	AutoLock<Benaphore> lock(fLock);
+
+	if (S_ISDIR(st.st_mode)) {
+		fDirCount++;
+		fPending.AddItem(new entry_ref(*ref));
+		fBusy++;
+		release_sem(fWorkSem);
+	} else {
+		if (S_ISLNK(st.st_mode))
+			fLinkCount++;
+		else {
+			fFileCount++;
+			fSize += st.st_size;
+		}
+	}
+
+	return B_OK;
+}
+
+void
+FolderSizeCalculator::Start()
+{
+	bool done = false;
+	{
+		AutoLock<Benaphore> lock(fLock);
+		if (fBusy == 0) {
+			// nothing to walk, the roots were all there is
+			fDone = true;
+			done = true;
+		}
+	}
+
+	if (done) {
+		Report(true);
+		return;
+	}
+
+	// directory reads mostly wait for the disk, use a few more walkers
+	// than there are CPUs to keep the device queue filled
+	system_info info;
+	get_system_info(&info);
+	int32 count = info.cpu_count * 2;
+	if (count > kMaxWalkerThreads)
+		count = kMaxWalkerThreads;
+
+	fWalkerCount = count;
+	atomic_add(&fReferences, count);
+
+	for (int32 index = 0; index < count; index++) {
+		thread_id thread = spawn_thread(&FolderSizeCalculator::WalkerEntry,
+			"FolderSizeWalker", B_LOW_PRIORITY, this);
+		if (thread < B_OK || resume_thread(thread) != B_OK)
+			ReleaseReference();
+	}
+}
+
+void
+FolderSizeCalculator::Cancel()
+{
+	fCanceled = true;
+
+	// wake up every walker that is waiting for work so that it can quit
+	if (fWalkerCount > 0)
+		release_sem_etc(fWorkSem, fWalkerCount, 0);
+}
+
+void
+FolderSizeCalculator::Release()
+{
+	ReleaseReference();
+}
+
+void
+FolderSizeCalculator::ReleaseReference()
+{
+	if (atomic_add(&fReferences, -1) == 1)
+		delete this;
+}
+
+int32
+FolderSizeCalculator::WalkerEntry(void *castToCalculator)
+{
+	FolderSizeCalculator *self = static_cast<FolderSizeCalculator *>
+		(castToCalculator);
+	self->Walk();
+	self->ReleaseReference();
+
+	return B_OK;
+}
+
+void
+FolderSizeCalculator::Walk()
+{
+	for (;;) {
+		if (acquire_sem(fWorkSem) != B_OK)
+			return;
+
+		entry_ref *ref;
+		{
+			AutoLock<Benaphore> lock(fLock);
+			if (fCanceled || fDone)
+				return;
+
+			ref = fPending.RemoveItemAt(fPending.CountItems() - 1);
+		}
+		ASSERT(ref);
+
+		BDirectory dir(ref);
+		node_ref dirNode;
+		if (dir.InitCheck() == B_OK && dir.GetNodeRef(&dirNode) == B_OK)
+			ReadDirectory(&dir, &dirNode);
+
+		delete ref;
+
+		bool done = false;
+		{
+			AutoLock<Benaphore> lock(fLock);
+			if (--fBusy == 0 && !fCanceled) {
+				fDone = true;
+				done = true;
+			}
+		}
+
+		if (done) {
+			Report(true);
+			// let the other walkers see that we are done
+			release_sem_etc(fWorkSem, fWalkerCount, 0);
+			return;
+		}
+	}
+}
+
+void
+FolderSizeCalculator::ReadDirectory(BDirectory *dir, const node_ref *dirNode)
+{
+	off_t size = 0;
+	int32 files = 0;
+	int32 links = 0;
+	BObjectList<entry_ref> subDirs(20, false);
+
+	BEntry entry;
+	struct stat st;
+	for (;;) {
+		bool atEnd = fCanceled || dir->GetNextEntry(&entry) != B_OK;
+
+		if (!atEnd && entry.GetStat(&st) == B_OK) {
+			if (S_ISDIR(st.st_mode)) {
+				// don't wander off into volumes mounted below this folder
+				entry_ref ref;
+				if (st.st_dev == dirNode->device && entry.GetRef(&ref) == B_OK)
+					subDirs.AddItem(new entry_ref(ref));
+			} else if (FirstLink(&st)) {
+				if (S_ISLNK(st.st_mode))
+					links++;
+				else {
+					files++;
+					size += st.st_size;
+				}
+			}
+		}
+
+		if (atEnd || files + links + subDirs.CountItems() >= kFlushBatch) {
+			bool report = false;
+			int32 dirCount = subDirs.CountItems();
+			{
+				AutoLock<Benaphore> lock(fLock);
+				fSize += size;
+				fFileCount += files;
+				fLinkCount += links;
+				fDirCount += dirCount;
+				fBusy += dirCount;
+				fPending.AddList(&subDirs);
+
+				bigtime_t now = system_time();
+				if (now - fLastReport >= kReportInterval) {
+					fLastReport = now;
+					report = true;
+				}
+			}
+			if (dirCount > 0)
+				release_sem_etc(fWorkSem, dirCount, 0);
+
+			size = 0;
+			files = 0;
+			links = 0;
+			subDirs.MakeEmpty();
+
+			if (report)
+				Report(false);
+		}
+
+		if (atEnd)
+			break;
+	}
+}
+
+bool
+FolderSizeCalculator::FirstLink(const struct stat *st)
+{
+	if (st->st_nlink < 2)
+		return true;
+
+	node_ref node;
+	node.device = st->st_dev;
+	node.node = st->st_ino;
+
+	AutoLock<Benaphore> lock(fLock);
+	return fSeenLinks.insert(node).second;
+}
+
+void
+FolderSizeCalculator::Report(bool done)
+{
+	if (fCanceled)
+		return;
+
+	BMessage message(kFolderSizeUpdate);
+	{
+		AutoLock<Benaphore> lock(fLock);
+		message.AddInt64("size", fSize);
+		message.AddInt32("files", fFileCount);
+		message.AddInt32("links", fLinkCount);
+		message.AddInt32("dirs", fDirCount);
+	}
+	message.AddInt32("generation", fGeneration);
+	message.AddBool("done", done);
+
+	// partial totals are not worth blocking for, a later one will do
+	fTarget.SendMessage(&message, (BHandler *)NULL,
+		done ? B_INFINITE_TIMEOUT : 0);
+}
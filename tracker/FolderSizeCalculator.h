@@ -0,0 +1,134 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+//	FolderSizeCalculator adds up the sizes of everything below a set of
+//	entries for the Get Info window.
+//
+//	A few walker threads read directories concurrently off a shared stack.
+//	Partial totals are posted to the target at a fixed rate so that big
+//	folders show a growing size instead of nothing; files with more than
+//	one link are only counted once.
+//
+//	The calculator is reference counted by its walkers and its owner.
+//	Cancel() only raises a flag and wakes the walkers, the owner does not
+//	have to wait for them to go away.
+
+#ifndef __FOLDER_SIZE_CALCULATOR__
+#define __FOLDER_SIZE_CALCULATOR__
+
+#include <Entry.h>
+#include <Messenger.h>
+#include <Node.h>
+#include <OS.h>
+
+#include <set>
+
+#include "ObjectList.h"
+#include "Utilities.h"
+
+class BDirectory;
+
+namespace BPrivate {
+
+const uint32 kFolderSizeUpdate = 'fszu';
+	// posted to the target with "size" (int64), "files", "links", "dirs",
+	// "generation" (int32) and "done" (bool)
+
+class FolderSizeCalculator {
+public:
+	FolderSizeCalculator(BMessenger target, int32 generation);
+
+	status_t AddRoot(const entry_ref *);
+		// call before Start(); directories are walked, anything else
+		// is counted as is
+
+	void Start();
+	void Cancel();
+		// returns right away; the remaining walkers quit on their own
+	void Release();
+		// drops the owner's reference, call exactly once after Start()
+
+	bool IsCanceled() const;
+
+private:
+	~FolderSizeCalculator();
+
+	static int32 WalkerEntry(void *);
+	void Walk();
+	void ReadDirectory(BDirectory *, const node_ref *);
+	bool FirstLink(const struct stat *);
+		// false if another link to the same file was counted already
+	void Report(bool done);
+	void ReleaseReference();
+
+	struct NodeRefLess {
+		bool operator()(const node_ref &a, const node_ref &b) const
+			{ return a.device < b.device
+				|| (a.device == b.device && a.node < b.node); }
+	};
+
+	BMessenger fTarget;
+	int32 fGeneration;
+
+	Benaphore fLock;
+	sem_id fWorkSem;
+		// counts directories on the stack, plus wake ups for quitting
+	BObjectList<entry_ref> fPending;
+	int32 fBusy;
+		// directories on the stack or being read
+	std::set<node_ref, NodeRefLess> fSeenLinks;
+
+	off_t fSize;
+	int32 fFileCount;
+	int32 fLinkCount;
+	int32 fDirCount;
+	bigtime_t fLastReport;
+
+	int32 fWalkerCount;
+	volatile bool fCanceled;
+	bool fDone;
+	int32 fReferences;
+};
+
+inline bool
+FolderSizeCalculator::IsCanceled() const
+{
+	return fCanceled;
+}
+
+} // namespace BPrivate
+
+using namespace BPrivate;
+
+#endif
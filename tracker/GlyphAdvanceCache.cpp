@@ -0,0 +1,294 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+#include <Debug.h>
+
+#include <string.h>
+
+#include "AutoLock.h"
+#include "GlyphAdvanceCache.h"
+
+BObjectList<GlyphAdvanceCache> GlyphAdvanceCache::sCacheList(5, true);
+Benaphore GlyphAdvanceCache::sCacheListLock("glyphAdvanceCacheList");
+
+static inline int32
+UTF8CharLength(const char *str)
+{
+	// number of bytes of the character starting at <str>
+	uchar c = (uchar)*str;
+	if (c < 0x80)
+		return 1;
+	if ((c & 0xe0) == 0xc0)
+		return 2;
+	if ((c & 0xf0) == 0xe0)
+		return 3;
+	if ((c & 0xf8) == 0xf0)
+		return 4;
+
+	// stray continuation byte, treat it as a single character
+	return 1;
+}
+
+static inline int32
+SafeCharLength(const char *str, int32 remaining)
+{
+	int32 length = UTF8CharLength(str);
+	return length > remaining ? remaining : length;
+}
+
+
+GlyphAdvanceCache::GlyphAdvanceCache(const BFont *font)
+	:	fFont(*font),
+		fEllipsisWidth(-1),
+		fLock("glyphAdvanceCache")
+{
+	for (int32 index = 0; index < 128; index++)
+		fAscii[index] = -1;
+}
+
+GlyphAdvanceCache *
+GlyphAdvanceCache::CacheFor(const BFont *font)
+{
+	AutoLock<Benaphore> lock(sCacheListLock);
+
+	int32 count = sCacheList.CountItems();
+	for (int32 index = 0; index < count; index++) {
+		GlyphAdvanceCache *cache = sCacheList.ItemAt(index);
+		if (cache->fFont == *font)
+			return cache;
+	}
+
+	GlyphAdvanceCache *cache = new GlyphAdvanceCache(font);
+	sCacheList.AddItem(cache);
+	return cache;
+}
+
+uint32
+GlyphAdvanceCache::CharKey(const char *str, int32 charLength)
+{
+	uint32 key = 0;
+	for (int32 index = 0; index < charLength; index++)
+		key = (key << 8) | (uchar)str[index];
+
+	return key;
+}
+
+void
+GlyphAdvanceCache::FetchLocked(const char *str, int32 length)
+{
+	int32 numChars = 0;
+	for (int32 offset = 0; offset < length;
+		offset += SafeCharLength(str + offset, length - offset))
+		numChars++;
+
+	if (!numChars)
+		return;
+
+	float *escapements = new float[numChars];
+	fFont.GetEscapements(str, numChars, escapements);
+
+	float size = fFont.Size();
+	int32 charIndex = 0;
+	for (int32 offset = 0; offset < length; charIndex++) {
+		int32 charLength = SafeCharLength(str + offset, length - offset);
+		float advance = escapements[charIndex] * size;
+		if (charLength == 1 && (uchar)str[offset] < 128)
+			fAscii[(uchar)str[offset]] = advance;
+		else
+			fOther[CharKey(str + offset, charLength)] = advance;
+
+		offset += charLength;
+	}
+
+	delete [] escapements;
+}
+
+float
+GlyphAdvanceCache::CharWidth(const char *str, int32 charLength)
+{
+	if (charLength == 1 && (uchar)*str < 128) {
+		if (fAscii[(uchar)*str] < 0)
+			FetchLocked(str, 1);
+
+		return fAscii[(uchar)*str];
+	}
+
+	uint32 key = CharKey(str, charLength);
+	std::map<uint32, float>::iterator found = fOther.find(key);
+	if (found != fOther.end())
+		return found->second;
+
+	FetchLocked(str, charLength);
+	return fOther[key];
+}
+
+float
+GlyphAdvanceCache::StringWidth(const char *str, int32 length)
+{
+	AutoLock<Benaphore> lock(fLock);
+
+	float width = 0;
+	for (int32 offset = 0; offset < length; ) {
+		int32 charLength = SafeCharLength(str + offset, length - offset);
+		width += CharWidth(str + offset, charLength);
+		offset += charLength;
+	}
+	return width;
+}
+
+void
+GlyphAdvanceCache::AddPending(const char *str, int32 charLength)
+{
+	if (fPending.FindFirst(BString(str, charLength)) < 0)
+		fPending.Append(str, charLength);
+}
+
+void
+GlyphAdvanceCache::Prefetch(const char *str, int32 length)
+{
+	AutoLock<Benaphore> lock(fLock);
+
+	for (int32 offset = 0; offset < length; ) {
+		int32 charLength = SafeCharLength(str + offset, length - offset);
+		if (charLength == 1 && (uchar)str[offset] < 128) {
+			if (fAscii[(uchar)str[offset]] < 0)
+				AddPending(str + offset, 1);
+		} else if (fOther.find(CharKey(str + offset, charLength)) == fOther.end())
+			AddPending(str + offset, charLength);
+
+		offset += charLength;
+	}
+}
+
+void
+GlyphAdvanceCache::FetchPending()
+{
+	AutoLock<Benaphore> lock(fLock);
+
+	if (!fPending.Length())
+		return;
+
+	FetchLocked(fPending.String(), fPending.Length());
+	fPending = "";
+}
+
+float
+GlyphAdvanceCache::TruncString(BString *result, const char *str, int32 length,
+	float width, uint32 truncMode)
+{
+	AutoLock<Benaphore> lock(fLock);
+
+	// measure every character once, we need the widths for picking the
+	// truncation points anyway
+	int32 *offsets = new int32[length + 1];
+	float *widths = new float[length + 1];
+	int32 numChars = 0;
+	float totalWidth = 0;
+	for (int32 offset = 0; offset < length; numChars++) {
+		int32 charLength = SafeCharLength(str + offset, length - offset);
+		offsets[numChars] = offset;
+		widths[numChars] = CharWidth(str + offset, charLength);
+		totalWidth += widths[numChars];
+		offset += charLength;
+	}
+	offsets[numChars] = length;
+
+	if (totalWidth <= width) {
+		result->SetTo(str, length);
+		delete [] offsets;
+		delete [] widths;
+		return totalWidth;
+	}
+
+	if (fEllipsisWidth < 0) {
+		const char *ellipsis = B_UTF8_ELLIPSIS;
+		fEllipsisWidth = CharWidth(ellipsis, (int32)strlen(ellipsis));
+	}
+
+	float available = width - fEllipsisWidth;
+	if (available < 0) {
+		*result = "";
+		delete [] offsets;
+		delete [] widths;
+		return 0;
+	}
+
+	// <head> characters are kept from the start, <tail> from the end
+	int32 head = 0;
+	int32 tail = 0;
+	float used = 0;
+
+	switch (truncMode) {
+		case B_TRUNCATE_END:
+			while (head < numChars && used + widths[head] <= available)
+				used += widths[head++];
+			break;
+
+		case B_TRUNCATE_BEGINNING:
+			while (tail < numChars
+				&& used + widths[numChars - tail - 1] <= available)
+				used += widths[numChars - 1 - tail++];
+			break;
+
+		default:
+			// B_TRUNCATE_MIDDLE and anything fancier: keep about the same
+			// amount from both ends
+			for (;;) {
+				bool added = false;
+				if (head + tail < numChars && used + widths[head] <= available) {
+					used += widths[head++];
+					added = true;
+				}
+				if (head + tail < numChars
+					&& used + widths[numChars - tail - 1] <= available) {
+					used += widths[numChars - 1 - tail++];
+					added = true;
+				}
+				if (!added)
+					break;
+			}
+			break;
+	}
+
+	result->SetTo(str, offsets[head]);
+	result->Append(B_UTF8_ELLIPSIS);
+	if (tail)
+		result->Append(str + offsets[numChars - tail],
+			length - offsets[numChars - tail]);
+
+	delete [] offsets;
+	delete [] widths;
+
+	return used + fEllipsisWidth;
+}
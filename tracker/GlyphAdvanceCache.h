@@ -0,0 +1,108 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+//	GlyphAdvanceCache keeps the escapements of every character we have
+//	measured for a given font, so fitting text into list view columns can
+//	be done locally instead of asking the app_server for widths and for
+//	truncated strings for every cell.
+//
+//	Missing advances can be queued up with Prefetch and fetched in one
+//	server round trip with FetchPending, this is what the batched column
+//	fitting in WidgetAttributeText uses.
+
+#ifndef __GLYPH_ADVANCE_CACHE__
+#define __GLYPH_ADVANCE_CACHE__
+
+#include <Font.h>
+#include <String.h>
+
+#include <map>
+
+#include "ObjectList.h"
+#include "Utilities.h"
+
+namespace BPrivate {
+
+class GlyphAdvanceCache {
+public:
+	static GlyphAdvanceCache *CacheFor(const BFont *);
+		// caches live for the lifetime of the app, there are only
+		// a handful of fonts used for drawing poses
+
+	float StringWidth(const char *, int32 length);
+	float TruncString(BString *result, const char *src, int32 length,
+		float width, uint32 truncMode = B_TRUNCATE_MIDDLE);
+		// returns the width of the fitted string
+
+	void Prefetch(const char *, int32 length);
+		// note characters with unknown advances
+	void FetchPending();
+		// get all the noted advances in a single server call
+
+	const BFont *Font() const;
+
+private:
+	GlyphAdvanceCache(const BFont *);
+
+	float CharWidth(const char *, int32 charLength);
+		// needs fLock held
+	void FetchLocked(const char *, int32 length);
+		// needs fLock held
+	void AddPending(const char *, int32 charLength);
+
+	static uint32 CharKey(const char *, int32 charLength);
+
+	BFont fFont;
+	float fAscii[128];
+		// negative if not fetched yet
+	std::map<uint32, float> fOther;
+	float fEllipsisWidth;
+	BString fPending;
+	Benaphore fLock;
+
+	static BObjectList<GlyphAdvanceCache> sCacheList;
+	static Benaphore sCacheListLock;
+};
+
+inline const BFont *
+GlyphAdvanceCache::Font() const
+{
+	return &fFont;
+}
+
+} // namespace BPrivate
+
+using namespace BPrivate;
+
+#endif
@@ -60,6 +60,7 @@ All rights reserved.
 #include "AutoLock.h"
 #include "Commands.h"
 #include "FSUtils.h"
+#include "FolderSizeCalculator.h"
 #include "IconCache.h"
 #include "IconMenuItem.h"
 #include "InfoWindow.h"
@@ -108,9 +109,9 @@ BInfoWindow::BInfoWindow(Model *model, int32 group_index, LockingList<BWindow> *
 			"InfoWindow", B_TITLED_WINDOW,
 			B_NOT_RESIZABLE | B_NOT_ZOOMABLE, B_CURRENT_WORKSPACE),
 		fModel(model),
-		fStopCalc(false),
 		fIndex(group_index),
-		fCalcThreadID(-1),
+		fSizeCalculator(NULL),
+		fSizeGeneration(0),
 		fWindowList(list),
 		fPermissionsView(NULL),
 		fFilePanel(NULL),
@@ -141,9 +142,9 @@ BInfoWindow::BInfoWindow(BMessage *message, int32 groupIndex, LockingList<BWindo
 			"InfoWindow", B_TITLED_WINDOW,
 			B_NOT_RESIZABLE | B_NOT_ZOOMABLE, B_CURRENT_WORKSPACE),
 		fModel(NULL),
-		fStopCalc(false),
 		fIndex(groupIndex),
-		fCalcThreadID(-1),
+		fSizeCalculator(NULL),
+		fSizeGeneration(0),
 		fWindowList(list),
 		fPermissionsView(NULL),
 		fFilePanel(NULL),
@@ -208,11 +209,8 @@ BInfoWindow::Quit()
 		fWindowList->RemoveItem(this);
 	}
 
-	fStopCalc = true;
-
-	// wait until CalcSize thread has terminated before closing window
-	status_t result;
-	wait_for_thread(fCalcThreadID, &result);
+	// the calculator winds down on its own, no need to wait for it
+	StopCalcSize();
 
 	_inherited::Quit();
 }
@@ -264,10 +262,9 @@ BInfoWindow::Show()
 	// volume case is handled by view
 	if (fMultiple || !TargetModel()->IsVolume()) {
 		if (fMultiple || TargetModel()->IsDirectory()) {
-			// if this is a folder or a multiple-file-info then spawn thread to calculate size
-			SetSizeStr(LOCALE("calculating"B_UTF8_ELLIPSIS));
-			fCalcThreadID = spawn_thread((fMultiple ? BInfoWindow::CalcMultipleSize : BInfoWindow::CalcSize), "CalcSize", B_NORMAL_PRIORITY, this);
-			resume_thread(fCalcThreadID);
+			// if this is a folder or a multiple-file-info then start
+			// calculating the size in the background
+			StartCalcSize();
 		} else {
 			fAttributeView->SetLastSize(TargetModel()->StatBuf()->st_size);
 
@@ -350,22 +347,12 @@ BInfoWindow::MessageReceived(BMessage *message)
 			}
 		
 		case kRecalculateSize:
-			{
-				fStopCalc = true;
-			
-				// Wait until any current CalcSize thread has terminated before
-				// starting a new one
-				status_t result;
-				wait_for_thread(fCalcThreadID, &result);
-				
-				// Start recalculating..			
-				fStopCalc = false;
-				SetSizeStr(LOCALE("calculating"B_UTF8_ELLIPSIS));
-				fCalcThreadID = spawn_thread((fMultiple ? BInfoWindow::CalcMultipleSize : BInfoWindow::CalcSize), "CalcSize", B_NORMAL_PRIORITY, this);
-				resume_thread(fCalcThreadID);
-				
-				break;
-			}
+			StartCalcSize();
+			break;
+
+		case kFolderSizeUpdate:
+			SizeUpdated(message);
+			break;
 		
 		case kSetLinkTarget: 
 			if (fMultiple)
@@ -665,126 +652,95 @@ BInfoWindow::GetSizeString(BString &result, off_t size, int32 fileCount, int32 d
 	}
 }
 
-class InfoWindowTFSContext : public TFSContext {
-	BInfoWindow		&mWindow;
-	
-public:
-	InfoWindowTFSContext(BInfoWindow &in_window, const entry_ref &in_ref) :
-		TFSContext(in_ref), mWindow(in_window) {}
-	InfoWindowTFSContext(BInfoWindow &in_window) :
-		TFSContext(), mWindow(in_window) {}
-	
-	void	CheckCancel() {
-				if (mWindow.StopCalc()) {
-					FS_CONTROL_THROW(kCancel);
-				}
-			}
-};
-
-int32
-BInfoWindow::CalcSize(void *castToWindow)
+void
+BInfoWindow::StartCalcSize()
 {
-	BInfoWindow *window = static_cast<BInfoWindow *>(castToWindow);
-	BDirectory dir(window->TargetModel()->EntryRef());
-	BDirectory trashDir;
-	TFSContext::GetTrashDir(trashDir, window->TargetModel()->EntryRef()->device); 
-	if (dir.InitCheck() != B_OK) {
-		if (window->StopCalc())
-			return B_ERROR;
-		
-		AutoLock<BWindow> lock(window);
-		if (!lock)
-			return B_ERROR;
-		
-		window->SetSizeStr(LOCALE("Error calculating size."));
+	// a running calculation is simply abandoned, results it might still
+	// post are told apart by their generation
+	StopCalcSize();
 
-		return B_ERROR;
-	}
-	
-	TFSContext::ProgressInfo info;
-	
-	if (dir == trashDir) {
-		
-		InfoWindowTFSContext *context = new InfoWindowTFSContext(*window);
-		BVolumeRoster volRoster;
-		BVolume volume;
-		BEntry entry;
-		entry_ref ref;
-		
-		while (volRoster.GetNextVolume(&volume) == B_OK) {
-			if (!volume.IsPersistent())
-				continue;
-			
-			if (TFSContext::GetTrashDir(trashDir, volume.Device()) == B_OK) {
-				trashDir.GetEntry(&entry);
-				entry.GetRef(&ref);
-				context->EntryList().push_back(ref);
-			}
-		}	
-		context -> CalculateItemsAndSize(info);
-		
+	SetSizeStr(LOCALE("calculating"B_UTF8_ELLIPSIS));
+
+	fSizeCalculator = new FolderSizeCalculator(BMessenger(this),
+		++fSizeGeneration);
+
+	if (fMultiple) {
+		for (int32 index = 0; index < fRefs->CountItems(); index++)
+			fSizeCalculator->AddRoot(fRefs->ItemAt(index));
 	} else {
-	
-		InfoWindowTFSContext *context = new InfoWindowTFSContext(*window, *window->TargetModel()->EntryRef());
-		context -> CalculateItemsAndSize(info);
+		const entry_ref *ref = TargetModel()->EntryRef();
+		BDirectory dir(ref);
+		BDirectory trashDir;
+		TFSContext::GetTrashDir(trashDir, ref->device);
+
+		if (dir.InitCheck() != B_OK) {
+			StopCalcSize();
+			SetSizeStr(LOCALE("Error calculating size."));
+			return;
+		}
+
+		if (dir == trashDir) {
+			// the Trash shows the contents of the trash folders of
+			// every volume
+			BVolumeRoster volRoster;
+			BVolume volume;
+			BEntry entry;
+			entry_ref trashRef;
+
+			while (volRoster.GetNextVolume(&volume) == B_OK) {
+				if (!volume.IsPersistent())
+					continue;
+
+				if (TFSContext::GetTrashDir(trashDir, volume.Device()) == B_OK
+					&& trashDir.GetEntry(&entry) == B_OK
+					&& entry.GetRef(&trashRef) == B_OK)
+					fSizeCalculator->AddRoot(&trashRef);
+			}
+		} else
+			fSizeCalculator->AddRoot(ref);
 	}
-		
-	BString string;
-	// got the size value, update the size string
-	GetSizeString(string, info.mTotalSize, info.mTotalEntryCount - info.mTotalDirCount);
-	// XXX we've got a lot more additional information here, what to do?
 
-	if (window->StopCalc())
-		// window closed, bail
-		return B_OK;
+	fSizeCalculator->Start();
+}
 
-	AutoLock<BWindow> lock(window);
-	if (lock.IsLocked()) 
-		window->SetSizeStr(string.String());
+void
+BInfoWindow::StopCalcSize()
+{
+	if (fSizeCalculator == NULL)
+		return;
 
-	return B_OK;
+	fSizeCalculator->Cancel();
+	fSizeCalculator->Release();
+	fSizeCalculator = NULL;
 }
 
-int32
-BInfoWindow::CalcMultipleSize(void *castToWindow)
+void
+BInfoWindow::SizeUpdated(const BMessage *message)
 {
-	BInfoWindow *window = static_cast<BInfoWindow *>(castToWindow);
-	int32 dirs = 0;
-	int32 files = 0;
-	int32 links = 0;
-	off_t size = 0;
-	off_t filesize;
-	
+	int32 generation;
+	if (message->FindInt32("generation", &generation) != B_OK
+		|| generation != fSizeGeneration)
+		// left over from an abandoned calculation
+		return;
+
+	off_t size = message->FindInt64("size");
+	int32 files = message->FindInt32("files");
+	int32 links = message->FindInt32("links");
+	int32 dirs = message->FindInt32("dirs");
+	bool done = message->FindBool("done");
+
 	BString string;
-	for (int index = 0; index < window->fRefs->CountItems(); index++) {
-		BEntry entry(window->fRefs->ItemAt(index));
-		
-		if (entry.InitCheck() == B_OK) {
-			if (entry.IsDirectory())
-				dirs++;
-			else if (entry.IsSymLink())
-				links++;
-			else if (entry.IsFile()) {
-				files++;
-				entry.GetSize(&filesize);
-				size += filesize;
-			} else
-				printf("something is wrong in CalcMultipleSize!\n");
-		}
-	}
-	
-	// got the size value, update the size string
-	GetSizeString(string, size, files, dirs, links, true);
-	
-	if (window->StopCalc())
-		// window closed, bail
-		return B_OK;
+	if (fMultiple)
+		GetSizeString(string, size, files, dirs, links, true);
+	else
+		GetSizeString(string, size, files + links);
 
-	AutoLock<BWindow> lock(window);
-	if (lock.IsLocked()) 
-		window->SetSizeStr(string.String());
+	if (done)
+		StopCalcSize();
+	else
+		string << B_UTF8_ELLIPSIS;
 
-	return B_OK;
+	SetSizeStr(string.String());
 }
 
 void
@@ -50,6 +50,7 @@ namespace BPrivate {
 
 class Model;
 class AttributeView;
+class FolderSizeCalculator;
 class TrackingView;
 
 // States for tracking the mouse
@@ -173,7 +174,6 @@ public:
 virtual	bool			IsShowing(const node_ref *) const;
 		Model			*TargetModel() const;
 		void			SetSizeStr(const char *);
-		bool			StopCalc();
 		void			OpenFilePanel(const entry_ref *);
 
 static	void			GetSizeString(BString &result, off_t size, int32 fileCount = 0, int32 dirCount = 0, int32 linkCount = 0, bool multiple = false);
@@ -185,13 +185,14 @@ virtual	void			Show();
 
 private:
 static	BRect			InfoWindowRect(bool displayingSymlink);
-static	int32			CalcSize(void *);
-static	int32			CalcMultipleSize(void *); 
+		void			StartCalcSize();
+		void			StopCalcSize();
+		void			SizeUpdated(const BMessage *);
 
 		Model			*fModel;
-volatile bool			fStopCalc;
 		int32			fIndex; // tells where it lives with respect to other
-		thread_id		fCalcThreadID;
+		FolderSizeCalculator	*fSizeCalculator;
+		int32			fSizeGeneration;
 		LockingList<BWindow>	*fWindowList;
 		FilePermissionsView		*fPermissionsView;
 		AttributeView	*fAttributeView;
@@ -205,12 +206,6 @@ typedef	BWindow			_inherited;
 };
 
 
-inline bool
-BInfoWindow::StopCalc()
-{
-	return fStopCalc;
-}
-
 inline Model *
 BInfoWindow::TargetModel() const
 {
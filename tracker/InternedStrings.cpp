@@ -0,0 +1,118 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+#include <Debug.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "AutoLock.h"
+#include "InternedStrings.h"
+#include "Utilities.h"
+
+InternedStrings::Entry *volatile InternedStrings::sBuckets[kBucketCount];
+int32 InternedStrings::sCount = 0;
+size_t InternedStrings::sBytes = 0;
+
+static Benaphore sInsertLock("internedStringsLock");
+
+uint32
+InternedStrings::Hash(const char *string)
+{
+	uint32 hash = 0;
+	for (const uchar *scan = (const uchar *)string; *scan; scan++)
+		hash = (hash << 5) - hash + *scan;
+
+	return hash;
+}
+
+const char *
+InternedStrings::FindInChain(const Entry *first, const Entry *last,
+	const char *string, uint32 hash)
+{
+	for (const Entry *entry = first; entry != last; entry = entry->next)
+		if (entry->hash == hash && strcmp(entry->string, string) == 0)
+			return entry->string;
+
+	return NULL;
+}
+
+const char *
+InternedStrings::Intern(const char *string)
+{
+	if (!string)
+		return NULL;
+
+	uint32 hash = Hash(string);
+	Entry *volatile *bucket = &sBuckets[hash % kBucketCount];
+
+	// entries are only ever pushed on the front of a chain and are never
+	// removed, so walking a chain while someone else adds to it is safe
+	const Entry *head = *bucket;
+	const char *result = FindInChain(head, NULL, string, hash);
+	if (result)
+		return result;
+
+	AutoLock<Benaphore> lock(sInsertLock);
+
+	// only look at what got added since we first looked
+	result = FindInChain(*bucket, head, string, hash);
+	if (result)
+		return result;
+
+	size_t length = strlen(string);
+	Entry *entry = (Entry *)malloc(sizeof(Entry) + length);
+	if (!entry)
+		return NULL;
+
+	entry->hash = hash;
+	memcpy(entry->string, string, length + 1);
+	entry->next = *bucket;
+
+	// fully set up entry gets published with a single pointer store
+	*bucket = entry;
+
+	sCount++;
+	sBytes += sizeof(Entry) + length;
+
+	return entry->string;
+}
+
+void
+InternedStrings::GetStats(int32 *count, size_t *bytes)
+{
+	AutoLock<Benaphore> lock(sInsertLock);
+	*count = sCount;
+	*bytes = sBytes;
+}
@@ -0,0 +1,83 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+//	InternedStrings hands out one shared, never freed copy of every distinct
+//	string it is asked about. Models keep their MIME types and preferred app
+//	signatures this way - a big query typically has a few dozen distinct
+//	types spread over tens of thousands of entries.
+//
+//	Lookups of strings that are already in the table do not lock, only adding
+//	a new string does. Interned strings may be compared by address.
+
+#ifndef __INTERNED_STRINGS__
+#define __INTERNED_STRINGS__
+
+#include <SupportDefs.h>
+
+namespace BPrivate {
+
+class InternedStrings {
+public:
+	static const char *Intern(const char *);
+		// returns NULL for NULL, the shared copy of <string> otherwise
+
+	static void GetStats(int32 *count, size_t *bytes);
+		// number of distinct strings and memory used by them, for
+		// debugging and benchmarking
+
+private:
+	struct Entry {
+		Entry *next;
+		uint32 hash;
+		char string[1];
+	};
+
+	enum {
+		kBucketCount = 1024
+	};
+
+	static uint32 Hash(const char *);
+	static const char *FindInChain(const Entry *first, const Entry *last,
+		const char *, uint32 hash);
+
+	static Entry *volatile sBuckets[kBucketCount];
+	static int32 sCount;
+	static size_t sBytes;
+};
+
+} // namespace BPrivate
+
+using namespace BPrivate;
+
+#endif
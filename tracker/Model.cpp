@@ -36,9 +36,9 @@ All rights reserved.
 
 // ToDo:
 // Consider moving iconFrom logic to BPose
-// use a more efficient way of storing file type and preferred app strings
 
 #include <malloc.h>
+#include <new.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -62,12 +62,15 @@ All rights reserved.
 #include "Model.h"
 
 #include "Attributes.h"
+#include "AutoLock.h"
 #include "Bitmaps.h"
 #include "FindPanel.h"
 #include "FSUtils.h"
 #include "IconCache.h"
+#include "InternedStrings.h"
 #include "LanguageTheme.h"
 #include "MimeTypes.h"
+#include "NodeMetadata.h"
 #include "TFSContext.h"
 #include "Tracker.h"
 #include "Undo.h"
@@ -90,8 +93,149 @@ bool CheckNodeIconHintPrivate(const BNode *, bool)
 #endif
 }
 
+void
+ModelStat::SetTo(const StatStruct &stat)
+{
+	st_dev = stat.st_dev;
+	st_ino = stat.st_ino;
+	st_mode = stat.st_mode;
+	st_uid = stat.st_uid;
+	st_gid = stat.st_gid;
+	st_size = stat.st_size;
+	st_mtime = stat.st_mtime;
+	st_ctime = stat.st_ctime;
+	st_crtime = stat.st_crtime;
+}
+
+void
+ModelStat::GetStat(StatStruct *stat) const
+{
+	memset(stat, 0, sizeof(StatStruct));
+	stat->st_dev = st_dev;
+	stat->st_ino = st_ino;
+	stat->st_mode = st_mode;
+	stat->st_uid = st_uid;
+	stat->st_gid = st_gid;
+	stat->st_size = st_size;
+	stat->st_mtime = st_mtime;
+	stat->st_ctime = st_ctime;
+	stat->st_crtime = st_crtime;
+}
+
+
+class ModelPool {
+	// hands out Model sized blocks carved from big chunks, saves the
+	// malloc overhead and fragmentation of allocating tens of thousands
+	// of Models one by one for a big directory or query
+public:
+	ModelPool();
+
+	void *Allocate(size_t);
+	void Free(void *);
+
+	void GetStats(int32 *live, int32 *allocated);
+
+private:
+	struct FreeBlock {
+		FreeBlock *next;
+	};
+
+	enum {
+		kModelsPerChunk = 256
+	};
+
+	Benaphore fLock;
+	FreeBlock *fFreeList;
+	int32 fLive;
+	int32 fAllocated;
+};
+
+static ModelPool sModelPool;
+
+ModelPool::ModelPool()
+	:	fLock("modelPoolLock"),
+		fFreeList(NULL),
+		fLive(0),
+		fAllocated(0)
+{
+}
+
+void *
+ModelPool::Allocate(size_t size)
+{
+	ASSERT(size == sizeof(Model));
+	AutoLock<Benaphore> lock(fLock);
+
+	if (!fFreeList) {
+		// chunks are never given back, freed Models get reused by the
+		// next directory or query that is opened
+		char *chunk = (char *)malloc(size * kModelsPerChunk);
+		if (!chunk)
+			return NULL;
+
+		for (int32 index = kModelsPerChunk - 1; index >= 0; index--) {
+			FreeBlock *block = (FreeBlock *)(chunk + index * size);
+			block->next = fFreeList;
+			fFreeList = block;
+		}
+		fAllocated += kModelsPerChunk;
+	}
+
+	FreeBlock *result = fFreeList;
+	fFreeList = result->next;
+	fLive++;
+
+	return result;
+}
+
+void
+ModelPool::Free(void *model)
+{
+	if (!model)
+		return;
+
+	AutoLock<Benaphore> lock(fLock);
+	FreeBlock *block = (FreeBlock *)model;
+	block->next = fFreeList;
+	fFreeList = block;
+	fLive--;
+}
+
+void
+ModelPool::GetStats(int32 *live, int32 *allocated)
+{
+	AutoLock<Benaphore> lock(fLock);
+	*live = fLive;
+	*allocated = fAllocated;
+}
+
+
+void *
+Model::operator new(size_t size)
+{
+	void *result = sModelPool.Allocate(size);
+	if (!result)
+		throw bad_alloc();
+
+	return result;
+}
+
+void
+Model::operator delete(void *model)
+{
+	sModelPool.Free(model);
+}
+
+void
+Model::GetAllocationStats(int32 *live, int32 *allocated)
+{
+	sModelPool.GetStats(live, allocated);
+}
+
+
 Model::Model()
-	:	fPreferredAppName(NULL),
+	:	fMimeType(NULL),
+		fPreferredAppName(NULL),
 		fBaseType(kUnknownNode),
 		fIconFrom(kUnknownSource),
 		fWritable(false),
@@ -117,7 +261,7 @@ Model::Model(const Model &cloneThis)
 	fStatus = OpenNode(cloneThis.IsNodeOpenForWriting());
 	if (fStatus == B_OK) {
 		ASSERT(fNode);
-		fNode->GetStat(&fStatBuf);
+		ReadStat(fNode);
 		ASSERT(fStatBuf.st_dev == cloneThis.NodeRef()->device);
 		ASSERT(fStatBuf.st_ino == cloneThis.NodeRef()->node);
 	}
@@ -127,16 +271,18 @@ Model::Model(const Model &cloneThis)
 }
 
 Model::Model(const node_ref *dirNode, const node_ref *node, const char *name,
-	bool open, bool writable)
-	:	fPreferredAppName(NULL),
+	bool open, bool writable, NodeMetadata *metadata)
+	:	fMimeType(NULL),
+		fPreferredAppName(NULL),
 		fWritable(false),
 		fNode(NULL)
 {
-	SetTo(dirNode, node, name, open, writable);
+	SetTo(dirNode, node, name, open, writable, metadata);
 }
 
 Model::Model(const BEntry *entry, bool open, bool writable)
-	:	fPreferredAppName(NULL),
+	:	fMimeType(NULL),
+		fPreferredAppName(NULL),
 		fWritable(false),
 		fNode(NULL)
 {
@@ -145,7 +291,8 @@ Model::Model(const BEntry *entry, bool open, bool writable)
 
 
 Model::Model(const entry_ref *ref, bool traverse, bool open, bool writable)
-	:	fPreferredAppName(NULL),
+	:	fMimeType(NULL),
+		fPreferredAppName(NULL),
 		fBaseType(kUnknownNode),
 		fIconFrom(kUnknownSource),
 		fWritable(false),
@@ -168,9 +315,8 @@ Model::DeletePreferredAppVolumeNameLinkTo()
 
 	} else if (IsVolume())
 		free(fVolumeName);
-	else
-		free(fPreferredAppName);
 
+	// preferred app signatures are interned, nothing to free
 	fPreferredAppName = NULL;
 }
 
@@ -204,13 +350,13 @@ Model::SetTo(const BEntry *entry, bool open, bool writable)
 	DeletePreferredAppVolumeNameLinkTo();
 	fIconFrom = kUnknownSource;
 	fBaseType = kUnknownNode;
-	fMimeType = "";
+	fMimeType = NULL;
 
 	fStatus = entry->GetRef(&fEntryRef);
 	if (fStatus != B_OK)
 		return fStatus;
 	
-	fStatus = entry->GetStat(&fStatBuf);
+	fStatus = ReadStat(entry);
 	if (fStatus != B_OK)
 		return fStatus;
 	
@@ -229,7 +375,7 @@ Model::SetTo(const entry_ref *newRef, bool traverse, bool open, bool writable)
 	DeletePreferredAppVolumeNameLinkTo();
 	fIconFrom = kUnknownSource;
 	fBaseType = kUnknownNode;
-	fMimeType = "";
+	fMimeType = NULL;
 
 	BEntry tmpEntry(newRef, traverse);
 	fStatus = tmpEntry.InitCheck();
@@ -241,7 +387,7 @@ Model::SetTo(const entry_ref *newRef, bool traverse, bool open, bool writable)
 	else
 		fEntryRef = *newRef;
 
-	fStatus = tmpEntry.GetStat(&fStatBuf);
+	fStatus = ReadStat(&tmpEntry);
 	if (fStatus != B_OK)
 		return fStatus;
 	
@@ -254,14 +400,14 @@ Model::SetTo(const entry_ref *newRef, bool traverse, bool open, bool writable)
 
 status_t 
 Model::SetTo(const node_ref *dirNode, const node_ref *nodeRef, const char *name,
-	bool open, bool writable)
+	bool open, bool writable, NodeMetadata *metadata)
 {
 	delete fNode;
 	fNode = NULL;
 	DeletePreferredAppVolumeNameLinkTo();
 	fIconFrom = kUnknownSource;
 	fBaseType = kUnknownNode;
-	fMimeType = "";
+	fMimeType = NULL;
 
 	fStatBuf.st_dev = nodeRef->device;
 	fStatBuf.st_ino = nodeRef->node;
@@ -274,11 +420,11 @@ Model::SetTo(const node_ref *dirNode, const node_ref *nodeRef, const char *name,
 	if (fStatus != B_OK)
 		return fStatus;
 	
-	fStatus = tmpNode.GetStat(&fStatBuf);
+	fStatus = ReadStat(&tmpNode);
 	if (fStatus != B_OK)
 		return fStatus;
 
-	fStatus = OpenNode(writable);
+	fStatus = OpenNodeCommon(writable, metadata);
 
 	if (!open)
 		CloseNode();
@@ -340,6 +486,17 @@ Model::OpenNode(bool writable)
 	return fStatus;
 }
 
+status_t
+Model::ReadStat(const BStatable *statable)
+{
+	StatStruct stat;
+	status_t result = statable->GetStat(&stat);
+	if (result == B_OK)
+		fStatBuf.SetTo(stat);
+
+	return result;
+}
+
 status_t 
 Model::UpdateStatAndOpenNode(bool writable)
 {
@@ -352,7 +509,7 @@ Model::UpdateStatAndOpenNode(bool writable)
 	if (fStatus != B_OK)
 		return fStatus;
 	
-	fStatus = tmpEntry.GetStat(&fStatBuf);
+	fStatus = ReadStat(&tmpEntry);
 	if (fStatus != B_OK)
 		return fStatus;
 
@@ -363,7 +520,7 @@ Model::UpdateStatAndOpenNode(bool writable)
 
 
 status_t
-Model::OpenNodeCommon(bool writable)
+Model::OpenNodeCommon(bool writable, NodeMetadata *metadata)
 {
 #if xDEBUG
 	PRINT(("opening node for %s\n", Name()));
@@ -430,8 +587,8 @@ Model::OpenNodeCommon(bool writable)
 
 	fWritable = writable;
 	
-	if (!fMimeType.Length())
-		FinishSettingUpType();
+	if (!fMimeType || !fMimeType[0])
+		FinishSettingUpType(metadata);
 	
 #ifdef CHECK_OPEN_MODEL_LEAKS
 	if (fWritable) {
@@ -513,9 +670,17 @@ Model::SetupBaseType()
 }
 
 void
-Model::FinishSettingUpType()
+Model::FinishSettingUpType(NodeMetadata *metadata)
 {
-	char mimeString[B_MIME_TYPE_LENGTH];
+	// read all the attributes we care about in one go instead of
+	// probing for each of them; if the caller passed in a snapshot it
+	// gets to use it for the pose info too
+	NodeMetadata localMetadata;
+	if (!metadata)
+		metadata = &localMetadata;
+
+	if (IsNodeOpen() && !metadata->IsRead())
+		metadata->ReadFrom(fNode);
 
 	// while we are reading the node, do a little
 	// snooping to see if it even makes sense to look for a node-based
@@ -524,10 +689,9 @@ Model::FinishSettingUpType()
 	// disk again for models that do not have an icon defined by the node
 	if (IsNodeOpen()
 		&& fBaseType != kLinkNode
-		&& !CheckNodeIconHintPrivate(fNode, dynamic_cast<TTracker *>(be_app) == NULL)) {
+		&& !metadata->HasNodeIcon(dynamic_cast<TTracker *>(be_app) == NULL)) {
 			// when checking for the node icon hint, if we are libtracker, only check
-			// for small icons - checking for the large icons is a little more
-			// work for the filesystem and this will speed up the test.
+			// for small icons
 			// This makes node icons only work if there is a small and a large node
 			// icon on a file - for libtracker that is not a problem though
 		fIconFrom = kUnknownNotFromNode;
@@ -537,24 +701,20 @@ Model::FinishSettingUpType()
 		&& fBaseType != kVolumeNode
 		&& fBaseType != kLinkNode
 		&& IsNodeOpen()) {
-		BNodeInfo info(fNode);
-		
 		// check if a specific mime type is set
-		if (info.GetType(mimeString) == B_OK) {
+		const char *type = metadata->Type();
+		if (type) {
 			// node has a specific mime type
-			fMimeType = mimeString;
-			if (strcmp(mimeString, B_QUERY_MIMETYPE) == 0)
+			fMimeType = InternedStrings::Intern(type);
+			if (strcmp(type, B_QUERY_MIMETYPE) == 0)
 				fBaseType = kQueryNode;
-			else if (strcmp(mimeString, B_QUERY_TEMPLATE_MIMETYPE) == 0)
+			else if (strcmp(type, B_QUERY_TEMPLATE_MIMETYPE) == 0)
 				fBaseType = kQueryTemplateNode;
-				
-			if (info.GetPreferredApp(mimeString) == B_OK) {
-				if (fPreferredAppName)
-					DeletePreferredAppVolumeNameLinkTo();
-					
-				if (mimeString[0])
-					fPreferredAppName = strdup(mimeString); 
-			}
+
+			if (fPreferredAppName)
+				DeletePreferredAppVolumeNameLinkTo();
+
+			fPreferredAppName = InternedStrings::Intern(metadata->PreferredApp());
 		}
 	}
 	
@@ -565,15 +725,14 @@ Model::FinishSettingUpType()
 				&& NodeRef()->device == fEntryRef.device) {
 				// promote from directory to file system root
 				fBaseType = kRootNode;
-				fMimeType = B_ROOT_MIMETYPE;
+				fMimeType = InternedStrings::Intern(B_ROOT_MIMETYPE);
 				break;
 			}
 
-			fMimeType = B_DIR_MIMETYPE;	// should use a shared string here
+			fMimeType = InternedStrings::Intern(B_DIR_MIMETYPE);
 			if (IsNodeOpen()) {
-				BNodeInfo info(fNode);
-				if (info.GetType(mimeString) == B_OK)
-					fMimeType = mimeString;
+				if (metadata->Type())
+					fMimeType = InternedStrings::Intern(metadata->Type());
 
 				if (fIconFrom == kUnknownNotFromNode
 					&& WellKnowEntryList::Match(NodeRef()) > (directory_which)-1)
@@ -590,7 +749,7 @@ Model::FinishSettingUpType()
 				fBaseType = kVolumeNode;
 
 				// volumes have to have a B_VOLUME_MIMETYPE type
-				fMimeType = B_VOLUME_MIMETYPE;
+				fMimeType = InternedStrings::Intern(B_VOLUME_MIMETYPE);
 				if (fIconFrom == kUnknownNotFromNode)
 					fIconFrom = kVolume;
 
@@ -606,29 +765,27 @@ Model::FinishSettingUpType()
 			break;
 
 		case kLinkNode:
-			fMimeType = B_LINK_MIMETYPE;	// should use a shared string here
+			fMimeType = InternedStrings::Intern(B_LINK_MIMETYPE);
 			break;
 		
 		case kExecutableNode:
 			if (IsNodeOpen()) {
-				char signature[B_MIME_TYPE_LENGTH];
-				if (GetAppSignatureFromAttr(dynamic_cast<BFile *>(fNode), signature)
-					== B_OK) {
-
+				const char *signature = metadata->AppSignature();
+				if (signature) {
 					if (fPreferredAppName)
 						DeletePreferredAppVolumeNameLinkTo();
 
 					if (signature[0])
-						fPreferredAppName = strdup(signature); 
+						fPreferredAppName = InternedStrings::Intern(signature);
 				}
 			}
-			if (!fMimeType.Length())
-				fMimeType = B_APP_MIME_TYPE;	// should use a shared string here
+			if (!fMimeType || !fMimeType[0])
+				fMimeType = InternedStrings::Intern(B_APP_MIME_TYPE);
 			break;
 
 		default:
-			if (!fMimeType.Length())
-				fMimeType = B_FILE_MIMETYPE;
+			if (!fMimeType || !fMimeType[0])
+				fMimeType = InternedStrings::Intern(B_FILE_MIMETYPE);
 			break;
 	}
 }
@@ -677,14 +834,8 @@ void
 Model::SetPreferredAppSignature(const char *signature)
 {
 	ASSERT(!IsVolume() && !IsSymLink());
-	ASSERT(signature != fPreferredAppName);
-		// self assignment should not be an option
 
-	free(fPreferredAppName);
-	if (signature)
-		fPreferredAppName = strdup(signature);
-	else
-		fPreferredAppName = NULL;
+	fPreferredAppName = InternedStrings::Intern(signature);
 }
 
 const Model *
@@ -801,10 +952,10 @@ Model::AttrChanged(const char *attrName)
 		char mimeString[B_MIME_TYPE_LENGTH];
 		BNodeInfo info(fNode);
 		if (info.GetType(mimeString) != B_OK)
-			fMimeType = "";
+			fMimeType = NULL;
 		else {
 			// node has a specific mime type
-			fMimeType = mimeString;				
+			fMimeType = InternedStrings::Intern(mimeString);
 			if (!IsVolume()
 				&& !IsSymLink()
 				&& info.GetPreferredApp(mimeString) == B_OK)
@@ -833,7 +984,7 @@ Model::StatChanged()
 {
 	ASSERT(IsNodeOpen());
 	mode_t oldMode = fStatBuf.st_mode;
-	fStatus = fNode->GetStat(&fStatBuf);
+	fStatus = ReadStat(fNode);
 	if (oldMode != fStatBuf.st_mode) {
 		bool forWriting = IsNodeOpenForWriting();
 		CloseNode();
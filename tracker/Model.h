@@ -52,6 +52,7 @@ All rights reserved.
 class BPath;
 class BHandler;
 class BEntry;
+class BStatable;
 
 #if __GNUC__ && __GNUC__ < 3
 // using std::stat instead of just stat here because of what
@@ -65,6 +66,27 @@ typedef struct stat StatStruct;
 
 namespace BPrivate {
 
+class NodeMetadata;
+
+struct ModelStat {
+	// the part of a stat structure Tracker actually looks at; the field
+	// names match StatStruct so StatBuf() users don't have to care.
+	// st_dev and st_ino need to stay first, NodeRef() relies on it
+	dev_t st_dev;
+	ino_t st_ino;
+	mode_t st_mode;
+	uid_t st_uid;
+	gid_t st_gid;
+	off_t st_size;
+	time_t st_mtime;
+	time_t st_ctime;
+	time_t st_crtime;
+
+	void SetTo(const StatStruct &);
+	void GetStat(StatStruct *) const;
+		// fills out a full stat structure, fields we do not keep are zeroed
+};
+
 enum {
 	kDoesNotSupportType,
 	kSuperhandlerModel,
@@ -81,18 +103,28 @@ public:
 	Model(const entry_ref *, bool traverse = false, bool open = false,
 		bool writable = false);
 	Model(const node_ref *dirNode, const node_ref *node, const char *name,
-		bool open = false, bool writable = false);
+		bool open = false, bool writable = false, NodeMetadata *metadata = NULL);
+		// if <metadata> is passed, the attributes read while setting up
+		// the type are left in it for the caller to use
 	~Model();
 
 	Model& operator=(const Model &);
 
+	void *operator new(size_t);
+	void operator delete(void *);
+		// Models are allocated from a shared pool, there are a lot of them
+		// and they are all the same size
+
+	static void GetAllocationStats(int32 *live, int32 *allocated);
+		// for benchmarking
+
 	status_t InitCheck() const;
 
 	status_t SetTo(const BEntry *, bool open = false, bool writable = false);
 	status_t SetTo(const entry_ref *, bool traverse = false, bool open = false,
 		bool writable = false);
 	status_t SetTo(const node_ref *dirNode, const node_ref *node, const char *name,
-		bool open = false, bool writable = false);
+		bool open = false, bool writable = false, NodeMetadata *metadata = NULL);
 
 	int CompareFolderNamesFirst(const Model *compareModel) const;
 
@@ -111,7 +143,7 @@ public:
 	const char *Name() const;
 	const entry_ref *EntryRef() const;
 	const node_ref *NodeRef() const;
-	const StatStruct *StatBuf() const;
+	const ModelStat *StatBuf() const;
 
 	BNode *Node() const;
 		// returns null if not Open
@@ -205,9 +237,10 @@ public:
 	bool Mimeset(bool force);
 		// returns true if mime type changed
 private:
-	status_t OpenNodeCommon(bool writable);
+	status_t OpenNodeCommon(bool writable, NodeMetadata *metadata = NULL);
+	status_t ReadStat(const BStatable *);
 	void SetupBaseType();
-	void FinishSettingUpType();
+	void FinishSettingUpType(NodeMetadata *);
 	void DeletePreferredAppVolumeNameLinkTo();
 
 	status_t FetchOneQuery(const BQuery *, BHandler *target,
@@ -234,12 +267,13 @@ private:
 	};
 
 	entry_ref fEntryRef;
-	StatStruct fStatBuf;
-	BString fMimeType;		// should use string that may be shared for common types
+	ModelStat fStatBuf;
+	const char *fMimeType;		// interned, shared with all other models of the type
 
 	// bit of overloading hackery here to save on footprint
 	union {
-		char *fPreferredAppName;	// used if we are neither a volume nor a symlink
+		const char *fPreferredAppName;	// interned, used if we are neither
+										// a volume nor a symlink
 		char *fVolumeName;			// used if we are a volume
 		Model *fLinkTo;				// used if we are a symlink
 	};
@@ -303,7 +337,7 @@ void InitOpenModelDumping();
 inline const char *
 Model::MimeType() const
 {
-	return fMimeType.String();
+	return fMimeType ? fMimeType : "";
 }
 
 inline const entry_ref *
@@ -324,7 +358,7 @@ Model::Node() const
 	return fNode;
 }
 
-inline const StatStruct *
+inline const ModelStat *
 Model::StatBuf() const
 {
 	return &fStatBuf;
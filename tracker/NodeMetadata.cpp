@@ -0,0 +1,155 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+#include <Debug.h>
+#include <fs_attr.h>
+
+#include <string.h>
+
+#include "Attributes.h"
+#include "NodeMetadata.h"
+
+NodeMetadata::NodeMetadata()
+	:	fFlags(0)
+{
+}
+
+void
+NodeMetadata::MakeEmpty()
+{
+	fFlags = 0;
+}
+
+status_t
+NodeMetadata::ReadFrom(BNode *node)
+{
+	MakeEmpty();
+
+	status_t result = node->RewindAttrs();
+	if (result != B_OK)
+		return result;
+
+	// note which of the interesting attributes the node has
+	uint32 present = 0;
+	char name[B_ATTR_NAME_LENGTH];
+	while (node->GetNextAttrName(name) == B_OK) {
+		if (strcmp(name, kAttrMIMEType) == 0)
+			present |= kHasType;
+		else if (strcmp(name, kAttrPreferredApp) == 0)
+			present |= kHasPreferredApp;
+		else if (strcmp(name, kAttrAppSignature) == 0)
+			present |= kHasAppSignature;
+		else if (strcmp(name, kAttrMiniIcon) == 0)
+			present |= kHasMiniIcon;
+		else if (strcmp(name, kAttrLargeIcon) == 0)
+			present |= kHasLargeIcon;
+		else if (strcmp(name, kAttrPoseInfo) == 0)
+			present |= kHasPoseInfo;
+		else if (strcmp(name, kAttrPoseInfoForeign) == 0)
+			present |= kHasForeignPoseInfo;
+	}
+
+	fFlags = kRead | (present & (kHasMiniIcon | kHasLargeIcon));
+
+	// only read what is there
+	if ((present & kHasType) && ReadString(node, kAttrMIMEType, fType))
+		fFlags |= kHasType;
+
+	if ((present & kHasPreferredApp)
+		&& ReadString(node, kAttrPreferredApp, fPreferredApp))
+		fFlags |= kHasPreferredApp;
+
+	if ((present & kHasAppSignature)
+		&& ReadString(node, kAttrAppSignature, fAppSignature))
+		fFlags |= kHasAppSignature;
+
+	if ((present & kHasPoseInfo) && ReadPoseInfo(node, kAttrPoseInfo, false))
+		fFlags |= kHasPoseInfo;
+	else if ((present & kHasForeignPoseInfo)
+		&& ReadPoseInfo(node, kAttrPoseInfoForeign, true))
+		fFlags |= kHasForeignPoseInfo;
+
+	return B_OK;
+}
+
+bool
+NodeMetadata::ReadString(BNode *node, const char *attrName, char *result)
+{
+	ssize_t length = node->ReadAttr(attrName, B_MIME_STRING_TYPE, 0, result,
+		B_MIME_TYPE_LENGTH);
+	if (length <= 0)
+		return false;
+
+	// make sure we are terminated, the attribute might not be
+	result[min_c(length, B_MIME_TYPE_LENGTH - 1)] = '\0';
+	return result[0] != '\0';
+}
+
+bool
+NodeMetadata::ReadPoseInfo(BNode *node, const char *attrName, bool foreign)
+{
+	if (node->ReadAttr(attrName, B_RAW_TYPE, 0, &fPoseInfo, sizeof(fPoseInfo))
+			!= (ssize_t)sizeof(fPoseInfo))
+		return false;
+
+	if (foreign)
+		PoseInfo::EndianSwap(&fPoseInfo);
+
+	return true;
+}
+
+bool
+NodeMetadata::HasNodeIcon(bool miniIconOnly) const
+{
+	if (fFlags & kHasMiniIcon)
+		return true;
+
+	return !miniIconOnly && (fFlags & kHasLargeIcon) != 0;
+}
+
+ReadAttrResult
+NodeMetadata::GetPoseInfo(PoseInfo *poseInfo) const
+{
+	if (fFlags & kHasPoseInfo) {
+		*poseInfo = fPoseInfo;
+		return kReadAttrNativeOK;
+	}
+
+	if (fFlags & kHasForeignPoseInfo) {
+		*poseInfo = fPoseInfo;
+		return kReadAttrForeignOK;
+	}
+
+	return kReadAttrFailed;
+}
@@ -0,0 +1,119 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+//	NodeMetadata is a snapshot of the attributes Tracker looks at when it
+//	first sets up a Model and its pose - file type, preferred app, app
+//	signature, whether there is an icon on the node and the pose info.
+//	The attribute directory is listed once and only attributes that are
+//	actually there get read, instead of probing for each one separately.
+
+#ifndef __NODE_METADATA__
+#define __NODE_METADATA__
+
+#include <Mime.h>
+#include <Node.h>
+
+#include "FSUtils.h"
+#include "Utilities.h"
+
+namespace BPrivate {
+
+class NodeMetadata {
+public:
+	NodeMetadata();
+
+	status_t ReadFrom(BNode *);
+	bool IsRead() const;
+	void MakeEmpty();
+
+	const char *Type() const;
+	const char *PreferredApp() const;
+	const char *AppSignature() const;
+		// return NULL if the attribute is not there
+
+	bool HasNodeIcon(bool miniIconOnly) const;
+	ReadAttrResult GetPoseInfo(PoseInfo *) const;
+		// same results as the endian swapping ReadAttr
+
+private:
+	bool ReadString(BNode *, const char *, char *);
+	bool ReadPoseInfo(BNode *, const char *, bool foreign);
+
+	enum {
+		kRead = 0x1,
+		kHasType = 0x2,
+		kHasPreferredApp = 0x4,
+		kHasAppSignature = 0x8,
+		kHasMiniIcon = 0x10,
+		kHasLargeIcon = 0x20,
+		kHasPoseInfo = 0x40,
+		kHasForeignPoseInfo = 0x80
+	};
+
+	uint32 fFlags;
+	char fType[B_MIME_TYPE_LENGTH];
+	char fPreferredApp[B_MIME_TYPE_LENGTH];
+	char fAppSignature[B_MIME_TYPE_LENGTH];
+	PoseInfo fPoseInfo;
+};
+
+inline bool
+NodeMetadata::IsRead() const
+{
+	return (fFlags & kRead) != 0;
+}
+
+inline const char *
+NodeMetadata::Type() const
+{
+	return (fFlags & kHasType) ? fType : NULL;
+}
+
+inline const char *
+NodeMetadata::PreferredApp() const
+{
+	return (fFlags & kHasPreferredApp) ? fPreferredApp : NULL;
+}
+
+inline const char *
+NodeMetadata::AppSignature() const
+{
+	return (fFlags & kHasAppSignature) ? fAppSignature : NULL;
+}
+
+} // namespace BPrivate
+
+using namespace BPrivate;
+
+#endif
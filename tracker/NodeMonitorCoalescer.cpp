@@ -0,0 +1,214 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+#include <Debug.h>
+#include <NodeMonitor.h>
+
+#include <string.h>
+
+#include "NodeMonitorCoalescer.h"
+
+
+NodeMonitorCoalescer::PendingNode::PendingNode(const node_ref *nodeRef)
+	:	node(*nodeRef),
+		removed(NULL),
+		created(NULL),
+		statChanged(NULL),
+		attrChanged(2, true)
+{
+}
+
+NodeMonitorCoalescer::PendingNode::~PendingNode()
+{
+	delete removed;
+	delete created;
+	delete statChanged;
+}
+
+void
+NodeMonitorCoalescer::PendingNode::DropChanges()
+{
+	delete statChanged;
+	statChanged = NULL;
+	attrChanged.MakeEmpty();
+}
+
+bool
+NodeMonitorCoalescer::PendingNode::IsEmpty() const
+{
+	return !removed && !created && !statChanged && attrChanged.IsEmpty();
+}
+
+
+NodeMonitorCoalescer::NodeMonitorCoalescer()
+	:	fPending(20, true),
+		fRawCount(0),
+		fDeliveredCount(0)
+{
+}
+
+NodeMonitorCoalescer::~NodeMonitorCoalescer()
+{
+}
+
+NodeMonitorCoalescer::PendingNode *
+NodeMonitorCoalescer::PendingFor(const node_ref *node)
+{
+	NodeMap::iterator found = fNodes.find(*node);
+	if (found != fNodes.end())
+		return found->second;
+
+	PendingNode *pending = new PendingNode(node);
+	fPending.AddItem(pending);
+	fNodes[*node] = pending;
+	return pending;
+}
+
+bool
+NodeMonitorCoalescer::Add(const BMessage *message)
+{
+	fRawCount++;
+
+	int32 opcode;
+	node_ref node;
+	if (message->what != B_NODE_MONITOR
+		|| message->FindInt32("opcode", &opcode) != B_OK
+		|| message->FindInt32("device", &node.device) != B_OK
+		|| message->FindInt64("node", (int64 *)&node.node) != B_OK) {
+		fDeliveredCount++;
+		return false;
+	}
+
+	switch (opcode) {
+		case B_ENTRY_CREATED:
+			{
+				PendingNode *pending = PendingFor(&node);
+				// whatever changed before is picked up by the new model
+				pending->DropChanges();
+				delete pending->created;
+				pending->created = new BMessage(*message);
+				break;
+			}
+
+		case B_ENTRY_REMOVED:
+			{
+				PendingNode *pending = PendingFor(&node);
+				pending->DropChanges();
+				if (pending->created) {
+					// created and gone again before the view got to see it
+					delete pending->created;
+					pending->created = NULL;
+				} else if (!pending->removed)
+					pending->removed = new BMessage(*message);
+				break;
+			}
+
+		case B_STAT_CHANGED:
+			{
+				PendingNode *pending = PendingFor(&node);
+				if (pending->created)
+					break;
+
+				delete pending->statChanged;
+				pending->statChanged = new BMessage(*message);
+				break;
+			}
+
+		case B_ATTR_CHANGED:
+			{
+				PendingNode *pending = PendingFor(&node);
+				if (pending->created)
+					break;
+
+				// keep the last change of every attribute
+				const char *attrName = NULL;
+				message->FindString("attr", &attrName);
+				int32 count = pending->attrChanged.CountItems();
+				for (int32 index = 0; index < count; index++) {
+					const char *name = NULL;
+					pending->attrChanged.ItemAt(index)->FindString("attr", &name);
+					if (attrName == name
+						|| (attrName && name && strcmp(attrName, name) == 0)) {
+						delete pending->attrChanged.RemoveItemAt(index);
+						break;
+					}
+				}
+				pending->attrChanged.AddItem(new BMessage(*message));
+				break;
+			}
+
+		default:
+			fDeliveredCount++;
+			return false;
+	}
+
+	return true;
+}
+
+void
+NodeMonitorCoalescer::TakeBatch(BObjectList<BMessage> *batch)
+{
+	int32 firstNew = batch->CountItems();
+	int32 count = fPending.CountItems();
+	for (int32 index = 0; index < count; index++) {
+		PendingNode *pending = fPending.ItemAt(index);
+		if (pending->IsEmpty())
+			continue;
+
+		if (pending->removed) {
+			batch->AddItem(pending->removed);
+			pending->removed = NULL;
+		}
+		if (pending->created) {
+			batch->AddItem(pending->created);
+			pending->created = NULL;
+		}
+		if (pending->statChanged) {
+			batch->AddItem(pending->statChanged);
+			pending->statChanged = NULL;
+		}
+		while (!pending->attrChanged.IsEmpty())
+			batch->AddItem(pending->attrChanged.RemoveItemAt(0));
+	}
+
+	fDeliveredCount += batch->CountItems() - firstNew;
+	MakeEmpty();
+}
+
+void
+NodeMonitorCoalescer::MakeEmpty()
+{
+	fNodes.clear();
+	fPending.MakeEmpty();
+}
@@ -0,0 +1,128 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+//	NodeMonitorCoalescer merges the node monitor messages a pose view
+//	receives in a short period into one batch.
+//
+//	Messages are merged per node: anything following a create is dropped
+//	since the new model reads the current state anyway, a create followed
+//	by a remove drops both, and repeated stat or attribute changes only
+//	keep the last one (per attribute). Messages that depend on ordering
+//	between nodes (moves, mounts) are not merged; the view flushes the
+//	pending batch before handling them.
+
+#ifndef __NODE_MONITOR_COALESCER__
+#define __NODE_MONITOR_COALESCER__
+
+#include <Message.h>
+#include <Node.h>
+
+#include <map>
+
+#include "ObjectList.h"
+
+namespace BPrivate {
+
+class NodeMonitorCoalescer {
+public:
+	NodeMonitorCoalescer();
+	~NodeMonitorCoalescer();
+
+	bool Add(const BMessage *);
+		// returns false if the message cannot be merged, the caller then
+		// has to flush and deliver it right away
+	bool IsEmpty() const;
+	void TakeBatch(BObjectList<BMessage> *);
+		// hands out everything pending, in the order the nodes first
+		// showed up; the messages are owned by the caller
+	void MakeEmpty();
+
+	int64 RawCount() const;
+	int64 DeliveredCount() const;
+		// number of messages received and passed on to the view
+
+private:
+	struct PendingNode {
+		PendingNode(const node_ref *);
+		~PendingNode();
+
+		void DropChanges();
+		bool IsEmpty() const;
+
+		node_ref node;
+		BMessage *removed;
+		BMessage *created;
+		BMessage *statChanged;
+		BObjectList<BMessage> attrChanged;
+	};
+
+	struct NodeRefLess {
+		bool operator()(const node_ref &a, const node_ref &b) const
+			{ return a.device < b.device
+				|| (a.device == b.device && a.node < b.node); }
+	};
+
+	typedef std::map<node_ref, PendingNode *, NodeRefLess> NodeMap;
+
+	PendingNode *PendingFor(const node_ref *);
+
+	BObjectList<PendingNode> fPending;
+	NodeMap fNodes;
+	int64 fRawCount;
+	int64 fDeliveredCount;
+};
+
+inline bool
+NodeMonitorCoalescer::IsEmpty() const
+{
+	return fPending.IsEmpty();
+}
+
+inline int64
+NodeMonitorCoalescer::RawCount() const
+{
+	return fRawCount;
+}
+
+inline int64
+NodeMonitorCoalescer::DeliveredCount() const
+{
+	return fDeliveredCount;
+}
+
+} // namespace BPrivate
+
+using namespace BPrivate;
+
+#endif
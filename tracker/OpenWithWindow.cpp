@@ -45,6 +45,7 @@ All rights reserved.
 #include <stdio.h>
 #include <string.h>
 
+#include "AppCapabilityIndex.h"
 #include "Attributes.h"
 #include "AutoLock.h"
 #include "Commands.h"
@@ -496,7 +497,7 @@ OpenWithPoseView::CanHandleDragSelection(const Model *, const BMessage *, bool)
 }
 
 static void
-AddSupportingAppForTypeToQuery(SearchForSignatureEntryList *queryIterator,
+AddSupportingAppSignaturesForType(SearchForSignatureEntryList *queryIterator,
 	const char *signature)
 {
 	// get supporting apps for type
@@ -520,6 +521,19 @@ AddSupportingAppForTypeToQuery(SearchForSignatureEntryList *queryIterator,
 	}
 }
 
+static void
+AddSupportingAppForTypeToQuery(SearchForSignatureEntryList *queryIterator,
+	const char *type)
+{
+	if (!queryIterator->PushUniqueSupportingAppType(type))
+		return;
+
+	// with the app capability index around the supporting apps get
+	// picked from its type map when iterating
+	if (!AppCapabilityIndex::Get())
+		AddSupportingAppSignaturesForType(queryIterator, type);
+}
+
 static const entry_ref *
 AddOneRefSignatures(const entry_ref *ref, void *castToIterator)
 {
@@ -560,6 +574,11 @@ AddOneRefSignatures(const entry_ref *ref, void *castToIterator)
 	if (mimeType.Length() && !mimeType.ICompare(B_FILE_MIMETYPE) == 0)
 		queryIterator->NonGenericFileFound();
 
+	if (!queryIterator->PushUniqueType(mimeType.String()))
+		// supporting apps and the preferred app for this type are
+		// already pushed, no need to ask the registrar again
+		return NULL;
+
 	// get supporting apps for type
 	AddSupportingAppForTypeToQuery(queryIterator, mimeType.String());
 
@@ -1100,6 +1119,11 @@ OpenWithMenu::ClearMenuBuildingState()
 SearchForSignatureEntryList::SearchForSignatureEntryList(bool canAddAllApps)
 	:	fIteratorList(NULL),
 		fSignatures(20, true),
+		fTypes(10, true),
+		fSupportingAppTypes(10, true),
+		fSupportingAppsPending(false),
+		fRelationTypes(10, true),
+		fRelationTypesSource(NULL),
 		fPreferredAppCount(0),
 		fPreferredAppForFileCount(0),
 		fGenericFilesOnly(true),
@@ -1124,6 +1148,29 @@ SearchForSignatureEntryList::PushUniqueSignature(const char *str)
 	fSignatures.AddItem(new BString(str));
 }
 
+bool 
+SearchForSignatureEntryList::PushUniqueType(const char *str)
+{
+	if (fTypes.EachElement(FindOne, (void *)str))
+		return false;
+	
+	fTypes.AddItem(new BString(str));
+	return true;
+}
+
+bool 
+SearchForSignatureEntryList::PushUniqueSupportingAppType(const char *str)
+{
+	if (fSupportingAppTypes.EachElement(FindOne, (void *)str))
+		return false;
+
+	fSupportingAppTypes.AddItem(new BString(str));
+	if (AppCapabilityIndex::Get())
+		fSupportingAppsPending = true;
+
+	return true;
+}
+
 status_t 
 SearchForSignatureEntryList::GetNextEntry(BEntry *entry, bool)
 {
@@ -1168,6 +1215,34 @@ SearchForSignatureEntryList::Rewind()
 	if (fIteratorList)
 		return fIteratorList->Rewind();
 
+	if (!fSignatures.CountItems() && !fSupportingAppTypes.CountItems())
+		return ENOENT;
+
+	AppCapabilityIndex *index = AppCapabilityIndex::Get();
+	if (index) {
+		// pick the apps straight from the index instead of running a query
+		IndexedAppEntryList *apps = new IndexedAppEntryList;
+		if (index->AddAppsWithSignatures(&fSignatures, apps)
+			&& index->AddAppsSupportingTypes(&fSupportingAppTypes, apps)) {
+			fIteratorList = new CachedEntryIteratorList;
+			fIteratorList->AddItem(apps);
+			fIteratorList->AddItem(new ConditionalAllAppsIterator(this));
+
+			return fIteratorList->Rewind();
+		}
+		delete apps;
+	}
+
+	if (fSupportingAppsPending) {
+		// the index went away since the types were pushed, fall back
+		// to asking the registrar
+		fSupportingAppsPending = false;
+		int32 count = fSupportingAppTypes.CountItems();
+		for (int32 typeIndex = 0; typeIndex < count; typeIndex++)
+			AddSupportingAppSignaturesForType(this,
+				fSupportingAppTypes.ItemAt(typeIndex)->String());
+	}
+
 	if (!fSignatures.CountItems())
 		return ENOENT;
 
@@ -1271,13 +1346,101 @@ SearchForSignatureEntryList::Relation(const Model *nodeModel,
 	return kNoRelation;
 }
 
+int32 
+SearchForSignatureEntryList::RelationFromSupport(int32 supportsMimeTypeResult)
+{
+	switch (supportsMimeTypeResult) {
+		case kSuperhandlerModel:
+			return kSuperhandler;
+			
+		case kModelSupportsSupertype:
+			return kSupportsSupertype;
+			
+		case kModelSupportsType:
+			return kSupportsType;
+	}
+
+	return kNoRelation;
+}
+
+void 
+SearchForSignatureEntryList::CollectRelationTypes(const BMessage *entriesToOpen) const
+{
+	if (fRelationTypesSource == entriesToOpen)
+		return;
+
+	fRelationTypes.MakeEmpty();
+	fRelationTypesSource = entriesToOpen;
+
+	// walk the entries exactly like the static Relation does, but only
+	// once per list instead of once per app
+	for (int32 index = 0; ; index++) {
+		entry_ref ref;
+		if (entriesToOpen->FindRef("refs", index, &ref) != B_OK)
+			break;
+
+		Model model(&ref, true, true);
+		if (model.InitCheck())
+			continue;
+
+		// entries of the same type relate the same, keep the first one
+		if (!fRelationTypes.EachElement(FindOne, (void *)model.MimeType()))
+			fRelationTypes.AddItem(new BString(model.MimeType()));
+	}
+}
+
+bool 
+SearchForSignatureEntryList::IndexedRelation(const BMessage *entriesToOpen,
+	const Model *applicationModel, const entry_ref *preferredApp,
+	const entry_ref *preferredAppForFile, int32 *result) const
+{
+	AppCapabilityIndex *index = AppCapabilityIndex::Get();
+	if (!index)
+		return false;
+
+	CollectRelationTypes(entriesToOpen);
+
+	int32 count = fRelationTypes.CountItems();
+	for (int32 typeIndex = 0; typeIndex < count; typeIndex++) {
+		int32 support = index->SupportsMimeType(applicationModel->NodeRef(),
+			fRelationTypes.ItemAt(typeIndex)->String());
+		if (support < 0)
+			// app not indexed, let the caller read it
+			return false;
+
+		int32 relation = RelationFromSupport(support);
+		if (relation == kNoRelation)
+			continue;
+
+		if (preferredAppForFile
+			&& *applicationModel->EntryRef() == *preferredAppForFile)
+			relation = kPreferredForFile;
+		else if (relation == kSupportsType && preferredApp
+			&& *applicationModel->EntryRef() == *preferredApp)
+			relation = kPreferredForType;
+
+		*result = relation;
+		return true;
+	}
+
+	*result = kNoRelation;
+	return true;
+}
+
 int32 
 SearchForSignatureEntryList::Relation(const BMessage *entriesToOpen,
 	const Model *model) const
 {
-	return Relation(entriesToOpen, model,
-		fPreferredAppCount == 1 ? &fPreferredRef : 0,
-		fPreferredAppForFileCount == 1 ? &fPreferredRefForFile : 0);
+	const entry_ref *preferredApp = fPreferredAppCount == 1 ? &fPreferredRef : 0;
+	const entry_ref *preferredAppForFile
+		= fPreferredAppForFileCount == 1 ? &fPreferredRefForFile : 0;
+
+	int32 result;
+	if (IndexedRelation(entriesToOpen, model, preferredApp, preferredAppForFile,
+			&result))
+		return result;
+
+	return Relation(entriesToOpen, model, preferredApp, preferredAppForFile);
 }
 
 void 
@@ -1467,7 +1630,10 @@ SearchForSignatureEntryList::CanOpenWithFilter(const Model *appModel,
 			return false;
 	}
 
-	int32 relation = Relation(entriesToOpen, appModel, preferredApp, 0);
+	int32 relation;
+	if (!IndexedRelation(entriesToOpen, appModel, preferredApp, 0, &relation))
+		relation = Relation(entriesToOpen, appModel, preferredApp, 0);
+
 	if (relation == kNoRelation && !ShowAllApplications()) {
 #if xDEBUG
 		BPath path;
@@ -1502,10 +1668,19 @@ ConditionalAllAppsIterator::Instantiate()
 	if (fWalker)
 		return;
 
+	AppCapabilityIndex *index = AppCapabilityIndex::Get();
+	if (index) {
+		IndexedAppEntryList *apps = new IndexedAppEntryList;
+		index->AddAllApps(apps);
+		fWalker = apps;
+		return;
+	}
+
 	BString lookForAppsPredicate;
 	lookForAppsPredicate << "(" << kAttrAppSignature << " = \"*\" ) && ( "
 		<< kAttrMIMEType << " = " << B_APP_MIME_TYPE << " ) ";
-	fWalker = new WALKER_NS::TQueryWalker(lookForAppsPredicate.String());
+	fWalker = new TWalkerWrapper(
+		new WALKER_NS::TQueryWalker(lookForAppsPredicate.String()));
 }
 
 
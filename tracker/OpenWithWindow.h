@@ -70,6 +70,12 @@ public:
 	
 	void PushUniqueSignature(const char *);
 		// add one signature to search for
+	bool PushUniqueType(const char *);
+		// remember one type of the entries to open, returns false if
+		// the type was already pushed
+	bool PushUniqueSupportingAppType(const char *);
+		// add one type whose supporting apps to search for, returns false
+		// if the type was already pushed
 	
 	// entry list iterators
 	virtual status_t GetNextEntry(BEntry *entry, bool traverse = false);
@@ -114,9 +120,27 @@ public:
 private:
 	static int32 Relation(const Model *node, const Model *app);
 		// returns the reason why an application is shown in Open With window
+	static int32 RelationFromSupport(int32 supportsMimeTypeResult);
+
+	bool IndexedRelation(const BMessage *entriesToOpen, const Model *app,
+		const entry_ref *preferredApp, const entry_ref *preferredAppForFile,
+		int32 *result) const;
+		// same result as the static Relation, computed through the app
+		// capability index, returns false if the index can't answer
+	void CollectRelationTypes(const BMessage *entriesToOpen) const;
 
 	CachedEntryIteratorList *fIteratorList;
 	BObjectList<BString> fSignatures;	
+	BObjectList<BString> fTypes;
+	BObjectList<BString> fSupportingAppTypes;
+	bool fSupportingAppsPending;
+		// the registrar was not asked for the supporting apps of
+		// fSupportingAppTypes because the index could answer
+
+	mutable BObjectList<BString> fRelationTypes;
+	mutable const BMessage *fRelationTypesSource;
+		// types of the entries to open, in order, as the static Relation
+		// sees them
 
 	entry_ref fPreferredRef;
 	int32 fPreferredAppCount;
@@ -314,7 +338,7 @@ protected:
 
 private:
 	SearchForSignatureEntryList *fParent;
-	WALKER_NS::TWalker *fWalker;
+	EntryListBase *fWalker;
 };
  
 
@@ -0,0 +1,237 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+#include <ByteOrder.h>
+#include <Debug.h>
+#include <fs_attr.h>
+
+#include <algorithm>
+
+#include <string.h>
+
+#include "Attributes.h"
+#include "Model.h"
+#include "PoseLocationIndex.h"
+#include "Utilities.h"
+
+const uint32 kPoseLocationIndexMagic = 'PLi2';
+	// indices without the item times are ignored
+const uint32 kRecordInvisible = 0x1;
+const size_t kMaxPoseLocationIndexSize = 4 * 1024 * 1024;
+	// sanity limit, a quarter million items
+
+
+PoseLocationIndex::PoseLocationIndex()
+	:	fDirectory(-1LL),
+		fRead(false),
+		fDirty(false)
+{
+}
+
+status_t
+PoseLocationIndex::Read(const BNode *directory, ino_t directoryNode)
+{
+	MakeEmpty();
+	fRead = true;
+	fDirectory = directoryNode;
+
+	const char *attrName = kAttrPoseLocationIndex;
+	bool foreign = false;
+	attr_info info;
+	if (directory->GetAttrInfo(attrName, &info) != B_OK) {
+		attrName = kAttrPoseLocationIndexForeign;
+		foreign = true;
+		if (directory->GetAttrInfo(attrName, &info) != B_OK)
+			return B_ENTRY_NOT_FOUND;
+	}
+
+	if (info.size < (off_t)sizeof(Header)
+		|| info.size > (off_t)kMaxPoseLocationIndexSize)
+		return B_BAD_DATA;
+
+	char *buffer = new char [info.size];
+	ssize_t result = directory->ReadAttr(attrName, B_RAW_TYPE, 0, buffer,
+		info.size);
+
+	Header *header = (Header *)buffer;
+	if (result == info.size && foreign)
+		SwapHeader(header);
+
+	if (result != info.size
+		|| header->magic != kPoseLocationIndexMagic
+		|| header->count > (info.size - sizeof(Header)) / sizeof(Record)
+		|| sizeof(Header) + header->count * sizeof(Record) != (size_t)info.size
+		|| header->directory != directoryNode) {
+		PRINT(("ignoring pose location index of %Ld\n", directoryNode));
+		delete [] buffer;
+		return B_BAD_DATA;
+	}
+
+	Record *records = (Record *)(buffer + sizeof(Header));
+	fRecords.reserve(header->count);
+	for (uint32 index = 0; index < header->count; index++) {
+		if (foreign)
+			SwapRecord(&records[index]);
+		fRecords.push_back(records[index]);
+	}
+	delete [] buffer;
+
+	// written sorted, but don't rely on it
+	std::sort(fRecords.begin(), fRecords.end());
+
+	return B_OK;
+}
+
+status_t
+PoseLocationIndex::Write(BNode *directory, ino_t directoryNode)
+{
+	size_t size = sizeof(Header) + fRecords.size() * sizeof(Record);
+	char *buffer = new char [size];
+
+	Header *header = (Header *)buffer;
+	header->magic = kPoseLocationIndexMagic;
+	header->count = fRecords.size();
+	header->directory = directoryNode;
+	if (!fRecords.empty())
+		memcpy(buffer + sizeof(Header), &fRecords[0],
+			fRecords.size() * sizeof(Record));
+
+	ssize_t result = directory->WriteAttr(kAttrPoseLocationIndex, B_RAW_TYPE,
+		0, buffer, size);
+	delete [] buffer;
+
+	if (result != (ssize_t)size)
+		return result < 0 ? (status_t)result : B_IO_ERROR;
+
+	// nuke opposite endianness
+	directory->RemoveAttr(kAttrPoseLocationIndexForeign);
+
+	fDirectory = directoryNode;
+	fDirty = false;
+	return B_OK;
+}
+
+bool
+PoseLocationIndex::Find(const ModelStat *stat, PoseInfo *poseInfo) const
+{
+	Record key;
+	key.node = stat->st_ino;
+	std::vector<Record>::const_iterator found
+		= std::lower_bound(fRecords.begin(), fRecords.end(), key);
+	if (found == fRecords.end() || found->node != stat->st_ino)
+		return false;
+
+	if (found->modified != (int32)stat->st_mtime
+		|| found->changed != (int32)stat->st_ctime)
+		// the item was touched since, its own pose info may be newer
+		return false;
+
+	poseInfo->fInvisible = (found->flags & kRecordInvisible) != 0;
+	poseInfo->fInitedDirectory = fDirectory;
+	poseInfo->fLocation = found->location;
+	return true;
+}
+
+void
+PoseLocationIndex::Set(const ModelStat *stat, const PoseInfo *poseInfo)
+{
+	Record record;
+	record.node = stat->st_ino;
+	record.location = poseInfo->fLocation;
+	record.modified = (int32)stat->st_mtime;
+	record.changed = (int32)stat->st_ctime;
+	record.flags = poseInfo->fInvisible ? kRecordInvisible : 0;
+	record.reserved = 0;
+
+	std::vector<Record>::iterator found
+		= std::lower_bound(fRecords.begin(), fRecords.end(), record);
+	if (found != fRecords.end() && found->node == record.node) {
+		if (found->location == record.location
+			&& found->modified == record.modified
+			&& found->changed == record.changed
+			&& found->flags == record.flags)
+			return;
+		*found = record;
+	} else
+		fRecords.insert(found, record);
+
+	fDirty = true;
+}
+
+void
+PoseLocationIndex::Remove(ino_t node)
+{
+	Record key;
+	key.node = node;
+	std::vector<Record>::iterator found
+		= std::lower_bound(fRecords.begin(), fRecords.end(), key);
+	if (found == fRecords.end() || found->node != node)
+		return;
+
+	fRecords.erase(found);
+	fDirty = true;
+}
+
+void
+PoseLocationIndex::MakeEmpty()
+{
+	fRecords.clear();
+	fDirectory = -1LL;
+	fRead = false;
+	fDirty = false;
+}
+
+void
+PoseLocationIndex::ClearDirty()
+{
+	fDirty = false;
+}
+
+void
+PoseLocationIndex::SwapHeader(Header *header)
+{
+	header->magic = SwapUInt32(header->magic);
+	header->count = SwapUInt32(header->count);
+	header->directory = SwapInt64(header->directory);
+}
+
+void
+PoseLocationIndex::SwapRecord(Record *record)
+{
+	record->node = SwapInt64(record->node);
+	swap_data(B_POINT_TYPE, &record->location, sizeof(BPoint), B_SWAP_ALWAYS);
+	record->modified = SwapInt32(record->modified);
+	record->changed = SwapInt32(record->changed);
+	record->flags = SwapUInt32(record->flags);
+}
@@ -0,0 +1,124 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+//	PoseLocationIndex keeps the icon locations of all the items of a
+//	directory in a single attribute of the directory itself.
+//
+//	Opening an icon mode window then takes one attribute read for the
+//	layout instead of reading the pose info attribute of every item. The
+//	per-item attributes are still written and used as a fallback for
+//	items the index does not know about, so other Tracker versions keep
+//	working with the same folders. Each record remembers the modification
+//	and change times of its item, a record whose item was touched since
+//	(possibly by something else writing its pose info) is not used.
+
+#ifndef __POSE_LOCATION_INDEX__
+#define __POSE_LOCATION_INDEX__
+
+#include <Node.h>
+#include <Point.h>
+
+#include <vector>
+
+namespace BPrivate {
+
+class PoseInfo;
+struct ModelStat;
+
+class PoseLocationIndex {
+public:
+	PoseLocationIndex();
+
+	status_t Read(const BNode *directory, ino_t directoryNode);
+		// an index written for some other directory (the folder was
+		// copied along with its attributes) is ignored
+	status_t Write(BNode *directory, ino_t directoryNode);
+
+	bool Find(const ModelStat *, PoseInfo *) const;
+		// fails if the item changed since its record was set
+	void Set(const ModelStat *, const PoseInfo *);
+	void Remove(ino_t node);
+	void MakeEmpty();
+	void ClearDirty();
+		// after a copy of the index was handed off to be written
+
+	bool IsRead() const;
+	bool IsDirty() const;
+
+private:
+	struct Record {
+		ino_t node;
+		BPoint location;
+		int32 modified;
+		int32 changed;
+		uint32 flags;
+		uint32 reserved;
+
+		bool operator<(const Record &other) const
+			{ return node < other.node; }
+	};
+
+	struct Header {
+		uint32 magic;
+		uint32 count;
+		ino_t directory;
+	};
+
+	static void SwapHeader(Header *);
+	static void SwapRecord(Record *);
+
+	std::vector<Record> fRecords;
+		// sorted by node
+	ino_t fDirectory;
+	bool fRead;
+	bool fDirty;
+};
+
+inline bool
+PoseLocationIndex::IsRead() const
+{
+	return fRead;
+}
+
+inline bool
+PoseLocationIndex::IsDirty() const
+{
+	return fDirty;
+}
+
+} // namespace BPrivate
+
+using namespace BPrivate;
+
+#endif
@@ -0,0 +1,295 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+#include <Debug.h>
+
+#include <string.h>
+
+#include "Attributes.h"
+#include "AutoLock.h"
+#include "FSUtils.h"
+#include "PoseLocationWriter.h"
+#include "Tracker.h"
+
+const bigtime_t kWriteBehindDelay = 250000;
+	// give repeated moves of the same icons a chance to coalesce
+
+
+PoseLocationWriter::PoseLocationWriter()
+	:	fLock("PoseLocationWriter"),
+		fWriteLock("PoseLocationWriter batch"),
+		fWakePending(false),
+		fWakeSem(create_sem(0, "PoseLocationWriter wake")),
+		fThread(-1),
+		fQuitting(false)
+{
+	fThread = spawn_thread(&PoseLocationWriter::WriterEntry,
+		"PoseLocationWriter", B_LOW_PRIORITY, this);
+	if (fThread >= B_OK)
+		resume_thread(fThread);
+}
+
+PoseLocationWriter::~PoseLocationWriter()
+{
+	fQuitting = true;
+	release_sem(fWakeSem);
+
+	status_t result;
+	wait_for_thread(fThread, &result);
+
+	Flush();
+	delete_sem(fWakeSem);
+}
+
+PoseLocationWriter *
+PoseLocationWriter::Get()
+{
+	TTracker *tracker = dynamic_cast<TTracker *>(be_app);
+	if (!tracker)
+		return NULL;
+
+	return tracker->LocationWriter();
+}
+
+void
+PoseLocationWriter::Save(const entry_ref *ref, const node_ref *node,
+	const PoseInfo *poseInfo, const BRect *desktopFrame)
+{
+	AutoLock<Benaphore> lock(fLock);
+
+	PendingLocation *pending;
+	PendingMap::iterator found = fPending.find(*node);
+	if (found != fPending.end())
+		pending = found->second;
+	else {
+		pending = new PendingLocation;
+		pending->node = *node;
+		fPending[*node] = pending;
+	}
+
+	// the newest ref wins, the item may have been renamed in between
+	pending->ref = *ref;
+	pending->poseInfo = *poseInfo;
+
+	if (desktopFrame) {
+		bool replaced = false;
+		for (uint32 index = 0; index < pending->frames.size(); index++) {
+			if (pending->frames[index].frame == *desktopFrame) {
+				pending->frames[index].location = poseInfo->fLocation;
+				replaced = true;
+				break;
+			}
+		}
+		if (!replaced) {
+			FrameLocation frameLocation;
+			frameLocation.frame = *desktopFrame;
+			frameLocation.location = poseInfo->fLocation;
+			pending->frames.push_back(frameLocation);
+		}
+	}
+
+	if (!fWakePending && fThread >= B_OK) {
+		fWakePending = true;
+		release_sem(fWakeSem);
+	}
+}
+
+void
+PoseLocationWriter::SaveIndex(const entry_ref *directory, const node_ref *node,
+	PoseLocationIndex *index)
+{
+	AutoLock<Benaphore> lock(fLock);
+
+	PendingIndex *pending;
+	PendingIndexMap::iterator found = fPendingIndices.find(*node);
+	if (found != fPendingIndices.end())
+		pending = found->second;
+	else {
+		pending = new PendingIndex;
+		pending->node = *node;
+		fPendingIndices[*node] = pending;
+	}
+
+	pending->ref = *directory;
+	pending->index = *index;
+	index->ClearDirty();
+
+	if (!fWakePending && fThread >= B_OK) {
+		fWakePending = true;
+		release_sem(fWakeSem);
+	}
+}
+
+void
+PoseLocationWriter::Flush()
+{
+	WriteBatch();
+}
+
+int32
+PoseLocationWriter::WriterEntry(void *castToWriter)
+{
+	static_cast<PoseLocationWriter *>(castToWriter)->Writer();
+	return B_OK;
+}
+
+void
+PoseLocationWriter::Writer()
+{
+	for (;;) {
+		if (acquire_sem(fWakeSem) != B_OK || fQuitting)
+			return;
+
+		snooze(kWriteBehindDelay);
+		if (fQuitting)
+			// the destructor flushes what is left
+			return;
+
+		WriteBatch();
+	}
+}
+
+void
+PoseLocationWriter::WriteBatch()
+{
+	// taking the batch while holding the write lock makes sure a newer
+	// location for a node is never overwritten by an older batch still
+	// being written
+	AutoLock<BLocker> writeLock(fWriteLock);
+
+	PendingMap batch;
+	PendingIndexMap indexBatch;
+	{
+		AutoLock<Benaphore> lock(fLock);
+		batch.swap(fPending);
+		indexBatch.swap(fPendingIndices);
+		fWakePending = false;
+	}
+
+	for (PendingIndexMap::iterator iterator = indexBatch.begin();
+		iterator != indexBatch.end(); iterator++) {
+		WriteIndex(iterator->second);
+		delete iterator->second;
+	}
+
+	if (batch.empty())
+		return;
+
+	PRINT(("writing %ld pose locations\n", (int32)batch.size()));
+
+	// the map is sorted by node, which keeps the writes roughly in disk
+	// order
+	for (PendingMap::iterator iterator = batch.begin();
+		iterator != batch.end(); iterator++) {
+		WriteOne(iterator->second);
+		delete iterator->second;
+	}
+}
+
+void
+PoseLocationWriter::WriteOne(const PendingLocation *pending)
+{
+	BNode node(&pending->ref);
+	node_ref nodeRef;
+	if (node.InitCheck() != B_OK || node.GetNodeRef(&nodeRef) != B_OK
+		|| nodeRef != pending->node)
+		// the item went away or was replaced in the meantime
+		return;
+
+	if (node.WriteAttr(kAttrPoseInfo, B_RAW_TYPE, 0, &pending->poseInfo,
+			sizeof(PoseInfo)) == sizeof(PoseInfo))
+		// nuke attribute in opposite endianness
+		node.RemoveAttr(kAttrPoseInfoForeign);
+
+	if (!pending->frames.empty())
+		WriteExtended(&node, pending);
+}
+
+void
+PoseLocationWriter::WriteIndex(PendingIndex *pending)
+{
+	BNode node(&pending->ref);
+	node_ref nodeRef;
+	if (node.InitCheck() != B_OK || node.GetNodeRef(&nodeRef) != B_OK
+		|| nodeRef != pending->node)
+		return;
+
+	pending->index.Write(&node, pending->node.node);
+}
+
+void
+PoseLocationWriter::WriteExtended(BNode *node, const PendingLocation *pending)
+{
+	int32 frameCount = pending->frames.size();
+
+	// read the pre-existing one, there may be locations for other frames
+	type_code type;
+	size_t size = 0;
+	ReadAttrResult result = GetAttrInfo(*node, kAttrExtendedPoseInfo,
+		kAttrExtendedPoseInfoForegin, &type, &size);
+
+	int32 oldFrameCount = 0;
+	if (result != kReadAttrFailed && size >= ExtendedPoseInfo::Size(0))
+		oldFrameCount = (size - ExtendedPoseInfo::Size(0))
+			/ sizeof(ExtendedPoseInfo::FrameLocation);
+
+	size_t bufferSize = ExtendedPoseInfo::Size(oldFrameCount + frameCount);
+	char *buffer = new char [bufferSize];
+	memset(buffer, 0, bufferSize);
+	ExtendedPoseInfo *extendedPoseInfo = (ExtendedPoseInfo *)buffer;
+
+	if (oldFrameCount == 0
+		|| ReadAttr(*node, kAttrExtendedPoseInfo, kAttrExtendedPoseInfoForegin,
+			B_RAW_TYPE, 0, buffer, size, &ExtendedPoseInfo::EndianSwap)
+				== kReadAttrFailed
+		|| extendedPoseInfo->fNumFrames != oldFrameCount) {
+		// don't have a usable one yet, start a new one
+		memset(buffer, 0, bufferSize);
+		extendedPoseInfo->fWorkspaces = 0xffffffff;
+		extendedPoseInfo->fInvisible = false;
+		extendedPoseInfo->fShowFromBootOnly = false;
+		extendedPoseInfo->fNumFrames = 0;
+	}
+
+	for (int32 index = 0; index < frameCount; index++)
+		extendedPoseInfo->SetLocationForFrame(pending->frames[index].location,
+			pending->frames[index].frame);
+
+	size = extendedPoseInfo->Size();
+	if (node->WriteAttr(kAttrExtendedPoseInfo, B_RAW_TYPE, 0, buffer, size)
+			== (ssize_t)size)
+		node->RemoveAttr(kAttrExtendedPoseInfoForegin);
+
+	delete [] buffer;
+}
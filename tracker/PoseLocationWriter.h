@@ -0,0 +1,139 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+//	PoseLocationWriter writes pose locations behind the back of the
+//	windows that save them.
+//
+//	Saving the locations of a few thousand icons means opening every node
+//	and writing an attribute, on the Desktop even reading one first; doing
+//	that in the window thread freezes the window. Saved locations are
+//	queued here instead and written by a background thread in batches
+//	ordered by node. Saving a node again before it got written just
+//	replaces the queued location.
+//
+//	Flush() is the barrier used before a volume gets unmounted and when
+//	Tracker quits.
+
+#ifndef __POSE_LOCATION_WRITER__
+#define __POSE_LOCATION_WRITER__
+
+#include <Entry.h>
+#include <Locker.h>
+#include <Node.h>
+#include <OS.h>
+#include <Rect.h>
+
+#include <map>
+#include <vector>
+
+#include "PoseLocationIndex.h"
+#include "Utilities.h"
+
+namespace BPrivate {
+
+class PoseLocationWriter {
+public:
+	PoseLocationWriter();
+	~PoseLocationWriter();
+		// writes out everything still pending
+
+	static PoseLocationWriter *Get();
+		// NULL if not running in Tracker; callers write synchronously then
+
+	void Save(const entry_ref *, const node_ref *, const PoseInfo *,
+		const BRect *desktopFrame = NULL);
+		// with a desktopFrame the extended pose info for that frame is
+		// updated as well
+
+	void SaveIndex(const entry_ref *directory, const node_ref *,
+		PoseLocationIndex *);
+		// writes a copy of the location index of <directory> and marks
+		// the passed one clean
+
+	void Flush();
+		// returns once everything queued so far has been written
+
+private:
+	struct FrameLocation {
+		BRect frame;
+		BPoint location;
+	};
+
+	struct PendingLocation {
+		entry_ref ref;
+		node_ref node;
+		PoseInfo poseInfo;
+		std::vector<FrameLocation> frames;
+	};
+
+	struct NodeRefLess {
+		bool operator()(const node_ref &a, const node_ref &b) const
+			{ return a.device < b.device
+				|| (a.device == b.device && a.node < b.node); }
+	};
+
+	struct PendingIndex {
+		entry_ref ref;
+		node_ref node;
+		PoseLocationIndex index;
+	};
+
+	typedef std::map<node_ref, PendingLocation *, NodeRefLess> PendingMap;
+	typedef std::map<node_ref, PendingIndex *, NodeRefLess> PendingIndexMap;
+
+	static int32 WriterEntry(void *);
+	void Writer();
+	void WriteBatch();
+	static void WriteOne(const PendingLocation *);
+	static void WriteExtended(BNode *, const PendingLocation *);
+	static void WriteIndex(PendingIndex *);
+
+	Benaphore fLock;
+		// guards fPending, fPendingIndices and fWakePending
+	BLocker fWriteLock;
+		// held while a batch is being written, orders the writer thread
+		// against Flush()
+	PendingMap fPending;
+	PendingIndexMap fPendingIndices;
+	bool fWakePending;
+	sem_id fWakeSem;
+	thread_id fThread;
+	volatile bool fQuitting;
+};
+
+} // namespace BPrivate
+
+using namespace BPrivate;
+
+#endif
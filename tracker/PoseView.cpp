@@ -77,13 +77,17 @@ All rights reserved.
 #include "ExtendedIcon.h"
 #include "FilePanelPriv.h"
 #include "FunctionObject.h"
+#include "GlyphAdvanceCache.h"
 #include "InfoWindow.h"
 #include "LanguageTheme.h"
 #include "MimeTypes.h"
 #include "Navigator.h"
 #include "NavMenu.h"
+#include "NodeMetadata.h"
 #include "Pose.h"
 #include "PoseList.h"
+#include "PoseLocationWriter.h"
+#include "RowRenderCache.h"
 #include "Utilities.h"
 #include "Undo.h"
 #include "FSClipboard.h"
@@ -91,7 +95,6 @@ All rights reserved.
 #include "TFSContext.h"
 #include "PoseView.h"
 #include "Tests.h"
-#include "TextViewSupport.h"
 #include "ThreadMagic.h"
 #include "Tracker.h"
 #include "TrackerFilters.h"
@@ -104,6 +107,11 @@ const float kCountViewWidth = 62;
 const uint32 kAddNewPoses = 'Tanp';
 const int32 kMaxAddPosesChunk = 10;
 
+const uint32 kFlushNodeMonitors = 'Tfnm';
+const bigtime_t kNodeMonitorCoalesceDelay = 50000;
+	// node monitors arriving within this much of each other are applied
+	// as one batch
+
 namespace BPrivate {
 extern bool delete_point(void *);
 	// ToDo: exterminate this
@@ -148,7 +156,7 @@ const char *kOkToCopyStr = "Are you sure you want to copy the selected "
 float BPoseView::fFontHeight = -1;
 font_height BPoseView::fFontInfo = { 0, 0, 0 };
 bigtime_t BPoseView::fLastKeyTime = 0;
-_BWidthBuffer_* BPoseView::fWidthBuf = new _BWidthBuffer_;
+GlyphAdvanceCache *BPoseView::fGlyphCache = NULL;
 BFont BPoseView::fCurrentFont;
 OffscreenBitmap *BPoseView::fOffscreen = new OffscreenBitmap;
 char BPoseView::fMatchString[] = "";
@@ -195,6 +203,7 @@ BPoseView::BPoseView(Model *model, BRect bounds, uint32 viewMode, uint32 resizeM
 		fStateNeedsSaving(false),
 		fCountView(NULL),
 		fUpdateRegion(new BRegion),				// does this need to be allocated ??
+		fRowCache(new RowRenderCache),
 		fDropTarget(NULL),
 		fDropTargetWasSelected(false),
 		fSelectionHandler(be_app),
@@ -211,6 +220,7 @@ BPoseView::BPoseView(Model *model, BRect bounds, uint32 viewMode, uint32 resizeM
 		fRealPivotPose(NULL),
 		fKeyRunner(NULL),
 		fFilterRunner(NULL),
+		fNodeMonitorRunner(NULL),
 		fSelectionVisible(true),
 		fMultipleSelection(true),
 		fDragEnabled(true),
@@ -227,6 +237,7 @@ BPoseView::BPoseView(Model *model, BRect bounds, uint32 viewMode, uint32 resizeM
 		fIsDesktopWindow(false),
 		fIsWatchingDateFormatChange(false),
 		fHasPosesInClipboard(false),
+		fBatchingNodeMonitors(false),
 		fLastExpression(BString("")),
 		fCurrentExpression(BString("")),
 		fLastFilterTime(system_time())
@@ -256,10 +267,12 @@ BPoseView::~BPoseView()
 	delete fMimeTypeList;
 	delete fZombieList;
 	delete fUpdateRegion;
+	delete fRowCache;
 	delete fViewState;
 	delete fModel;
 	delete fKeyRunner;
 	delete fFilterRunner;
+	delete fNodeMonitorRunner;
 	
 	IconCache::sIconCache->Deleting(this);
 }
@@ -671,14 +684,51 @@ BPoseView::SaveState(BMessage &message) const
 float 
 BPoseView::StringWidth(const char *str) const
 {
-	return fWidthBuf->StringWidth(str, 0, (int32)strlen(str), &fCurrentFont);
+	return GlyphCache()->StringWidth(str, (int32)strlen(str));
 }
 
 float 
 BPoseView::StringWidth(const char *str, int32 len) const
 {
 	ASSERT(strlen(str) == (uint32)len);
-	return fWidthBuf->StringWidth(str, 0, len, &fCurrentFont);
+	return GlyphCache()->StringWidth(str, len);
+}
+
+GlyphAdvanceCache *
+BPoseView::GlyphCache() const
+{
+	if (!fGlyphCache)
+		fGlyphCache = GlyphAdvanceCache::CacheFor(&fCurrentFont);
+
+	return fGlyphCache;
+}
+
+void
+BPoseView::FitVisibleColumnText(const BColumn *column)
+{
+	ASSERT(ViewMode() == kListMode);
+
+	BRect bounds(Bounds());
+	int32 count = fVSPoseList->CountItems();
+	int32 startIndex = (int32)(bounds.top / fListElemHeight);
+	if (startIndex < 0)
+		startIndex = 0;
+	int32 endIndex = (int32)(bounds.bottom / fListElemHeight) + 1;
+	if (endIndex > count)
+		endIndex = count;
+
+	if (startIndex >= endIndex)
+		return;
+
+	BObjectList<WidgetAttributeText> texts(endIndex - startIndex, false);
+	for (int32 index = startIndex; index < endIndex; index++) {
+		BTextWidget *widget = fVSPoseList->ItemAt(index)->WidgetFor(
+			column->AttrHash());
+		if (widget)
+			texts.AddItem(widget->AttributeText());
+	}
+
+	WidgetAttributeText::FitBatch(&texts, this);
 }
 
 void
@@ -705,6 +755,9 @@ BPoseView::SavePoseLocations(BRect *frameIfDesktop)
 
 	bool desktop = IsDesktopWindow() && (frameIfDesktop != NULL);
 
+	PoseLocationWriter *locationWriter = PoseLocationWriter::Get();
+		// hand the writes to the background writer if we can
+
 	int32 count = fPoseList->CountItems();
 	for (int32 index = 0; index < count; index++) {
 		BPose *pose = fPoseList->ItemAt(index);
@@ -719,6 +772,13 @@ BPoseView::SavePoseLocations(BRect *frameIfDesktop)
 	
 			poseInfo.fLocation = pose->Location();
 
+			if (locationWriter && !model->IsRoot()) {
+				if (model->InitCheck() == B_OK)
+					locationWriter->Save(model->EntryRef(), model->NodeRef(),
+						&poseInfo, desktop ? frameIfDesktop : NULL);
+				continue;
+			}
+
 			ExtendedPoseInfo *extendedPoseInfo = NULL;
 			size_t extendedPoseInfoSize = 0;
 			ModelNodeLazyOpener opener(model, true);
@@ -786,6 +846,33 @@ BPoseView::SavePoseLocations(BRect *frameIfDesktop)
 				// fix up this mess
 		}
 	}
+
+	PoseLocationIndex *locationIndex = LocationIndex();
+	if (locationIndex) {
+		// the index gets every located item, not just the ones that moved,
+		// so that the first save of a folder builds it up completely
+		poseInfo.fInvisible = false;
+		poseInfo.fInitedDirectory = TargetModel()->NodeRef()->node;
+		for (int32 index = 0; index < count; index++) {
+			BPose *pose = fPoseList->ItemAt(index);
+			if (pose->HasLocation() && InTargetDirectory(pose->TargetModel())) {
+				poseInfo.fLocation = pose->Location();
+				locationIndex->Set(pose->TargetModel()->StatBuf(), &poseInfo);
+			}
+		}
+
+		if (locationIndex->IsDirty()) {
+			if (locationWriter) {
+				// the writer takes a copy, the window doesn't wait
+				locationWriter->SaveIndex(TargetModel()->EntryRef(),
+					TargetModel()->NodeRef(), locationIndex);
+			} else {
+				BNode node(TargetModel()->EntryRef());
+				if (node.InitCheck() == B_OK)
+					locationIndex->Write(&node, TargetModel()->NodeRef()->node);
+			}
+		}
+	}
 }
 
 void 
@@ -887,6 +974,7 @@ BPoseView::AttachedToWindow()
 	font.SetSpacing(B_BITMAP_SPACING);
 	SetFont(&font);
 	GetFont(&fCurrentFont);
+	fGlyphCache = GlyphAdvanceCache::CacheFor(&fCurrentFont);
 
 	// static - init just once
 	if (fFontHeight == -1) {
@@ -1242,6 +1330,7 @@ BPoseView::AddPosesTask(void *castToParams)
 			char entBuf[1024];
 			dirent *eptr = (dirent *)entBuf;
 			Model *model = 0;
+			NodeMetadata metadata;
 			node_ref dirNode;
 			node_ref itemNode;
 
@@ -1268,7 +1357,8 @@ BPoseView::AddPosesTask(void *castToParams)
 					// have to node monitor ahead of time because Model will
 					// cache up the file type and preferred app
 					// OK to call when poseView is not locked
-				model = new Model(&dirNode, &itemNode, eptr->d_name, true);
+				model = new Model(&dirNode, &itemNode, eptr->d_name, true,
+					false, &metadata);
 				result = model->InitCheck();
 				posesResult->fModels[modelChunkIndex] = model;
 			}
@@ -1303,7 +1393,8 @@ BPoseView::AddPosesTask(void *castToParams)
 					continue;
 				}
 		
-				view->ReadPoseInfo(model, &(posesResult->fPoseInfos[modelChunkIndex]));
+				view->ReadPoseInfo(model, &(posesResult->fPoseInfos[modelChunkIndex]),
+					&metadata);
 				if (!view->ShouldShowPose(model, &(posesResult->fPoseInfos[modelChunkIndex]))
 					// filter out models we do not want to show
 					|| model->IsSymLink() && !view->CreateSymlinkPoseTarget(model)) {
@@ -1566,6 +1657,10 @@ BPoseView::CreatePoses(Model **models, PoseInfo *poseInfoArray, int32 count,
 	else
 		viewBounds = Bounds();
 	
+	if (fBatchingNodeMonitors)
+		// the whole view gets redrawn at the end of the batch
+		forceDraw = false;
+
 	int32 poseIndex = 0;
 	float listViewScrollBy = 0;
 	for (int32 modelIndex = 0; modelIndex < count; modelIndex++) {
@@ -1621,7 +1716,8 @@ BPoseView::CreatePoses(Model **models, PoseInfo *poseInfoArray, int32 count,
 								vsposeIndex++;
 						}
 						
-						if (!fDynamicFiltering || addtovs) {
+						if ((!fDynamicFiltering || addtovs)
+							&& !fBatchingNodeMonitors) {
 							poseBounds = CalcPoseRect(pose, vsposeIndex);
 							havePoseBounds = true;
 							BRect srcRect(Extent());
@@ -1755,9 +1851,19 @@ BPoseView::ShouldShowPose(const Model *model, const PoseInfo *poseInfo)
 		return false;
 
 	// check filters before adding item
-	if (fRefFilter && !fRefFilter->Filter(model->EntryRef(), model->Node(),
-		const_cast<StatStruct *>(model->StatBuf()), model->MimeType()))
-		return false;
+	if (fRefFilter) {
+		// filters get a full stat structure, Models only keep the
+		// fields we use, so stat the node for real
+		StatStruct stat;
+		status_t result = model->Node() ? model->Node()->GetStat(&stat)
+			: BEntry(model->EntryRef()).GetStat(&stat);
+		if (result != B_OK)
+			model->StatBuf()->GetStat(&stat);
+
+		if (!fRefFilter->Filter(model->EntryRef(), model->Node(), &stat,
+				model->MimeType()))
+			return false;
+	}
 	
 	if (fStaticFiltering && !TrackerFilters().FilterModel(model))
 		return false;
@@ -1974,8 +2080,11 @@ BPoseView::MessageReceived(BMessage *message)
 
 		case B_NODE_MONITOR:
 		case B_QUERY_UPDATE:
-			if (!FSNotification(message)) 
-				pendingNodeMonitorCache.Add(message);
+			QueueNodeMonitor(message);
+			break;
+
+		case kFlushNodeMonitors:
+			FlushNodeMonitors();
 			break;
 
 		case kScaleIconMode: {
@@ -2250,6 +2359,14 @@ BPoseView::MessageReceived(BMessage *message)
 //			RunIconCacheTests();
 //			break;
 
+		case kRunBenchmarks:
+			RunBenchmarks();
+			break;
+
+		case kRunModelMemoryTests:
+			RunModelMemoryTests();
+			break;
+
 		case 'dbug':
 			{
 				int32 count = fSelectionList->CountItems();
@@ -2568,13 +2685,16 @@ BPoseView::HandleAttrMenuItemSelected(BMessage *message)
 const int32 kSanePoseLocation = 50000;
 
 void
-BPoseView::ReadPoseInfo(Model *model, PoseInfo *poseInfo)
+BPoseView::ReadPoseInfo(Model *model, PoseInfo *poseInfo,
+	const NodeMetadata *metadata)
 {
 	BModelOpener opener(model);
 	if (!model->Node())
 		return;
 
 	ReadAttrResult result = kReadAttrFailed;
+	PoseLocationIndex *index = NULL;
+		// set if the index should learn the pose info read from the item
 
 	// special case the "root" disks icon
 	if (model->IsRoot()) {
@@ -2586,32 +2706,18 @@ BPoseView::ReadPoseInfo(Model *model, PoseInfo *poseInfo)
 		}
 	} else {
 		ASSERT(model->IsNodeOpen());
-		for (int32 count = 10; count >= 0; count--) {
-			if (!model->Node())
-				break;
-
+		// try the location index of the directory before going to the
+		// item itself; newly created items that get their pose info
+		// written late are moved in place by PoseInfoChanged()
+		index = InTargetDirectory(model) ? LocationIndex() : NULL;
+		if (index && index->Find(model->StatBuf(), poseInfo)) {
+			result = kReadAttrNativeOK;
+			index = NULL;
+		} else if (metadata && metadata->IsRead())
+			result = metadata->GetPoseInfo(poseInfo);
+		else
 			result = ReadAttr(*model->Node(), kAttrPoseInfo, kAttrPoseInfoForeign,
 				B_RAW_TYPE, 0, poseInfo, sizeof(*poseInfo), &PoseInfo::EndianSwap);
-
-			if (result != kReadAttrFailed) {
-				// got it, bail
-				break;
-			}
-
-			// if we're in one of the icon modes and it's a newly created item
-			// then we're going to retry a few times to see if we can get some
-			// pose info to properly place the icon
-			if (ViewMode() == kListMode)
-				break;
-				
-			const StatStruct *stat = model->StatBuf();
-			if (stat->st_crtime != stat->st_mtime)
-				break;
-			
-			PRINT(("retrying to read pose info for %s, %d\n", model->Name(), count));
-
-			snooze(20000);
-		}
 	}
 	if (result == kReadAttrFailed) {
 		poseInfo->fInitedDirectory = -1LL;
@@ -2627,7 +2733,65 @@ BPoseView::ReadPoseInfo(Model *model, PoseInfo *poseInfo)
 		|| poseInfo->fLocation.y > kSanePoseLocation) {
 		// location values not realistic, probably screwed up, force reset
 		poseInfo->fInitedDirectory = -1LL;
+	} else if (index)
+		// the record was missing or outdated, the next open of this
+		// folder can use it again
+		index->Set(model->StatBuf(), poseInfo);
+}
+
+bool
+BPoseView::InTargetDirectory(const Model *model) const
+{
+	return TargetModel()
+		&& model->EntryRef()->directory == TargetModel()->NodeRef()->node
+		&& model->EntryRef()->device == TargetModel()->NodeRef()->device;
+}
+
+PoseLocationIndex *
+BPoseView::LocationIndex()
+{
+	if (!TargetModel() || !TargetModel()->IsDirectory()
+		|| TargetModel()->IsRoot())
+		return NULL;
+
+	if (!fLocationIndex.IsRead()) {
+		// first use, read it in
+		BNode node(TargetModel()->EntryRef());
+		if (node.InitCheck() != B_OK)
+			return NULL;
+
+		fLocationIndex.Read(&node, TargetModel()->NodeRef()->node);
 	}
+
+	return &fLocationIndex;
+}
+
+void
+BPoseView::PoseInfoChanged(BPose *pose)
+{
+	// the pose info of a new item often gets written right after the
+	// item was created and we placed it somewhere ourselves, move it to
+	// the location it was given
+	if (ViewMode() == kListMode || !pose->WasAutoPlaced())
+		return;
+
+	PoseInfo poseInfo;
+	ReadPoseInfo(pose->TargetModel(), &poseInfo);
+	if (poseInfo.fInitedDirectory == -1LL)
+		return;
+
+	PinPointToValidRange(poseInfo.fLocation);
+
+	RemoveFromVSList(pose);
+	BRect oldBounds(pose->CalcRect(this));
+	pose->SetLocation(poseInfo.fLocation);
+	pose->SetAutoPlaced(false);
+	AddToVSList(pose);
+
+	BRect newBounds(pose->CalcRect(this));
+	AddToExtent(newBounds);
+	Invalidate(oldBounds);
+	Invalidate(newBounds);
 }
 
 ExtendedPoseInfo *
@@ -4595,6 +4759,7 @@ inline void
 UpdateWasBrokenSymlinkBinder(BPose *pose, Model *, BPoseView *poseView,
 	BPoint *loc)
 {
+	poseView->InvalidateCachedRow(pose);
 	pose->UpdateWasBrokenSymlink(*loc, poseView);
 	loc->y += poseView->ListElemHeight();
 }
@@ -4652,6 +4817,7 @@ OneMetaMimeChanged(BPose *pose, Model *model, int32 index,
 		// metamime change very likely affected the documents icon
 
 		BPoint poseLoc(0, index * poseView->ListElemHeight());
+		poseView->InvalidateCachedRow(pose);
 		pose->UpdateIcon(poseLoc, poseView);
 	}
 }
@@ -4890,6 +5056,82 @@ BPoseView::FSNotification(const BMessage *message)
 	return true;
 }
 
+void
+BPoseView::QueueNodeMonitor(const BMessage *message)
+{
+	if (!fNodeMonitorCoalescer.Add(message)) {
+		// moves, mounts and query updates must not overtake anything
+		// that is still pending
+		FlushNodeMonitors();
+		DeliverNodeMonitor(message);
+		return;
+	}
+
+	if (!fNodeMonitorRunner) {
+		BMessage flush(kFlushNodeMonitors);
+		fNodeMonitorRunner = new BMessageRunner(BMessenger(this), &flush,
+			kNodeMonitorCoalesceDelay, 1);
+	}
+}
+
+void
+BPoseView::FlushNodeMonitors()
+{
+	delete fNodeMonitorRunner;
+	fNodeMonitorRunner = NULL;
+
+	if (fNodeMonitorCoalescer.IsEmpty())
+		return;
+
+	BObjectList<BMessage> batch(20, true);
+	fNodeMonitorCoalescer.TakeBatch(&batch);
+
+	int32 count = batch.CountItems();
+	PRINT(("applying %ld node monitors, %Ld received, %Ld applied so far\n",
+		count, fNodeMonitorCoalescer.RawCount(),
+		fNodeMonitorCoalescer.DeliveredCount()));
+
+	if (count == 1) {
+		DeliverNodeMonitor(batch.ItemAt(0));
+		return;
+	}
+
+	// apply the batch without drawing or fixing up the scroll range for
+	// every single pose, then redraw once
+	fBatchingNodeMonitors = true;
+	for (int32 index = 0; index < count; index++)
+		DeliverNodeMonitor(batch.ItemAt(index));
+	fBatchingNodeMonitors = false;
+
+	if (ViewMode() == kListMode) {
+		// make sure that the last item in the list is not placed
+		// above the top of the view
+		BRect bounds(Bounds());
+		float lastItemTop = (fVSPoseList->CountItems() - 1) * fListElemHeight;
+		if (bounds.top > lastItemTop)
+			ScrollTo(bounds.left, max_c(lastItemTop, 0));
+	}
+
+	UpdateCount();
+	UpdateScrollRange();
+	ResetPosePlacementHint();
+	Invalidate();
+}
+
+void
+BPoseView::DeliverNodeMonitor(const BMessage *message)
+{
+	if (!FSNotification(message))
+		pendingNodeMonitorCache.Add(message);
+}
+
+void
+BPoseView::GetNodeMonitorCounts(int64 *raw, int64 *delivered) const
+{
+	*raw = fNodeMonitorCoalescer.RawCount();
+	*delivered = fNodeMonitorCoalescer.DeliveredCount();
+}
+
 bool
 BPoseView::CreateSymlinkPoseTarget(Model *symlink)
 {
@@ -4940,7 +5182,8 @@ BPoseView::EntryCreated(const node_ref *dirNode, const node_ref *itemNode,
 	BPoseView::WatchNewNode(itemNode);
 		// have to node monitor ahead of time because Model will
 		// cache up the file type and preferred app
-	Model *model = new Model(dirNode, itemNode, name, true);
+	NodeMetadata metadata;
+	Model *model = new Model(dirNode, itemNode, name, true, false, &metadata);
 	if (model->InitCheck() != B_OK) {
 		// if we have trouble setting up model then we stuff it into
 		// a zombie list in a half-alive state until we can properly awaken it
@@ -4952,7 +5195,7 @@ BPoseView::EntryCreated(const node_ref *dirNode, const node_ref *itemNode,
 	
 	// get saved pose info out of attribute
 	PoseInfo poseInfo;
-	ReadPoseInfo(model, &poseInfo);
+	ReadPoseInfo(model, &poseInfo, &metadata);
 
 	if (!ShouldShowPose(model, &poseInfo)
 		// filter out undesired poses
@@ -5063,6 +5306,7 @@ BPoseView::EntryMoved(const BMessage *message)
 			// if we get a rename then we need to assume that we might
 			// have missed some other attr changed notifications so we
 			// recheck all widgets
+			InvalidateCachedRow(pose);
 			if (pose->TargetModel()->OpenNode() == B_OK) {
 				pose->UpdateAllWidgets((vspose ? vsindex : index), loc, this);
 				pose->TargetModel()->CloseNode();
@@ -5147,6 +5391,7 @@ BPoseView::AttributeChanged(const BMessage *message)
 		}
 
 		if (result == B_OK) {
+			InvalidateCachedRow(pose);
 			if (attrName && model->Node()) {
 				model->Node()->GetAttrInfo(attrName, &info);
 				pose->UpdateWidgetAndModel(model, attrName, info.type, (vspose ? vsindex : index), loc, this);
@@ -5173,6 +5418,11 @@ BPoseView::AttributeChanged(const BMessage *message)
 			if (!attrName || attrHash == PrimarySort() || attrHash == SecondarySort())
 				CheckPoseSortOrder(vspose, vsindex);
 		}
+
+		if (attrName && model == pose->TargetModel()
+			&& (strcmp(attrName, kAttrPoseInfo) == 0
+				|| strcmp(attrName, kAttrPoseInfoForeign) == 0))
+			PoseInfoChanged(pose);
 	} else {
 		// pose might be in zombie state if we're copying...
 		Model *zombie = FindZombie(&itemNode, &index);
@@ -5203,6 +5453,7 @@ BPoseView::UpdateIcon(BPose *pose)
 		}
 	}
 
+	InvalidateCachedRow(pose);
 	pose->UpdateIcon(location, this);
 }
 
@@ -7194,6 +7445,7 @@ BPoseView::DeleteSymLinkPoseTarget(const node_ref *itemNode, BPose *pose,
 	watch_node(itemNode, B_STOP_WATCHING, this);
 	BPoint loc(0, index * fListElemHeight);
 	pose->TargetModel()->SetLinkTo(0);
+	InvalidateCachedRow(pose);
 	pose->UpdateBrokenSymLink(loc, this);
 }
 
@@ -7220,7 +7472,8 @@ BPoseView::DeletePose(const node_ref *itemNode, BPose *pose, int32 index)
 		if (pose == ActivePose())
 			CommitActivePose();
 
-		Window()->UpdateIfNeeded();
+		if (!fBatchingNodeMonitors)
+			Window()->UpdateIfNeeded();
 
 		// remove it from list no matter what since it might be in list
 		// but not "selected" since selection is hidden
@@ -7234,6 +7487,9 @@ BPoseView::DeletePose(const node_ref *itemNode, BPose *pose, int32 index)
 			ContainerWindow()->SelectionChanged();
 
 
+		if (InTargetDirectory(pose->TargetModel()))
+			fLocationIndex.Remove(itemNode->node);
+
 		fPoseList->RemoveItemAt(index);
 		if (ViewMode() == kListMode && fDynamicFiltering) {
 			index = fVSPoseList->IndexOf(pose);
@@ -7253,10 +7509,17 @@ BPoseView::DeletePose(const node_ref *itemNode, BPose *pose, int32 index)
 		else
 			invalidRect = pose->CalcRect(this);
 
-		if (ViewMode() == kListMode)
-			CloseGapInList(&invalidRect);
-		else
+		if (ViewMode() != kListMode)
 			RemoveFromExtent(invalidRect);
+		else if (!fBatchingNodeMonitors)
+			CloseGapInList(&invalidRect);
+
+		if (fBatchingNodeMonitors) {
+			// the rest is done once the whole batch has been applied
+			InvalidateCachedRow(pose);
+			delete pose;
+			return true;
+		}
 
 		Invalidate(invalidRect);
 		UpdateCount();
@@ -7271,6 +7534,7 @@ BPoseView::DeletePose(const node_ref *itemNode, BPose *pose, int32 index)
 				ScrollTo(bounds.left, max_c(bounds.top - fListElemHeight, 0));
 		}
 
+		InvalidateCachedRow(pose);
 		delete pose;
 
 	} else {
@@ -7480,6 +7744,11 @@ BPoseView::ClearPoses()
 	SavePoseLocations();
 
 	// clear all pose lists
+	fRowCache->MakeEmpty();
+	fLocationIndex.MakeEmpty();
+	fNodeMonitorCoalescer.MakeEmpty();
+	delete fNodeMonitorRunner;
+	fNodeMonitorRunner = NULL;
 	fPoseList->MakeEmpty();
 	fMimeTypeListIsDirty = true;
 	fVSPoseList->MakeEmpty();
@@ -8204,10 +8473,24 @@ BPoseView::DrawViewCommon(BRect updateRect, bool recalculateText)
 
 		BPoint loc(0, startIndex * fListElemHeight);
 
+		bool useRowCache = UseRowCache(recalculateText);
+		uint32 layout = 0;
+		if (useRowCache) {
+			layout = ColumnLayoutStamp();
+			// keep about three screens worth of rows around
+			fRowCache->SetCapacity(3
+				* (int32)(Bounds().Height() / fListElemHeight));
+		} else if (recalculateText)
+			fRowCache->MakeEmpty();
+
 		for (int32 index = startIndex; index < count; index++) {
 			BPose *pose = fVSPoseList->ItemAt(index);
-			BRect poseRect(pose->CalcRect(loc, this, true));
-			pose->Draw(poseRect, this, true, fUpdateRegion, recalculateText);
+			if (!useRowCache || pose->ActiveWidget()
+				|| !fRowCache->Draw(pose, pose->CalcRect(loc, this, false),
+					RowRenderState(pose), layout, this)) {
+				BRect poseRect(pose->CalcRect(loc, this, true));
+				pose->Draw(poseRect, this, true, fUpdateRegion, recalculateText);
+			}
 			loc.y += fListElemHeight;
 			if (loc.y >= updateRect.bottom)
 				break;
@@ -8223,6 +8506,51 @@ BPoseView::DrawViewCommon(BRect updateRect, bool recalculateText)
 	}
 }
 
+bool
+BPoseView::UseRowCache(bool recalculateText) const
+{
+	// the desktop draws over a background image, rows can't be
+	// rendered on their own there
+	return ViewMode() == kListMode && !recalculateText && !IsDesktopWindow()
+		&& fListElemHeight > 0 && Window();
+}
+
+uint32
+BPoseView::RowRenderState(const BPose *pose) const
+{
+	BContainerWindow *window = dynamic_cast<BContainerWindow *>(Window());
+	bool windowActive = Window()->IsActive()
+		|| (window && window->IsAboutToBeActivated());
+
+	// everything BPose::Draw looks at besides the pose itself
+	return (pose->IsSelected() ? 1 : 0)
+		| (windowActive ? 2 : 0)
+		| (fShowSelectionWhenInactive ? 4 : 0)
+		| (fIsDrawingSelectionRect ? 8 : 0)
+		| (pose->ClipboardMode() << 4);
+}
+
+uint32
+BPoseView::ColumnLayoutStamp() const
+{
+	uint32 stamp = (uint32)IconSizeInt() * 31 + (uint32)fListElemHeight;
+	int32 count = fColumnList->CountItems();
+	for (int32 index = 0; index < count; index++) {
+		BColumn *column = fColumnList->ItemAt(index);
+		stamp = stamp * 31 + column->AttrHash();
+		stamp = stamp * 31 + (uint32)column->Offset();
+		stamp = stamp * 31 + (uint32)column->Width();
+		stamp = stamp * 31 + (uint32)column->Alignment();
+	}
+	return stamp;
+}
+
+void
+BPoseView::InvalidateCachedRow(const BPose *pose)
+{
+	fRowCache->Invalidate(pose);
+}
+
 void
 BPoseView::ColumnRedraw(BRect updateRect)
 {
@@ -8585,6 +8913,8 @@ BPoseView::ResizeColumn(BColumn *column, float newSize,
 	invalidateRect.right = sourceRect.right;
 
 	column->SetWidth(newSize);
+	FitVisibleColumnText(column);
+		// refit the resized column in one pass before redrawing it
 
 	float offset = kColumnStart;
 	BColumn *last = fColumnList->FirstItem();
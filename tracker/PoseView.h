@@ -45,10 +45,12 @@ All rights reserved.
 #include "AttributeStream.h"
 #include "ContainerWindow.h"
 #include "Model.h"
+#include "NodeMonitorCoalescer.h"
 #include "ObjectList.h"
 #include "PendingNodeMonitorCache.h"
 #include "Pose.h"
 #include "PoseList.h"
+#include "PoseLocationIndex.h"
 #include "TitleView.h"
 #include "Utilities.h"
 #include "ViewState.h"
@@ -66,15 +68,15 @@ All rights reserved.
 class BRefFilter;
 class BList;
 
-// TODO: Get rid of this.
-class _BWidthBuffer_;
-
 namespace BPrivate {
 
 class BCountView;
 class BContainerWindow;
+class GlyphAdvanceCache;
 class BHScrollBar;
 class EntryListBase;
+class NodeMetadata;
+class RowRenderCache;
 
 const int32 kSmallStep = 10;
 const int32 kListOffset = 20;
@@ -169,6 +171,10 @@ class BPoseView : public BView {
 		// file change notification handler
 		virtual bool FSNotification(const BMessage *);
 
+		void GetNodeMonitorCounts(int64 *raw, int64 *delivered) const;
+			// node monitor messages received and actually applied after
+			// coalescing
+
 		// scrollbars
 		virtual void UpdateScrollRange();
 		virtual	void SetScrollBarsTo(BPoint);
@@ -368,6 +374,11 @@ class BPoseView : public BView {
 			// deliberately hide the BView StringWidth here - this makes it
 			// easy to have the right StringWidth picked up by
 			// template instantiation, as used by WidgetAttributeText
+		GlyphAdvanceCache *GlyphCache() const;
+			// glyph advances of the pose font, used for fitting text
+
+		void FitVisibleColumnText(const BColumn *);
+			// fits the text of the visible cells of a column in one batch
 
 		// show/hide barberpole while a background task is filling up the view, etc.
 		void ShowBarberPole();
@@ -426,7 +437,10 @@ class BPoseView : public BView {
 			// remove all the current poses from the view
 
 		// pose info read/write calls
-		void ReadPoseInfo(Model *, PoseInfo *);
+		void ReadPoseInfo(Model *, PoseInfo *,
+			const NodeMetadata * = NULL);
+			// pass in the attribute snapshot taken when setting up the
+			// model to avoid reading the pose info attribute again
 		ExtendedPoseInfo *ReadExtendedPoseInfo(Model *);
 
 		// pose creation
@@ -559,6 +573,22 @@ class BPoseView : public BView {
 		// view drawing
 		void SynchronousUpdate(BRect, bool clip = false);
 
+		// list mode row cache
+		bool UseRowCache(bool recalculateText) const;
+		uint32 RowRenderState(const BPose *) const;
+		uint32 ColumnLayoutStamp() const;
+		void InvalidateCachedRow(const BPose *);
+
+		// per directory pose locations
+		PoseLocationIndex *LocationIndex();
+		bool InTargetDirectory(const Model *) const;
+		void PoseInfoChanged(BPose *);
+
+		// node monitor batching
+		void QueueNodeMonitor(const BMessage *);
+		void FlushNodeMonitors();
+		void DeliverNodeMonitor(const BMessage *);
+
 		// scrolling
 		void HandleAutoScroll();
 		bool CheckAutoScroll(BPoint mouseLoc, bool shouldScroll, bool selectionScrolling = false);
@@ -623,6 +653,8 @@ class BPoseView : public BView {
 			// used for mime string based icon highliting during a drag
 		BObjectList<Model> *fZombieList;
 		PendingNodeMonitorCache pendingNodeMonitorCache;
+		NodeMonitorCoalescer fNodeMonitorCoalescer;
+		PoseLocationIndex fLocationIndex;
 		BObjectList<BColumn> *fColumnList;
 		BObjectList<BString> *fMimeTypeList;
 	  	bool fMimeTypeListIsDirty;
@@ -633,6 +665,8 @@ class BPoseView : public BView {
 		float fListElemHeight;
 		float fIconPoseHeight;
 		BRegion *fUpdateRegion;
+		RowRenderCache *fRowCache;
+			// rasterized list mode rows, recycled while scrolling
 		BPose *fDropTarget;
 		bool fDropTargetWasSelected;
 		BLooper *fSelectionHandler;
@@ -654,6 +688,7 @@ class BPoseView : public BView {
 		const BPose *fRealPivotPose;
 		BMessageRunner *fKeyRunner;
 		BMessageRunner *fFilterRunner;
+		BMessageRunner *fNodeMonitorRunner;
 
 		bool fSelectionVisible : 1;
 		bool fMultipleSelection : 1;
@@ -671,6 +706,9 @@ class BPoseView : public BView {
 		bool fIsDesktopWindow : 1;
 		bool fIsWatchingDateFormatChange : 1;
 		bool fHasPosesInClipboard : 1;
+		bool fBatchingNodeMonitors : 1;
+			// a batch of node monitors is being applied, drawing and
+			// scroll range updates are done once at the end
 
 		BRect fStartFrame;
 		BRect fSelectionRect;
@@ -685,8 +723,7 @@ class BPoseView : public BView {
 		static char fMatchString[B_FILE_NAME_LENGTH];
 		// used for typeahead - should be replaced by a typeahead state
 
-		// TODO: Get rid of this.
-		static _BWidthBuffer_ *fWidthBuf;
+		static GlyphAdvanceCache *fGlyphCache;
 
 		static OffscreenBitmap *fOffscreen;
 
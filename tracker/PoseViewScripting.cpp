@@ -52,6 +52,7 @@ All rights reserved.
 #define kPosesSuites "suite/vnd.Be-TrackerPoses"
 
 #define kPropertyPath "Path"
+#define kPropertyNodeMonitorCounts "NodeMonitorCounts"
 
 // notes on PoseView scripting interface:
 // Indices and entry_refs are used to specify poses; In the case of indices
@@ -69,6 +70,7 @@ All rights reserved.
 #if 0
 doo Tracker get Suites of Poses of Window test
 doo Tracker get Path of Poses of Window test
+doo Tracker get NodeMonitorCounts of Poses of Window test
 doo Tracker count Entry of Poses of Window test
 doo Tracker get Entry of Poses of Window test
 doo Tracker get Entry 2 of Poses of Window test
@@ -101,6 +103,16 @@ const property_info kPosesPropertyList[] = {
 		{},
 		{}
 	},
+	{	kPropertyNodeMonitorCounts,
+		{ B_GET_PROPERTY },
+		{ B_DIRECT_SPECIFIER },
+		"get NodeMonitorCounts of ... # returns the number of node monitor "
+			"messages received and the number applied after coalescing",
+		0,
+		{ B_INT64_TYPE },
+		{},
+		{}
+	},
 	{	kPropertyEntry,
 		{ B_COUNT_PROPERTIES },
 		{ B_DIRECT_SPECIFIER },
@@ -496,6 +508,15 @@ BPoseView::GetProperty(BMessage *specifier, int32 form, const char *property,
 			else 
 				reply->AddRef("result", TargetModel()->EntryRef());
 		}
+	} else if (strcmp(property, kPropertyNodeMonitorCounts) == 0) {
+		if (form == B_DIRECT_SPECIFIER) {
+			handled = true;
+			int64 raw;
+			int64 delivered;
+			GetNodeMonitorCounts(&raw, &delivered);
+			reply->AddInt64("result", raw);
+			reply->AddInt64("result", delivered);
+		}
 	} else if (strcmp(property, kPropertySelection) == 0) {
 		int32 count = fSelectionList->CountItems();
 		switch (form) {
@@ -49,9 +49,13 @@ All rights reserved.
 #include "MimeTypeList.h"
 #include "MimeTypes.h"
 #include "QueryPoseView.h"
+#include "QueryResultSnapshot.h"
 #include "Tracker.h"
 
 #include <fs_attr.h>
+#include <parsedate.h>
+#include <stddef.h>
+#include <string.h>
 
 // Currently filtering out Trash doesn't node monitor too well - if you
 // remove an item from the Trash, it doesn't show up in the query result
@@ -65,7 +69,9 @@ BQueryPoseView::BQueryPoseView(Model *model, BRect frame, uint32 resizeMask)
 		fShowResultsFromTrash(false),
 		fQueryList(NULL),
 		fQueryListContainer(NULL),
-		fCreateOldPoseList(false)
+		fCreateOldPoseList(false),
+		fLastRefreshTime(0),
+		fResultsChanged(false)
 {
 }
 
@@ -84,6 +90,21 @@ BQueryPoseView::MessageReceived(BMessage *message)
 			UpdatePosesClipboardModeFromClipboard(message);
 			break;
 		}
+
+		case B_QUERY_UPDATE:
+			fResultsChanged = true;
+			_inherited::MessageReceived(message);
+			break;
+
+		case B_NODE_MONITOR:
+		{
+			int32 opcode;
+			if (message->FindInt32("opcode", &opcode) == B_OK
+				&& (opcode == B_ENTRY_REMOVED || opcode == B_ENTRY_MOVED))
+				fResultsChanged = true;
+			_inherited::MessageReceived(message);
+			break;
+		}
 		
 		default:
 			_inherited::MessageReceived(message);
@@ -138,6 +159,23 @@ BQueryPoseView::RestoreState(const BMessage &message)
 	fViewState->SetViewMode(kListMode);
 }
 
+void
+BQueryPoseView::SaveState(AttributeStreamNode *node)
+{
+	_inherited::SaveState(node);
+
+	// remember the results for the next time the query gets opened;
+	// not while they are still coming in
+	if (!fResultsChanged || !fQueryListContainer || !fAddPosesThreads.empty())
+		return;
+
+	BNode queryFile(TargetModel()->EntryRef());
+	if (queryFile.InitCheck() == B_OK
+		&& QueryResultSnapshot::Write(&queryFile,
+			fQueryListContainer->Predicate(), fPoseList) == B_OK)
+		fResultsChanged = false;
+}
+
 void 
 BQueryPoseView::SavePoseLocations(BRect *)
 {
@@ -158,6 +196,13 @@ BQueryPoseView::Refresh()
 {
 	PRINT(("refreshing dynamic date query\n"));
 
+	// only the dynamic dates of the query change with time, try to just
+	// apply the difference that makes; not while the results are still
+	// coming in though
+	if (fQueryListContainer && fAddPosesThreads.empty()
+		&& RefreshIncrementally())
+		return;
+
 	// cause the old AddPosesTask to die
 	fAddPosesThreads.clear();
 	delete fQueryListContainer;
@@ -171,6 +216,174 @@ BQueryPoseView::Refresh()
 	ResetPosePlacementHint();
 }
 
+struct DynamicDateTerm {
+	// a <stat time attribute> <comparison> %<date>% part of a query
+	BString attribute;
+	BString op;
+	BString date;
+};
+
+static bool
+ParseDynamicDateTerms(const char *predicate, BObjectList<DynamicDateTerm> *terms)
+{
+	// collects all the date comparisons of <predicate>; only works for
+	// queries where every term has to match and all the dates are
+	// compared against stat times we keep in the Model, returns false
+	// for everything else
+	for (const char *scan = predicate; *scan; scan++) {
+		switch (*scan) {
+			case '"':
+				// skip strings, they may contain anything
+				for (scan++; *scan && *scan != '"'; scan++)
+					if (*scan == '\\' && scan[1])
+						scan++;
+				if (!*scan)
+					return false;
+				break;
+
+			case '|':
+				return false;
+
+			case '!':
+				if (scan[1] != '=')
+					return false;
+				break;
+
+			case '%':
+			{
+				const char *dateEnd = strchr(scan + 1, '%');
+				if (!dateEnd)
+					return false;
+
+				// walk back over the operator and the attribute name
+				const char *opEnd = scan;
+				while (opEnd > predicate && opEnd[-1] == ' ')
+					opEnd--;
+				const char *opStart = opEnd;
+				while (opStart > predicate && strchr("<>=!", opStart[-1]))
+					opStart--;
+				const char *nameEnd = opStart;
+				while (nameEnd > predicate && nameEnd[-1] == ' ')
+					nameEnd--;
+				const char *nameStart = nameEnd;
+				while (nameStart > predicate
+					&& !strchr("( &", nameStart[-1]))
+					nameStart--;
+
+				DynamicDateTerm *term = new DynamicDateTerm;
+				term->attribute.SetTo(nameStart, nameEnd - nameStart);
+				term->op.SetTo(opStart, opEnd - opStart);
+				term->date.SetTo(scan + 1, dateEnd - scan - 1);
+				terms->AddItem(term);
+
+				if ((term->attribute != "last_modified"
+						&& term->attribute != "created")
+					|| (term->op != "<" && term->op != "<="
+						&& term->op != ">" && term->op != ">="))
+					return false;
+
+				scan = dateEnd;
+				break;
+			}
+		}
+	}
+
+	return terms->CountItems() > 0;
+}
+
+static time_t
+StatTime(const Model *model, const DynamicDateTerm *term)
+{
+	if (term->attribute == "created")
+		return model->StatBuf()->st_crtime;
+
+	return model->StatBuf()->st_mtime;
+}
+
+static bool
+MatchesDate(time_t value, const DynamicDateTerm *term, time_t date)
+{
+	if (term->op == "<")
+		return value < date;
+	if (term->op == "<=")
+		return value <= date;
+	if (term->op == ">")
+		return value > date;
+
+	return value >= date;
+}
+
+bool
+BQueryPoseView::RefreshIncrementally()
+{
+	BObjectList<DynamicDateTerm> terms(5, true);
+	BString predicate(fQueryListContainer->Predicate());
+	if (!ParseDynamicDateTerms(predicate.String(), &terms))
+		return false;
+
+	time_t now = time(0);
+	int32 termCount = terms.CountItems();
+	time_t *oldDates = new time_t[termCount];
+	time_t *newDates = new time_t[termCount];
+	for (int32 index = 0; index < termCount; index++) {
+		oldDates[index] = parsedate(terms.ItemAt(index)->date.String(),
+			fLastRefreshTime);
+		newDates[index] = parsedate(terms.ItemAt(index)->date.String(), now);
+	}
+
+	// remove everything that aged out, judging by the stat times the
+	// models keep up to date through node monitoring
+	BObjectList<node_ref> agedOut(20, true);
+	int32 count = fPoseList->CountItems();
+	for (int32 poseIndex = 0; poseIndex < count; poseIndex++) {
+		const Model *model = fPoseList->ItemAt(poseIndex)->TargetModel();
+		for (int32 index = 0; index < termCount; index++) {
+			DynamicDateTerm *term = terms.ItemAt(index);
+			if (!MatchesDate(StatTime(model, term), term, newDates[index])) {
+				agedOut.AddItem(new node_ref(*model->NodeRef()));
+				break;
+			}
+		}
+	}
+
+	for (int32 index = 0; index < agedOut.CountItems(); index++)
+		DeletePose(agedOut.ItemAt(index));
+
+	// entries can only start matching as time goes on if they are
+	// supposed to be older than some date; query just for the time window
+	// between the last refresh and now
+	BString window;
+	for (int32 index = 0; index < termCount; index++) {
+		DynamicDateTerm *term = terms.ItemAt(index);
+		if ((term->op != "<" && term->op != "<=")
+			|| newDates[index] <= oldDates[index])
+			continue;
+
+		if (window.Length())
+			window << "||";
+
+		window << "(" << term->attribute << (term->op == "<" ? ">=" : ">")
+			<< (int32)oldDates[index] << ")";
+	}
+
+	delete [] oldDates;
+	delete [] newDates;
+
+	PRINT(("incremental refresh removed %ld results\n", agedOut.CountItems()));
+
+	fLastRefreshTime = now;
+
+	if (window.Length()) {
+		fDeltaPredicate << "(" << predicate << ")&&(" << window << ")";
+		PRINT(("querying for new results with %s\n", fDeltaPredicate.String()));
+		AddPoses(TargetModel());
+		TargetModel()->CloseNode();
+	}
+
+	ScheduleRefresh();
+	return true;
+}
+
 bool
 BQueryPoseView::ShouldShowPose(const Model *model, const PoseInfo *poseInfo)
 {
@@ -181,6 +394,17 @@ BQueryPoseView::ShouldShowPose(const Model *model, const PoseInfo *poseInfo)
 		&& dynamic_cast<TTracker *>(be_app)->InTrashNode(model->EntryRef()))
 		return false;
 
+	if (fQueryListContainer->Snapshot()) {
+		// a result the snapshot remembered under a stale ref ended up
+		// as a zombie, the live result for the same node replaces it
+		int32 zombieIndex;
+		Model *zombie = FindZombie(model->NodeRef(), &zombieIndex);
+		if (zombie) {
+			fZombieList->RemoveItemAt(zombieIndex);
+			delete zombie;
+		}
+	}
+
 	bool result = _inherited::ShouldShowPose(model, poseInfo);
 
 	PoseList *oldPoseList = fQueryListContainer->OldPoseList();
@@ -194,11 +418,37 @@ BQueryPoseView::ShouldShowPose(const Model *model, const PoseInfo *poseInfo)
 	return result;
 }
 
+void
+BQueryPoseView::ReconcileSnapshot()
+{
+	// the live queries are done, remove what the snapshot showed but
+	// is not a result anymore
+	QueryResultSnapshot *snapshot = fQueryListContainer->Snapshot();
+
+	BObjectList<node_ref> stale(20, true);
+	snapshot->GetUnconfirmed(&stale);
+	int32 count = stale.CountItems();
+	for (int32 index = 0; index < count; index++)
+		// also takes care of the zombies of refs that went away
+		DeletePose(stale.ItemAt(index));
+
+	PRINT(("result snapshot: %ld stale, %ld new results\n", count,
+		snapshot->CountUnknown()));
+
+	if (count || snapshot->CountUnknown())
+		fResultsChanged = true;
+
+	fQueryListContainer->SetSnapshot(NULL);
+}
+
 void 
 BQueryPoseView::AddPosesCompleted()
 {
 	ASSERT(Window()->IsLocked());
 
+	if (fQueryListContainer && fQueryListContainer->Snapshot())
+		ReconcileSnapshot();
+
 	PoseList *oldPoseList = fQueryListContainer->OldPoseList();
 	if (oldPoseList) {
 		int32 count = oldPoseList->CountItems();
@@ -228,6 +478,20 @@ BQueryPoseView::InitDirentIterator(const entry_ref *ref)
 
 	ASSERT(sourceModel.IsQuery());
 
+	if (fDeltaPredicate.Length()) {
+		// an incremental refresh, run the narrowed down query once; the
+		// live queries of the full result set stay in place
+		QueryEntryListCollection *result = new QueryEntryListCollection(
+			&sourceModel, NULL, NULL, fDeltaPredicate.String());
+		fDeltaPredicate = "";
+
+		if (result->InitCheck() != B_OK) {
+			delete result;
+			return NULL;
+		}
+		return result;
+	}
+
 	// old pose list is used for finding poses that no longer match a
 	// dynamic date query during a Refresh call
 	PoseList *oldPoseList = NULL;
@@ -236,6 +500,8 @@ BQueryPoseView::InitDirentIterator(const entry_ref *ref)
 		oldPoseList->AddList(fPoseList);
 	}
 
+	bool firstOpen = !fCreateOldPoseList && !fPoseList->CountItems();
+
 	fQueryListContainer = new QueryEntryListCollection(&sourceModel, this, oldPoseList);
 	fCreateOldPoseList = false;
 	
@@ -244,6 +510,18 @@ BQueryPoseView::InitDirentIterator(const entry_ref *ref)
 		fQueryListContainer = NULL;
 		return NULL;
 	}
+
+	if (firstOpen) {
+		// show what the query found last time right away
+		QueryResultSnapshot *snapshot = new QueryResultSnapshot;
+		if (snapshot->Read(sourceModel.Node(), fQueryListContainer->Predicate())
+				== B_OK)
+			fQueryListContainer->SetSnapshot(snapshot);
+		else {
+			delete snapshot;
+			fResultsChanged = true;
+		}
+	}
 	
 	fShowResultsFromTrash = fQueryListContainer->ShowResultsFromTrash();
 
@@ -251,7 +529,16 @@ BQueryPoseView::InitDirentIterator(const entry_ref *ref)
 		| B_WATCH_ATTR, this);
 
 	fQueryList = fQueryListContainer->QueryList();
+	fLastRefreshTime = time(0);
+
+	ScheduleRefresh();
 	
+	return fQueryListContainer->Clone();
+}
+
+void
+BQueryPoseView::ScheduleRefresh()
+{
 	if (fQueryListContainer->DynamicDateQuery()) {
 
 		// calculate the time to trigger the query refresh - next midnight
@@ -316,8 +603,6 @@ BQueryPoseView::InitDirentIterator(const entry_ref *ref)
 		tracker->MainTaskLoop()->RunLater(
 			NewLockingFunctionObject(this, &BQueryPoseView::Refresh), delta);
 	}
-	
-	return fQueryListContainer->Clone();
 }
 
 uint32 
@@ -365,8 +650,9 @@ BQueryPoseView::ActiveOnDevice(dev_t device) const
 }
 
 QueryEntryListCollection::QueryEntryListCollection(Model *model, BHandler *target,
-	PoseList *oldPoseList)
-	:	fQueryListRep(new QueryListRep(new BObjectList<BQuery>(5, true)))
+	PoseList *oldPoseList, const char *predicate)
+	:	fQueryListRep(new QueryListRep(new BObjectList<BQuery>(5, true))),
+		fMergeQueue(NULL)
 {
 	Rewind();
 	attr_info info;
@@ -398,7 +684,8 @@ QueryEntryListCollection::QueryEntryListCollection(Model *model, BHandler *targe
 		&MoreOptionsStruct::EndianSwap) != kReadAttrFailed) 
 		fQueryListRep->fShowResultsFromTrash = saveMoreOptions.searchTrash;
 	
-	fStatus = query.SetPredicate(buffer.String());
+	fQueryListRep->fPredicate = predicate ? predicate : buffer.String();
+	fStatus = query.SetPredicate(fQueryListRep->fPredicate.String());
 	
 	fQueryListRep->fOldPoseList = oldPoseList;
 	fQueryListRep->fDynamicDateQuery = false;
@@ -493,7 +780,8 @@ QueryEntryListCollection::FetchOneQuery(const BQuery *copyThis,
 	const_cast<BQuery *>(copyThis)->GetPredicate(&buffer);
 	query->SetPredicate(buffer.String());
 
-	query->SetTarget(BMessenger(target));
+	if (target)
+		query->SetTarget(BMessenger(target));
 	query->SetVolume(volume);
 	
 	status_t result = query->Fetch();
@@ -502,12 +790,15 @@ QueryEntryListCollection::FetchOneQuery(const BQuery *copyThis,
 		return result;
 	}
 	list->AddItem(query);
+	fQueryListRep->fQueryVolumes.push_back(volume->Device());
 
 	return B_OK;
 }
 
 QueryEntryListCollection::~QueryEntryListCollection()
 {
+	ReleaseMergeQueue();
+
 	if (fQueryListRep->CloseQueryList()) 
 		delete fQueryListRep;
 }
@@ -522,7 +813,8 @@ QueryEntryListCollection::Clone()
 QueryEntryListCollection::QueryEntryListCollection(
 	const QueryEntryListCollection &cloneThis)
 	:	EntryListBase(),
-		fQueryListRep(cloneThis.fQueryListRep)
+		fQueryListRep(cloneThis.fQueryListRep),
+		fMergeQueue(NULL)
 {
 	// only to be used by the Clone routine
 }
@@ -535,9 +827,40 @@ QueryEntryListCollection::ClearOldPoseList()
 }
 
 
+QueryMergeQueue *
+QueryEntryListCollection::MergeQueue()
+{
+	if (fQueryListRep->fQueryList->CountItems() < 2)
+		return NULL;
+
+	if (!fMergeQueue)
+		fMergeQueue = new QueryMergeQueue(fQueryListRep);
+
+	return fMergeQueue;
+}
+
+void
+QueryEntryListCollection::ReleaseMergeQueue()
+{
+	if (!fMergeQueue)
+		return;
+
+	fMergeQueue->Release();
+	fMergeQueue = NULL;
+}
+
 status_t 
 QueryEntryListCollection::GetNextEntry(BEntry *entry, bool traverse)
 {
+	if (MergeQueue()) {
+		entry_ref ref;
+		status_t result = GetNextRef(&ref);
+		if (result != B_OK)
+			return result;
+
+		return entry->SetTo(&ref, traverse);
+	}
+
 	status_t result = B_ERROR;
 	
 	for (int32 count = fQueryListRep->fQueryList->CountItems();
@@ -551,10 +874,47 @@ QueryEntryListCollection::GetNextEntry(BEntry *entry, bool traverse)
 	return result;
 }
 
+void
+QueryEntryListCollection::SetSnapshot(QueryResultSnapshot *snapshot)
+{
+	delete fQueryListRep->fSnapshot;
+	fQueryListRep->fSnapshot = snapshot;
+}
+
 int32 
 QueryEntryListCollection::GetNextDirents(struct dirent *buffer, size_t length,
 	int32 count)
 {
+	QueryResultSnapshot *snapshot = fQueryListRep->fSnapshot;
+	if (!snapshot)
+		return GetNextQueryDirents(buffer, length, count);
+
+	if (snapshot->GetNextDirent(buffer, length) == B_OK)
+		return 1;
+
+	// skip the results the snapshot already handed out
+	for (;;) {
+		int32 result = GetNextQueryDirents(buffer, length, count);
+		if (result <= 0)
+			return result;
+
+		result = snapshot->FilterKnown(buffer, result);
+		if (result > 0)
+			return result;
+	}
+}
+
+int32 
+QueryEntryListCollection::GetNextQueryDirents(struct dirent *buffer,
+	size_t length, int32 count)
+{
+	QueryMergeQueue *mergeQueue = MergeQueue();
+	if (mergeQueue) {
+		// hand out one result at a time, that is all the add poses
+		// task asks for anyway
+		return mergeQueue->GetNextDirent(buffer, length) == B_OK ? 1 : 0;
+	}
+
 	int32 result = 0;
 
 	for (int32 queryCount = fQueryListRep->fQueryList->CountItems();
@@ -572,6 +932,19 @@ QueryEntryListCollection::GetNextDirents(struct dirent *buffer, size_t length,
 status_t 
 QueryEntryListCollection::GetNextRef(entry_ref *ref)
 {
+	QueryMergeQueue *mergeQueue = MergeQueue();
+	if (mergeQueue) {
+		char buffer[sizeof(struct dirent) + B_FILE_NAME_LENGTH];
+		struct dirent *dirent = (struct dirent *)buffer;
+		status_t result = mergeQueue->GetNextDirent(dirent, sizeof(buffer));
+		if (result != B_OK)
+			return result;
+
+		ref->device = dirent->d_pdev;
+		ref->directory = dirent->d_pino;
+		return ref->set_name(dirent->d_name);
+	}
+
 	status_t result = B_ERROR;
 	
 	for (int32 count = fQueryListRep->fQueryList->CountItems();
@@ -591,6 +964,7 @@ status_t
 QueryEntryListCollection::Rewind()
 {
 	fQueryListRep->fQueryListIndex = 0;
+	ReleaseMergeQueue();
 	
 	return B_OK;
 }
@@ -625,3 +999,187 @@ QueryEntryListCollection::DynamicDateRefreshEveryMinute() const
 	return fQueryListRep->fRefreshEveryMinute;
 }
 
+
+
+QueryMergeQueue::QueryMergeQueue(QueryEntryListCollection::QueryListRep *rep)
+	:	fQueryListRep(rep),
+		fLock("queryMergeLock"),
+		fFirst(0),
+		fCount(0),
+		fFreeSlots(create_sem(kQueueSize, "queryMergeSlots")),
+		fResults(create_sem(0, "queryMergeResults")),
+		fActiveDrainers(0),
+		fReferences(1),
+		fQuitting(false),
+		fDrainers(rep->fQueryList->CountItems(), true)
+{
+	// the queries have to stay around until the last drainer is done
+	BObjectList<BQuery> *queryList = fQueryListRep->OpenQueryList();
+	const std::vector<dev_t> &volumes = fQueryListRep->fQueryVolumes;
+
+	int32 count = queryList->CountItems();
+	for (int32 index = 0; index < count; index++) {
+		Drainer *drainer = new Drainer;
+		drainer->queue = this;
+		drainer->query = queryList->ItemAt(index);
+		drainer->volume = index < (int32)volumes.size() ? volumes[index] : -1;
+		drainer->thread = spawn_thread(&QueryMergeQueue::DrainQuery,
+			"QueryDrainer", B_NORMAL_PRIORITY, drainer);
+
+		if (drainer->thread < B_OK) {
+			delete drainer;
+			continue;
+		}
+
+		fDrainers.AddItem(drainer);
+		fActiveDrainers++;
+		fReferences++;
+	}
+
+	for (int32 index = 0; index < fDrainers.CountItems(); index++)
+		resume_thread(fDrainers.ItemAt(index)->thread);
+}
+
+QueryMergeQueue::~QueryMergeQueue()
+{
+	delete_sem(fFreeSlots);
+	delete_sem(fResults);
+
+	if (fQueryListRep->CloseQueryList())
+		delete fQueryListRep;
+}
+
+void
+QueryMergeQueue::Release()
+{
+	// don't wait for the drainers, one may be stuck reading a slow
+	// volume; wake up the ones waiting for a free slot, they see
+	// fQuitting and bail out, the others do once their read returns
+	fQuitting = true;
+	release_sem_etc(fFreeSlots, fDrainers.CountItems(), 0);
+
+	ReleaseReference();
+}
+
+void
+QueryMergeQueue::ReleaseReference()
+{
+	if (atomic_add(&fReferences, -1) == 1)
+		delete this;
+}
+
+status_t
+QueryMergeQueue::DrainQuery(void *castToDrainer)
+{
+	Drainer *drainer = (Drainer *)castToDrainer;
+	QueryMergeQueue *queue = drainer->queue;
+
+	bigtime_t start = system_time();
+	bigtime_t firstResult = -1;
+	int32 count = 0;
+
+	char buffer[4096];
+	while (!queue->fQuitting) {
+		int32 direntCount = drainer->query->GetNextDirents(
+			(struct dirent *)buffer, sizeof(buffer), 16);
+		if (direntCount <= 0)
+			break;
+
+		if (firstResult < 0)
+			firstResult = system_time() - start;
+
+		struct dirent *dirent = (struct dirent *)buffer;
+		for (int32 index = 0; index < direntCount; index++) {
+			if (!queue->Push(dirent))
+				break;
+
+			count++;
+			dirent = (struct dirent *)((char *)dirent + dirent->d_reclen);
+		}
+	}
+
+	queue->DrainerDone(drainer, count, firstResult, system_time() - start);
+	queue->ReleaseReference();
+	return B_OK;
+}
+
+bool
+QueryMergeQueue::Push(const struct dirent *dirent)
+{
+	if (acquire_sem(fFreeSlots) != B_OK || fQuitting)
+		return false;
+
+	{
+		AutoLock<Benaphore> lock(fLock);
+		Result *result = &fQueue[(fFirst + fCount) % kQueueSize];
+		result->device = dirent->d_dev;
+		result->node = dirent->d_ino;
+		result->dirDevice = dirent->d_pdev;
+		result->directory = dirent->d_pino;
+		strncpy(result->name, dirent->d_name, B_FILE_NAME_LENGTH);
+		result->name[B_FILE_NAME_LENGTH - 1] = '\0';
+		fCount++;
+	}
+
+	release_sem(fResults);
+	return true;
+}
+
+void
+QueryMergeQueue::DrainerDone(const Drainer *drainer, int32 count,
+	bigtime_t firstResult, bigtime_t elapsed)
+{
+	PRINT(("query on volume %ld: %ld results, first after %Ld usec, "
+		"done after %Ld usec\n", drainer->volume, count, firstResult, elapsed));
+
+	{
+		AutoLock<Benaphore> lock(fLock);
+		fActiveDrainers--;
+	}
+
+	// wake up the consumer in case it is waiting for us
+	release_sem(fResults);
+}
+
+status_t
+QueryMergeQueue::GetNextDirent(struct dirent *buffer, size_t length)
+{
+	for (;;) {
+		{
+			AutoLock<Benaphore> lock(fLock);
+			if (!fCount && !fActiveDrainers)
+				return B_ENTRY_NOT_FOUND;
+		}
+
+		if (acquire_sem(fResults) != B_OK)
+			return B_ENTRY_NOT_FOUND;
+
+		AutoLock<Benaphore> lock(fLock);
+		if (!fCount)
+			// a drainer finished, see if there is more to come
+			continue;
+
+		Result *result = &fQueue[fFirst];
+		size_t nameLength = strlen(result->name);
+		if (offsetof(struct dirent, d_name) + nameLength + 1 > length) {
+			// should not happen, our callers all pass room for a full name
+			TRESPASS();
+			return B_BUFFER_OVERFLOW;
+		}
+
+		buffer->d_dev = result->device;
+		buffer->d_ino = result->node;
+		buffer->d_pdev = result->dirDevice;
+		buffer->d_pino = result->directory;
+		buffer->d_reclen = (unsigned short)(offsetof(struct dirent, d_name)
+			+ nameLength + 1);
+		memcpy(buffer->d_name, result->name, nameLength + 1);
+
+		fFirst = (fFirst + 1) % kQueueSize;
+		fCount--;
+		lock.Unlock();
+
+		release_sem(fFreeSlots);
+		return B_OK;
+	}
+}
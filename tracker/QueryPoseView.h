@@ -37,6 +37,8 @@ All rights reserved.
 
 class BQuery;
 
+#include <vector>
+
 #include "EntryIterator.h"
 #include "PoseView.h"
 
@@ -44,6 +46,8 @@ namespace BPrivate {
 
 class BQueryContainerWindow;
 class QueryEntryListCollection;
+class QueryMergeQueue;
+class QueryResultSnapshot;
 
 class BQueryPoseView : public BPoseView {
 public:
@@ -66,6 +70,7 @@ protected:
 	virtual void AttachedToWindow();
 	virtual void RestoreState(AttributeStreamNode *);
 	virtual void RestoreState(const BMessage &);
+	virtual void SaveState(AttributeStreamNode *);
 	virtual void SavePoseLocations(BRect * = NULL);
 	virtual void SetUpDefaultColumnsIfNeeded();
 	virtual void SetViewMode(uint32);
@@ -77,6 +82,13 @@ protected:
 	virtual void AddPosesCompleted();
 
 private:
+	bool RefreshIncrementally();
+		// removes results that aged out and adds the ones that started
+		// matching since the last refresh; returns false if the query
+		// is too complex for that and has to be run again as a whole
+	void ScheduleRefresh();
+	void ReconcileSnapshot();
+
 		// list of all the queries this PoseView represents
 		// typically there will be one query per volume specified
 		// QueryEntryListCollection provides the abstraction layer
@@ -89,6 +101,13 @@ private:
 	
 	bool fCreateOldPoseList;
 
+	time_t fLastRefreshTime;
+		// the time the dynamic dates of the current results are based on
+	BString fDeltaPredicate;
+		// if set, the next InitDirentIterator only runs this query once
+	bool fResultsChanged;
+		// since the result snapshot was read, written or looked for
+
 	typedef BPoseView _inherited;
 };
 
@@ -106,19 +125,23 @@ class QueryEntryListCollection : public EntryListBase {
 			:	fQueryList(queryList),
 				fRefCount(0),
 				fShowResultsFromTrash(0),
-				fOldPoseList(NULL)
+				fOldPoseList(NULL),
+				fSnapshot(NULL)
 			{}
 	
 		~QueryListRep()
 			{
 				ASSERT(fRefCount <= 0);
+				delete fSnapshot;
 				delete fQueryList;
 				delete fOldPoseList;
 			}
 	
 		BObjectList<BQuery> *OpenQueryList()
 			{
-				fRefCount++;
+				// merge queue drainers hold references from their own
+				// threads
+				atomic_add(&fRefCount, 1);
 				return fQueryList;
 			}
 	
@@ -138,11 +161,22 @@ class QueryEntryListCollection : public EntryListBase {
 		PoseList *fOldPoseList;
 			// when doing a Refresh, this list is used to detect poses that
 			// are no longer a part of a fDynamicDateQuery and need to be removed
+
+		BString fPredicate;
+
+		std::vector<dev_t> fQueryVolumes;
+			// volume of each query in fQueryList
+		QueryResultSnapshot *fSnapshot;
+			// results remembered from last time, handed out before the
+			// ones of the live queries
 	};
 
 public:
 
-	QueryEntryListCollection(Model *, BHandler * = NULL, PoseList *oldPoseList = NULL);
+	QueryEntryListCollection(Model *, BHandler * = NULL, PoseList *oldPoseList = NULL,
+		const char *predicate = NULL);
+		// if <predicate> is passed it is used instead of the one stored
+		// in the query file
 	virtual ~QueryEntryListCollection();
 
 	QueryEntryListCollection *Clone();
@@ -152,6 +186,14 @@ public:
 
 	PoseList *OldPoseList() const
 		{ return fQueryListRep->fOldPoseList; }
+	const char *Predicate() const
+		{ return fQueryListRep->fPredicate.String(); }
+
+	QueryResultSnapshot *Snapshot() const
+		{ return fQueryListRep->fSnapshot; }
+	void SetSnapshot(QueryResultSnapshot *);
+		// takes ownership; only GetNextDirents, which is what adding
+		// poses uses, knows about snapshots
 	void ClearOldPoseList();
 	
 	virtual status_t GetNextEntry(BEntry *entry, bool traverse = false);
@@ -172,8 +214,83 @@ private:
 		// only to be used by the Clone routine
 	status_t FetchOneQuery(const BQuery *, BHandler *target,
 		BObjectList<BQuery> *, BVolume *);
+	QueryMergeQueue *MergeQueue();
+		// returns NULL if there is only one query to drain
+	void ReleaseMergeQueue();
+	int32 GetNextQueryDirents(struct dirent *buffer, size_t length,
+		int32 count);
 
 	QueryListRep *fQueryListRep;
+	QueryMergeQueue *fMergeQueue;
+		// set up on first use if there is more than one query, every
+		// clone drains through its own
+
+	friend class QueryMergeQueue;
+};
+
+
+class QueryMergeQueue {
+	// drains a number of queries at the same time, one thread per query,
+	// and hands out their results in the order they come in, so a slow
+	// volume does not hold up the results of a fast one; the queue is
+	// bounded, the drainers block when the consumer falls behind
+	//
+	// the drainers are never waited for, each of them holds a reference
+	// to the queue and the queue holds one to the query list, so whoever
+	// is done last tears it all down
+public:
+	QueryMergeQueue(QueryEntryListCollection::QueryListRep *);
+
+	void Release();
+		// drops the consumer's reference, stops the drainers as soon as
+		// their current read returns
+
+	status_t GetNextDirent(struct dirent *buffer, size_t length);
+		// blocks until a result is available; returns B_ENTRY_NOT_FOUND
+		// once all queries are exhausted
+
+private:
+	~QueryMergeQueue();
+		// only through Release()
+
+	struct Drainer {
+		QueryMergeQueue *queue;
+		BQuery *query;
+		dev_t volume;
+		thread_id thread;
+	};
+
+	struct Result {
+		dev_t device;
+		ino_t node;
+		dev_t dirDevice;
+		ino_t directory;
+		char name[B_FILE_NAME_LENGTH];
+	};
+
+	enum {
+		kQueueSize = 128
+	};
+
+	static status_t DrainQuery(void *);
+	bool Push(const struct dirent *);
+	void DrainerDone(const Drainer *, int32 count, bigtime_t firstResult,
+		bigtime_t elapsed);
+	void ReleaseReference();
+
+	QueryEntryListCollection::QueryListRep *fQueryListRep;
+	Benaphore fLock;
+	Result fQueue[kQueueSize];
+	int32 fFirst;
+	int32 fCount;
+	sem_id fFreeSlots;
+	sem_id fResults;
+		// released once for every result and once for every finished
+		// drainer
+	int32 fActiveDrainers;
+	int32 fReferences;
+	volatile bool fQuitting;
+	BObjectList<Drainer> fDrainers;
 };
 
 } // namespace BPrivate
@@ -0,0 +1,322 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+#include <Debug.h>
+#include <Message.h>
+#include <Volume.h>
+#include <fs_attr.h>
+
+#include <algorithm>
+
+#include <dirent.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "Attributes.h"
+#include "Model.h"
+#include "Pose.h"
+#include "PoseList.h"
+#include "QueryResultSnapshot.h"
+#include "Utilities.h"
+
+const uint32 kQueryResultSnapshotMagic = 'QRsn';
+const size_t kMaxQueryResultSnapshotSize = 16 * 1024 * 1024;
+	// sanity limit, a few hundred thousand results
+
+
+QueryResultSnapshot::QueryResultSnapshot()
+	:	fNextEntry(0),
+		fUnknownCount(0)
+{
+}
+
+status_t
+QueryResultSnapshot::Read(const BNode *queryFile, const char *predicate)
+{
+	fEntries.clear();
+	fNames.clear();
+	fNextEntry = 0;
+	fUnknownCount = 0;
+
+	// a snapshot of the other endianness is just ignored, the query
+	// writes a new one when it is closed
+	attr_info info;
+	if (queryFile->GetAttrInfo(kAttrQueryResultSnapshot, &info) != B_OK)
+		return B_ENTRY_NOT_FOUND;
+
+	if (info.size < (off_t)sizeof(Header)
+		|| info.size > (off_t)kMaxQueryResultSnapshotSize)
+		return B_BAD_DATA;
+
+	char *buffer = new char [info.size];
+	ssize_t result = queryFile->ReadAttr(kAttrQueryResultSnapshot, B_RAW_TYPE,
+		0, buffer, info.size);
+
+	Header header;
+	memcpy(&header, buffer, sizeof(Header));
+
+	BMessage message;
+	if (result != info.size
+		|| header.magic != kQueryResultSnapshotMagic
+		|| header.infoSize > (size_t)info.size - sizeof(Header)
+		|| message.Unflatten(buffer + sizeof(Header)) != B_OK) {
+		delete [] buffer;
+		return B_BAD_DATA;
+	}
+
+	const char *snapshotPredicate;
+	if (message.FindString("predicate", &snapshotPredicate) != B_OK
+		|| strcmp(snapshotPredicate, predicate) != 0) {
+		PRINT(("ignoring result snapshot taken for a different query\n"));
+		delete [] buffer;
+		return B_BAD_DATA;
+	}
+
+	// device numbers change between boots, find the current ones
+	std::vector<dev_t> devices;
+	type_code type;
+	int32 volumeCount = 0;
+	message.GetInfo("creationDate", &type, &volumeCount);
+	for (int32 index = 0; index < volumeCount; index++) {
+		BVolume volume;
+		if (MatchArchivedVolume(&volume, &message, index) == B_OK)
+			devices.push_back(volume.Device());
+		else
+			devices.push_back(-1);
+	}
+
+	const char *scan = buffer + sizeof(Header) + header.infoSize;
+	const char *end = buffer + info.size;
+	fEntries.reserve(header.count);
+	for (uint32 index = 0; index < header.count; index++) {
+		Record record;
+		if (scan + sizeof(Record) > end)
+			break;
+		memcpy(&record, scan, sizeof(Record));
+		scan += sizeof(Record);
+
+		if (scan + record.nameLength > end)
+			break;
+
+		if (record.volume < devices.size() && devices[record.volume] >= 0) {
+			Entry entry;
+			entry.device = devices[record.volume];
+			entry.node = record.node;
+			entry.directory = record.directory;
+			entry.nameOffset = fNames.size();
+			entry.confirmed = false;
+			fNames.insert(fNames.end(), scan, scan + record.nameLength);
+			fNames.push_back('\0');
+			fEntries.push_back(entry);
+		}
+		scan += record.nameLength;
+	}
+	delete [] buffer;
+
+	std::sort(fEntries.begin(), fEntries.end());
+
+	PRINT(("read result snapshot with %ld entries\n", CountEntries()));
+	return B_OK;
+}
+
+status_t
+QueryResultSnapshot::Write(BNode *queryFile, const char *predicate,
+	const PoseList *poseList)
+{
+	BMessage message;
+	message.AddString("predicate", predicate);
+
+	// volumes are stored in a form that can be matched after a reboot,
+	// records refer to them by index
+	std::vector<dev_t> devices;
+	std::vector<int32> volumeIndices;
+	int32 count = poseList->CountItems();
+	for (int32 index = 0; index < count; index++) {
+		dev_t device = poseList->ItemAt(index)->TargetModel()->NodeRef()->device;
+		if (std::find(devices.begin(), devices.end(), device) != devices.end())
+			continue;
+
+		devices.push_back(device);
+
+		type_code type;
+		int32 before = 0;
+		message.GetInfo("creationDate", &type, &before);
+		BVolume volume(device);
+		EmbedUniqueVolumeInfo(&message, &volume);
+
+		int32 after = 0;
+		message.GetInfo("creationDate", &type, &after);
+		volumeIndices.push_back(after > before ? before : -1);
+	}
+
+	size_t size = sizeof(Header) + message.FlattenedSize();
+	for (int32 index = 0; index < count; index++)
+		size += sizeof(Record)
+			+ strlen(poseList->ItemAt(index)->TargetModel()->Name());
+
+	if (size > kMaxQueryResultSnapshotSize)
+		return B_NO_MEMORY;
+
+	char *buffer = new char [size];
+	Header header;
+	header.magic = kQueryResultSnapshotMagic;
+	header.count = 0;
+	header.infoSize = message.FlattenedSize();
+	message.Flatten(buffer + sizeof(Header), header.infoSize);
+
+	char *scan = buffer + sizeof(Header) + header.infoSize;
+	for (int32 index = 0; index < count; index++) {
+		const Model *model = poseList->ItemAt(index)->TargetModel();
+		int32 volume = volumeIndices[std::find(devices.begin(), devices.end(),
+			model->NodeRef()->device) - devices.begin()];
+		if (volume < 0)
+			continue;
+
+		Record record;
+		memset(&record, 0, sizeof(Record));
+		record.node = model->NodeRef()->node;
+		record.directory = model->EntryRef()->directory;
+		record.volume = (uint16)volume;
+		record.nameLength = (uint16)strlen(model->Name());
+		memcpy(scan, &record, sizeof(Record));
+		scan += sizeof(Record);
+		memcpy(scan, model->Name(), record.nameLength);
+		scan += record.nameLength;
+		header.count++;
+	}
+	memcpy(buffer, &header, sizeof(Header));
+
+	size = scan - buffer;
+	ssize_t result = queryFile->WriteAttr(kAttrQueryResultSnapshot, B_RAW_TYPE,
+		0, buffer, size);
+	delete [] buffer;
+
+	if (result != (ssize_t)size)
+		return result < 0 ? (status_t)result : B_IO_ERROR;
+
+	// nuke opposite endianness
+	queryFile->RemoveAttr(kAttrQueryResultSnapshotForeign);
+	return B_OK;
+}
+
+status_t
+QueryResultSnapshot::GetNextDirent(struct dirent *buffer, size_t length)
+{
+	if (fNextEntry >= CountEntries())
+		return B_ENTRY_NOT_FOUND;
+
+	const Entry &entry = fEntries[fNextEntry];
+	const char *name = &fNames[entry.nameOffset];
+	size_t nameLength = strlen(name);
+	if (offsetof(struct dirent, d_name) + nameLength + 1 > length)
+		return B_BUFFER_OVERFLOW;
+
+	buffer->d_dev = entry.device;
+	buffer->d_ino = entry.node;
+	buffer->d_pdev = entry.device;
+	buffer->d_pino = entry.directory;
+	buffer->d_reclen = (unsigned short)(offsetof(struct dirent, d_name)
+		+ nameLength + 1);
+	memcpy(buffer->d_name, name, nameLength + 1);
+
+	fNextEntry++;
+	return B_OK;
+}
+
+QueryResultSnapshot::Entry *
+QueryResultSnapshot::Find(dev_t device, ino_t node)
+{
+	Entry key;
+	key.device = device;
+	key.node = node;
+	std::vector<Entry>::iterator found
+		= std::lower_bound(fEntries.begin(), fEntries.end(), key);
+	if (found == fEntries.end() || found->device != device
+		|| found->node != node)
+		return NULL;
+
+	return &*found;
+}
+
+int32
+QueryResultSnapshot::FilterKnown(struct dirent *buffer, int32 count)
+{
+	char *source = (char *)buffer;
+	char *dest = (char *)buffer;
+	int32 remaining = 0;
+
+	for (int32 index = 0; index < count; index++) {
+		struct dirent *dirent = (struct dirent *)source;
+		size_t length = dirent->d_reclen;
+		source += length;
+
+		Entry *entry = Find(dirent->d_dev, dirent->d_ino);
+		if (entry) {
+			// either way the live result stands in for the remembered
+			// one, don't let the reconcile pass remove its pose
+			entry->confirmed = true;
+
+			if (entry->directory == dirent->d_pino
+				&& strcmp(&fNames[entry->nameOffset], dirent->d_name) == 0)
+				// handed out under the same ref, its pose is already there
+				continue;
+
+			// renamed or moved since the snapshot was taken, the stale
+			// ref did not make it into a pose, let the live one through
+		}
+
+		if (dest != (char *)dirent)
+			memmove(dest, dirent, length);
+		dest += length;
+		remaining++;
+		fUnknownCount++;
+	}
+
+	return remaining;
+}
+
+void
+QueryResultSnapshot::GetUnconfirmed(BObjectList<node_ref> *result) const
+{
+	for (std::vector<Entry>::const_iterator iterator = fEntries.begin();
+		iterator != fEntries.end(); iterator++) {
+		if (iterator->confirmed)
+			continue;
+
+		node_ref *nodeRef = new node_ref;
+		nodeRef->device = iterator->device;
+		nodeRef->node = iterator->node;
+		result->AddItem(nodeRef);
+	}
+}
@@ -0,0 +1,137 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+//	QueryResultSnapshot remembers the results a saved query had the last
+//	time its window was closed, in a single attribute of the query file.
+//
+//	When the query is opened again the remembered entries are shown right
+//	away while the live query runs; results the snapshot already showed
+//	are not built into Models a second time and entries the query does
+//	not return anymore are removed once it is done.
+
+#ifndef __QUERY_RESULT_SNAPSHOT__
+#define __QUERY_RESULT_SNAPSHOT__
+
+#include <Node.h>
+
+#include <vector>
+
+#include "ObjectList.h"
+
+struct dirent;
+
+namespace BPrivate {
+
+class PoseList;
+
+class QueryResultSnapshot {
+public:
+	QueryResultSnapshot();
+
+	status_t Read(const BNode *queryFile, const char *predicate);
+		// a snapshot taken for a different predicate is ignored, entries
+		// of volumes that are not mounted are dropped
+	static status_t Write(BNode *queryFile, const char *predicate,
+		const PoseList *);
+
+	int32 CountEntries() const;
+
+	status_t GetNextDirent(struct dirent *buffer, size_t length);
+		// hands out the remembered entries, B_ENTRY_NOT_FOUND when done
+	int32 FilterKnown(struct dirent *buffer, int32 count);
+		// drops the live query results the snapshot already handed out
+		// under the same name and directory from <buffer> and marks them
+		// as confirmed; returns how many are left
+	void GetUnconfirmed(BObjectList<node_ref> *) const;
+		// entries the live query did not return
+	int32 CountUnknown() const;
+		// live query results that were not part of the snapshot
+
+private:
+	struct Entry {
+		dev_t device;
+		ino_t node;
+		ino_t directory;
+		uint32 nameOffset;
+		bool confirmed;
+
+		bool operator<(const Entry &other) const
+			{
+				return device < other.device
+					|| (device == other.device && node < other.node);
+			}
+	};
+
+	struct Header {
+		uint32 magic;
+		uint32 count;
+		uint32 infoSize;
+			// size of the flattened message with the predicate and the
+			// volumes, records follow it
+	};
+
+	struct Record {
+		ino_t node;
+		ino_t directory;
+		uint16 volume;
+		uint16 nameLength;
+			// name follows, not terminated
+	};
+
+	Entry *Find(dev_t, ino_t);
+
+	std::vector<Entry> fEntries;
+		// sorted by node_ref
+	std::vector<char> fNames;
+	int32 fNextEntry;
+	int32 fUnknownCount;
+};
+
+inline int32
+QueryResultSnapshot::CountEntries() const
+{
+	return (int32)fEntries.size();
+}
+
+inline int32
+QueryResultSnapshot::CountUnknown() const
+{
+	return fUnknownCount;
+}
+
+} // namespace BPrivate
+
+using namespace BPrivate;
+
+#endif
@@ -0,0 +1,187 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+#include <Bitmap.h>
+#include <Debug.h>
+#include <View.h>
+
+#include "Pose.h"
+#include "PoseView.h"
+#include "RowRenderCache.h"
+
+const int32 kMinCachedRows = 64;
+const int32 kMaxCachedRows = 512;
+
+
+RowRenderCache::RowRenderCache()
+	:	fRows(kMinCachedRows, true),
+		fCapacity(kMinCachedRows),
+		fUseCounter(0)
+{
+}
+
+
+RowRenderCache::~RowRenderCache()
+{
+}
+
+void
+RowRenderCache::SetCapacity(int32 rows)
+{
+	if (rows < kMinCachedRows)
+		rows = kMinCachedRows;
+	if (rows > kMaxCachedRows)
+		rows = kMaxCachedRows;
+
+	fCapacity = rows;
+
+	// drop the least recently used rows if we shrunk
+	while (fRows.CountItems() > fCapacity) {
+		CachedRow *row = Recycle();
+		if (!row)
+			break;
+		fRows.RemoveItem(row);
+	}
+}
+
+RowRenderCache::CachedRow *
+RowRenderCache::Find(const BPose *pose) const
+{
+	std::map<const BPose *, CachedRow *>::const_iterator i
+		= fRowsByPose.find(pose);
+	return i != fRowsByPose.end() ? i->second : NULL;
+}
+
+void
+RowRenderCache::Forget(CachedRow *row)
+{
+	// takes a row that has a pose out of the maps
+	fRowsByPose.erase(row->pose);
+	fRowsByAge.erase(row->lastUse);
+	row->pose = NULL;
+}
+
+RowRenderCache::CachedRow *
+RowRenderCache::Recycle()
+{
+	// returns a row without a pose, one that was invalidated or the least
+	// recently used one if the cache is full
+	if (!fFreeRows.empty()) {
+		CachedRow *row = fFreeRows.back();
+		fFreeRows.pop_back();
+		return row;
+	}
+
+	if (fRows.CountItems() < fCapacity) {
+		CachedRow *row = new CachedRow;
+		row->pose = NULL;
+		fRows.AddItem(row);
+		return row;
+	}
+
+	if (fRowsByAge.empty())
+		return NULL;
+
+	CachedRow *oldest = fRowsByAge.begin()->second;
+	Forget(oldest);
+	return oldest;
+}
+
+void
+RowRenderCache::Invalidate(const BPose *pose)
+{
+	CachedRow *row = Find(pose);
+	if (row) {
+		Forget(row);
+		fFreeRows.push_back(row);
+	}
+}
+
+void
+RowRenderCache::MakeEmpty()
+{
+	fRowsByPose.clear();
+	fRowsByAge.clear();
+	fFreeRows.clear();
+	fRows.MakeEmpty();
+}
+
+bool
+RowRenderCache::Draw(BPose *pose, BRect rowRect, uint32 state, uint32 layout,
+	BPoseView *poseView)
+{
+	BRect bounds(rowRect);
+	bounds.OffsetTo(B_ORIGIN);
+
+	CachedRow *row = Find(pose);
+	bool render = !row || row->state != state || row->layout != layout;
+	if (row)
+		Forget(row);
+	else
+		row = Recycle();
+
+	if (!row)
+		return false;
+
+	BView *offscreenView = row->bitmap.BeginUsing(bounds);
+	if (render) {
+		offscreenView->SetDrawingMode(B_OP_COPY);
+		offscreenView->SetLowColor(poseView->LowColor());
+		offscreenView->SetHighColor(poseView->HighColor());
+		BFont font;
+		poseView->GetFont(&font);
+		offscreenView->SetFont(&font);
+		offscreenView->FillRect(bounds, B_SOLID_LOW);
+
+		BPoint offsetBy(-rowRect.left, -rowRect.top);
+		pose->Draw(rowRect, poseView, offscreenView, true, NULL, offsetBy,
+			pose->IsSelected());
+		offscreenView->Sync();
+
+		row->state = state;
+		row->layout = layout;
+	}
+	row->pose = pose;
+	row->lastUse = ++fUseCounter;
+	fRowsByPose[pose] = row;
+	fRowsByAge[row->lastUse] = row;
+
+	drawing_mode mode = poseView->DrawingMode();
+	poseView->SetDrawingMode(B_OP_COPY);
+	poseView->DrawBitmap(row->bitmap.Bitmap(), bounds, rowRect);
+	poseView->SetDrawingMode(mode);
+	row->bitmap.DoneUsing();
+
+	return true;
+}
@@ -0,0 +1,111 @@
+/*
+Open Tracker License
+
+Terms and Conditions
+
+Copyright (c) 1991-2000, Be Incorporated. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice applies to all licensees
+and shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF TITLE, MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+BE INCORPORATED BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF, OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Except as contained in this notice, the name of Be Incorporated shall not be
+used in advertising or otherwise to promote the sale, use or other dealings in
+this Software without prior written authorization from Be Incorporated.
+
+Tracker(TM), Be(R), BeOS(R), and BeIA(TM) are trademarks or registered trademarks
+of Be Incorporated in the United States and other countries. Other brand product
+names are registered trademarks or trademarks of their respective holders.
+All rights reserved.
+*/
+
+//	RowRenderCache keeps rasterized list mode rows around so that scrolling
+//	back and forth over a list blits rows instead of redrawing icons and
+//	text for every exposed row.
+//
+//	A cached row is keyed by its pose, the pose's draw state (selection,
+//	clipboard mode, window activation) and a stamp of the column layout.
+//	Rows are looked up by pose and recycled least recently used first, both
+//	through maps so that scrolling over long lists doesn't scan the cache.
+//	Poses that change through node monitoring have to be invalidated
+//	explicitly.
+
+#ifndef __ROW_RENDER_CACHE__
+#define __ROW_RENDER_CACHE__
+
+#include <Rect.h>
+
+#include <map>
+#include <vector>
+
+#include "ObjectList.h"
+#include "Utilities.h"
+
+namespace BPrivate {
+
+class BPose;
+class BPoseView;
+
+class RowRenderCache {
+public:
+	RowRenderCache();
+	~RowRenderCache();
+
+	bool Draw(BPose *, BRect rowRect, uint32 state, uint32 layout,
+		BPoseView *);
+		// blits the row of <pose> to rowRect, rendering it first if it is
+		// not cached or stale; returns false if the caller should draw
+		// directly
+
+	void Invalidate(const BPose *);
+	void MakeEmpty();
+
+	void SetCapacity(int32 rows);
+	int32 Capacity() const;
+
+private:
+	struct CachedRow {
+		const BPose *pose;
+		uint32 state;
+		uint32 layout;
+		uint32 lastUse;
+		OffscreenBitmap bitmap;
+	};
+
+	CachedRow *Find(const BPose *) const;
+	CachedRow *Recycle();
+	void Forget(CachedRow *);
+
+	BObjectList<CachedRow> fRows;
+	std::map<const BPose *, CachedRow *> fRowsByPose;
+	std::map<uint32, CachedRow *> fRowsByAge;
+		// both hold the rows that have a pose, keyed by pose and lastUse
+	std::vector<CachedRow *> fFreeRows;
+	int32 fCapacity;
+	uint32 fUseCounter;
+};
+
+inline int32
+RowRenderCache::Capacity() const
+{
+	return fCapacity;
+}
+
+} // namespace BPrivate
+
+using namespace BPrivate;
+
+#endif
@@ -39,6 +39,7 @@ All rights reserved.
 #include "Tracker.h"
 #include "ThreadMagic.h"
 #include "Bitmaps.h"
+#include "FSIOScheduler.h"
 #include "FSStatusWindow.h"
 #include "OverrideAlert.h"
 #include "FSDialogWindow.h"
@@ -86,16 +87,24 @@ TFSContext::initialize() {
 
 	mPause				= false;
 	mActuallyPaused		= false;
-	mAutoPaused		= false;
-	mShouldAutoPause	= true;
+	mWaitingForDevice	= false;
+	mScheduled		= false;
 	mCancel			= false;
 	mSkipOperation		= false;
 	mSkipDirectory		= false;
 	mSkipEntry			= false;
 	
 	mWorkingThread		= 0;
-	mPreviousTimeGuess	= 0;
+	mEstimationSampleTime		= 0;
+	mEstimationSampleOverhead	= 0;
+	mEstimationSampleSize		= 0;
+	mEstimationSampleEntries	= 0;
+	mEntryCost			= 0;
+	mByteCost			= 0;
 	mStartTime			= -1;
+	
+	if (gTrackerSettings.VerifyCopies())
+		DoCopy(fVerifyData);
 }
 
 TFSContext::TFSContext() :
@@ -143,7 +152,19 @@ TFSContext::TFSContext(const entry_ref &in_ref) :
 	initialize();
 }
 
+TFSContext::TFSContext(const fs::EntryList &in_list) :
+				mElapsedStopWatch("", true),
+				mOverheadStopWatch("", true),
+				mEntryList(in_list),
+				mEntryIterator(mEntryList) {
+
+	initialize();
+}
+
 TFSContext::~TFSContext() {
+	if (mScheduled)
+		gIOScheduler().Unregister(*this);
+
 	if (IsConnectedToStatusWindow())
 		gStatusWindow().Remove(*this);
 		
@@ -217,87 +238,89 @@ void
 TFSContext::OperationBegins() {
 	mElapsedStopWatch.Reset();
 	mOverheadStopWatch.Reset();
+	mEstimationSampleTime = mEstimationSampleOverhead = 0;
+	mEstimationSampleSize = 0;
+	mEstimationSampleEntries = 0;
 	mOperationBegun = true;
+
+	if (mScheduled == false) {
+		mScheduled = true;
+		gIOScheduler().Register(*this);
+	}
 }
 
-int32
+int32		// the remaining time is modelled as a cost per entry plus a cost per byte
 TFSContext::EstimatedTimeLeft() {
 
-	static const int32 kMinimalEntryCountForEstimation = 20;
+	static const bigtime_t	kEstimationSampleInterval	= 1000000;
+	static const float		kEstimationSmoothing		= 0.3;		// weight of the newest sample
 
 	if (mProgressInfo.IsTotalEnabled() == false  ||  DidOperationBegin() == false  ||
 		mElapsedStopWatch.ElapsedTime() < 3000000)
 		return 0;
 
-	ASSERT(mProgressInfo.EntryProgress() <= 1		&&  mProgressInfo.EntryProgress() >= 0);
-	ASSERT(mProgressInfo.TotalSizeProgress() <= 1	&&  mProgressInfo.TotalSizeProgress() >= 0);
+	ProgressInfo::Snapshot info;
+	mProgressInfo.GetSnapshot(info);
 
-	float max		= (float)(mProgressInfo.mTotalEntryCount * 2);
+	// the overhead stopwatch is suspended while file data is moved, so the time
+	// it shows goes to the entries and the rest of the elapsed time to the bytes
+	bigtime_t elapsed = mElapsedStopWatch.ElapsedTime();
+	bigtime_t overhead = mOverheadStopWatch.ElapsedTime();
 
-	float current1	= (float)mProgressInfo.mCurrentEntryCount;
-	float weight1 = mProgressInfo.TotalSizeProgress();
-
-	float current2;
-	float weight2;
-
-	if (mProgressInfo.IsTotalSizeProgressEnabled()) {
-	
-		current2 = (float)mProgressInfo.mCurrentSize * mProgressInfo.mTotalEntryCount / mProgressInfo.mTotalSize;
-		weight1 = mProgressInfo.TotalSizeProgress();
-		weight2 = mProgressInfo.EntryProgress();
-		float f = (weight1 + weight2) / 2;
-		weight1 /= f;
-		weight2 /= f;
-	
-		weight1 = powf(weight1, 0.4);
-		weight2 = powf(weight2, 0.4);
-	
-		f = (weight1 + weight2) / 2;
-		weight1 /= f;
-		weight2 /= f;
-	
-		if (mProgressInfo.mTotalEntryCount < kMinimalEntryCountForEstimation) {	// to few files, don't bother
-			current1 = 0;
-			weight1 = 0;
-			weight2 = 2;
+	if (elapsed - mEstimationSampleTime >= kEstimationSampleInterval) {
+		int32 entries = info.mCurrentEntryCount - mEstimationSampleEntries;
+		off_t size = info.mCurrentSize - mEstimationSampleSize;
+		bigtime_t overhead_time = overhead - mEstimationSampleOverhead;
+		bigtime_t copy_time = elapsed - mEstimationSampleTime - overhead_time;
+		
+		if (entries > 0) {
+			float cost = (float)overhead_time / entries;
+			mEntryCost = (mEntryCost == 0) ? cost : mEntryCost + (cost - mEntryCost) * kEstimationSmoothing;
 		}
-	} else {
-		current2 = 0;
-		weight2 = 0;
-		weight1 = 2;
+		
+		if (size > 0  &&  copy_time > 0) {
+			float cost = (float)copy_time / size;
+			mByteCost = (mByteCost == 0) ? cost : mByteCost + (cost - mByteCost) * kEstimationSmoothing;
+		}
+		
+		mEstimationSampleTime = elapsed;
+		mEstimationSampleOverhead = overhead;
+		mEstimationSampleSize = info.mCurrentSize;
+		mEstimationSampleEntries = info.mCurrentEntryCount;
 	}
-	
-	float time = mElapsedStopWatch.ElapsedTime() / 1000000;
-	float guess = time / (current1 * weight1 + current2 * weight2) * max - time;
+
+	int32 entries_left = info.mTotalEntryCount - info.mCurrentEntryCount;
+	off_t size_left = info.mTotalSize - info.mCurrentSize;
+
+	bool bytes_left = info.IsTotalSizeProgressEnabled()  &&  size_left > 0;
+
+	if ((bytes_left  &&  mByteCost == 0)  ||
+		(bytes_left == false  &&  entries_left > 0  &&  mEntryCost == 0))
+		return 0;							// not enough samples yet; until an entry cost is sampled the bytes alone give the estimate
+
+	float guess = mEntryCost * (entries_left > 0 ? entries_left : 0);
+	if (bytes_left)
+		guess += mByteCost * size_left;
+	guess /= 1000000;
 
 #if FS_PRINT_ESTIMATION_INFO
-	printf("elaps: %.1f,\toverh: %.1f,\tprogr: %.2f, %.2f,\tguess: %.1f * %.1f + %.1f * %.1f  = %.1f/%.1f -> \t%.2f\n",
-			(float)(mElapsedStopWatch.ElapsedTime() / 1000000),
-			(float)(mOverheadStopWatch.ElapsedTime() / 1000000),
-			mProgressInfo.EntryProgress(),
-			mProgressInfo.TotalSizeProgress(),
-			current1, weight1, current2, weight2,
-			current1 * weight1 + current2 * weight2, max, guess);
+	printf("elaps: %.1f,\toverh: %.1f,\tprogr: %.2f, %.2f,\tcost: %.0f us/entry, %.3f us/byte -> \t%.2f\n",
+			(float)(elapsed / 1000000),
+			(float)(overhead / 1000000),
+			info.EntryProgress(),
+			info.TotalSizeProgress(),
+			mEntryCost, mByteCost, guess);
 #endif		
 
 	if (guess > 10000  ||  guess < 0)
 		return 0;							// no idea
 
-	if (mPreviousTimeGuess == 0)
-		mPreviousTimeGuess = guess;
-		
-	time = (mPreviousTimeGuess + guess) / 2;
-	mPreviousTimeGuess = guess;
-	
-	return (int32)time;
+	return (int32)guess;
 }
 
 bool
 TFSContext::Pause() {
 
-	mShouldAutoPause = false;
-	mAutoPaused = false;
-	
 	if (mPause) {
 	
 		HardResume();
@@ -366,6 +389,8 @@ TFSContext::CheckCancel() {
 		mOverheadStopWatch.Suspend();
 
 		ReleaseBuffer();
+		if (mScheduled)
+			gIOScheduler().Release(*this);		// let the others use the devices while we sleep
 
 		mWorkingThread = find_thread(0);
 		mActuallyPaused = true;
@@ -373,24 +398,58 @@ TFSContext::CheckCancel() {
 		suspend_thread(mWorkingThread);		// StatusView will call Pause() that will wake the thread up if required
 
 		CheckCancel();						// check again to quickly catch a cancel or skipop if it was blocked by a pause
-	} else if (mShouldAutoPause  &&  mAutoPaused == false) {
-		// should not check again for autopause if it was resumed once
-		
+	} else if (mScheduled  &&  mPause == false) {
+	
 		if (CurrentOperation() == kCalculatingItemsAndSize  ||  RootOperation() != kCopying) {
 			if (mProgressInfo.mTotalEntryCount <= 10)
-				return;
+				return;						// not worth queueing for
 		}
 		
-		if (gStatusWindow().ShouldPause(*this)) {
-			mPause = true;
-			mAutoPaused = true;
-			mOperationStringDirty = true;
-			
-			CheckCancel();		// XXX maybe not usefull here?
+		WaitForDevices();
+	}
+}
+
+void		// blocks until the FSIOScheduler gives us our turn on the devices, wakes up regularly to see if the user wants something
+TFSContext::WaitForDevices() {
+
+	static const bigtime_t kWaitTimeout = 100000;
+
+	off_t left = -1;						// unknown
+	if (mProgressInfo.IsTotalSizeProgressEnabled())
+		left = mProgressInfo.mTotalSize - mProgressInfo.CurrentSize();
+		
+	if (gIOScheduler().Acquire(*this, mProgressInfo.CurrentSize(), left, 0) == B_OK)
+		return;
+
+	{
+		PauseStopWatch				p1(mElapsedStopWatch);
+		PauseStopWatch_ResumeIf 	p2(mOverheadStopWatch, this, &TFSContext::IsEffectiveFileCopyRunning);
+
+		mWaitingForDevice = true;
+		mOperationStringDirty = true;
+
+		while (mCancel == false  &&  mSkipOperation == false  &&  mSkipEntry == false
+			&&  mSkipDirectory == false  &&  mPause == false) {
+
+			if (gIOScheduler().Acquire(*this, mProgressInfo.CurrentSize(), left, kWaitTimeout) == B_OK)
+				break;
 		}
+
+		mWaitingForDevice = false;
+		mOperationStringDirty = true;
 	}
+
+	if (mCancel  ||  mSkipOperation  ||  mSkipEntry  ||  mSkipDirectory  ||  mPause)
+		CheckCancel();						// serve the request, we will queue up again on the next call
 }
 
+bigtime_t
+TFSContext::DeviceWaitTime() const {
+	if (mScheduled == false)
+		return 0;
+
+	return gIOScheduler().WaitTime(*this);
+}
 
 status_t
 TFSContext::SetPoseLocation(ino_t in_dest_dir_inode, BNode &in_dest_node, const BPoint &in_point) {
@@ -572,6 +631,17 @@ TFSContext::DirectoryTrashed(node_ref &in_node) {
 	be_app->PostMessage(&message);
 }
 
+fs::FSContext *
+TFSContext::NewContext() {
+
+	TFSContext *context = new TFSContext();
+	context -> SetInteractive(IsInteractive());
+	if (mProgressInfoEnabled == false)
+		context -> DisableProgressInfo();
+
+	return context;
+}
+
 void
 TFSContext::AboutToDeleteOrTrash(BEntry &entry) {
 
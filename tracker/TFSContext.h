@@ -80,6 +80,7 @@ public:
 	TFSContext(const PoseList &);
 	TFSContext(const BMessage &);
 	TFSContext(const entry_ref &);
+	TFSContext(const fs::EntryList &);
 	~TFSContext();
 	
 	fs::EntryIterator *	NewIterator()		{ return mEntryList.NewIterator(); }
@@ -106,8 +107,8 @@ _IMPEXP_TRACKER		void		DisableProgressInfo()							{ mProgressInfoEnabled = fals
 _IMPEXP_TRACKER		bool		Pause();
 _IMPEXP_TRACKER		bool		IsPauseRequested() const						{ return mPause; }
 _IMPEXP_TRACKER		bool		IsPaused() const								{ return mActuallyPaused; }
-_IMPEXP_TRACKER		bool		IsAutoPaused() const							{ return mAutoPaused; }
-_IMPEXP_TRACKER		void		ContinueAutoPaused() 							{ mShouldAutoPause = false; HardResume(); }
+_IMPEXP_TRACKER		bool		IsWaitingForDevice() const						{ return mWaitingForDevice; }
+_IMPEXP_TRACKER		bigtime_t	DeviceWaitTime() const;
 			
 _IMPEXP_TRACKER		void		SoftResume();
 _IMPEXP_TRACKER		void		HardResume()									{ mPause = false; SoftResume(); }
@@ -158,9 +159,11 @@ private:
 	void		NextEntryCreated(node_ref &, BNode &);
 	void		DirectoryTrashed(node_ref &);
 	void		AboutToDeleteOrTrash(BEntry &);
+	FSContext *	NewContext();
 
 	void		PreparingOperation();
 	void		OperationBegins();
+	void		WaitForDevices();
 
 	bool		IsConnectedToStatusWindow() const				{ return mConnectedToStatusWindow; }
 
@@ -174,18 +177,23 @@ private:
 	point_list_t						mPointList;
 	point_list_t::iterator				mPointListPos;
 	thread_id							mWorkingThread;
-	float								mPreviousTimeGuess;		// to avoid time guess jumping around, make an average of the last two
+	bigtime_t							mEstimationSampleTime;		// where EstimatedTimeLeft() took its last sample
+	bigtime_t							mEstimationSampleOverhead;
+	off_t								mEstimationSampleSize;
+	int32								mEstimationSampleEntries;
+	float								mEntryCost;				// usec spent per entry besides moving data, smoothed
+	float								mByteCost;				// usec spent per byte of file data, smoothed
 	bool								mConnectedToStatusWindow;
 	bool								mInteractive;
 	bool								mProgressInfoEnabled;
 	bool								mOperationBegun;
 	bool								mWasOverheadSWRunning;
 	bool								mOperationStringDirty;
-	bool								mShouldAutoPause;
+	bool								mScheduled;					// registered with the FSIOScheduler
 	
 	bool								mPause;
 	bool								mActuallyPaused;			// pause is only a request, buffer is first emptied. this flag shows wether it is actually paused
-	bool								mAutoPaused;
+	bool								mWaitingForDevice;			// our turn on the source/target device has not come yet
 	bool								mCancel;
 	bool								mSkipOperation;
 	bool								mSkipEntry;
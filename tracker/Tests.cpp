@@ -32,27 +32,42 @@ names are registered trademarks or trademarks of their respective holders.
 All rights reserved.
 */
 
-#if somethingthatisntDEBUG
+#if DEBUG
 
 #include "Defines.h"
 #include "Tests.h"
 
 #include <Debug.h>
+#include <Directory.h>
+#include <File.h>
+#include <FindDirectory.h>
 #include <Locker.h>
+#include <NodeInfo.h>
 #include <Path.h>
 #include <String.h>
 #include <Window.h>
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include "Commands.h"
+#include "ContainerWindow.h"
 #include "EntryIterator.h"
+#include "FSClipboard.h"
 #include "IconCache.h"
+#include "InternedStrings.h"
 #include "Model.h"
+#include "NodeMetadata.h"
 #include "NodeWalker.h"
+#include "PoseView.h"
 #include "StopWatch.h"
+#include "TFSContext.h"
 #include "ThreadMagic.h"
+#include "TrackerFilters.h"
 
 
-
+#if somethingthatisntDEBUG
 
 const char *pathsToSearch[] = {
 //	"/boot/home/config/settings/NetPositive/Bookmarks/",
@@ -318,3 +333,731 @@ RunIconCacheTests()
 }
 
 #endif
+
+
+// Benchmarks; unlike the icon spewer these don't need the contents of
+// the boot volume. They build a synthetic hierarchy in the temp directory
+// and time the hot paths over it, reporting throughput and latency
+// percentiles. Directory loads go through a hidden container window so
+// that the real AddPosesTask gets timed.
+
+struct BenchmarkSettings {
+	int32 depth;
+	int32 directoriesPerDirectory;
+	int32 filesPerDirectory;
+	int32 attributesPerFile;
+	size_t attributeSize;
+	size_t fileSize;
+	int32 repeatCount;
+};
+
+const BenchmarkSettings kDefaultBenchmarkSettings = {
+	3,		// depth
+	4,		// directories per directory
+	200,	// files per directory
+	4,		// attributes per file
+	64,		// attribute size
+	4096,	// file size
+	5		// repeat count
+};
+
+class LatencySamples {
+public:
+	LatencySamples(const char *name);
+	~LatencySamples();
+
+	void Start()
+		{ start = system_time(); }
+	void Stop()
+		{ Add(system_time() - start); }
+	void Add(bigtime_t);
+	int32 Count() const
+		{ return count; }
+
+	void Report(off_t bytes = 0);
+
+private:
+	static int Compare(const void *, const void *);
+
+	const char *name;
+	bigtime_t *samples;
+	int32 count;
+	int32 capacity;
+	bigtime_t total;
+	bigtime_t start;
+};
+
+
+LatencySamples::LatencySamples(const char *name)
+	:	name(name),
+		samples(NULL),
+		count(0),
+		capacity(0),
+		total(0),
+		start(0)
+{
+}
+
+
+LatencySamples::~LatencySamples()
+{
+	free(samples);
+}
+
+
+void
+LatencySamples::Add(bigtime_t sample)
+{
+	if (count == capacity) {
+		capacity = capacity ? capacity * 2 : 1024;
+		samples = (bigtime_t *)realloc(samples, capacity * sizeof(bigtime_t));
+	}
+	samples[count++] = sample;
+	total += sample;
+}
+
+
+int
+LatencySamples::Compare(const void *a, const void *b)
+{
+	bigtime_t first = *(const bigtime_t *)a;
+	bigtime_t second = *(const bigtime_t *)b;
+
+	return first < second ? -1 : (first > second ? 1 : 0);
+}
+
+
+void
+LatencySamples::Report(off_t bytes)
+{
+	if (!count) {
+		PRINT(("%s: no samples\n", name));
+		return;
+	}
+
+	qsort(samples, count, sizeof(bigtime_t), &LatencySamples::Compare);
+
+	PRINT(("%s: %ld ops in %Ld usec, %Ld ops/sec", name, count, total,
+		total ? (count * 1000000LL) / total : 0));
+	if (bytes && total)
+		PRINT((", %Ld KB/sec", (bytes * 1000000LL / 1024) / total));
+	PRINT(("\n    p50 %Ld, p90 %Ld, p99 %Ld, max %Ld usec\n",
+		samples[count / 2], samples[count * 9 / 10], samples[count * 99 / 100],
+		samples[count - 1]));
+}
+
+
+static status_t
+BuildBenchmarkTree(BDirectory *directory, const BenchmarkSettings &settings,
+	int32 level, int32 *fileCount)
+{
+	char *buffer = (char *)malloc(max_c(settings.fileSize,
+		settings.attributeSize));
+	if (!buffer)
+		return B_NO_MEMORY;
+
+	memset(buffer, 'x', max_c(settings.fileSize, settings.attributeSize));
+
+	status_t result = B_OK;
+	for (int32 index = 0; result == B_OK && index < settings.filesPerDirectory;
+			index++) {
+		char name[B_FILE_NAME_LENGTH];
+		sprintf(name, "file %ld", index);
+
+		BFile file;
+		result = directory->CreateFile(name, &file);
+		if (result != B_OK)
+			break;
+
+		file.Write(buffer, settings.fileSize);
+
+		BNodeInfo(&file).SetType(index & 1 ? "text/plain" : "image/jpeg");
+		for (int32 attr = 0; attr < settings.attributesPerFile; attr++) {
+			sprintf(name, "bench:attr%ld", attr);
+			file.WriteAttr(name, B_RAW_TYPE, 0, buffer, settings.attributeSize);
+		}
+		(*fileCount)++;
+	}
+	free(buffer);
+
+	if (level + 1 >= settings.depth)
+		return result;
+
+	for (int32 index = 0;
+			result == B_OK && index < settings.directoriesPerDirectory; index++) {
+		char name[B_FILE_NAME_LENGTH];
+		sprintf(name, "folder %ld", index);
+
+		BDirectory subdirectory;
+		result = directory->CreateDirectory(name, &subdirectory);
+		if (result == B_OK)
+			result = BuildBenchmarkTree(&subdirectory, settings, level + 1,
+				fileCount);
+	}
+
+	return result;
+}
+
+
+static status_t
+BuildAttributeBenchmarkDirectory(BDirectory *directory, int32 fileCount,
+	int32 attributeCount, size_t attributeSize)
+{
+	char *buffer = (char *)malloc(attributeSize);
+	if (!buffer)
+		return B_NO_MEMORY;
+
+	memset(buffer, 'x', attributeSize);
+
+	status_t result = B_OK;
+	for (int32 index = 0; result == B_OK && index < fileCount; index++) {
+		char name[B_FILE_NAME_LENGTH];
+		sprintf(name, "file %ld", index);
+
+		BFile file;
+		result = directory->CreateFile(name, &file);
+		if (result != B_OK)
+			break;
+
+		for (int32 attr = 0; attr < attributeCount; attr++) {
+			sprintf(name, "bench:attr%ld", attr);
+			file.WriteAttr(name, B_RAW_TYPE, 0, buffer, attributeSize);
+		}
+	}
+	free(buffer);
+
+	return result;
+}
+
+
+class BenchmarkPoseView : public BPoseView {
+public:
+	BenchmarkPoseView(Model *model, BRect rect, uint32 viewMode, sem_id done)
+		:	BPoseView(model, rect, viewMode),
+			done(done)
+		{}
+
+protected:
+	virtual void AddPosesCompleted()
+		{
+			BPoseView::AddPosesCompleted();
+			release_sem(done);
+		}
+
+private:
+	sem_id done;
+};
+
+class BenchmarkWindow : public BContainerWindow {
+public:
+	BenchmarkWindow(sem_id done)
+		:	BContainerWindow(NULL, kIsHidden),
+			done(done)
+		{}
+
+protected:
+	virtual BPoseView *NewPoseView(Model *model, BRect rect, uint32 viewMode)
+		{ return new BenchmarkPoseView(model, rect, viewMode, done); }
+
+private:
+	sem_id done;
+};
+
+
+static void
+LoadBenchmarkDirectory(const entry_ref *ref, LatencySamples *samples)
+{
+	// opens a hidden window on the directory and waits for its add poses
+	// task to finish, the same path a user opening the folder takes
+
+	Model *model = new Model(ref);
+	if (model->InitCheck() != B_OK) {
+		delete model;
+		return;
+	}
+
+	sem_id done = create_sem(0, "benchmark add poses");
+	if (done < B_OK) {
+		delete model;
+		return;
+	}
+
+	samples->Start();
+
+	BenchmarkWindow *window = new BenchmarkWindow(done);
+	if (window->Lock()) {
+		window->CreatePoseView(model);
+			// window adopts the model
+		window->Unlock();
+	}
+	window->PostMessage(kRestoreState);
+
+	status_t result = acquire_sem_etc(done, 1, B_RELATIVE_TIMEOUT, 60000000);
+	samples->Stop();
+
+	if (result != B_OK)
+		PRINT(("timed out loading %s\n", ref->name));
+
+	if (window->Lock())
+		window->Quit();
+
+	delete_sem(done);
+}
+
+
+static void
+CollectBenchmarkModels(const entry_ref *ref, BObjectList<Model> *models,
+	BObjectList<entry_ref> *directories)
+{
+	// builds the models of the whole hierarchy for the benchmarks that
+	// work on models, with the node metadata read in one pass like
+	// AddPosesTask does; not timed
+
+	BDirectory directory(ref);
+	if (directory.InitCheck() != B_OK)
+		return;
+
+	directories->AddItem(new entry_ref(*ref));
+	BObjectList<entry_ref> subdirectories(10, true);
+
+	for (;;) {
+		char entBuf[1024];
+		dirent *eptr = (dirent *)entBuf;
+
+		if (directory.GetNextDirents(eptr, 1024, 1) <= 0)
+			break;
+
+		if (strcmp(eptr->d_name, ".") == 0 || strcmp(eptr->d_name, "..") == 0)
+			continue;
+
+		node_ref dirNode;
+		node_ref itemNode;
+		dirNode.device = eptr->d_pdev;
+		dirNode.node = eptr->d_pino;
+		itemNode.device = eptr->d_dev;
+		itemNode.node = eptr->d_ino;
+
+		NodeMetadata metadata;
+		Model *model = new Model(&dirNode, &itemNode, eptr->d_name, true,
+			false, &metadata);
+		if (model->InitCheck() != B_OK) {
+			delete model;
+			continue;
+		}
+
+		// don't keep the nodes open, there are more of them than we can
+		// have file descriptors for
+		model->CloseNode();
+
+		if (model->IsDirectory())
+			subdirectories.AddItem(new entry_ref(*model->EntryRef()));
+
+		models->AddItem(model);
+	}
+
+	for (int32 index = 0; index < subdirectories.CountItems(); index++)
+		CollectBenchmarkModels(subdirectories.ItemAt(index), models,
+			directories);
+}
+
+
+static void
+RunContext(uint32 operation, TFSContext *context, BDirectory *target = NULL,
+	LatencySamples *samples = NULL)
+{
+	// runs a synchronous file operation without dialogs or status views;
+	// file contexts delete themselves when their operation is done, so
+	// <context> has to be allocated with new and is gone on return
+	context->SetInteractive(false);
+	context->DisableProgressInfo();
+
+	if (samples)
+		samples->Start();
+
+	switch (operation) {
+		case kCopySelectionTo:
+			context->CopyTo(*target, false);
+			break;
+		case kMoveSelectionTo:
+			context->MoveTo(*target, false);
+			break;
+		case kDuplicateSelection:
+			context->Duplicate(false);
+			break;
+		case kDelete:
+			context->Remove(false, false);
+			break;
+	}
+
+	if (samples)
+		samples->Stop();
+}
+
+
+static void
+RemoveScratch(const entry_ref &ref)
+{
+	RunContext(kDelete, new TFSContext(ref));
+}
+
+
+static void
+RemoveScratch(const BDirectory &directory)
+{
+	BEntry entry;
+	entry_ref ref;
+	directory.GetEntry(&entry);
+	entry.GetRef(&ref);
+	RemoveScratch(ref);
+}
+
+
+static int
+CompareBenchmarkModels(const Model *model1, const Model *model2)
+{
+	return model1->CompareFolderNamesFirst(model2);
+}
+
+
+static void
+ShuffleBenchmarkModels(BObjectList<Model> *models)
+{
+	for (int32 index = models->CountItems(); index > 1; index--) {
+		int32 other = rand() % index;
+		Model *model = models->SwapWithItem(index - 1, models->ItemAt(other));
+		models->SwapWithItem(other, model);
+	}
+}
+
+
+static status_t
+CreateBenchmarkTree(const BenchmarkSettings &settings, entry_ref *rootRef,
+	int32 *fileCount)
+{
+	// builds the synthetic hierarchy in a new folder of the temp directory
+	BPath path;
+	if (find_directory(B_COMMON_TEMP_DIRECTORY, &path, true) != B_OK)
+		return B_ERROR;
+
+	char name[B_FILE_NAME_LENGTH];
+	sprintf(name, "Tracker benchmark %Ld", system_time());
+
+	BDirectory temp(path.Path());
+	BDirectory root;
+	if (temp.CreateDirectory(name, &root) != B_OK)
+		return B_ERROR;
+
+	BEntry rootEntry;
+	root.GetEntry(&rootEntry);
+	rootEntry.GetRef(rootRef);
+
+	*fileCount = 0;
+	bigtime_t start = system_time();
+	if (BuildBenchmarkTree(&root, settings, 0, fileCount) != B_OK) {
+		PRINT(("failed to build the benchmark hierarchy\n"));
+		RemoveScratch(*rootRef);
+		return B_ERROR;
+	}
+	PRINT(("built %ld files in %Ld usec\n", *fileCount, system_time() - start));
+
+	return B_OK;
+}
+
+
+static status_t
+RunBenchmarksTask(void *)
+{
+	const BenchmarkSettings &settings = kDefaultBenchmarkSettings;
+
+	entry_ref rootRef;
+	int32 fileCount;
+	if (CreateBenchmarkTree(settings, &rootRef, &fileCount) != B_OK)
+		return B_ERROR;
+
+	BObjectList<Model> models(fileCount + 100, true);
+	BObjectList<entry_ref> directories(20, true);
+	CollectBenchmarkModels(&rootRef, &models, &directories);
+
+	// directory load
+
+	LatencySamples loadSamples("directory load (per folder)");
+	for (int32 run = 0; run < settings.repeatCount; run++) {
+		for (int32 index = 0; index < directories.CountItems(); index++)
+			LoadBenchmarkDirectory(directories.ItemAt(index), &loadSamples);
+	}
+	loadSamples.Report();
+	PRINT(("%ld entries in %ld folders\n", models.CountItems(),
+		directories.CountItems()));
+
+	// sort
+
+	BObjectList<Model> sortList(models.CountItems(), false);
+	for (int32 index = 0; index < models.CountItems(); index++)
+		sortList.AddItem(models.ItemAt(index));
+
+	LatencySamples sortSamples("sort (whole list)");
+	for (int32 run = 0; run < settings.repeatCount; run++) {
+		ShuffleBenchmarkModels(&sortList);
+		sortSamples.Start();
+		sortList.SortItems(&CompareBenchmarkModels);
+		sortSamples.Stop();
+	}
+	sortSamples.Report();
+
+	// filter, the way BPoseView::ShouldShowPose does it
+
+	LatencySamples filterSamples("filter (per model)");
+	int32 shown = 0;
+	for (int32 run = 0; run < settings.repeatCount; run++) {
+		for (int32 index = 0; index < models.CountItems(); index++) {
+			Model *model = models.ItemAt(index);
+			filterSamples.Start();
+			StatStruct stat;
+			model->StatBuf()->GetStat(&stat);
+			if (TrackerFilters().FilterModel(model))
+				shown++;
+			filterSamples.Stop();
+		}
+	}
+	filterSamples.Report();
+	PRINT(("%ld of %ld models shown\n", shown / settings.repeatCount,
+		models.CountItems()));
+
+	// icon cache lookups, first for an empty cache entry, then cached
+
+	LatencySamples coldIconSamples("icon cache lookup (cold)");
+	LatencySamples warmIconSamples("icon cache lookup (warm)");
+	for (int32 index = 0; index < models.CountItems(); index++) {
+		Model *model = models.ItemAt(index);
+		coldIconSamples.Start();
+		IconCache::sIconCache->Preload(model, kNormalIcon, B_MINI_ICON);
+		coldIconSamples.Stop();
+	}
+	for (int32 run = 0; run < settings.repeatCount; run++) {
+		for (int32 index = 0; index < models.CountItems(); index++) {
+			Model *model = models.ItemAt(index);
+			warmIconSamples.Start();
+			IconCache::sIconCache->Preload(model, kNormalIcon, B_MINI_ICON);
+			warmIconSamples.Stop();
+		}
+	}
+	coldIconSamples.Report();
+	warmIconSamples.Report();
+
+	// clipboard lookups, done for every pose added to a view
+
+	LatencySamples clipboardSamples("clipboard lookup (per model)");
+	for (int32 index = 0; index < models.CountItems(); index++) {
+		Model *model = models.ItemAt(index);
+		clipboardSamples.Start();
+		FSClipboardFindNodeMode(model, false);
+		clipboardSamples.Stop();
+	}
+	clipboardSamples.Report();
+
+	for (int32 index = 0; index < models.CountItems(); index++)
+		IconCache::sIconCache->Deleting(models.ItemAt(index));
+	sortList.MakeEmpty();
+	models.MakeEmpty();
+
+	// copy and move
+
+	off_t bytes = (off_t)fileCount * settings.fileSize;
+	LatencySamples copySamples("copy (whole hierarchy)");
+	LatencySamples verifiedCopySamples("verified copy (whole hierarchy)");
+	LatencySamples moveSamples("move (whole hierarchy)");
+	for (int32 run = 0; run < settings.repeatCount; run++) {
+		BDirectory copyTarget;
+		BDirectory verifiedCopyTarget;
+		BDirectory moveTarget;
+		sprintf(name, "%s copy %ld", rootRef.name, run);
+		if (temp.CreateDirectory(name, &copyTarget) != B_OK)
+			break;
+		sprintf(name, "%s verified copy %ld", rootRef.name, run);
+		if (temp.CreateDirectory(name, &verifiedCopyTarget) != B_OK)
+			break;
+		sprintf(name, "%s move %ld", rootRef.name, run);
+		if (temp.CreateDirectory(name, &moveTarget) != B_OK)
+			break;
+
+		RunContext(kCopySelectionTo, new TFSContext(rootRef), &copyTarget,
+			&copySamples);
+
+		TFSContext *verifiedCopyContext = new TFSContext(rootRef);
+		verifiedCopyContext->DoCopy(TFSContext::fVerifyData);
+		RunContext(kCopySelectionTo, verifiedCopyContext, &verifiedCopyTarget,
+			&verifiedCopySamples);
+
+		BEntry copyEntry(&copyTarget, rootRef.name);
+		entry_ref copyRef;
+		copyEntry.GetRef(&copyRef);
+
+		RunContext(kMoveSelectionTo, new TFSContext(copyRef), &moveTarget,
+			&moveSamples);
+
+		RemoveScratch(copyTarget);
+		RemoveScratch(verifiedCopyTarget);
+		RemoveScratch(moveTarget);
+	}
+	copySamples.Report(bytes * copySamples.Count());
+	verifiedCopySamples.Report(bytes * verifiedCopySamples.Count());
+	moveSamples.Report();
+
+	// attribute heavy copies, nodes with 0, 10 and 100 attributes
+
+	const int32 kAttributeCounts[] = { 0, 10, 100 };
+	for (uint32 count = 0;
+			count < sizeof(kAttributeCounts) / sizeof(kAttributeCounts[0]);
+			count++) {
+		int32 attributeCount = kAttributeCounts[count];
+
+		BDirectory source;
+		sprintf(name, "%s attributes %ld", rootRef.name, attributeCount);
+		if (temp.CreateDirectory(name, &source) != B_OK
+			|| BuildAttributeBenchmarkDirectory(&source,
+				settings.filesPerDirectory, attributeCount,
+				settings.attributeSize) != B_OK)
+			break;
+
+		BEntry sourceEntry;
+		entry_ref sourceRef;
+		source.GetEntry(&sourceEntry);
+		sourceEntry.GetRef(&sourceRef);
+
+		char sampleName[64];
+		sprintf(sampleName, "attribute copy (%ld files, %ld attributes each)",
+			settings.filesPerDirectory, attributeCount);
+		LatencySamples attributeSamples(sampleName);
+
+		for (int32 run = 0; run < settings.repeatCount; run++) {
+			BDirectory target;
+			sprintf(name, "%s copy %ld", sourceRef.name, run);
+			if (temp.CreateDirectory(name, &target) != B_OK)
+				break;
+
+			RunContext(kCopySelectionTo, new TFSContext(sourceRef), &target,
+				&attributeSamples);
+			RemoveScratch(target);
+		}
+		attributeSamples.Report((off_t)settings.filesPerDirectory
+			* attributeCount * settings.attributeSize * attributeSamples.Count());
+
+		RemoveScratch(sourceRef);
+	}
+
+	// duplicating into a crowded folder, every run adds a copy of each file
+	// so the unique names get longer to find
+
+	BDirectory duplicateDir;
+	sprintf(name, "%s duplicate", rootRef.name);
+	if (temp.CreateDirectory(name, &duplicateDir) == B_OK
+		&& BuildAttributeBenchmarkDirectory(&duplicateDir,
+			settings.filesPerDirectory, 0, 0) == B_OK) {
+		BObjectList<entry_ref> originals(settings.filesPerDirectory, true);
+		entry_ref ref;
+		while (duplicateDir.GetNextRef(&ref) == B_OK)
+			originals.AddItem(new entry_ref(ref));
+
+		LatencySamples duplicateSamples("duplicate (whole folder)");
+		for (int32 run = 0; run < settings.repeatCount; run++)
+			RunContext(kDuplicateSelection, new TFSContext(&originals), NULL,
+				&duplicateSamples);
+		duplicateSamples.Report();
+
+		RemoveScratch(duplicateDir);
+	}
+
+	RemoveScratch(rootRef);
+	return B_OK;
+}
+
+
+void
+RunBenchmarks()
+{
+	// the directory loads wait for windows to finish adding their poses,
+	// don't do that on a window thread
+	thread_id thread = spawn_thread(&RunBenchmarksTask, "Tracker benchmarks",
+		B_LOW_PRIORITY, NULL);
+	if (thread >= B_OK)
+		resume_thread(thread);
+}
+
+
+static status_t
+RunModelMemoryTestsTask(void *)
+{
+	// builds a Model for every entry of the benchmark hierarchy, the way
+	// a big query window would, and reports what they cost compared to
+	// what the old layout with a full stat, a BString type and strdup'ed
+	// signatures used to take
+	const size_t kMallocOverhead = 8;
+
+	entry_ref rootRef;
+	int32 fileCount;
+	if (CreateBenchmarkTree(kDefaultBenchmarkSettings, &rootRef, &fileCount)
+		!= B_OK)
+		return B_ERROR;
+
+	BObjectList<Model> models(fileCount + 100, true);
+	size_t oldStringBytes = 0;
+	bigtime_t start = system_time();
+
+	TNodeWalker walker(&rootRef);
+	entry_ref ref;
+	while (walker.GetNextRef(&ref) == B_OK) {
+		Model *model = new Model(&ref);
+		if (model->InitCheck() != B_OK) {
+			delete model;
+			continue;
+		}
+		// don't keep the nodes open, there are more of them than we can
+		// have file descriptors for
+		model->CloseNode();
+
+		oldStringBytes += strlen(model->MimeType()) + 1 + sizeof(int32)
+			+ kMallocOverhead;
+		if (model->PreferredAppSignature()[0])
+			oldStringBytes += strlen(model->PreferredAppSignature()) + 1
+				+ kMallocOverhead;
+		models.AddItem(model);
+	}
+
+	bigtime_t elapsed = system_time() - start;
+	int32 count = models.CountItems();
+
+	int32 live;
+	int32 allocated;
+	Model::GetAllocationStats(&live, &allocated);
+
+	int32 stringCount;
+	size_t stringBytes;
+	InternedStrings::GetStats(&stringCount, &stringBytes);
+
+	size_t oldModelBytes = count * (sizeof(Model) - sizeof(ModelStat)
+		+ sizeof(StatStruct) + kMallocOverhead) + oldStringBytes;
+	size_t newModelBytes = allocated * sizeof(Model) + stringBytes;
+
+	PRINT(("%ld models in %Ld usec, %Ld usec per model\n", count, elapsed,
+		count ? elapsed / count : 0));
+	PRINT(("%ld models in pool, %ld distinct strings, %ld bytes\n",
+		allocated, stringCount, stringBytes));
+	PRINT(("old layout %ld bytes, new layout %ld bytes\n", oldModelBytes,
+		newModelBytes));
+
+	models.MakeEmpty();
+	RemoveScratch(rootRef);
+	return B_OK;
+}
+
+
+void
+RunModelMemoryTests()
+{
+	thread_id thread = spawn_thread(&RunModelMemoryTestsTask,
+		"Tracker model memory test", B_LOW_PRIORITY, NULL);
+	if (thread >= B_OK)
+		resume_thread(thread);
+}
+
+#endif
@@ -34,6 +34,10 @@ All rights reserved.
 
 #if DEBUG
 void RunIconCacheTests();
+void RunModelMemoryTests();
+void RunBenchmarks();
 #else
 inline void RunIconCacheTests() {}
+inline void RunModelMemoryTests() {}
+inline void RunBenchmarks() {}
 #endif
@@ -93,6 +93,8 @@ public:
 		// used for sorting in PoseViews
 
 	void RecalculateText(const BPoseView *view);
+
+	WidgetAttributeText *AttributeText() const;
 	
 private:
 	BRect CalcRectCommon(BPoint poseLoc, const BColumn *, const BPoseView *, float width);
@@ -149,6 +151,12 @@ BTextWidget::SetActive(bool on)
 	fActive = on;
 }
 
+inline WidgetAttributeText *
+BTextWidget::AttributeText() const
+{
+	return fText;
+}
+
 
 inline void
 BTextWidget::Draw(BRect widgetRect, BRect widgetTextRect, float width,
@@ -56,6 +56,7 @@ All rights reserved.
 
 #include "BackgroundImage.h"
 #include "Bitmaps.h"
+#include "AppCapabilityIndex.h"
 #include "Attributes.h"
 #include "AutoLock.h"
 #include "AutoMounter.h"
@@ -67,6 +68,7 @@ All rights reserved.
 #include "FindPanel.h"
 #include "VolumeWindow.h"
 #include "PoseView.h"
+#include "PoseLocationWriter.h"
 #include "OpenWithWindow.h"
 #include "InfoWindow.h"
 #include "LanguageTheme.h"
@@ -200,6 +202,8 @@ HideVarDir()
 
 TTracker::TTracker()
 	:	BApplication(kTrackerSignature),
+		fAppCapabilityIndex(NULL),
+		fLocationWriter(NULL),
 		fSettingsWindow(NULL)
 {
 	// set the cwd to /boot/home, anything that's launched 
@@ -318,7 +322,17 @@ TTracker::Quit()
 	fTrashWatcher->Lock();
 	fTrashWatcher->Quit();
 
+	if (fAppCapabilityIndex) {
+		fAppCapabilityIndex->Lock();
+		fAppCapabilityIndex->Quit();
+		fAppCapabilityIndex = NULL;
+	}
+
 	WellKnowEntryList::Quit();
+
+	// all windows are gone, write out the pose locations they left behind
+	delete fLocationWriter;
+	fLocationWriter = NULL;
 	
 	delete gPreloader;
 	delete fTaskLoop;
@@ -373,6 +387,8 @@ TTracker::MessageReceived(BMessage *message)
 			//	context menu, this is where the message gets received.  Save
 			//	pose locations and forward this to the automounter
 			SaveAllPoseLocations();
+			if (fLocationWriter)
+				fLocationWriter->Flush();
 			fAutoMounter->PostMessage(message);
 			break;
 
@@ -1220,6 +1236,8 @@ TTracker::ReadyToRun()
 	
 	HideVarDir();
 
+	fLocationWriter = new PoseLocationWriter();
+
 	fTrashWatcher = new BTrashWatcher();
 	fTrashWatcher->Run();
 
@@ -1352,6 +1370,10 @@ TTracker::ReadyToRun()
 	// kick off building the mime type list for find panels, etc.
 	fMimeTypeList = new MimeTypeList();
 
+	// kick off indexing installed apps for the Open With menus
+	fAppCapabilityIndex = new AppCapabilityIndex();
+	fAppCapabilityIndex->Run();
+
 	if (!BootedInSafeMode())
 		// kick of transient query killer
 		DeleteTransientQueriesTask::StartUpTransientQueryCleaner();
@@ -1363,6 +1385,18 @@ TTracker::MimeTypes() const
 	return fMimeTypeList;
 }	
 
+AppCapabilityIndex *
+TTracker::AppCapabilities() const
+{
+	return fAppCapabilityIndex;
+}
+
+PoseLocationWriter *
+TTracker::LocationWriter() const
+{
+	return fLocationWriter;
+}
+
 void 
 TTracker::SelectChildInParentSoon(const entry_ref *parent,
 	const node_ref *child)
@@ -50,6 +50,7 @@ All rights reserved.
 
 namespace BPrivate {
 
+class AppCapabilityIndex;
 class AutoMounter;
 class BClipboardRefsWatcher;
 class BContainerWindow;
@@ -57,6 +58,7 @@ class BDeskWindow;
 class BInfoWindow;
 class BTrashWatcher;
 class BooleanValueSetting;
+class PoseLocationWriter;
 class ExtraAttributeLazyInstaller;
 class MimeTypeList;
 class Model;
@@ -94,6 +96,8 @@ public:
 	MimeTypeList *MimeTypes() const;
 		// list of mime types that have a description and do not have
 		// themselves as a preferred handler (case of applications)
+	AppCapabilityIndex *AppCapabilities() const;
+	PoseLocationWriter *LocationWriter() const;
 	
 	bool TrashFull() const;
 	bool IsTrashNode(const node_ref *) const;
@@ -217,6 +221,8 @@ private:
 	BDeskWindow *GetDeskWindow() const;
 
 	MimeTypeList *fMimeTypeList;	
+	AppCapabilityIndex *fAppCapabilityIndex;
+	PoseLocationWriter *fLocationWriter;
 	WindowList fWindowList;
 	BClipboardRefsWatcher *fClipboardRefsWatcher;
 	BTrashWatcher *fTrashWatcher;
@@ -32,7 +32,9 @@ names are registered trademarks or trademarks of their respective holders.
 All rights reserved.
 */
 
+#include <FindDirectory.h>
 #include <Message.h>
+#include <Path.h>
 #include <PropertyInfo.h>
 
 #include "Tracker.h"
@@ -40,11 +42,14 @@ All rights reserved.
 
 #define kPropertyTrash "Trash"
 #define kPropertyFolder "Folder"
+#define kPropertyTelemetry "Telemetry"
 
 #if 0
 
 doo Tracker delete Trash
 doo Tracker create Folder to '/boot/home/Desktop/hello'
+doo Tracker get Telemetry
+doo Tracker execute Telemetry
 
 ToDo:
 Create file: on a "Tracker" "File" "B_CREATE_PROPERTY" "name"
@@ -73,6 +78,16 @@ const property_info kTrackerPropertyList[] = {
 		{},
 		{}
 	},
+	{	kPropertyTelemetry,
+		{ B_GET_PROPERTY, B_EXECUTE_PROPERTY },
+		{ B_DIRECT_SPECIFIER },
+		"get Telemetry # counters of the running and the last finished file operations\n"
+		"execute Telemetry # appends them to a file in the log directory",
+		0,
+		{},
+		{},
+		{}
+	},
 	{NULL,
 		{},
 		{},
@@ -172,8 +187,27 @@ TTracker::HandleScriptingMessage(BMessage *message)
 
 
 bool
-TTracker::ExecuteProperty(BMessage *, int32 , const char *, BMessage *)
+TTracker::ExecuteProperty(BMessage *, int32 form, const char *property, BMessage *reply)
 {
+	if (strcmp(property, kPropertyTelemetry) == 0) {
+		if (form != B_DIRECT_SPECIFIER)
+			return false;
+
+		BPath path;
+		status_t error = find_directory(B_COMMON_LOG_DIRECTORY, &path, true);
+		if (error == B_OK)
+			error = path.Append("Tracker telemetry");
+		if (error == B_OK)
+			error = fs::gTelemetryLog().Dump(path.Path());
+		
+		if (error == B_OK)
+			reply->AddString("result", path.Path());
+		else
+			reply->AddInt32("error", error);
+
+		return true;
+	}
+	
 	return false;
 }
 
@@ -241,8 +275,18 @@ TTracker::CountProperty(BMessage *, int32, const char *, BMessage *)
 }
 
 bool
-TTracker::GetProperty(BMessage *, int32, const char *,	BMessage *)
+TTracker::GetProperty(BMessage *, int32 form, const char *property, BMessage *reply)
 {
+	if (strcmp(property, kPropertyTelemetry) == 0) {
+		if (form != B_DIRECT_SPECIFIER)
+			return false;
+
+		BMessage telemetry;
+		fs::gTelemetryLog().Archive(&telemetry);
+		reply->AddMessage("result", &telemetry);
+		return true;
+	}
+	
 	return false;		
 }
 
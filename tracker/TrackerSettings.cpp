@@ -141,6 +141,8 @@ TrackerSettings::LoadSettingsIfNeeded()
 	
 	Add(fWarnInWellKnownDirectories = new BooleanValueSetting("WarnInWellKnownDirectories", true));
 	
+	Add(fVerifyCopies = new BooleanValueSetting("VerifyCopies", false));
+	
 	Add(fIconThemeEnabled = new BooleanValueSetting("IconThemeEnabled", false));
 	Add(fCurrentIconTheme = new StringValueSetting("CurrentIconTheme", "", "", ""));
 	Add(fIconThemeLookupSequence = new StringValueSetting("IconThemeLookupSequence", "badecf", "", ""));
@@ -650,6 +652,18 @@ TrackerSettings::SetWarnInWellKnownDirectories(bool enabled)
 	fWarnInWellKnownDirectories->SetValue(enabled);
 }
 
+bool
+TrackerSettings::VerifyCopies()
+{
+	return fVerifyCopies->Value();
+}
+
+void
+TrackerSettings::SetVerifyCopies(bool enabled)
+{
+	fVerifyCopies->SetValue(enabled);
+}
+
 bool
 TrackerSettings::IconThemeEnabled()
 {
@@ -150,6 +150,9 @@ public:
 
 		bool					WarnInWellKnownDirectories();
 		void					SetWarnInWellKnownDirectories(bool);
+		
+		bool					VerifyCopies();
+		void					SetVerifyCopies(bool);
 
 		bool					IconThemeEnabled();
 		void					SetIconThemeEnabled(bool);
@@ -211,6 +214,8 @@ private:
 		ScalarValueSetting		*fUndoDepth;
 
 		BooleanValueSetting		*fWarnInWellKnownDirectories;
+		
+		BooleanValueSetting		*fVerifyCopies;
 
 		BooleanValueSetting		*fIconThemeEnabled;
 		StringValueSetting		*fCurrentIconTheme;
@@ -1,4 +1,5 @@
 #include <fs_attr.h>
+#include <string.h>
 #include "LanguageTheme.h"
 #include "ObjectList.h"
 #include "TFSContext.h"
@@ -9,6 +10,90 @@ namespace BPrivate {
 
 static UndoHistory gUndoHistory;
 
+// the entries of one kind of bulk operation grouped by the index of the
+// directory they have to go to, -1 stands for the directory that was
+// recorded for the whole context
+typedef map<int32, EntryList> entry_groups;
+
+struct bulk_actions {
+	entry_groups	trash;
+	entry_groups	move;
+	entry_groups	restore;
+	entry_groups	copy;
+	entry_groups	link;
+	entry_groups	rlink;
+};
+
+static void
+CollectEntries(UndoContext *context, bulk_actions &actions, bool redo)
+{
+	// entries are appended as the operation walks a directory, so the
+	// directory they are checked in only changes now and then
+	BDirectory dir;
+	int32 dirIndex = -1;
+	
+	int32 count = context->CountEntries();
+	for (int32 index = 0; index < count; index++) {
+		const UndoContext::entry &item = context->EntryAt(index);
+		
+		int32 from = redo ? item.origDirectory : item.newDirectory;
+		const char *name = context->NameAt(redo ? item.origName : item.newName);
+		entry_groups *groups = NULL;
+		int32 to = -1;
+		
+		switch (item.what) {
+			case kCreateLink:
+				if (redo) {
+					groups = &actions.link;
+					to = item.newDirectory;
+				} else
+					groups = &actions.trash;
+				break;
+			case kCreateRelativeLink:
+				if (redo) {
+					groups = &actions.rlink;
+					to = item.newDirectory;
+				} else
+					groups = &actions.trash;
+				break;
+			case kCopySelectionTo:
+				if (redo) {
+					groups = &actions.copy;
+					to = item.newDirectory;
+				} else
+					groups = &actions.trash;
+				break;
+			case kRestoreFromTrash:
+				groups = redo ? &actions.restore : &actions.trash;
+				break;
+			case kMoveSelectionTo:
+				groups = &actions.move;
+				to = redo ? item.newDirectory : item.origDirectory;
+				break;
+			case kDelete:
+				groups = redo ? &actions.trash : &actions.restore;
+				break;
+			default:
+				continue;
+		}
+		
+		const UndoContext::directory &source = context->DirectoryAt(from);
+		if (from != dirIndex) {
+			node_ref ref;
+			ref.device = source.device;
+			ref.node = source.node;
+			dir.SetTo(&ref);
+			dirIndex = from;
+		}
+		
+		if (dir.InitCheck() != B_OK || !dir.Contains(name))
+			continue;
+		
+		(*groups)[to].push_back(EntryRef(source.device, source.node, name));
+	}
+}
+
+
 UndoHistory::UndoHistory()
 	:	fList(20),
 		fOpen(10),
@@ -32,7 +117,7 @@ UndoHistory::CommitUndoContext(FSContext *context)
 	if (ourContext) {
 		fOpen.RemoveItem(ourContext);
 		
-		if (ourContext->CountActions() > 0)
+		if (ourContext->CountActions() > 0  ||  ourContext->CountEntries() > 0)
 			AddContext(ourContext);
 		else
 			delete ourContext;
@@ -55,6 +140,15 @@ UndoHistory::AddItemToContext(BMessage *message, FSContext *context)
 		ourContext->AddItem(message);
 }
 
+void
+UndoHistory::AddEntryToContext(uint32 what, const entry_ref &orig_ref,
+	const entry_ref &new_ref, FSContext *context)
+{
+	UndoContext *ourContext = FindContext(context);
+	if (ourContext)
+		ourContext->AddEntry(what, orig_ref, new_ref);
+}
+
 void
 UndoHistory::AddContext(UndoContext *context)
 {
@@ -95,7 +189,6 @@ UndoHistory::Undo(int32 count)
 	if (count <= 0)
 		return 0;
 	
-	TFSContext *tfscontext;
 	BMessage *message = NULL;
 	UndoContext *context = NULL;
 	int32 result;
@@ -107,16 +200,14 @@ UndoHistory::Undo(int32 count)
 		
 		context->RewindActions();
 		
-		BObjectList<entry_ref> trash_list(20);
-		BObjectList<entry_ref> move_list(20);
-		BObjectList<entry_ref> restore_list(20);
+		bulk_actions actions;
 		
 		while ((message = context->NextAction()) != NULL) {
-			entry_ref *new_ref = new entry_ref;
-			if (message->FindRef("new_ref", new_ref) != B_OK)
+			entry_ref new_ref;
+			if (message->FindRef("new_ref", &new_ref) != B_OK)
 				continue;
 			
-			BEntry entry(new_ref);
+			BEntry entry(&new_ref);
 			if (entry.InitCheck() != B_OK || !entry.Exists())
 				continue;
 					
@@ -126,16 +217,16 @@ UndoHistory::Undo(int32 count)
 				case kCreateRelativeLink:
 				case kCopySelectionTo:
 				case kRestoreFromTrash:
-					trash_list.AddItem(new_ref);
+					actions.trash[-1].push_back(new_ref);
 					break;
 				case kMoveSelectionTo:
-					move_list.AddItem(new_ref);
+					actions.move[-1].push_back(new_ref);
 					break;
 				case kDelete:
-					restore_list.AddItem(new_ref);
+					actions.restore[-1].push_back(new_ref);
 					break;
 				case kEditName: {
-					BEntry entry(new_ref);
+					BEntry entry(&new_ref);
 					if (entry.InitCheck() != B_OK || !entry.Exists())
 						break;
 					
@@ -159,7 +250,7 @@ UndoHistory::Undo(int32 count)
 					break;
 				}
 				case kEditItem: {
-					BEntry entry(new_ref);
+					BEntry entry(&new_ref);
 					if (entry.InitCheck() != B_OK || !entry.Exists())
 						break;
 					
@@ -171,7 +262,7 @@ UndoHistory::Undo(int32 count)
 						break;
 
 					// save redo data
-					BNode node(new_ref);
+					BNode node(&new_ref);
 					entry_ref orig_ref;
 					entry.GetRef(&orig_ref);
 					uint8 redo_buffer[B_FILE_NAME_LENGTH * 10];
@@ -213,24 +304,8 @@ UndoHistory::Undo(int32 count)
 			}
 		}
 		
-		if (trash_list.CountItems() > 0) {
-			tfscontext = new TFSContext(&trash_list);
-			IgnoreContext(tfscontext);
-			tfscontext->MoveToTrash(false);
-		}
-		
-		if (move_list.CountItems() > 0) {
-			tfscontext = new TFSContext(&move_list);
-			IgnoreContext(tfscontext);
-			BDirectory target_dir(context->SourceForContext());
-			tfscontext->MoveTo(target_dir, false);
-		}
-		
-		if (restore_list.CountItems() > 0) {
-			tfscontext = new TFSContext(&restore_list);
-			IgnoreContext(tfscontext);
-			tfscontext->RestoreFromTrash(false);
-		}
+		CollectEntries(context, actions, false);
+		RunBulkActions(context, actions, false);
 	}
 		
 	return result;
@@ -242,7 +317,6 @@ UndoHistory::Redo(int32 count, BContainerWindow */*source*/)
 	if (count <= 0)
 		return 0;
 	
-	TFSContext *tfscontext;
 	BMessage *message = NULL;
 	UndoContext *context = NULL;
 	int32 result;
@@ -254,20 +328,15 @@ UndoHistory::Redo(int32 count, BContainerWindow */*source*/)
 		
 		context->RewindActions();
 		
-		BObjectList<entry_ref> trash_list(20);
-		BObjectList<entry_ref> move_list(20);
-		BObjectList<entry_ref> restore_list(20);
-		BObjectList<entry_ref> copy_list(20);
-		BObjectList<entry_ref> link_list(20);
-		BObjectList<entry_ref> rlink_list(20);
+		bulk_actions actions;
 		
 		while ((message = context->NextAction()) != NULL) {
-			entry_ref *orig_ref = new entry_ref;
-			if (message->FindRef("orig_ref", orig_ref) != B_OK &&
-				message->FindRef("new_ref", orig_ref) != B_OK)
+			entry_ref orig_ref;
+			if (message->FindRef("orig_ref", &orig_ref) != B_OK &&
+				message->FindRef("new_ref", &orig_ref) != B_OK)
 				continue;
 			
-			BEntry entry(orig_ref);
+			BEntry entry(&orig_ref);
 			if (entry.InitCheck() != B_OK || !entry.Exists())
 				continue;
 					
@@ -277,7 +346,7 @@ UndoHistory::Redo(int32 count, BContainerWindow */*source*/)
 					if (message->FindString("name", &name) != B_OK)
 						name = NULL;
 					
-					BDirectory dir(orig_ref);
+					BDirectory dir(&orig_ref);
 					if (dir.InitCheck() != B_OK)
 						break;
 					
@@ -290,22 +359,22 @@ UndoHistory::Redo(int32 count, BContainerWindow */*source*/)
 					break;
 				}
 				case kCreateLink:
-					link_list.AddItem(orig_ref);
+					actions.link[-1].push_back(orig_ref);
 					break;
 				case kCreateRelativeLink:
-					rlink_list.AddItem(orig_ref);
+					actions.rlink[-1].push_back(orig_ref);
 					break;
 				case kCopySelectionTo:
-					copy_list.AddItem(orig_ref);
+					actions.copy[-1].push_back(orig_ref);
 					break;
 				case kRestoreFromTrash:
-					restore_list.AddItem(orig_ref);
+					actions.restore[-1].push_back(orig_ref);
 					break;
 				case kMoveSelectionTo:
-					move_list.AddItem(orig_ref);
+					actions.move[-1].push_back(orig_ref);
 					break;
 				case kDelete:
-					trash_list.AddItem(orig_ref);
+					actions.trash[-1].push_back(orig_ref);
 					break;
 				case kEditName: {
 					char *new_name;
@@ -349,46 +418,66 @@ UndoHistory::Redo(int32 count, BContainerWindow */*source*/)
 			}
 		}
 		
-		BDirectory target_dir(context->TargetForContext());
-		
-		if (trash_list.CountItems() > 0) {
-			tfscontext = new TFSContext(&trash_list);
-			IgnoreContext(tfscontext);
-			tfscontext->MoveToTrash(false);
-		}
-		
-		if (move_list.CountItems() > 0) {
-			tfscontext = new TFSContext(&move_list);
-			IgnoreContext(tfscontext);
-			tfscontext->MoveTo(target_dir, false);
-		}
-		
-		if (restore_list.CountItems() > 0) {
-			tfscontext = new TFSContext(&restore_list);
-			IgnoreContext(tfscontext);
-			tfscontext->RestoreFromTrash(false);
-		}
-		
-		if (copy_list.CountItems() > 0) {
-			tfscontext = new TFSContext(&copy_list);
-			IgnoreContext(tfscontext);
-			tfscontext->CopyTo(target_dir, false);
-		}
-		
-		if (link_list.CountItems() > 0) {
-			tfscontext = new TFSContext(&link_list);
-			IgnoreContext(tfscontext);
-			tfscontext->CreateLinkTo(target_dir, false, false);
-		}
+		CollectEntries(context, actions, true);
+		RunBulkActions(context, actions, true);
+	}
 		
-		if (rlink_list.CountItems() > 0) {
-			tfscontext = new TFSContext(&rlink_list);
+	return result;
+}
+
+void
+UndoHistory::RunBulkActions(UndoContext *context, bulk_actions &actions, bool redo)
+{
+	entry_groups *groups[] = { &actions.trash, &actions.move, &actions.restore,
+		&actions.copy, &actions.link, &actions.rlink };
+	
+	for (uint32 kind = 0; kind < sizeof(groups) / sizeof(groups[0]); kind++) {
+		for (entry_groups::iterator i = groups[kind]->begin();
+			i != groups[kind]->end(); ++i) {
+			if (i->second.empty())
+				continue;
+			
+			BDirectory target_dir;
+			if (i->first < 0)
+				target_dir.SetTo(redo ? context->TargetForContext()
+					: context->SourceForContext());
+			else {
+				node_ref ref;
+				ref.device = context->DirectoryAt(i->first).device;
+				ref.node = context->DirectoryAt(i->first).node;
+				target_dir.SetTo(&ref);
+			}
+			
+			if (groups[kind] != &actions.trash && groups[kind] != &actions.restore) {
+				if (target_dir.InitCheck() != B_OK)
+					continue;
+				
+				// entries copied or linked into a folder the same operation
+				// created go back there; if that folder was trashed or removed
+				// since, don't put them into the trash
+				BEntry target_entry;
+				if (i->first >= 0 && groups[kind] != &actions.move
+					&& (target_dir.GetEntry(&target_entry) != B_OK
+						|| FSContext::IsInTrash(target_entry)))
+					continue;
+			}
+			
+			TFSContext *tfscontext = new TFSContext(i->second);
 			IgnoreContext(tfscontext);
-			tfscontext->CreateLinkTo(target_dir, true, false);
+			
+			if (groups[kind] == &actions.trash)
+				tfscontext->MoveToTrash(false);
+			else if (groups[kind] == &actions.move)
+				tfscontext->MoveTo(target_dir, false);
+			else if (groups[kind] == &actions.restore)
+				tfscontext->RestoreFromTrash(false);
+			else if (groups[kind] == &actions.copy)
+				tfscontext->CopyTo(target_dir, false);
+			else
+				tfscontext->CreateLinkTo(target_dir,
+					groups[kind] == &actions.rlink, false);
 		}
 	}
-		
-	return result;
 }
 
 void
@@ -450,11 +539,69 @@ UndoHistory::CurrentContext(int32 offsetby)
 
 UndoContext::UndoContext(FSContext *context, int32 items)
 	:	fActions(BObjectList<BMessage>(items, true)),
+		fLastOrigDirectory(-1),
+		fLastNewDirectory(-1),
 		fContext(context),
 		fOverwrite(false)
 {
 }
 
+void
+UndoContext::AddEntry(uint32 what, const entry_ref &orig_ref,
+	const entry_ref &new_ref)
+{
+	entry item;
+	item.what = what;
+	item.origDirectory = DirectoryIndex(orig_ref.device, orig_ref.directory,
+		fLastOrigDirectory);
+	item.newDirectory = DirectoryIndex(new_ref.device, new_ref.directory,
+		fLastNewDirectory);
+	item.origName = AddName(orig_ref.name);
+	
+	// moves and trashing mostly keep the name
+	if (orig_ref.name != NULL  &&  new_ref.name != NULL
+		&&  strcmp(orig_ref.name, new_ref.name) == 0)
+		item.newName = item.origName;
+	else
+		item.newName = AddName(new_ref.name);
+	
+	fEntries.push_back(item);
+}
+
+int32
+UndoContext::DirectoryIndex(dev_t device, ino_t node, int32 &last)
+{
+	if (last >= 0  &&  fDirectories[last].device == device
+		&&  fDirectories[last].node == node)
+		return last;
+	
+	directory dir;
+	dir.device = device;
+	dir.node = node;
+	
+	map<directory, int32>::iterator i = fDirectoryIndex.find(dir);
+	if (i != fDirectoryIndex.end())
+		last = i->second;
+	else {
+		last = fDirectories.size();
+		fDirectories.push_back(dir);
+		fDirectoryIndex[dir] = last;
+	}
+	
+	return last;
+}
+
+int32
+UndoContext::AddName(const char *name)
+{
+	if (name == NULL)
+		name = "";
+	
+	int32 offset = fNames.size();
+	fNames.insert(fNames.end(), name, name + strlen(name) + 1);
+	return offset;
+}
+
 void
 UndoContext::SetSourceForContext(BDirectory &source)
 {
@@ -15,6 +15,7 @@ const uint32 kEditName = 'Ednm';
 
 class UndoContext;
 class UndoHistory;
+struct bulk_actions;
 extern UndoHistory gUndoHistory;
 
 class UndoHistory {
@@ -25,6 +26,8 @@ public:
 		void				CommitUndoContext(FSContext *context);
 		void				AddItem(BMessage *message); // add an action without context
 		void				AddItemToContext(BMessage *message, FSContext *context);
+		void				AddEntryToContext(uint32 what, const entry_ref &orig_ref,
+								const entry_ref &new_ref, FSContext *context);
 		void				SetSourceForContext(BDirectory &source, FSContext *context);
 		void				SetTargetForContext(BDirectory &target, FSContext *context);
 
@@ -34,6 +37,8 @@ public:
 private:
 		UndoContext			*FindContext(FSContext *context);
 		UndoContext			*CurrentContext(int32 offsetby);
+		void				RunBulkActions(UndoContext *context, bulk_actions &actions,
+								bool redo);
 		void				AddContext(UndoContext *context);
 		void				IgnoreContext(FSContext *context);
 		void				CheckSize();
@@ -63,8 +68,44 @@ public:
 		void				SetOverwrite(bool overwrite) { fOverwrite = overwrite; };
 		bool				Overwrite() { return fOverwrite; };
 
+		// plain moves, copies, links and trashing are kept in a packed form:
+		// the directories are stored once in a table and every entry only
+		// refers to them by index, so adding one doesn't allocate a message
+		struct directory {
+			dev_t			device;
+			ino_t			node;
+			
+			bool			operator<(const directory &other) const {
+								return device < other.device
+									|| (device == other.device  &&  node < other.node);
+							}
+		};
+		struct entry {
+			uint32			what;
+			int32			origDirectory;	// index into the directory table
+			int32			newDirectory;
+			int32			origName;		// offset into the name pool
+			int32			newName;
+		};
+
+		void				AddEntry(uint32 what, const entry_ref &orig_ref,
+								const entry_ref &new_ref);
+		int32				CountEntries() const { return fEntries.size(); };
+		const entry			&EntryAt(int32 index) const { return fEntries[index]; };
+		const directory		&DirectoryAt(int32 index) const { return fDirectories[index]; };
+		const char			*NameAt(int32 offset) const { return &fNames[offset]; };
+
 private:
+		int32				DirectoryIndex(dev_t device, ino_t node, int32 &last);
+		int32				AddName(const char *name);
+
 		BObjectList<BMessage>	fActions;
+		vector<directory>	fDirectories;
+		map<directory, int32>	fDirectoryIndex;
+		int32				fLastOrigDirectory;	// saves the lookup when all entries
+		int32				fLastNewDirectory;	// come from and go to the same place
+		vector<entry>		fEntries;
+		vector<char>		fNames;
 		int32				fPosition;
 		FSContext			*fContext;
 		BString				fMoveSource;
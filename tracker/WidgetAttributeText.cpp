@@ -49,6 +49,7 @@ All rights reserved.
 
 #include "Attributes.h"
 #include "FindPanel.h"
+#include "GlyphAdvanceCache.h"
 #include "LanguageTheme.h"
 #include "MimeTypes.h"
 #include "Model.h"
@@ -67,26 +68,24 @@ TruncStringBase(BString *result, const char *str, int32 length,
 	const View *view, float width, uint32 truncMode = B_TRUNCATE_MIDDLE)
 {
 	// we are using a template version of this call to make sure
-	// the right StringWidth gets picked up for BView x BPoseView
+	// the right font cache gets picked up for BView x BPoseView
 	// for max speed and flexibility
 
-	// a standard ellipsis inserting fitting algorithm
-	if (view->StringWidth(str, length) <= width)
-		*result = str;
-	else {
-		const char *srcstr[1];
-		char *results[1];
-
-		srcstr[0] = str;
-		results[0] = result->LockBuffer(length + 3);
+	// the fitting is done locally from cached glyph advances, the
+	// app_server only gets asked about characters we never measured
+	BFont font;
+	view->GetFont(&font);
+	return GlyphAdvanceCache::CacheFor(&font)->TruncString(result, str, length,
+		width, truncMode);
+}
 
-		BFont font;
-		view->GetFont(&font);
-	
-	    font.GetTruncatedStrings(srcstr, 1, truncMode, width, results);
-		result->UnlockBuffer();
-	}
-	return view->StringWidth(result->String(), result->Length());
+float
+TruncStringBase(BString *result, const char *str, int32 length,
+	const BPoseView *view, float width, uint32 truncMode = B_TRUNCATE_MIDDLE)
+{
+	// pose views share one font, skip the font lookup
+	return view->GlyphCache()->TruncString(result, str, length, width,
+		truncMode);
 }
 
 WidgetAttributeText *
@@ -134,6 +133,7 @@ WidgetAttributeText::WidgetAttributeText(const Model *model, const BColumn *colu
 	:
 		fModel(const_cast<Model *>(model)),
 		fColumn(column),
+		fFittedFor(NULL),
 		fDirty(true),
 		fValueIsDefined(false)
 {
@@ -145,21 +145,59 @@ WidgetAttributeText::~WidgetAttributeText()
 {
 }
 
+bool
+WidgetAttributeText::NeedsFitting(const BPoseView *view) const
+{
+	return fDirty || fColumn->Width() != fOldWidth || !fValueIsDefined
+		|| fFittedFor != view->GlyphCache();
+}
+
 const char *
 WidgetAttributeText::FittingText(const BPoseView *view)
 {
-	if (fDirty || fColumn->Width() != fOldWidth || !fValueIsDefined)
+	if (NeedsFitting(view))
 		CheckViewChanged(view);
 
 	ASSERT(!fDirty);
 	return fText.String();
 }
 
+void
+WidgetAttributeText::FitBatch(BObjectList<WidgetAttributeText> *texts,
+	const BPoseView *view)
+{
+	GlyphAdvanceCache *cache = view->GlyphCache();
+	int32 count = texts->CountItems();
+
+	// note every character the stale cells are going to measure and
+	// get them all from the app_server at once
+	for (int32 index = 0; index < count; index++) {
+		WidgetAttributeText *text = texts->ItemAt(index);
+		if (text->NeedsFitting(view))
+			text->PrefetchGlyphs(cache);
+	}
+	cache->FetchPending();
+
+	// now the fitting itself runs entirely from the cache
+	for (int32 index = 0; index < count; index++)
+		texts->ItemAt(index)->FittingText(view);
+}
+
+void
+WidgetAttributeText::PrefetchGlyphs(GlyphAdvanceCache *cache)
+{
+	// scalar values are formatted from digits and a few separators,
+	// the rest gets fetched during fitting
+	const char *kScalarCharacters = "0123456789 .,:-/";
+	cache->Prefetch(kScalarCharacters, (int32)strlen(kScalarCharacters));
+}
+
 bool
 WidgetAttributeText::CheckViewChanged(const BPoseView *view)
 {
 	BString newText;
 	FitValue(&newText, view);	
+	fFittedFor = view->GlyphCache();
 
 	if (newText == fText)
 		return false;
@@ -535,6 +573,15 @@ StringAttributeText::FitValue(BString *result, const BPoseView *view)
 	fDirty = false;
 }
 
+void
+StringAttributeText::PrefetchGlyphs(GlyphAdvanceCache *cache)
+{
+	if (fValueDirty)
+		ReadValue(&fFullValueText);
+
+	cache->Prefetch(fFullValueText.String(), fFullValueText.Length());
+}
+
 float
 StringAttributeText::PreferredWidth(const BPoseView *pose) const
 {
@@ -1176,6 +1223,16 @@ GenericAttributeText::ReadValue()
 	}
 }
 
+void
+GenericAttributeText::PrefetchGlyphs(GlyphAdvanceCache *cache)
+{
+	if (fValueDirty)
+		ReadValue();
+
+	WidgetAttributeText::PrefetchGlyphs(cache);
+	cache->Prefetch(fFullValueText.String(), fFullValueText.Length());
+}
+
 void
 GenericAttributeText::FitValue(BString *result, const BPoseView *view)
 {
@@ -37,6 +37,7 @@ All rights reserved.
 
 #include <String.h>
 
+#include "ObjectList.h"
 #include "Tracker.h"
 #include "TrackerSettings.h"
 
@@ -45,6 +46,7 @@ namespace BPrivate {
 class Model;
 class BPoseView;
 class BColumn;
+class GlyphAdvanceCache;
 
 // Tracker-only type for truncating the size string
 // (Used in InfoWindow.cpp)
@@ -69,6 +71,13 @@ public:
 
 	const char *FittingText(const BPoseView *);
 		// returns text, recalculating if not yet calculated
+	bool NeedsFitting(const BPoseView *) const;
+		// true if FittingText would have to recalculate the text
+
+	static void FitBatch(BObjectList<WidgetAttributeText> *,
+		const BPoseView *);
+		// fits a batch of cells, such as the visible part of a column,
+		// fetching all the missing glyph advances in one server call
 	
 	virtual int Compare(WidgetAttributeText &, BPoseView *view) = 0;
 		// override to define a compare of two different attributes for
@@ -120,9 +129,13 @@ protected:
 	virtual void FitValue(BString *result, const BPoseView *) = 0;
 		// override FitValue to do a specific text fitting for a given
 		// attribute
+	virtual void PrefetchGlyphs(GlyphAdvanceCache *);
+		// note the characters FitValue is about to measure
 		
 	mutable Model *fModel;
 	const BColumn *fColumn;
+	GlyphAdvanceCache *fFittedFor;
+		// font the text was last fitted with
 	float fOldWidth;			// ToDo: make these int32 only
 	float fTruncatedWidth;
 	bool fDirty;
@@ -156,6 +169,7 @@ protected:
 		{ return false; }
 
 	virtual void FitValue(BString *result, const BPoseView *);
+	virtual void PrefetchGlyphs(GlyphAdvanceCache *);
 	virtual void ReadValue(BString *result) = 0;
 
 	virtual int Compare(WidgetAttributeText &, BPoseView *view);
@@ -220,6 +234,7 @@ private:
 	virtual bool CommitEditedTextFlavor(BTextView *);
 
 	virtual void FitValue(BString *result, const BPoseView *);
+	virtual void PrefetchGlyphs(GlyphAdvanceCache *);
 	virtual void ReadValue();
 	
 	// ToDo: